@@ -11,6 +11,7 @@
  */
 #include <rocky/vsg/Application.h>
 #include <rocky/vsg/engine/TerrainEngine.h>
+#include <rocky/vsg/engine/TerrainTileAtlas.h>
 #include <rocky/Memory.h>
 #include <vsg/core/Allocator.h>
 #include "helpers.h"
@@ -26,6 +27,7 @@ namespace
     Timings events(frame_count);
     Timings update(frame_count);
     Timings record(frame_count);
+    Timings terrain(frame_count);
     int frame_num = 0;
     char buf[256];
     float get_timings(void* data, int index) {
@@ -48,6 +50,7 @@ auto Demo_Stats = [](Application& app)
     events[f] = app.stats.events;
     update[f] = app.stats.update;
     record[f] = app.stats.record;
+    terrain[f] = app.mapNode->terrain->recordTime();
 
     const int over = 60;
 
@@ -76,6 +79,9 @@ auto Demo_Stats = [](Application& app)
         sprintf(buf, u8"%lld \x00B5s", average(&record, over, f));
         ImGuiLTable::PlotLines("Record", get_timings, &record, frame_count, f, buf, 0.0f, 10.0f);
 
+        sprintf(buf, u8"%lld \x00B5s", average(&terrain, over, f));
+        ImGuiLTable::PlotLines("Terrain record", get_timings, &terrain, frame_count, f, buf, 0.0f, 10.0f);
+
         ImGuiLTable::End();
     }
 
@@ -115,7 +121,20 @@ auto Demo_Stats = [](Application& app)
     {
         auto& engine = app.mapNode->terrain->engine;
         ImGuiLTable::Text("Resident tiles", std::to_string(engine->tiles.size()).c_str());
+        ImGuiLTable::Text("Triangles drawn", std::to_string(app.mapNode->terrain->trianglesDrawn()).c_str());
+        ImGuiLTable::Text("Resident memory", "%.1lf MB", (double)engine->tiles.residentBytes() / 1048576.0);
         ImGuiLTable::Text("Geometry pool cache", std::to_string(engine->geometryPool.size()).c_str());
+        auto& uploader = app.instance.runtime().uploader;
+        ImGuiLTable::Text("Uploads", "%.1lf KB / frame", (double)uploader->bytesUploaded() / 1024.0);
+        ImGuiLTable::Text("Upload lock wait", u8"%lld \x00B5s", (long long)uploader->lockWaitTime().count());
+        ImGuiLTable::Text("Upload copy", u8"%lld \x00B5s", (long long)uploader->copyTime().count());
+        if (auto& atlas = engine->stateFactory.atlas)
+        {
+            ImGuiLTable::Text("Atlas tiles", std::to_string(atlas->size()).c_str());
+            ImGuiLTable::Text("Instanced tiles drawn", std::to_string(atlas->tilesDrawn()).c_str());
+            ImGuiLTable::Text("Instanced draw calls", std::to_string(atlas->drawCalls()).c_str());
+            ImGuiLTable::Text("Upload backlog", std::to_string(atlas->backlog()).c_str());
+        }
         ImGuiLTable::End();
     }
 
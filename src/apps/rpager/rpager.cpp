@@ -0,0 +1,201 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+
+/**
+* RPAGER flies a camera along a scripted path over a map and reports how
+* the terrain engine pages tiles in and out, frame by frame, as JSON.
+* It needs no window or GPU, so it can run as a performance regression
+* check for the terrain engine.
+*
+* rpager [--map file.json | --earthfile file.earth] [--terrain settings.json]
+*        [--path path.json] [--out report.json]
+*
+* A path file is a JSON array of waypoints:
+*   [ { "time": 0, "lat": 0, "lon": 0, "alt": 1e7, "heading": 0, "pitch": -90 }, ... ]
+*/
+
+#include <rocky/Instance.h>
+#include <rocky/Map.h>
+#include <rocky/ImageLayer.h>
+#include <rocky/ElevationLayer.h>
+#include <rocky/Utils.h>
+#include <rocky/contrib/EarthFileImporter.h>
+#include <rocky/vsg/engine/TerrainPagingSimulator.h>
+
+#define ROCKY_EXPOSE_JSON_FUNCTIONS
+#include <rocky/json.h>
+
+#include <iostream>
+
+using namespace ROCKY_NAMESPACE;
+
+int usage(const char* msg)
+{
+    std::cout << msg << std::endl;
+    return -1;
+}
+
+namespace
+{
+    //! Procedural imagery, so a run needs no network or local data.
+    struct SyntheticImageLayer : public Inherit<ImageLayer, SyntheticImageLayer>
+    {
+        SyntheticImageLayer() {
+            setProfile(Profile::GLOBAL_GEODETIC);
+        }
+
+        Result<GeoImage> createImageImplementation(const TileKey& key, const IOOptions& io) const override
+        {
+            auto image = Image::create(Image::R8G8B8A8_UNORM, 256, 256);
+            auto ptr = image->data<unsigned char>();
+            for (unsigned t = 0; t < 256; ++t)
+            {
+                for (unsigned s = 0; s < 256; ++s, ptr += 4)
+                {
+                    ptr[0] = (unsigned char)s;
+                    ptr[1] = (unsigned char)t;
+                    ptr[2] = (unsigned char)(key.levelOfDetail() * 12);
+                    ptr[3] = 255;
+                }
+            }
+            return GeoImage(image, key.extent());
+        }
+    };
+
+    //! Procedural rolling hills.
+    struct SyntheticElevationLayer : public Inherit<ElevationLayer, SyntheticElevationLayer>
+    {
+        SyntheticElevationLayer() {
+            setProfile(Profile::GLOBAL_GEODETIC);
+        }
+
+        Result<GeoHeightfield> createHeightfieldImplementation(const TileKey& key, const IOOptions& io) const override
+        {
+            auto hf = Heightfield::create(257, 257);
+            auto& ex = key.extent();
+            for (unsigned r = 0; r < hf->height(); ++r)
+            {
+                for (unsigned c = 0; c < hf->width(); ++c)
+                {
+                    double lon = ex.xmin() + ex.width() * (double)c / 256.0;
+                    double lat = ex.ymin() + ex.height() * (double)r / 256.0;
+                    hf->heightAt(c, r) = (float)(2000.0 * sin(deg2rad(lon) * 7.0) * cos(deg2rad(lat) * 5.0));
+                }
+            }
+            return GeoHeightfield(hf, ex);
+        }
+    };
+
+    //! Descend from orbit to a few kilometers, look toward the horizon, then fly along it.
+    std::vector<TerrainPagingSimulator::Waypoint> defaultPath()
+    {
+        return {
+            { 0.0, -77.0, 38.9, 1.5e7, 0.0, -90.0 },
+            { 10.0, -77.0, 38.9, 5.0e3, 0.0, -90.0 },
+            { 15.0, -77.0, 38.9, 5.0e3, 45.0, -20.0 },
+            { 30.0, -76.0, 39.6, 5.0e3, 45.0, -20.0 }
+        };
+    }
+
+    bool readPath(const std::string& filename, std::vector<TerrainPagingSimulator::Waypoint>& path)
+    {
+        std::string input;
+        if (!util::readFromFile(input, filename))
+            return false;
+
+        auto j = parse_json(input);
+        if (!j.is_array())
+            return false;
+
+        for (auto& item : j)
+        {
+            TerrainPagingSimulator::Waypoint wp;
+            get_to(item, "time", wp.time);
+            get_to(item, "lon", wp.longitude);
+            get_to(item, "lat", wp.latitude);
+            get_to(item, "alt", wp.altitude);
+            get_to(item, "heading", wp.heading);
+            get_to(item, "pitch", wp.pitch);
+            path.push_back(wp);
+        }
+        return !path.empty();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string mapfile, earthfile, terrainfile, pathfile, outfile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "--help") return usage(argv[0]);
+        else if (arg == "--map" && hasValue) mapfile = argv[++i];
+        else if (arg == "--earthfile" && hasValue) earthfile = argv[++i];
+        else if (arg == "--terrain" && hasValue) terrainfile = argv[++i];
+        else if (arg == "--path" && hasValue) pathfile = argv[++i];
+        else if (arg == "--out" && hasValue) outfile = argv[++i];
+        else return usage(("Unrecognized argument: " + arg).c_str());
+    }
+
+    Instance instance;
+    auto map = Map::create(instance);
+
+    if (!mapfile.empty())
+    {
+        JSON json;
+        if (!util::readFromFile(json, mapfile))
+            return usage(("Failed to read map from \"" + mapfile + "\"").c_str());
+        map->from_json(json);
+    }
+    else if (!earthfile.empty())
+    {
+        EarthFileImporter importer;
+        auto result = importer.read(earthfile, instance.ioOptions());
+        if (result.status.failed())
+            return usage(("Failed to read earth file - " + result.status.message).c_str());
+        map->from_json(result.value);
+    }
+    else
+    {
+        map->layers().add(SyntheticImageLayer::create());
+        map->layers().add(SyntheticElevationLayer::create());
+    }
+
+    JSON terrainConf;
+    if (!terrainfile.empty() && !util::readFromFile(terrainConf, terrainfile))
+        return usage(("Failed to read terrain settings from \"" + terrainfile + "\"").c_str());
+    TerrainSettings settings(terrainConf);
+
+    auto path = defaultPath();
+    if (!pathfile.empty())
+    {
+        path.clear();
+        if (!readPath(pathfile, path))
+            return usage(("Failed to read a camera path from \"" + pathfile + "\"").c_str());
+    }
+
+    TerrainPagingSimulator simulator(map, settings);
+    auto report = simulator.run(path, instance.ioOptions());
+
+    Log()->info(
+        std::to_string(report.frames.size()) + " frames; " +
+        (report.converged ? "settled " + std::to_string(report.framesToConverge) + " frames after the path" : "did not settle") +
+        "; peak tiles = " + std::to_string(report.peakTilesResident) +
+        " (" + std::to_string(report.peakResidentBytes / 1048576) + " MB)" +
+        "; tiles traversed = " + std::to_string(report.totalTilesTraversed) +
+        "; blurry tile-frames = " + std::to_string(report.totalBlurryTileFrames) +
+        "; loaded " + std::to_string(report.totalBytesLoaded) + " bytes in " + std::to_string(report.totalLoads) + " loads");
+
+    auto output = report.to_json();
+    if (outfile.empty())
+        std::cout << json_pretty(output) << std::endl;
+    else if (!util::writeToFile(json_pretty(output), outfile))
+        return usage(("Failed to write report to \"" + outfile + "\"").c_str());
+
+    return report.converged ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "CameraPredictor.h"
+
+using namespace ROCKY_NAMESPACE;
+
+void
+CameraPredictor::update(const glm::dvec3& eye, double seconds)
+{
+    double dt = seconds - _time;
+
+    // several samples in one frame (e.g. more than one pass over the same view)
+    if (_samples > 0 && dt == 0.0)
+        return;
+
+    if (_samples > 0 && (dt < 0.0 || dt > maxInterval))
+        reset();
+
+    if (_samples > 0)
+    {
+        glm::dvec3 v = (eye - _eye) / dt;
+        _velocity = _samples == 1 ? v : _velocity + (v - _velocity) * smoothing;
+    }
+
+    _eye = eye;
+    _time = seconds;
+    ++_samples;
+}
+
+void
+CameraPredictor::reset()
+{
+    _eye = { 0, 0, 0 };
+    _velocity = { 0, 0, 0 };
+    _time = 0.0;
+    _samples = 0;
+}
+
+glm::dvec3
+CameraPredictor::displacement(double seconds, double maxDistance) const
+{
+    if (!valid() || seconds <= 0.0)
+        return { 0, 0, 0 };
+
+    glm::dvec3 d = _velocity * seconds;
+    double len = glm::length(d);
+    if (len > maxDistance)
+        d *= maxDistance / len;
+
+    return d;
+}
@@ -0,0 +1,64 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/Common.h>
+#include <rocky/Math.h>
+
+namespace ROCKY_NAMESPACE
+{
+    /**
+     * Extrapolates the motion of a camera from the eye positions of
+     * recent frames, so that data the camera is about to need can be
+     * requested ahead of time.
+     *
+     * Motion along the view direction (zooming) is part of the eye's
+     * velocity like any other motion.
+     */
+    class ROCKY_EXPORT CameraPredictor
+    {
+    public:
+        //! Weight (0..1] of the newest frame's velocity in the running
+        //! estimate. Lower values smooth out jittery motion.
+        double smoothing = 0.5;
+
+        //! Longest time between two samples, in seconds, that still counts
+        //! as continuous motion. Anything longer starts the history over.
+        double maxInterval = 0.5;
+
+    public:
+        //! Records the eye position at a time.
+        //! @param eye Eye position in world coordinates
+        //! @param seconds Time of the sample, in seconds
+        void update(const glm::dvec3& eye, double seconds);
+
+        //! Forgets all history.
+        void reset();
+
+        //! Whether there is enough history to predict anything
+        bool valid() const {
+            return _samples >= 2;
+        }
+
+        //! Estimated velocity of the eye, in world units per second
+        const glm::dvec3& velocity() const {
+            return _velocity;
+        }
+
+        //! Expected motion of the eye over a span of time.
+        //! @param seconds How far ahead to look
+        //! @param maxDistance Limit on the length of the result, since a
+        //!    camera rarely keeps going in a straight line for long
+        //! @return Displacement in world coordinates; zero if not valid()
+        glm::dvec3 displacement(double seconds, double maxDistance = DBL_MAX) const;
+
+    private:
+        glm::dvec3 _eye = { 0, 0, 0 };
+        glm::dvec3 _velocity = { 0, 0, 0 };
+        double _time = 0.0;
+        unsigned _samples = 0;
+    };
+}
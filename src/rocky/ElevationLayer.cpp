@@ -7,9 +7,12 @@
 #include "Geoid.h"
 #include "Heightfield.h"
 #include "Metrics.h"
+#include "TerrainRGB.h"
 #include "json.h"
 
 #include <cinttypes>
+#include <algorithm>
+#include <vector>
 
 using namespace ROCKY_NAMESPACE;
 using namespace ROCKY_NAMESPACE::util;
@@ -73,6 +76,16 @@ ElevationLayer::construct(const JSON& conf)
             _encoding = Encoding::SingleChannel;
         else if (encoding == "mapboxrgb")
             _encoding = Encoding::MapboxRGB;
+        else if (encoding == "terrarium")
+            _encoding = Encoding::Terrarium;
+    }
+
+    std::string cacheEncoding;
+    if (get_to(j, "cache_encoding", cacheEncoding))
+    {
+        auto format = Heightfield::encoding(cacheEncoding);
+        if (format != Image::UNDEFINED)
+            _cacheEncoding = format;
     }
 
     // a small L2 cache will help with things like normal map creation
@@ -105,6 +118,15 @@ ElevationLayer::to_json() const
         set(j, "encoding", "single_channel");
     else if (_encoding.has_value(Encoding::MapboxRGB))
         set(j, "encoding", "mapboxrgb");
+    else if (_encoding.has_value(Encoding::Terrarium))
+        set(j, "encoding", "terrarium");
+
+    if (_cacheEncoding.has_value(Image::R32_SFLOAT))
+        set(j, "cache_encoding", "float");
+    else if (_cacheEncoding.has_value(Image::R16_UNORM))
+        set(j, "cache_encoding", "r16");
+    else if (_cacheEncoding.has_value(Image::R16_SFLOAT))
+        set(j, "cache_encoding", "half");
 
     return j.dump();
 }
@@ -119,6 +141,31 @@ ElevationLayer::setVisible(bool value)
         close();
 }
 
+void
+ElevationLayer::dirty()
+{
+    super::dirty();
+
+    // cached heightfields are stale now
+    _L2cache.setCapacity(_l2cachesize.value());
+}
+
+void
+ElevationLayer::dirty(const GeoExtent& extent)
+{
+    super::dirty(extent);
+
+    // the cache doesn't track extents, so it all goes
+    _L2cache.setCapacity(_l2cachesize.value());
+}
+
+void ElevationLayer::setCacheEncoding(Image::PixelFormat value) {
+    if (Heightfield::isHeightfieldFormat(value))
+        _cacheEncoding = value, _L2cache.setCapacity(_l2cachesize.value());
+}
+const optional<Image::PixelFormat>& ElevationLayer::cacheEncoding() const {
+    return _cacheEncoding;
+}
 void ElevationLayer::setEncoding(ElevationLayer::Encoding value) {
     _encoding = value;
 }
@@ -349,7 +396,33 @@ ElevationLayer::createHeightfield(
         return Result(GeoHeightfield::INVALID);
     }
 
-    return createHeightfieldInKeyProfile(key, io);
+    // The memory cache holds heightfields in the cache encoding. Full-precision
+    // entries are shared with the caller as they are; compact ones decode
+    // into a new copy.
+    auto cached = _L2cache.get(key);
+    if (cached.status.ok() && cached.value.valid())
+    {
+        if (cached.value.heightfield()->pixelFormat() == Image::R32_SFLOAT)
+            return cached.value;
+        else
+            return GeoHeightfield(cached.value.heightfield()->decode(), cached.value.extent());
+    }
+
+    auto result = createHeightfieldInKeyProfile(key, io);
+
+    if (result.status.ok() && result.value.valid())
+    {
+        if (result.value.heightfield()->pixelFormat() != Image::R32_SFLOAT)
+            result.value = GeoHeightfield(result.value.heightfield()->decode(), result.value.extent());
+
+        auto format = _cacheEncoding.value();
+        if (format == Image::R32_SFLOAT)
+            _L2cache.put(key, result.value);
+        else
+            _L2cache.put(key, result.value.encode(format));
+    }
+
+    return result;
 }
 
 Result<GeoHeightfield>
@@ -399,6 +472,12 @@ ElevationLayer::createHeightfieldInKeyProfile(
     // heightfield from scratch...not from a cache.
     hf = result.heightfield();
 
+    // the rest of the pipeline works on full precision heights
+    if (hf && hf->pixelFormat() != Image::R32_SFLOAT)
+    {
+        hf = hf->decode();
+    }
+
     // validate it to make sure it's legal.
     if (hf && !validateHeightfield(hf.get()))
     {
@@ -479,18 +558,27 @@ namespace
             double lonInterval = geodeticExtent.width() / (double)(numCols - 1);
             double latInterval = geodeticExtent.height() / (double)(numRows - 1);
 
+            // gather the invalid posts and query the geoid for all of them at once
+            std::vector<glm::dvec3> points;
+            std::vector<float*> targets;
             for (unsigned r = 0; r < numRows; ++r)
             {
                 double lat = latMin + latInterval * (double)r;
                 for (unsigned c = 0; c < numCols; ++c)
                 {
-                    double lon = lonMin + lonInterval * (double)c;
-                    if (grid->heightAt(c, r) == invalidValue)
+                    float& height = grid->heightAt(c, r);
+                    if (height == invalidValue)
                     {
-                        grid->heightAt(c, r) = geoid->getHeight(lat, lon);
+                        points.emplace_back(lonMin + lonInterval * (double)c, lat, 0.0);
+                        targets.push_back(&height);
                     }
                 }
             }
+
+            std::vector<float> heights(points.size());
+            geoid->getHeights(points.data(), points.size(), heights.data());
+            for (std::size_t i = 0; i < targets.size(); ++i)
+                *targets[i] = heights[i];
         }
         else
         {
@@ -633,10 +721,11 @@ ElevationLayerVector::populateHeightfield(
     // Sample the layers into our target.
     unsigned numColumns = hf->width();
     unsigned numRows = hf->height();
-    double   xmin = key.extent().xMin();
-    double   ymin = key.extent().yMin();
-    double   dx = key.extent().width() / (double)(numColumns - 1);
-    double   dy = key.extent().height() / (double)(numRows - 1);
+    Box      keyBounds = key.bounds();
+    double   xmin = keyBounds.xmin;
+    double   ymin = keyBounds.ymin;
+    double   dx = keyBounds.width() / (double)(numColumns - 1);
+    double   dy = keyBounds.height() / (double)(numRows - 1);
 
     auto keySRS = keyToUse.profile().srs();
 
@@ -876,14 +965,278 @@ ElevationLayerVector::populateHeightfield(
     return realData;
 }
 
+namespace
+{
+    // Samples a heightfield at many pixel locations. Bilinear sampling of float data
+    // takes a tight path that skips the per-sample interpolation switch; samples
+    // touching NO_DATA_VALUE and other cases defer to Heightfield::heightAtPixel.
+    void samplePixels(
+        const Heightfield* hf,
+        const double* px, const double* py,
+        float* out, std::size_t count,
+        Image::Interpolation interpolation)
+    {
+        if (hf->pixelFormat() != Image::R32_SFLOAT || interpolation != Image::BILINEAR)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = hf->heightAtPixel(px[i], py[i], interpolation);
+            return;
+        }
+
+        const float* grid = hf->data<float>();
+        const unsigned w = hf->width(), h = hf->height();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            unsigned c0 = (unsigned)px[i], r0 = (unsigned)py[i];
+            unsigned c1 = std::min(c0 + 1, w - 1), r1 = std::min(r0 + 1, h - 1);
+            float fx = (float)(px[i] - (double)c0), fy = (float)(py[i] - (double)r0);
+
+            float ll = grid[r0 * w + c0], lr = grid[r0 * w + c1];
+            float ul = grid[r1 * w + c0], ur = grid[r1 * w + c1];
+
+            if (ll == NO_DATA_VALUE || lr == NO_DATA_VALUE || ul == NO_DATA_VALUE || ur == NO_DATA_VALUE)
+            {
+                out[i] = hf->heightAtPixel(px[i], py[i], interpolation);
+            }
+            else
+            {
+                float bottom = ll + (lr - ll) * fx;
+                float top = ul + (ur - ul) * fx;
+                out[i] = bottom + (top - bottom) * fy;
+            }
+        }
+    }
+
+    // Samples one layer at the points whose height is still missing (or, for an
+    // offset layer, the points that already have one). Returns the number of
+    // heights written.
+    std::size_t sampleLayer(
+        const ElevationLayer* layer,
+        const glm::dvec3* points,
+        std::size_t count,
+        const SRS& srs,
+        float* out_heights,
+        unsigned lod,
+        Image::Interpolation interpolation,
+        const IOOptions& io,
+        jobs::jobpool* pool)
+    {
+        const Profile& profile = layer->profile();
+        if (!profile.valid() || lod < layer->minLevel())
+            return 0;
+
+        bool isOffset = layer->offset() == true;
+
+        // collect the points this layer should sample and move them into its SRS:
+        std::vector<std::uint32_t> indices;
+        indices.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if ((out_heights[i] != NO_DATA_VALUE) == isOffset)
+                indices.push_back((std::uint32_t)i);
+        }
+
+        if (indices.empty())
+            return 0;
+
+        std::vector<glm::dvec3> local(indices.size());
+        for (std::size_t k = 0; k < indices.size(); ++k)
+            local[k] = glm::dvec3(points[indices[k]].x, points[indices[k]].y, 0.0);
+
+        auto xform = srs.to(profile.srs());
+        if (!xform.valid())
+            return 0;
+
+        // failed points come back as HUGE_VAL and drop out at the extent check below
+        xform.transformArray(local.data(), local.size());
+
+        // group the points by the tile that contains them:
+        auto& extent = profile.extent();
+        auto [tilesX, tilesY] = profile.numTiles(lod);
+
+        struct Entry {
+            std::uint64_t tile;
+            std::uint32_t k;
+            bool operator < (const Entry& rhs) const {
+                return tile < rhs.tile || (tile == rhs.tile && k < rhs.k);
+            }
+        };
+        std::vector<Entry> entries;
+        entries.reserve(local.size());
+
+        for (std::uint32_t k = 0; k < (std::uint32_t)local.size(); ++k)
+        {
+            double x = local[k].x, y = local[k].y;
+            if (extent.contains(x, y))
+            {
+                double rx = (x - extent.xMin()) / extent.width();
+                double ry = (y - extent.yMin()) / extent.height();
+                std::uint64_t tx = std::min((unsigned)(rx * (double)tilesX), tilesX - 1);
+                std::uint64_t ty = std::min((unsigned)((1.0 - ry) * (double)tilesY), tilesY - 1);
+                entries.push_back({ ty * tilesX + tx, k });
+            }
+        }
+
+        std::sort(entries.begin(), entries.end());
+
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        for (std::size_t first = 0; first < entries.size(); )
+        {
+            std::size_t last = first + 1;
+            while (last < entries.size() && entries[last].tile == entries[first].tile)
+                ++last;
+            ranges.emplace_back(first, last);
+            first = last;
+        }
+
+        // fetch each tile once and sample all of its points:
+        std::vector<float> heights(local.size(), NO_DATA_VALUE);
+
+        util::parallel_for(pool, ranges.size(), 1, "sample elevation",
+            [&](std::size_t firstRange, std::size_t lastRange)
+            {
+                std::vector<double> px, py;
+                std::vector<float> samples;
+
+                // neighboring tiles often fall back on the same data tile
+                TileKey lastKey;
+                Result<GeoHeightfield> result;
+
+                for (auto r = firstRange; r < lastRange && !io.canceled(); ++r)
+                {
+                    auto [first, last] = ranges[r];
+                    auto tile = entries[first].tile;
+                    TileKey key(lod, (unsigned)(tile % tilesX), (unsigned)(tile / tilesX), profile);
+
+                    auto bestKey = layer->bestAvailableTileKey(key);
+                    if (!bestKey.valid())
+                        continue;
+
+                    if (bestKey != lastKey)
+                    {
+                        result = layer->createHeightfield(bestKey, io);
+                        lastKey = bestKey;
+                    }
+
+                    if (result.status.failed() || !result.value.valid())
+                        continue;
+
+                    auto& geohf = result.value;
+                    const Heightfield* hf = geohf.heightfield().get();
+                    auto& ex = geohf.extent();
+                    auto res = geohf.resolution();
+                    double maxCol = (double)(hf->width() - 1), maxRow = (double)(hf->height() - 1);
+
+                    auto n = last - first;
+                    px.resize(n), py.resize(n), samples.resize(n);
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        auto& p = local[entries[first + i].k];
+                        px[i] = clamp((p.x - ex.xmin()) / res.x, 0.0, maxCol);
+                        py[i] = clamp((p.y - ex.ymin()) / res.y, 0.0, maxRow);
+                    }
+
+                    samplePixels(hf, px.data(), py.data(), samples.data(), n, interpolation);
+
+                    for (std::size_t i = 0; i < n; ++i)
+                        heights[entries[first + i].k] = samples[i];
+                }
+            });
+
+        // express the heights in the vertical datum of the input SRS. Offsets are
+        // relative values and need no datum shift.
+        std::vector<std::uint32_t> valid;
+        valid.reserve(local.size());
+        for (std::uint32_t k = 0; k < (std::uint32_t)local.size(); ++k)
+        {
+            if (heights[k] != NO_DATA_VALUE)
+                valid.push_back(k);
+        }
+
+        if (!isOffset)
+        {
+            std::vector<glm::dvec3> shifted(valid.size());
+            for (std::size_t v = 0; v < valid.size(); ++v)
+                shifted[v] = glm::dvec3(local[valid[v]].x, local[valid[v]].y, heights[valid[v]]);
+
+            xform.inverseArray(shifted.data(), shifted.size());
+
+            for (std::size_t v = 0; v < valid.size(); ++v)
+                heights[valid[v]] = (float)shifted[v].z;
+        }
+
+        for (auto k : valid)
+        {
+            auto i = indices[k];
+            out_heights[i] = isOffset ? out_heights[i] + heights[k] : heights[k];
+        }
+
+        return valid.size();
+    }
+}
+
+std::size_t
+ElevationLayerVector::sampleHeights(
+    const glm::dvec3* points,
+    std::size_t count,
+    const SRS& srs,
+    float* out_heights,
+    unsigned lod,
+    Image::Interpolation interpolation,
+    const IOOptions& io,
+    jobs::jobpool* pool) const
+{
+    ROCKY_PROFILING_ZONE;
+    ROCKY_SOFT_ASSERT_AND_RETURN(points && out_heights && srs.valid(), 0);
+
+    std::fill(out_heights, out_heights + count, NO_DATA_VALUE);
+
+    // Check them in reverse order since the highest priority is last;
+    // each layer fills in whatever the layers above it could not.
+    for (int i = (int)size() - 1; i >= 0 && !io.canceled(); --i)
+    {
+        auto& layer = (*this)[i];
+        if (layer->isOpen() && layer->offset() != true)
+        {
+            sampleLayer(layer.get(), points, count, srs, out_heights, lod, interpolation, io, pool);
+        }
+    }
+
+    // then apply any offset layers to the heights we found.
+    for (auto& layer : *this)
+    {
+        if (layer->isOpen() && layer->offset() == true && !io.canceled())
+        {
+            sampleLayer(layer.get(), points, count, srs, out_heights, lod, interpolation, io, pool);
+        }
+    }
+
+    if (io.canceled())
+        return 0;
+
+    return (std::size_t)std::count_if(out_heights, out_heights + count,
+        [](float h) { return h != NO_DATA_VALUE; });
+}
+
 shared_ptr<Heightfield>
-ElevationLayer::decodeMapboxRGB(shared_ptr<Image> image) const
+ElevationLayer::decodeRGB(shared_ptr<Image> image) const
 {
     if (!image || !image->valid())
         return nullptr;
 
-    // convert the RGB Elevation into an actual heightfield
-    auto hf = Heightfield::create(image->width(), image->height());
+    auto format = _encoding.has_value(Encoding::Terrarium) ?
+        TerrainRGB::Format::Terrarium :
+        TerrainRGB::Format::Mapbox;
+
+    // fast path for 8-bit RGB(A) pixels
+    auto hf = TerrainRGB::decode(image.get(), format);
+    if (hf)
+        return hf;
+
+    // any other layout: requantize each row to 8-bit RGB and decode that.
+    hf = Heightfield::create(image->width(), image->height());
+    std::vector<unsigned char> row(image->width() * 3);
 
     glm::fvec4 pixel;
     for (unsigned y = 0; y < image->height(); ++y)
@@ -891,15 +1244,11 @@ ElevationLayer::decodeMapboxRGB(shared_ptr<Image> image) const
         for (unsigned x = 0; x < image->width(); ++x)
         {
             image->read(pixel, x, y);
-
-            float height = -10000.f +
-                ((pixel.r * 256.0f * 256.0f + pixel.g * 256.0f + pixel.b) * 256.0f * 0.1f);
-
-            if (height < -9999 || height > 999999)
-                height = NO_DATA_VALUE;
-
-            hf->heightAt(x, y) = height;
+            for (unsigned c = 0; c < 3; ++c)
+                row[x * 3 + c] = (unsigned char)(clamp(pixel[c], 0.0f, 1.0f) * 255.0f + 0.5f);
         }
+
+        TerrainRGB::decodeRow(row.data(), 3, image->width(), format, hf->data<float>() + y * hf->width());
     }
 
     return hf;
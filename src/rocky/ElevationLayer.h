@@ -19,7 +19,8 @@ namespace ROCKY_NAMESPACE
     public:
         enum class Encoding {
             SingleChannel,
-            MapboxRGB
+            MapboxRGB,
+            Terrarium
         };
 
         //! Whether this layer contains offsets instead of absolute elevation heights
@@ -42,9 +43,21 @@ namespace ROCKY_NAMESPACE
         void setEncoding(Encoding evalue);
         const optional<Encoding>& encoding() const;
 
+        //! Encoding of heightfields held in the layer's memory cache:
+        //! R32_SFLOAT (default), R16_UNORM or R16_SFLOAT. The compact encodings
+        //! halve the cache's memory use; heightfields are always returned
+        //! to callers at full precision.
+        void setCacheEncoding(Image::PixelFormat value);
+        const optional<Image::PixelFormat>& cacheEncoding() const;
+
         //! Override from VisibleLayer
         void setVisible(bool value) override;
 
+        //! Override from Layer
+        void dirty() override;
+
+        void dirty(const GeoExtent& extent) override;
+
         //! Serialize this layer
         JSON to_json() const override;
 
@@ -53,7 +66,9 @@ namespace ROCKY_NAMESPACE
         /**
          * Creates a GeoHeightField for this layer that corresponds to the extents and LOD
          * in the specified TileKey. The returned HeightField will always match the geospatial
-         * extents of that TileKey.
+         * extents of that TileKey. The heightfield is R32_SFLOAT and may be shared
+         * with the layer's memory cache, so copy it (Heightfield::decode) before
+         * changing any heights.
          *
          * @param key TileKey for which to create a heightfield.
          */
@@ -63,7 +78,9 @@ namespace ROCKY_NAMESPACE
         /**
          * Creates a GeoHeightField for this layer that corresponds to the extents and LOD
          * in the specified TileKey. The returned HeightField will always match the geospatial
-         * extents of that TileKey.
+         * extents of that TileKey. The heightfield is R32_SFLOAT and may be shared
+         * with the layer's memory cache, so copy it (Heightfield::decode) before
+         * changing any heights.
          *
          * @param key TileKey for which to create a heightfield.
          * @param progress Callback for tracking progress and cancelation
@@ -109,8 +126,9 @@ namespace ROCKY_NAMESPACE
             shared_ptr<Heightfield> hf,
             const IOOptions& io) const;
 
-        //! Decodes a mapbox RGB encoded heightfield image into a heightfield.
-        shared_ptr<Heightfield> decodeMapboxRGB(shared_ptr<Image> image) const;
+        //! Decodes an RGB encoded heightfield image into a heightfield
+        //! according to the layer's encoding (MapboxRGB or Terrarium).
+        shared_ptr<Heightfield> decodeRGB(shared_ptr<Image> image) const;
 
         virtual ~ElevationLayer() { }
 
@@ -119,6 +137,7 @@ namespace ROCKY_NAMESPACE
         optional<float> _noDataValue = NO_DATA_VALUE;
         optional<float> _minValidValue = -FLT_MAX;
         optional<float> _maxValidValue = FLT_MAX;
+        optional<Image::PixelFormat> _cacheEncoding = Image::R32_SFLOAT;
 
     private:
         void construct(const JSON&);
@@ -162,6 +181,34 @@ namespace ROCKY_NAMESPACE
             const Profile& hae_profile,
             Image::Interpolation interpolation,
             const IOOptions& io ) const;
+
+        /**
+         * Samples elevation at many points at once. Points are transformed
+         * in bulk and grouped by tile, so each tile is fetched once per layer
+         * (through the layer's memory cache) no matter how many points it holds.
+         *
+         * @param points Input points; only x and y are used
+         * @param count Number of input points
+         * @param srs Spatial reference of the input points
+         * @param out_heights Receives "count" heights, relative to the vertical datum
+         *     of the input SRS, or NO_DATA_VALUE where no layer has data
+         * @param lod Level of detail at which to sample (layers fall back to
+         *     their best available data)
+         * @param interpolation Elevation interpolation technique
+         * @param io Options and cancelation callback
+         * @param pool Optional job pool across which to spread tile fetching and
+         *     sampling. The calling thread must not belong to this pool.
+         * @return Number of points that received a valid height
+         */
+        std::size_t sampleHeights(
+            const glm::dvec3* points,
+            std::size_t count,
+            const SRS& srs,
+            float* out_heights,
+            unsigned lod,
+            Image::Interpolation interpolation,
+            const IOOptions& io,
+            jobs::jobpool* pool = nullptr) const;
     };
 
 } // namespace
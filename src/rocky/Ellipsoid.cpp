@@ -111,6 +111,32 @@ namespace
         height = p / cos(latitude) - N;
     }
 
+    // Closed-form geocentric to geodetic conversion (Vermeille, 2002).
+    // Outputs the "k" and "D" terms from which latitude, height and the
+    // surface normal all follow without iteration. Returns false near the
+    // center of the earth, where the caller must use convertXYZToLatLongHeight.
+    inline bool solveVermeille(
+        double RE, double ECC2,
+        double X, double Y, double Z,
+        double& k, double& D)
+    {
+        double e4 = ECC2 * ECC2;
+        double p = (X*X + Y*Y) / (RE*RE);
+        double q = (1.0 - ECC2) * Z*Z / (RE*RE);
+        double r = (p + q - e4) / 6.0;
+        if (r <= 0.0)
+            return false;
+
+        double s = e4 * p * q / (4.0 * r*r*r);
+        double t = std::cbrt(1.0 + s + std::sqrt(s * (2.0 + s)));
+        double u = r * (1.0 + t + 1.0 / t);
+        double v = std::sqrt(u*u + e4 * q);
+        double w = ECC2 * (u + v - q) / (2.0 * v);
+        k = std::sqrt(u + v + w*w) - w;
+        D = k * std::sqrt(X*X + Y*Y) / (k + ECC2);
+        return true;
+    }
+
     inline void computeLocalToWorldTransformFromLatLongHeight(
         double RE, double RP, double ECC2,
         double latitude,
@@ -253,6 +279,83 @@ Ellipsoid::geocentricToGeodetic(const glm::dvec3& xyz) const
     return out;
 }
 
+void
+Ellipsoid::geocentricToGeodetic(const glm::dvec3* in, glm::dvec3* out, std::size_t count) const
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const glm::dvec3 xyz = in[i];
+        double k, D;
+        if (solveVermeille(_re, _ecc2, xyz.x, xyz.y, xyz.z, k, D))
+        {
+            double dz = std::sqrt(D*D + xyz.z*xyz.z);
+            out[i] = glm::dvec3(
+                rad2deg(atan2(xyz.y, xyz.x)),
+                rad2deg(2.0 * atan2(xyz.z, D + dz)),
+                (k + _ecc2 - 1.0) / k * dz);
+        }
+        else
+        {
+            out[i] = geocentricToGeodetic(xyz);
+        }
+    }
+}
+
+void
+Ellipsoid::geodeticToGeocentric(const glm::dvec3* in, glm::dvec3* out, std::size_t count) const
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const glm::dvec3 lla = in[i];
+        convertLatLongHeightToXYZ(
+            _re, _rp, _ecc2,
+            deg2rad(lla.y), deg2rad(lla.x), lla.z,
+            out[i].x, out[i].y, out[i].z);
+    }
+}
+
+void
+Ellipsoid::geocentricToUpVectors(const glm::dvec3* geoc, glm::dvec3* out_up, std::size_t count) const
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const glm::dvec3 xyz = geoc[i];
+        double k, D;
+        if (solveVermeille(_re, _ecc2, xyz.x, xyz.y, xyz.z, k, D))
+        {
+            // the normal at the foot point, with no trig required:
+            // (cos(lat)cos(lon), cos(lat)sin(lon), sin(lat)) = (X*k/(k+e2), Y*k/(k+e2), Z) / sqrt(D^2 + Z^2)
+            double scale = k / (k + _ecc2);
+            out_up[i] = glm::dvec3(xyz.x * scale, xyz.y * scale, xyz.z) / std::sqrt(D*D + xyz.z*xyz.z);
+        }
+        else
+        {
+            out_up[i] = computeLocalUpVector(_re, _rp, _ecc2, xyz.x, xyz.y, xyz.z);
+        }
+    }
+}
+
+void
+Ellipsoid::geocentricToLocalToWorld(const glm::dvec3* geoc, glm::dmat4* out, std::size_t count) const
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        glm::dvec3 up;
+        geocentricToUpVectors(&geoc[i], &up, 1);
+
+        // east = (-sin(lon), cos(lon), 0)
+        double dxy = std::sqrt(geoc[i].x * geoc[i].x + geoc[i].y * geoc[i].y);
+        glm::dvec3 east = dxy > 0.0 ? glm::dvec3(-geoc[i].y / dxy, geoc[i].x / dxy, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+        glm::dvec3 north = glm::cross(up, east);
+
+        glm::dmat4& m = out[i];
+        m = glm::translate(glm::dmat4(1.0), geoc[i]);
+        m[0] = glm::dvec4(east, 0.0);
+        m[1] = glm::dvec4(north, 0.0);
+        m[2] = glm::dvec4(up, 0.0);
+    }
+}
+
 void
 Ellipsoid::set(double re, double rp)
 {
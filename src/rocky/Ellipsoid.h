@@ -64,6 +64,21 @@ namespace ROCKY_NAMESPACE
         //! Get the coordinate frame at the geocentric point
         glm::dmat4 geodeticToCoordFrame(const glm::dvec3& geodPoint) const;
 
+        //! Convert an array of geocentric coords to geodetic (degrees longitude,
+        //! degrees latitude, meters altitude) using a closed-form solution.
+        //! "in" and "out" may be the same array.
+        void geocentricToGeodetic(const glm::dvec3* in, glm::dvec3* out, std::size_t count) const;
+
+        //! Convert an array of geodetic coords to geocentric.
+        //! "in" and "out" may be the same array.
+        void geodeticToGeocentric(const glm::dvec3* in, glm::dvec3* out, std::size_t count) const;
+
+        //! Get the local up vectors at an array of geocentric points
+        void geocentricToUpVectors(const glm::dvec3* geocPoints, glm::dvec3* out_up, std::size_t count) const;
+
+        //! Get the LTP-to-geocentric matrices at an array of geocentric points
+        void geocentricToLocalToWorld(const glm::dvec3* geocPoints, glm::dmat4* out, std::size_t count) const;
+
         //! Converts degrees to meters at a given latitide
         double longitudinalDegreesToMeters(double value, double lat_deg = 0.0) const;
 
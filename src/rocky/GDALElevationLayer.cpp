@@ -174,7 +174,7 @@ GDALElevationLayer::createHeightfieldImplementation(
             }
             else // assume Image::R8G8B8_UNORM?
             {
-                auto hf = decodeMapboxRGB(r.value);
+                auto hf = decodeRGB(r.value);
                 return GeoHeightfield(hf, key.extent());
             }
         }
@@ -47,6 +47,21 @@ GeoCircle::transform(const SRS& srs, GeoCircle& output) const
     return true;
 }
 
+std::size_t
+GeoCircle::transformArray(GeoCircle* circles, std::size_t count, const SRS& srs)
+{
+    std::vector<GeoPoint> centers(count);
+    for (std::size_t i = 0; i < count; ++i)
+        centers[i] = circles[i].center();
+
+    auto numTransformed = GeoPoint::transformArray(centers.data(), count, srs);
+
+    for (std::size_t i = 0; i < count; ++i)
+        circles[i].setCenter(centers[i]);
+
+    return numTransformed;
+}
+
 bool 
 GeoCircle::intersects( const GeoCircle& rhs ) const
 {
@@ -53,6 +53,10 @@ namespace ROCKY_NAMESPACE
         /** transform the GeoCircle to another SRS */
         bool transform(const SRS& srs, GeoCircle& out_circle) const;
 
+        /** transform an array of GeoCircles in place to another SRS, using one
+            bulk transformation per source SRS. Returns the number transformed. */
+        static std::size_t transformArray(GeoCircle* circles, std::size_t count, const SRS& srs);
+
         /** does this GeoCircle intersect another? */
         bool intersects(const GeoCircle& rhs) const;
 
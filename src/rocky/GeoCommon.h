@@ -16,3 +16,54 @@
 //{
 //    constexpr float NO_DATA_VALUE = -FLT_MAX;
 //}
+
+#include <rocky/SRS.h>
+#include <algorithm>
+#include <vector>
+
+namespace ROCKY_NAMESPACE
+{
+    namespace util
+    {
+        //! Indices of the items in an array that share an SRS (see groupBySRS)
+        struct SRSGroup
+        {
+            SRS srs;
+            std::vector<std::size_t> indices;
+        };
+
+        //! Groups the items of an array by equivalent SRS, in order of first
+        //! appearance, so each SRS pair costs one transform call.
+        //! @param count Number of items
+        //! @param srsOf Callable taking an index and returning a pointer to the
+        //!    item's SRS, or nullptr to leave the item out
+        template<class FUNC>
+        inline std::vector<SRSGroup> groupBySRS(std::size_t count, FUNC&& srsOf)
+        {
+            std::vector<SRSGroup> groups;
+            SRSGroup* group = nullptr;
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const SRS* srs = srsOf(i);
+                if (!srs)
+                    continue;
+
+                // consecutive items usually share one
+                if (!group || group->srs.equivalenceId() != srs->equivalenceId())
+                {
+                    auto iter = std::find_if(groups.begin(), groups.end(),
+                        [&](const SRSGroup& g) { return g.srs.equivalenceId() == srs->equivalenceId(); });
+
+                    if (iter == groups.end())
+                        iter = groups.insert(groups.end(), SRSGroup{ *srs, { } });
+
+                    group = &(*iter);
+                }
+                group->indices.push_back(i);
+            }
+
+            return groups;
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #include "GeoExtent.h"
+#include "GeoCommon.h"
 #include "Math.h"
 #include "Instance.h"
+#include <algorithm>
 
 using namespace ROCKY_NAMESPACE;
 using namespace ROCKY_NAMESPACE::util;
@@ -37,6 +39,7 @@ GeoExtent::operator =(GeoExtent&& rhs)
     _width = rhs._width;
     _south = rhs._south;
     _height = rhs._height;
+    _normalized = rhs._normalized;
     rhs._srs = { };
     return *this;
 }
@@ -96,6 +99,7 @@ GeoExtent::set(double west, double south, double east, double north)
     {
         _west = _south = 0.0;
         _width = _height = -1.0;
+        _normalized = { };
         return;
     }
 
@@ -242,127 +246,155 @@ GeoExtent::splitAcrossAntimeridian(GeoExtent& out_west, GeoExtent& out_east) con
 
 namespace
 {
-    bool transformExtentToMBR(
-        const SRS& fromSRS,
-        const SRS& toSRS,
-        double& in_out_xmin,
-        double& in_out_ymin,
-        double& in_out_xmax,
-        double& in_out_ymax)
+    // Samples taken per extent when computing a minimum bounding rectangle:
+    // the centroid, the four corners, and five points along each edge.
+    constexpr unsigned mbr_edge_samples = 5;
+    constexpr unsigned mbr_samples = 5 + 4 * mbr_edge_samples;
+
+    // When going from a geodetic SRS to a projected one, the legal bounds
+    // of the target SRS expressed in the source SRS. Otherwise returns false.
+    // TODO: rethink this to be more generic.
+    bool mbrClampBounds(const SRS& fromSRS, const SRS& toSRS, Box& out)
     {
-        ROCKY_SOFT_ASSERT_AND_RETURN(fromSRS.valid() && toSRS.valid(), false);
-
-        // Transform all points and take the maximum bounding rectangle the resulting points
-        std::vector<glm::dvec3> v;
-
-        // Start by clamping to the out_srs' legal bounds, if possible.
-        // TODO: rethink this to be more generic.
         if (fromSRS.isGeodetic() && !toSRS.isGeodetic())
         {
-            auto to_geo = toSRS.to(fromSRS);
             Box b = toSRS.bounds(); // long,lat degrees
-            glm::dvec3 min(b.xmin, b.ymin, 0);
-            glm::dvec3 max(b.xmax, b.ymax, 0);
-            to_geo(min, min);
-            to_geo(max, max);
-
             if (b.valid())
             {
-                in_out_xmin = clamp(in_out_xmin, min.x, max.x);
-                in_out_xmax = clamp(in_out_xmax, min.x, max.x);
-                in_out_ymin = clamp(in_out_ymin, min.y, max.y);
-                in_out_ymax = clamp(in_out_ymax, min.y, max.y);
+                auto to_geo = toSRS.to(fromSRS);
+                glm::dvec3 min(b.xmin, b.ymin, 0);
+                glm::dvec3 max(b.xmax, b.ymax, 0);
+                to_geo(min, min);
+                to_geo(max, max);
+                out = Box(min.x, min.y, 0, max.x, max.y, 0);
+                return true;
             }
         }
+        return false;
+    }
 
-        double height = in_out_ymax - in_out_ymin;
-        double width = in_out_xmax - in_out_xmin;
+    // Writes the mbr_samples points of an extent into "v"
+    void sampleForMBR(
+        double xmin, double ymin, double xmax, double ymax,
+        const Box* clampBounds,
+        glm::dvec3* v)
+    {
+        if (clampBounds)
+        {
+            xmin = clamp(xmin, clampBounds->xmin, clampBounds->xmax);
+            xmax = clamp(xmax, clampBounds->xmin, clampBounds->xmax);
+            ymin = clamp(ymin, clampBounds->ymin, clampBounds->ymax);
+            ymax = clamp(ymax, clampBounds->ymin, clampBounds->ymax);
+        }
+
+        double height = ymax - ymin;
+        double width = xmax - xmin;
 
         // first point is a centroid. This we will use to make sure none of the corner points
         // wraps around if the target SRS is geographic.
-        v.push_back(glm::dvec3(in_out_xmin + width * 0.5, in_out_ymin + height * 0.5, 0)); // centroid.
+        *v++ = glm::dvec3(xmin + width * 0.5, ymin + height * 0.5, 0); // centroid.
 
         // add the four corners
-        v.push_back(glm::dvec3(in_out_xmin, in_out_ymin, 0)); // ll
-        v.push_back(glm::dvec3(in_out_xmin, in_out_ymax, 0)); // ul
-        v.push_back(glm::dvec3(in_out_xmax, in_out_ymax, 0)); // ur
-        v.push_back(glm::dvec3(in_out_xmax, in_out_ymin, 0)); // lr
+        *v++ = glm::dvec3(xmin, ymin, 0); // ll
+        *v++ = glm::dvec3(xmin, ymax, 0); // ul
+        *v++ = glm::dvec3(xmax, ymax, 0); // ur
+        *v++ = glm::dvec3(xmax, ymin, 0); // lr
 
         //We also sample along the edges of the bounding box and include them in the 
         //MBR computation in case you are dealing with a projection that will cause the edges
         //of the bounding box to be expanded.  This was first noticed when dealing with converting
         //Hotline Oblique Mercator to WGS84
-
-        //Sample the edges
-        unsigned int numSamples = 5;
-        double dWidth = width / (numSamples - 1);
-        double dHeight = height / (numSamples - 1);
+        double dWidth = width / (mbr_edge_samples - 1);
+        double dHeight = height / (mbr_edge_samples - 1);
 
         //Left edge
-        for (unsigned int i = 0; i < numSamples; i++)
+        for (unsigned i = 0; i < mbr_edge_samples; i++)
+            *v++ = glm::dvec3(xmin, ymin + dHeight * (double)i, 0);
+
+        //Right edge
+        for (unsigned i = 0; i < mbr_edge_samples; i++)
+            *v++ = glm::dvec3(xmax, ymin + dHeight * (double)i, 0);
+
+        //Top edge
+        for (unsigned i = 0; i < mbr_edge_samples; i++)
+            *v++ = glm::dvec3(xmin + dWidth * (double)i, ymax, 0);
+
+        //Bottom edge
+        for (unsigned i = 0; i < mbr_edge_samples; i++)
+            *v++ = glm::dvec3(xmin + dWidth * (double)i, ymin, 0);
+    }
+
+    // Computes the MBR of mbr_samples transformed points. Returns false
+    // if any of the points failed to transform.
+    bool mbrOfSamples(
+        const glm::dvec3* v,
+        const SRS& toSRS,
+        double& out_xmin, double& out_ymin, double& out_xmax, double& out_ymax)
+    {
+        // failed points come back from PROJ as HUGE_VAL
+        for (unsigned i = 0; i < mbr_samples; i++)
         {
-            v.push_back(glm::dvec3(in_out_xmin, in_out_ymin + dHeight * (double)i, 0));
+            if (!std::isfinite(v[i].x) || !std::isfinite(v[i].y))
+                return false;
         }
 
-        //Right edge
-        for (unsigned int i = 0; i < numSamples; i++)
+        out_xmin = DBL_MAX;
+        out_ymin = DBL_MAX;
+        out_xmax = -DBL_MAX;
+        out_ymax = -DBL_MAX;
+
+        // For a geographic target, make sure the new extents contain the centroid
+        // because they might have wrapped around or run into a precision failure.
+        // v[0]=centroid, v[1]=LL, v[2]=UL, v[3]=UR, v[4]=LR
+        if (toSRS.isGeodetic())
         {
-            v.push_back(glm::dvec3(in_out_xmax, in_out_ymin + dHeight * (double)i, 0));
+            if (v[1].x > v[0].x || v[2].x > v[0].x) out_xmin = -180.0;
+            if (v[3].x < v[0].x || v[4].x < v[0].x) out_xmax = 180.0;
         }
 
-        //Top edge
-        for (unsigned int i = 0; i < numSamples; i++)
+        // enforce an MBR:
+        for (unsigned i = 0; i < mbr_samples; i++)
         {
-            v.push_back(glm::dvec3(in_out_xmin + dWidth * (double)i, in_out_ymax, 0));
+            out_xmin = std::min(v[i].x, out_xmin);
+            out_ymin = std::min(v[i].y, out_ymin);
+            out_xmax = std::max(v[i].x, out_xmax);
+            out_ymax = std::max(v[i].y, out_ymax);
         }
 
-        //Bottom edge
-        for (unsigned int i = 0; i < numSamples; i++)
+        if (toSRS.isGeodetic())
         {
-            v.push_back(glm::dvec3(in_out_xmin + dWidth * (double)i, in_out_ymin, 0));
+            out_xmin = std::max(out_xmin, -180.0);
+            out_ymin = std::max(out_ymin, -90.0);
+            out_xmax = std::min(out_xmax, 180.0);
+            out_ymax = std::min(out_ymax, 90.0);
         }
 
-        auto xform = fromSRS.to(toSRS);
+        return true;
+    }
 
-        if (xform.transformRange(v.begin(), v.end()))
-        {
-            in_out_xmin = DBL_MAX;
-            in_out_ymin = DBL_MAX;
-            in_out_xmax = -DBL_MAX;
-            in_out_ymax = -DBL_MAX;
-
-            // For a geographic target, make sure the new extents contain the centroid
-            // because they might have wrapped around or run into a precision failure.
-            // v[0]=centroid, v[1]=LL, v[2]=UL, v[3]=UR, v[4]=LR
-            if (toSRS.isGeodetic())
-            {
-                if (v[1].x > v[0].x || v[2].x > v[0].x) in_out_xmin = -180.0;
-                if (v[3].x < v[0].x || v[4].x < v[0].x) in_out_xmax = 180.0;
-            }
+    bool transformExtentToMBR(
+        const SRS& fromSRS,
+        const SRS& toSRS,
+        double& in_out_xmin,
+        double& in_out_ymin,
+        double& in_out_xmax,
+        double& in_out_ymax)
+    {
+        ROCKY_SOFT_ASSERT_AND_RETURN(fromSRS.valid() && toSRS.valid(), false);
 
-            // enforce an MBR:
-            for (unsigned int i = 0; i < v.size(); i++)
-            {
-                in_out_xmin = std::min(v[i].x, in_out_xmin);
-                in_out_ymin = std::min(v[i].y, in_out_ymin);
-                in_out_xmax = std::max(v[i].x, in_out_xmax);
-                in_out_ymax = std::max(v[i].y, in_out_ymax);
-            }
+        // Transform all points and take the maximum bounding rectangle the resulting points
+        glm::dvec3 v[mbr_samples];
 
-            if (toSRS.isGeodetic())
-            {
-                in_out_xmin = std::max(in_out_xmin, -180.0);
-                in_out_ymin = std::max(in_out_ymin, -90.0);
-                in_out_xmax = std::min(in_out_xmax, 180.0);
-                in_out_ymax = std::min(in_out_ymax, 90.0);
-            }
+        // Start by clamping to the out_srs' legal bounds, if possible.
+        Box clampBounds;
+        bool clamped = mbrClampBounds(fromSRS, toSRS, clampBounds);
 
-            volatile int ii = 0;
+        sampleForMBR(in_out_xmin, in_out_ymin, in_out_xmax, in_out_ymax, clamped ? &clampBounds : nullptr, v);
 
-            return true;
-        }
+        if (!fromSRS.to(toSRS).transformArray(v, mbr_samples))
+            return false;
 
-        return false;
+        return mbrOfSamples(v, toSRS, in_out_xmin, in_out_ymin, in_out_xmax, in_out_ymax);
     }
 }
 
@@ -377,7 +409,20 @@ GeoExtent::transform(const SRS& to_srs) const
     if (srs().isHorizEquivalentTo(to_srs))
         return *this;
 
-    //TODO: this may not work across the antimeridian - unit test required
+    // An extent that crosses the antimeridian goes through as its two halves,
+    // so neither one wraps around in the target SRS; the halves are then rejoined.
+    if (crossesAntimeridian())
+    {
+        GeoExtent west_half, east_half;
+        splitAcrossAntimeridian(west_half, east_half);
+        GeoExtent result = west_half.transform(to_srs);
+        GeoExtent east_result = east_half.transform(to_srs);
+        if (!result.valid())
+            return east_result;
+        result.expandToInclude(east_result);
+        return result;
+    }
+
     if (valid() && to_srs.valid())
     {
         // do not normalize the X values here.
@@ -400,6 +445,84 @@ GeoExtent::transform(const SRS& srs, GeoExtent& output) const
     return output.valid();
 }
 
+std::size_t
+GeoExtent::transformArray(const GeoExtent* in, std::size_t count, const SRS& to_srs, GeoExtent* out)
+{
+    ROCKY_PROFILE_FUNCTION();
+
+    if (!to_srs.valid())
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            out[i] = GeoExtent::INVALID;
+        return 0;
+    }
+
+    // results are staged here so that "in" and "out" may be the same array
+    std::vector<GeoExtent> results(count);
+    std::size_t numValid = 0;
+
+    auto groups = groupBySRS(count, [&](std::size_t i) -> const SRS*
+        {
+            if (!in[i].valid())
+                return nullptr;
+
+            // these go through their two halves one at a time (see transform)
+            if (in[i].crossesAntimeridian() && !in[i].srs().isHorizEquivalentTo(to_srs))
+            {
+                results[i] = in[i].transform(to_srs);
+                if (results[i].valid())
+                    ++numValid;
+                return nullptr;
+            }
+
+            return &in[i].srs();
+        });
+
+    std::vector<glm::dvec3> v;
+
+    for (auto& g : groups)
+    {
+        if (g.srs.isHorizEquivalentTo(to_srs))
+        {
+            for (auto i : g.indices)
+                results[i] = in[i];
+            numValid += g.indices.size();
+            continue;
+        }
+
+        Box clampBounds;
+        bool clamped = mbrClampBounds(g.srs, to_srs, clampBounds);
+
+        // densify every extent in the group into one array, and transform it in one go.
+        v.resize(g.indices.size() * mbr_samples);
+        for (std::size_t k = 0; k < g.indices.size(); ++k)
+        {
+            auto& e = in[g.indices[k]];
+            // do not normalize the X values here.
+            sampleForMBR(e.west(), e.south(), e.west() + e.width(), e.south() + e.height(),
+                clamped ? &clampBounds : nullptr, &v[k * mbr_samples]);
+        }
+
+        auto xform = g.srs.to(to_srs);
+        if (!xform.transformArray(v.data(), v.size()) && !xform.valid())
+            continue;
+
+        for (std::size_t k = 0; k < g.indices.size(); ++k)
+        {
+            double xmin, ymin, xmax, ymax;
+            if (mbrOfSamples(&v[k * mbr_samples], to_srs, xmin, ymin, xmax, ymax))
+            {
+                results[g.indices[k]] = GeoExtent(to_srs, xmin, ymin, xmax, ymax);
+                if (results[g.indices[k]].valid())
+                    ++numValid;
+            }
+        }
+    }
+
+    std::move(results.begin(), results.end(), out);
+    return numValid;
+}
+
 void
 GeoExtent::getBounds(double &xmin, double &ymin, double &xmax, double &ymax) const
 {
@@ -417,6 +540,12 @@ GeoExtent::bounds() const
     return Box( west, south, 0, east, north, 0 );
 }
 
+namespace
+{
+    // tolerance for containment tests, to absorb tiny rounding errors
+    constexpr double containment_epsilon = 1e-6;
+}
+
 bool
 GeoExtent::contains(double x, double y, const SRS& xy_srs) const
 {
@@ -433,38 +562,7 @@ GeoExtent::contains(double x, double y, const SRS& xy_srs) const
             return false;
     }
 
-    const double epsilon = 1e-6;
-    const double lsouth = south();
-    const double lnorth = north();
-    const double least = east();
-    const double lwest = west();
-    const double lwidth = width();
-    double localx = x;
-    double localy = y;
-
-    // Quantize the Y coordinate to account for tiny rounding errors:
-    if (fabs(lsouth - localy) < epsilon)
-       localy = lsouth;
-    if (fabs(lnorth - localy) < epsilon)
-       localy = lnorth;
-
-    // Test the Y coordinate:
-    if (localy < lsouth || localy > lnorth)
-        return false;
-
-    // Bring the X coordinate into normal range:
-    localx = normalizeX(localx);
-    
-    // Quantize the X coordinate to account for tiny rounding errors:
-    if (fabs(lwest - localx) < epsilon)
-       localx = lwest;
-    if (fabs(least - localx) < epsilon)
-       localx = least;
-
-    // account for the antimeridian wrap-around:
-    const double a0 = lwest, a1 = lwest + lwidth;
-    const double b0 = least - lwidth, b1 = least;
-    return (a0 <= localx && localx <= a1) || (b0 <= localx && localx <= b1);
+    return _normalized.contains(normalizeX(x), y, containment_epsilon);
 }
 
 bool
@@ -479,25 +577,24 @@ GeoExtent::contains(const Box& rhs) const
     return
         valid() &&
         rhs.valid() &&
-        contains(rhs.xmin, rhs.ymin) &&
-        contains(rhs.xmax, rhs.ymax) &&
-        contains(rhs.center().x, rhs.center().y);
+        _normalized.contains(GeoExtent(_srs, rhs)._normalized, containment_epsilon);
 }
 
 bool
 GeoExtent::contains(const GeoExtent& rhs) const
 {
+    if (!valid() || !rhs.valid())
+        return false;
+
+    if (_srs.isHorizEquivalentTo(rhs.srs()))
+        return _normalized.contains(rhs._normalized, containment_epsilon);
+
     return
-        valid() &&
-        rhs.valid() &&
         contains(rhs.west(), rhs.south(), rhs.srs()) &&
         contains(rhs.east(), rhs.north(), rhs.srs()) &&
         contains(rhs.centroid().x, rhs.centroid().y, rhs.srs());   // this accounts for the antimeridian
 }
 
-#undef  OVERLAPS
-#define OVERLAPS(A, B, C, D) (!(B <= C || A >= D))
-
 bool
 GeoExtent::intersects(const GeoExtent& rhs, bool checkSRS) const
 {
@@ -513,30 +610,8 @@ GeoExtent::intersects(const GeoExtent& rhs, bool checkSRS) const
         return thisGeo.intersects(rhsGeo, false);
     }
 
-    // Trivial reject: y-dimension does not overlap:
-    bool y_excl = south() >= rhs.north() || north() <= rhs.south();
-    if (y_excl)
-        return false;
-
-    // Trivial reject: x-dimension does not overlap in projected SRS:
-    if (!_srs.isGeodetic())
-    {
-        bool x_excl = west() >= rhs.east() || east() <= rhs.west();
-        return x_excl == false;
-    }
-
-    // By now we know that Y overlaps and we are in a geographic SRS
-    // and therefore must consider the antimeridian wrap-around in X.
-    // a and b are "this"; c and d are "rhs":
-    double a0 = east() - width(), a1 = east();
-    double b0 = west(), b1 = west() + width();
-    double c0 = rhs.east() - rhs.width(), c1 = rhs.east();
-    double d0 = rhs.west(), d1 = rhs.west() + rhs.width();
-    return
-        OVERLAPS(a0, a1, c0, c1) ||
-        OVERLAPS(a0, a1, d0, d1) ||
-        OVERLAPS(b0, b1, c0, c1) ||
-        OVERLAPS(b0, b1, d0, d1);
+    // the normalized form has the antimeridian wrap-around already split out
+    return _normalized.intersects(rhs._normalized);
 }
 
 GeoCircle
@@ -741,6 +816,7 @@ GeoExtent::expandToInclude(const GeoExtent& rhs)
             _width = w0;
         }
 
+        updateNormalized();
     }
 
     return true;
@@ -921,6 +997,21 @@ GeoExtent::clamp()
 
         _height = rocky::util::clamp(_height, 0.0, 180.0);
     }
+
+    updateNormalized();
+}
+
+void
+GeoExtent::updateNormalized()
+{
+    if (!valid())
+        _normalized = Normalized();
+    else if (_srs.isGeodetic() && _width >= 360.0)
+        _normalized = Normalized(-180.0, south(), 180.0, north());
+    else if (crossesAntimeridian())
+        _normalized = Normalized(west(), 180.0, -180.0, east(), south(), north());
+    else
+        _normalized = Normalized(xMin(), south(), xMax(), north());
 }
 
 double
@@ -8,6 +8,7 @@
 #include <rocky/Common.h>
 #include <rocky/GeoPoint.h>
 #include <rocky/GeoCircle.h>
+#include <cfloat>
 
 namespace ROCKY_NAMESPACE
 {
@@ -18,6 +19,68 @@ namespace ROCKY_NAMESPACE
     class ROCKY_EXPORT GeoExtent
     {
     public:
+        /**
+         * Bounds of an extent with the antimeridian wrap-around taken out:
+         * a geographic extent that crosses it becomes two boxes, one ending
+         * at +180 and one starting at -180. An unused box is empty (it has
+         * xmin > xmax) so the tests below run the same, branch-free, either way.
+         */
+        struct Normalized
+        {
+            double xmin[2] = { DBL_MAX, DBL_MAX };
+            double xmax[2] = { -DBL_MAX, -DBL_MAX };
+            double ymin = DBL_MAX;
+            double ymax = -DBL_MAX;
+
+            //! Empty
+            constexpr Normalized() = default;
+
+            //! One box
+            constexpr Normalized(double x0, double y0, double x1, double y1) :
+                xmin{ x0, DBL_MAX }, xmax{ x1, -DBL_MAX }, ymin(y0), ymax(y1) { }
+
+            //! Two boxes spanning the same latitudes
+            constexpr Normalized(double west0, double east0, double west1, double east1, double y0, double y1) :
+                xmin{ west0, west1 }, xmax{ east0, east1 }, ymin(y0), ymax(y1) { }
+
+            //! Whether the interiors of the two overlap
+            constexpr bool intersects(const Normalized& rhs) const {
+                return
+                    (ymin < rhs.ymax) & (ymax > rhs.ymin) & (
+                        overlapsX(0, rhs, 0) | overlapsX(0, rhs, 1) |
+                        overlapsX(1, rhs, 0) | overlapsX(1, rhs, 1));
+            }
+
+            //! Whether a point falls inside, within a tolerance
+            constexpr bool contains(double x, double y, double epsilon = 0.0) const {
+                return
+                    (y >= ymin - epsilon) & (y <= ymax + epsilon) & (
+                        ((x >= xmin[0] - epsilon) & (x <= xmax[0] + epsilon)) |
+                        ((x >= xmin[1] - epsilon) & (x <= xmax[1] + epsilon)));
+            }
+
+            //! Whether another one falls entirely inside, within a tolerance
+            constexpr bool contains(const Normalized& rhs, double epsilon = 0.0) const {
+                return
+                    (rhs.ymin >= ymin - epsilon) & (rhs.ymax <= ymax + epsilon) & (rhs.ymin <= rhs.ymax) &
+                    containsX(rhs, 0, epsilon) & containsX(rhs, 1, epsilon) &
+                    ((rhs.xmin[0] <= rhs.xmax[0]) | (rhs.xmin[1] <= rhs.xmax[1]));
+            }
+
+        private:
+            constexpr bool overlapsX(unsigned i, const Normalized& rhs, unsigned j) const {
+                return (xmin[i] < rhs.xmax[j]) & (xmax[i] > rhs.xmin[j]);
+            }
+
+            // an empty box on the rhs is trivially contained
+            constexpr bool containsX(const Normalized& rhs, unsigned j, double epsilon) const {
+                return
+                    (rhs.xmin[j] > rhs.xmax[j]) |
+                    ((rhs.xmin[j] >= xmin[0] - epsilon) & (rhs.xmax[j] <= xmax[0] + epsilon)) |
+                    ((rhs.xmin[j] >= xmin[1] - epsilon) & (rhs.xmax[j] <= xmax[1] + epsilon));
+            }
+        };
+
         //! Default ctor creates an invalid extent
         GeoExtent();
         GeoExtent(const GeoExtent& rhs) = default;
@@ -89,6 +152,9 @@ namespace ROCKY_NAMESPACE
         //! True if the extent is geographic and crosses the 180 degree meridian.
         bool crossesAntimeridian() const;
 
+        //! Bounds split at the antimeridian, as used by intersects() and contains()
+        const Normalized& normalized() const { return _normalized; }
+
         //! Raw bounds of the extent (unnormalized)
         void getBounds(double& xmin, double& ymin, double& xmax, double& ymax) const;
 
@@ -114,6 +180,17 @@ namespace ROCKY_NAMESPACE
         //! Same as transform(srs) but puts the result in the output extent
         bool transform(const SRS& to_srs, GeoExtent& output) const;
 
+        //! Transforms many extents into another SRS at once. Extents are grouped
+        //! by source SRS, and the edge samples of each group go through a single
+        //! bulk transformation.
+        //! @param in Input extents
+        //! @param count Number of input extents
+        //! @param to_srs Target SRS
+        //! @param out Receives "count" extents (GeoExtent::INVALID where the transform
+        //!    failed); may be the same array as "in"
+        //! @return Number of valid output extents
+        static std::size_t transformArray(const GeoExtent* in, std::size_t count, const SRS& to_srs, GeoExtent* out);
+
         //! Returns true if the specified point falls within the bounds of the extent.
         //! @param x, y Coordinates to test
         //! @param xy_srs SRS of input x and y coordinates; if null, the method assumes x and y
@@ -192,11 +269,14 @@ namespace ROCKY_NAMESPACE
     private:
         double _west, _width, _south, _height;
         SRS _srs;
+        Normalized _normalized;
 
         double normalizeX(double longitude) const;
 
         void clamp();
 
+        void updateNormalized();
+
         void setOriginAndSize(double west, double south, double width, double height);
     };
 
@@ -51,18 +51,32 @@ GeoHeightfield::init()
         _resolution.x = _extent.width() / (double)(_hf->width() - 1);
         _resolution.y = _extent.height() / (double)(_hf->height() - 1);
 
-        for (unsigned row = 0; row < _hf->height(); ++row)
-        {
-            for (unsigned col = 0; col < _hf->width(); ++col)
+        const Heightfield* hf = _hf.get();
+        hf->forEachHeight([this](float h)
             {
-                float h = _hf->heightAt(col, row);
                 _maxHeight = std::max(_maxHeight, h);
                 _minHeight = std::min(_minHeight, h);
-            }
-        }
+            });
     }
 }
 
+GeoHeightfield
+GeoHeightfield::encode(Image::PixelFormat format) const
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(valid(), GeoHeightfield::INVALID);
+
+    if (_hf->pixelFormat() == format)
+        return *this;
+
+    // the min height includes NO_DATA_VALUE when the grid has holes;
+    // in that case let the encoder find the range of valid heights.
+    auto hf = _minHeight == NO_DATA_VALUE ?
+        _hf->encode(format) :
+        _hf->encode(format, _minHeight, _maxHeight);
+
+    return hf ? GeoHeightfield(hf, _extent) : GeoHeightfield::INVALID;
+}
+
 float
 GeoHeightfield::heightAtLocation(
     double x,
@@ -92,6 +92,11 @@ namespace ROCKY_NAMESPACE
         //! The maximum height in the heightfield
         float maxHeight() const { return _maxHeight; }
 
+        //! Copy of this heightfield in a compact 16-bit encoding (R16_UNORM
+        //! or R16_SFLOAT), quantized over this object's height range.
+        //! See Heightfield::encode.
+        GeoHeightfield encode(Image::PixelFormat format) const;
+
         //! Gets a pointer to the underlying OSG heightfield.
         shared_ptr<Heightfield> heightfield() const {
             return _hf;
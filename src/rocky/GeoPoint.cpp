@@ -1,6 +1,8 @@
 #include "GeoPoint.h"
+#include "GeoCommon.h"
 #include "Math.h"
 #include "Utils.h"
+#include <algorithm>
 
 using namespace ROCKY_NAMESPACE;
 using namespace ROCKY_NAMESPACE::util;
@@ -77,6 +79,47 @@ GeoPoint::transformInPlace(const SRS& to_srs)
     return false;
 }
 
+std::size_t
+GeoPoint::transformArray(GeoPoint* points, std::size_t count, const SRS& to_srs)
+{
+    if (!to_srs.valid())
+        return 0;
+
+    auto groups = groupBySRS(count, [&](std::size_t i) -> const SRS*
+        {
+            return points[i].valid() ? &points[i].srs : nullptr;
+        });
+
+    std::vector<glm::dvec3> v;
+    std::size_t numTransformed = 0;
+
+    for (auto& g : groups)
+    {
+        v.resize(g.indices.size());
+        for (std::size_t k = 0; k < g.indices.size(); ++k)
+        {
+            auto& p = points[g.indices[k]];
+            v[k] = glm::dvec3(p.x, p.y, p.z);
+        }
+
+        auto xform = g.srs.to(to_srs);
+        if (!xform.transformArray(v.data(), v.size()) && !xform.valid())
+            continue;
+
+        for (std::size_t k = 0; k < g.indices.size(); ++k)
+        {
+            // failed points come back from PROJ as HUGE_VAL
+            if (std::isfinite(v[k].x) && std::isfinite(v[k].y) && std::isfinite(v[k].z))
+            {
+                points[g.indices[k]] = GeoPoint(to_srs, v[k]);
+                ++numTransformed;
+            }
+        }
+    }
+
+    return numTransformed;
+}
+
 Distance
 GeoPoint::geodesicDistanceTo(const GeoPoint& rhs) const
 {
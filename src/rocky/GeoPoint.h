@@ -54,6 +54,12 @@ namespace ROCKY_NAMESPACE
         //! Transforms this point in place to another SRS
         bool transformInPlace(const SRS& srs);
 
+        //! Transforms an array of points in place to another SRS. Points are
+        //! grouped by source SRS and each group goes through a single bulk
+        //! transformation. Points that fail to transform are left unchanged.
+        //! @return Number of points successfully transformed
+        static std::size_t transformArray(GeoPoint* points, std::size_t count, const SRS& srs);
+
         //! Geodesic distance from this point to another.
         //! This is the distance along the real-world ellipsoidal surface
         //! of the Earth (or other body), regardless of map projection.
@@ -7,6 +7,7 @@
 #include "Heightfield.h"
 #include "Units.h"
 #include "GeoHeightfield.h"
+#include "Math.h"
 
 #define LC "[Geoid] "
 
@@ -50,3 +51,50 @@ Geoid::getHeight(
 
     return result;
 }
+
+void
+Geoid::getHeights(
+    const glm::dvec3* points,
+    std::size_t count,
+    float* out_heights) const
+{
+    if (!valid() || heightfield->width() < 2 || heightfield->height() < 2)
+    {
+        std::fill(out_heights, out_heights + count, 0.0f);
+        return;
+    }
+
+    if (heightfield->pixelFormat() != Image::R32_SFLOAT)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            out_heights[i] = getHeight(points[i].y, points[i].x);
+        return;
+    }
+
+    // The grid spans the globe with posts on the edges, as in getHeight().
+    // Work straight off the float data so the loop stays tight.
+    const float* data = heightfield->data<float>();
+    const int cols = (int)heightfield->width();
+    const int rows = (int)heightfield->height();
+    const double colsPerDegree = (double)(cols - 1) / 360.0;
+    const double rowsPerDegree = (double)(rows - 1) / 180.0;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        double lon = points[i].x;
+        if (lon < -180.0 || lon > 180.0)
+            lon -= 360.0 * std::floor((lon + 180.0) / 360.0);
+        double px = util::clamp(lon + 180.0, 0.0, 360.0) * colsPerDegree;
+        double py = util::clamp(points[i].y + 90.0, 0.0, 180.0) * rowsPerDegree;
+
+        int c = std::min((int)px, cols - 2);
+        int r = std::min((int)py, rows - 2);
+        double fx = px - (double)c;
+        double fy = py - (double)r;
+
+        const float* p = data + r * cols + c;
+        double south = (1.0 - fx) * (double)p[0] + fx * (double)p[1];
+        double north = (1.0 - fx) * (double)p[cols] + fx * (double)p[cols + 1];
+        out_heights[i] = (float)((1.0 - fy) * south + fy * north);
+    }
+}
@@ -37,6 +37,14 @@ namespace ROCKY_NAMESPACE
             double lon_deg, 
             Heightfield::Interpolation interp = Heightfield::BILINEAR) const;
 
+        //! Queries the geoid for the height offsets at many geodetic points at
+        //! once (x = longitude, y = latitude, in degrees; z is ignored), with
+        //! bilinear interpolation.
+        void getHeights(
+            const glm::dvec3* points,
+            std::size_t count,
+            float* out_heights) const;
+
         //! Whether this is a valid object to use
         bool valid() const;
     };
@@ -5,6 +5,8 @@
  */
 #include "Heightfield.h"
 #include "GeoCommon.h"
+#include "Utils.h"
+#include <cmath>
 
 using namespace ROCKY_NAMESPACE;
 
@@ -58,6 +60,12 @@ Heightfield::Heightfield(unsigned cols, unsigned rows) :
     //nop
 }
 
+Heightfield::Heightfield(unsigned cols, unsigned rows, PixelFormat format) :
+    super(isHeightfieldFormat(format) ? format : Image::R32_SFLOAT, cols, rows, 1)
+{
+    //nop
+}
+
 Heightfield::Heightfield(Image* image)
 {
     if (image)
@@ -66,6 +74,12 @@ Heightfield::Heightfield(Image* image)
         _width = image->width();
         _height = image->height();
         _depth = image->depth();
+        _mipmapLevels = image->mipmapLevels();
+        if (auto hf = cast_from(image))
+        {
+            _valueScale = hf->heightScale();
+            _valueOffset = hf->heightOffset();
+        }
         _data = image->releaseData();
     }
 }
@@ -73,12 +87,21 @@ Heightfield::Heightfield(Image* image)
 const Heightfield*
 Heightfield::cast_from(const Image* rhs)
 {
-    if (rhs && rhs->pixelFormat() == PixelFormat::R32_SFLOAT)
+    if (rhs && isHeightfieldFormat(rhs->pixelFormat()))
         return reinterpret_cast<const Heightfield*>(rhs);
     else
         return nullptr;
 }
 
+bool
+Heightfield::isHeightfieldFormat(PixelFormat format)
+{
+    return
+        format == PixelFormat::R32_SFLOAT ||
+        format == PixelFormat::R16_SFLOAT ||
+        format == PixelFormat::R16_UNORM;
+}
+
 float
 Heightfield::heightAtUV(
     double nx, double ny,
@@ -278,7 +301,105 @@ Heightfield::heightAtPixel(
 void
 Heightfield::fill(float value)
 {
+    ROCKY_HARD_ASSERT(pixelFormat() == R32_SFLOAT, "Only R32_SFLOAT heightfields are writable");
     float* ptr = data<float>();
     for (unsigned i = 0; i < sizeInPixels(); ++i)
         *ptr++ = value;
 }
+
+shared_ptr<Heightfield>
+Heightfield::encode(PixelFormat format) const
+{
+    float minHeight = FLT_MAX, maxHeight = -FLT_MAX;
+    forEachHeight([&](float h)
+        {
+            if (h != NO_DATA_VALUE)
+            {
+                minHeight = std::min(minHeight, h);
+                maxHeight = std::max(maxHeight, h);
+            }
+        });
+
+    if (minHeight > maxHeight)
+        minHeight = maxHeight = 0.0f;
+
+    return encode(format, minHeight, maxHeight);
+}
+
+shared_ptr<Heightfield>
+Heightfield::encode(PixelFormat format, float minHeight, float maxHeight) const
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(valid() && isHeightfieldFormat(format), nullptr);
+
+    if (format == R32_SFLOAT)
+        return decode();
+
+    if (minHeight > maxHeight)
+        std::swap(minHeight, maxHeight);
+
+    auto output = Heightfield::create(width(), height(), format);
+    auto out = output->data<std::uint16_t>();
+    unsigned i = 0;
+
+    if (format == R16_UNORM)
+    {
+        // Valid heights map to codes [1..65535] and code 0 means NO_DATA_VALUE.
+        // In normalized terms that's height = n * 65535 * step + (min - step).
+        double step = ((double)maxHeight - (double)minHeight) / 65534.0;
+        double invStep = step > 0.0 ? 1.0 / step : 0.0;
+        output->_valueScale = (float)(step * 65535.0);
+        output->_valueOffset = (float)((double)minHeight - step);
+
+        forEachHeight([&](float h)
+            {
+                if (h == NO_DATA_VALUE)
+                {
+                    out[i++] = 0u;
+                }
+                else
+                {
+                    double code = 1.0 + std::round(((double)h - (double)minHeight) * invStep);
+                    out[i++] = (std::uint16_t)clamp(code, 1.0, 65535.0);
+                }
+            });
+    }
+    else // R16_SFLOAT
+    {
+        // clamp to the finite half range, since -inf stands for NO_DATA_VALUE
+        constexpr float half_max = 65504.0f;
+        constexpr std::uint16_t half_nodata = 0xfc00; // -inf
+
+        forEachHeight([&](float h)
+            {
+                out[i++] = h == NO_DATA_VALUE ? half_nodata :
+                    util::float_to_half(clamp(h, -half_max, half_max));
+            });
+    }
+
+    return output;
+}
+
+shared_ptr<Heightfield>
+Heightfield::decode() const
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(valid(), nullptr);
+
+    auto output = Heightfield::create(width(), height());
+    float* out = output->data<float>();
+    forEachHeight([&](float h) { *out++ = h; });
+    return output;
+}
+
+Image::PixelFormat
+Heightfield::encoding(const std::string& name)
+{
+    auto lower = util::toLower(name);
+    if (lower == "float" || lower == "r32")
+        return R32_SFLOAT;
+    else if (lower == "r16" || lower == "quantized")
+        return R16_UNORM;
+    else if (lower == "half" || lower == "r16f")
+        return R16_SFLOAT;
+    else
+        return UNDEFINED;
+}
@@ -6,13 +6,20 @@
 #pragma once
 
 #include <rocky/Image.h>
+#include <limits>
 
 namespace ROCKY_NAMESPACE
 {
     constexpr float NO_DATA_VALUE = -FLT_MAX;
 
     /**
-     * A grid of height values (32-bit floats).
+     * A grid of height values.
+     *
+     * Heights are normally 32-bit floats (R32_SFLOAT). A heightfield may also
+     * use a compact 16-bit encoding (see encode): half floats (R16_SFLOAT), or
+     * R16_UNORM values quantized over the tile's height range that decode as
+     * height = normalized_value * heightScale() + heightOffset().
+     * Only R32_SFLOAT heightfields support writing heights in place.
      */
     class ROCKY_EXPORT Heightfield : public Inherit<Image, Heightfield>
     {
@@ -25,6 +32,13 @@ namespace ROCKY_NAMESPACE
             unsigned cols,
             unsigned rows);
 
+        //! Construct a heightfield with the given dimensions and encoding
+        //! (R32_SFLOAT, R16_SFLOAT or R16_UNORM)
+        Heightfield(
+            unsigned cols,
+            unsigned rows,
+            PixelFormat format);
+
         //! Make a heightfield, stealing data from an image.
         explicit Heightfield(Image* rhs);
 
@@ -33,15 +47,28 @@ namespace ROCKY_NAMESPACE
         //! usage: auto hf = Heightfield::cast_from(image);
         static const Heightfield* cast_from(const Image* rhs);
 
-        //! Access the height value at col, row
+        //! Whether the pixel format is one that a heightfield can use
+        static bool isHeightfieldFormat(PixelFormat format);
+
+        //! Access the height value at col, row (R32_SFLOAT only)
         inline float& heightAt(unsigned col, unsigned row);
+
+        //! Height value at col, row, in any encoding
         inline float heightAt(unsigned col, unsigned row) const;
 
+        //! Scale that decodes normalized R16_UNORM heights (1 for other encodings)
+        float heightScale() const { return _valueScale; }
+
+        //! Offset that decodes normalized R16_UNORM heights (0 for other encodings)
+        float heightOffset() const { return _valueOffset; }
+
         //! Visits each height in the field with a user-provided function
-        //! that takes "float" or "float&" as an argument.
+        //! that takes "float" or "float&" as an argument. (R32_SFLOAT only)
         template<typename FUNC>
         void forEachHeight(FUNC func);
 
+        //! Visits each height in the field, in any encoding, with a
+        //! user-provided function that takes "float" as an argument.
         template<typename FUNC>
         void forEachHeight(FUNC func) const;
 
@@ -55,8 +82,33 @@ namespace ROCKY_NAMESPACE
             double col, double row,
             Interpolation interp = BILINEAR) const;
 
-        //! Fill with a single height value
+        //! Fill with a single height value (R32_SFLOAT only)
         void fill(float value);
+
+        //! Creates a copy of this heightfield in a compact 16-bit encoding.
+        //! R16_UNORM quantizes heights over [minHeight, maxHeight], for an error of
+        //! at most (maxHeight - minHeight) / 131068. R16_SFLOAT stores half floats,
+        //! for a relative error of at most 2^-11, clamped to +/-65504.
+        //! NO_DATA_VALUE survives either encoding. Passing R32_SFLOAT decodes.
+        shared_ptr<Heightfield> encode(
+            PixelFormat format,
+            float minHeight,
+            float maxHeight) const;
+
+        //! Creates a copy of this heightfield in a compact 16-bit encoding,
+        //! quantizing over the range of valid heights in the data.
+        shared_ptr<Heightfield> encode(
+            PixelFormat format) const;
+
+        //! Creates a full precision (R32_SFLOAT) copy of this heightfield.
+        shared_ptr<Heightfield> decode() const;
+
+        //! Resolves an encoding name ("float", "r16" or "half") to a pixel format.
+        //! Returns UNDEFINED for an unknown name.
+        static PixelFormat encoding(const std::string& name);
+
+    private:
+        inline float decodeHeight(std::uint16_t value) const;
     };
 
 
@@ -64,17 +116,37 @@ namespace ROCKY_NAMESPACE
 
     float& Heightfield::heightAt(unsigned c, unsigned r)
     {
+        ROCKY_HARD_ASSERT(_pixelFormat == R32_SFLOAT, "Only R32_SFLOAT heightfields are writable");
         return data<float>(c, r);
     }
 
     float Heightfield::heightAt(unsigned c, unsigned r) const
     {
-        return data<float>(c, r);
-    }    
+        if (_pixelFormat == R32_SFLOAT)
+            return data<float>(c, r);
+        else
+            return decodeHeight(data<std::uint16_t>(c, r));
+    }
+
+    float Heightfield::decodeHeight(std::uint16_t value) const
+    {
+        if (_pixelFormat == R16_UNORM)
+        {
+            // zero is reserved for NO_DATA_VALUE
+            return value == 0u ? NO_DATA_VALUE :
+                (float)value * (_valueScale / 65535.0f) + _valueOffset;
+        }
+        else
+        {
+            float h = util::half_to_float(value);
+            return h == -std::numeric_limits<float>::infinity() ? NO_DATA_VALUE : h;
+        }
+    }
 
     template<typename FUNC>
     void Heightfield::forEachHeight(FUNC func)
     {
+        ROCKY_HARD_ASSERT(_pixelFormat == R32_SFLOAT, "Only R32_SFLOAT heightfields are writable");
         float* ptr = data<float>();
         for (auto i = 0u; i < sizeInPixels(); ++i, ++ptr)
             func(*ptr);
@@ -83,8 +155,17 @@ namespace ROCKY_NAMESPACE
     template<typename FUNC>
     void Heightfield::forEachHeight(FUNC func) const
     {
-        const float* ptr = data<float>();
-        for (auto i = 0u; i < sizeInPixels(); ++i, ++ptr)
-            func(*ptr);
+        if (_pixelFormat == R32_SFLOAT)
+        {
+            const float* ptr = data<float>();
+            for (auto i = 0u; i < sizeInPixels(); ++i, ++ptr)
+                func(*ptr);
+        }
+        else
+        {
+            const std::uint16_t* ptr = data<std::uint16_t>();
+            for (auto i = 0u; i < sizeInPixels(); ++i, ++ptr)
+                func(decodeHeight(*ptr));
+        }
     }
 }
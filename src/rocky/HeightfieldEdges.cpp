@@ -0,0 +1,127 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "HeightfieldEdges.h"
+#include "Heightfield.h"
+
+#include <vector>
+
+using namespace ROCKY_NAMESPACE;
+
+HeightfieldEdges::Side
+HeightfieldEdges::opposite(Side side)
+{
+    return
+        side == WEST ? EAST :
+        side == EAST ? WEST :
+        side == SOUTH ? NORTH :
+        SOUTH;
+}
+
+unsigned
+HeightfieldEdges::numSamples(const Heightfield& hf, Side side)
+{
+    return (side == WEST || side == EAST) ? hf.height() : hf.width();
+}
+
+void
+HeightfieldEdges::sampleAt(const Heightfield& hf, Side side, unsigned i, unsigned& col, unsigned& row)
+{
+    switch (side)
+    {
+    case WEST:  col = 0;               row = i; break;
+    case EAST:  col = hf.width() - 1;  row = i; break;
+    case SOUTH: col = i; row = 0;               break;
+    case NORTH: col = i; row = hf.height() - 1; break;
+    }
+}
+
+bool
+HeightfieldEdges::average(Heightfield& hf, Side side, const Heightfield& neighbor)
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(hf.pixelFormat() == Image::R32_SFLOAT, false);
+
+    auto other = opposite(side);
+    unsigned n = numSamples(hf, side);
+    if (n != numSamples(neighbor, other))
+        return false;
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        unsigned c, r, nc, nr;
+        sampleAt(hf, side, i, c, r);
+        sampleAt(neighbor, other, i, nc, nr);
+
+        float a = hf.heightAt(c, r);
+        float b = neighbor.heightAt(nc, nr);
+
+        // a hole on one side takes the height from the other
+        if (a == NO_DATA_VALUE)
+            hf.heightAt(c, r) = b;
+        else if (b != NO_DATA_VALUE)
+            hf.heightAt(c, r) = 0.5f * (a + b);
+    }
+    return true;
+}
+
+float
+HeightfieldEdges::boundaryHeight(
+    const Heightfield& hf,
+    const glm::dmat4& matrix,
+    unsigned segments,
+    double u,
+    double v)
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(segments > 0, 0.0f);
+
+    // sampled as the terrain vertex shader does: the matrix scales both axes alike
+    auto vertexHeight = [&](double vu, double vv)
+        {
+            return hf.heightAtUV(
+                vu * matrix[0][0] + matrix[3][0],
+                vv * matrix[0][0] + matrix[3][1]);
+        };
+
+    u = clamp(u, 0.0, 1.0);
+    v = clamp(v, 0.0, 1.0);
+
+    // walk along whichever side the point is on
+    bool vertical = (u == 0.0 || u == 1.0);
+    double s = (vertical ? v : u) * (double)segments;
+    unsigned k = std::min((unsigned)s, segments - 1);
+    double t0 = (double)k / (double)segments;
+    double t1 = (double)(k + 1) / (double)segments;
+    float f = (float)(s - (double)k);
+
+    float h0 = vertical ? vertexHeight(u, t0) : vertexHeight(t0, v);
+    float h1 = vertical ? vertexHeight(u, t1) : vertexHeight(t1, v);
+    return h0 + (h1 - h0) * f;
+}
+
+void
+HeightfieldEdges::follow(
+    Heightfield& hf,
+    Side side,
+    const Heightfield& neighbor,
+    const glm::dmat4& matrix,
+    unsigned segments,
+    double start,
+    double end)
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(hf.pixelFormat() == Image::R32_SFLOAT, void());
+
+    auto other = opposite(side);
+    unsigned n = numSamples(hf, side);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        double t = start + (end - start) * (double)i / (double)(n - 1);
+        double u = other == WEST ? 0.0 : other == EAST ? 1.0 : t;
+        double v = other == SOUTH ? 0.0 : other == NORTH ? 1.0 : t;
+
+        unsigned c, r;
+        sampleAt(hf, side, i, c, r);
+        hf.heightAt(c, r) = boundaryHeight(neighbor, matrix, segments, u, v);
+    }
+}
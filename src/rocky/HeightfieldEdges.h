@@ -0,0 +1,86 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/Common.h>
+#include <rocky/Math.h>
+
+namespace ROCKY_NAMESPACE
+{
+    class Heightfield;
+
+    /**
+     * Makes the heightfields of adjacent terrain tiles agree along their
+     * shared edges, so that the tiles meet without cracks and need no skirts.
+     *
+     * A side of a tile either averages with the neighbor at the same level of
+     * detail, sample for sample, or follows whatever surface the neighbor
+     * draws there: straight segments between the neighbor's vertices, which
+     * may be coarser than the tile's own. Running average() on each of two
+     * neighbors with the other's original data gives both the same samples.
+     *
+     * All functions write into an R32_SFLOAT heightfield (see Heightfield::decode).
+     */
+    class ROCKY_EXPORT HeightfieldEdges
+    {
+    public:
+        //! Side of a heightfield. Row 0 is the south side.
+        enum Side { WEST, EAST, SOUTH, NORTH };
+
+        //! Side a neighbor shares with the given side of a heightfield
+        static Side opposite(Side side);
+
+        //! Number of samples along a side
+        static unsigned numSamples(const Heightfield& hf, Side side);
+
+        //! Column and row of a sample along a side, counting west to
+        //! east or south to north
+        static void sampleAt(const Heightfield& hf, Side side, unsigned i, unsigned& col, unsigned& row);
+
+        //! Averages the samples along one side of a heightfield with those
+        //! along the opposite side of the neighbor at the same level of detail.
+        //! @param hf Heightfield to change (R32_SFLOAT)
+        //! @param side Side of hf to average
+        //! @param neighbor Original data of the neighbor across that side
+        //! @return False if the sides are not the same size, leaving hf as is
+        static bool average(Heightfield& hf, Side side, const Heightfield& neighbor);
+
+        //! Height of the surface a tile draws at a point on its boundary: the
+        //! straight line between the vertices on either side of the point.
+        //! @param hf Heightfield the tile draws, in any encoding
+        //! @param matrix Scale/bias from the tile's coordinates to the coordinates
+        //!    of its heightfield (identity unless it inherits an ancestor's)
+        //! @param segments Number of segments along a side of the tile's geometry
+        //!    (tile size - 1)
+        //! @param u, v Point in the tile's coordinates, [0..1]; one of them 0 or 1
+        static float boundaryHeight(
+            const Heightfield& hf,
+            const glm::dmat4& matrix,
+            unsigned segments,
+            double u,
+            double v);
+
+        //! Moves the samples along one side of a heightfield onto the surface
+        //! a neighbor draws across it.
+        //! @param hf Heightfield to change (R32_SFLOAT)
+        //! @param side Side of hf to change
+        //! @param neighbor Heightfield the neighbor draws, in any encoding
+        //! @param matrix Scale/bias from the neighbor's tile coordinates to the
+        //!    coordinates of its heightfield (identity unless it inherits an ancestor's)
+        //! @param segments Number of segments along a side of the neighbor's geometry
+        //!    (tile size - 1)
+        //! @param start, end Span of the side of hf along the neighbor's side, [0..1],
+        //!    e.g. [0.5..1] for the upper half of a neighbor one LOD coarser
+        static void follow(
+            Heightfield& hf,
+            Side side,
+            const Heightfield& neighbor,
+            const glm::dmat4& matrix,
+            unsigned segments,
+            double start = 0.0,
+            double end = 1.0);
+    };
+}
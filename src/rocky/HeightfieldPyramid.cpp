@@ -0,0 +1,158 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "HeightfieldPyramid.h"
+#include "Heightfield.h"
+#include "Math.h"
+#include <cmath>
+
+using namespace ROCKY_NAMESPACE;
+
+namespace
+{
+    // grid cells (along each side) in one range of the bottom level; a range
+    // per cell would take more memory than the heightfield itself
+    constexpr unsigned cells_per_block = 4;
+
+    // most ranges a query will visit before moving up a level
+    constexpr unsigned max_ranges_per_query = 16;
+}
+
+HeightfieldPyramid::HeightfieldPyramid(const Heightfield* hf)
+{
+    if (!hf || hf->width() == 0 || hf->height() == 0)
+        return;
+
+    // decode each sample once
+    const unsigned w = hf->width(), h = hf->height();
+    std::vector<float> heights(w * h);
+    for (unsigned r = 0; r < h; ++r)
+        for (unsigned c = 0; c < w; ++c)
+            heights[r * w + c] = hf->heightAt(c, r);
+
+    _cols = std::max(w - 1, 1u);
+    _rows = std::max(h - 1, 1u);
+
+    // bottom level: the samples at the corners of a block of cells
+    Level base;
+    base.cols = (_cols + cells_per_block - 1) / cells_per_block;
+    base.rows = (_rows + cells_per_block - 1) / cells_per_block;
+    base.ranges.resize(base.cols * base.rows);
+
+    for (unsigned r = 0; r < base.rows; ++r)
+    {
+        unsigned sr0 = r * cells_per_block, sr1 = std::min(sr0 + cells_per_block, h - 1);
+        for (unsigned c = 0; c < base.cols; ++c)
+        {
+            unsigned sc0 = c * cells_per_block, sc1 = std::min(sc0 + cells_per_block, w - 1);
+            Range range = { FLT_MAX, -FLT_MAX };
+            for (unsigned sr = sr0; sr <= sr1; ++sr)
+            {
+                for (unsigned sc = sc0; sc <= sc1; ++sc)
+                {
+                    float s = heights[sr * w + sc];
+                    if (s != NO_DATA_VALUE)
+                    {
+                        range.min = std::min(range.min, s);
+                        range.max = std::max(range.max, s);
+                    }
+                }
+            }
+            base.ranges[r * base.cols + c] = range;
+        }
+    }
+
+    _levels.emplace_back(std::move(base));
+
+    // each level above merges 2x2 ranges of the one below, up to a single range
+    while (_levels.back().cols > 1 || _levels.back().rows > 1)
+    {
+        const Level& below = _levels.back();
+
+        Level level;
+        level.cols = (below.cols + 1) / 2;
+        level.rows = (below.rows + 1) / 2;
+        level.ranges.resize(level.cols * level.rows);
+
+        for (unsigned r = 0; r < level.rows; ++r)
+        {
+            for (unsigned c = 0; c < level.cols; ++c)
+            {
+                Range range = { FLT_MAX, -FLT_MAX };
+                for (unsigned rr = 2 * r; rr < std::min(2 * r + 2, below.rows); ++rr)
+                {
+                    for (unsigned cc = 2 * c; cc < std::min(2 * c + 2, below.cols); ++cc)
+                    {
+                        auto& b = below.ranges[rr * below.cols + cc];
+                        range.min = std::min(range.min, b.min);
+                        range.max = std::max(range.max, b.max);
+                    }
+                }
+                level.ranges[r * level.cols + c] = range;
+            }
+        }
+
+        _levels.emplace_back(std::move(level));
+    }
+}
+
+bool
+HeightfieldPyramid::heightRange(double u0, double v0, double u1, double v1, float& out_min, float& out_max) const
+{
+    out_min = FLT_MAX, out_max = -FLT_MAX;
+
+    if (!valid())
+        return false;
+
+    if (u0 > u1) std::swap(u0, u1);
+    if (v0 > v1) std::swap(v0, v1);
+
+    // grid cells touched by the window. A sample on a cell boundary
+    // is a corner of the cells on both sides, so one will do.
+    auto firstCell = [](double t, unsigned cells) {
+        return (unsigned)clamp(std::floor(clamp(t, 0.0, 1.0) * cells), 0.0, (double)(cells - 1));
+    };
+    auto lastCell = [](double t, unsigned cells) {
+        return (unsigned)clamp(std::ceil(clamp(t, 0.0, 1.0) * cells) - 1.0, 0.0, (double)(cells - 1));
+    };
+
+    unsigned c0 = firstCell(u0, _cols), c1 = std::max(c0, lastCell(u1, _cols));
+    unsigned r0 = firstCell(v0, _rows), r1 = std::max(r0, lastCell(v1, _rows));
+
+    // and the bottom level ranges that hold them
+    c0 /= cells_per_block, c1 /= cells_per_block;
+    r0 /= cells_per_block, r1 /= cells_per_block;
+
+    // climb until the window covers only a few ranges; coarser ranges
+    // contain finer ones, so the result stays conservative.
+    unsigned L = 0;
+    while (L + 1 < _levels.size() &&
+        ((c1 >> L) - (c0 >> L) + 1) * ((r1 >> L) - (r0 >> L) + 1) > max_ranges_per_query)
+    {
+        ++L;
+    }
+
+    auto& level = _levels[L];
+    for (unsigned r = r0 >> L; r <= (r1 >> L); ++r)
+    {
+        for (unsigned c = c0 >> L; c <= (c1 >> L); ++c)
+        {
+            auto& range = level.ranges[r * level.cols + c];
+            out_min = std::min(out_min, range.min);
+            out_max = std::max(out_max, range.max);
+        }
+    }
+
+    return out_min <= out_max;
+}
+
+std::size_t
+HeightfieldPyramid::sizeInBytes() const
+{
+    std::size_t size = sizeof(HeightfieldPyramid);
+    for (auto& level : _levels)
+        size += level.ranges.size() * sizeof(Range);
+    return size;
+}
@@ -0,0 +1,73 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/Common.h>
+#include <vector>
+
+namespace ROCKY_NAMESPACE
+{
+    class Heightfield;
+
+    /**
+     * Min/max pyramid over the heights of a Heightfield.
+     *
+     * The bottom level holds the range of each small block of grid cells (the
+     * samples at their corners); each level above it merges 2x2 ranges of the
+     * level below. Any height sampled inside a cell, nearest or bilinear, falls
+     * within the range of the samples at its corners, so a query returns a
+     * conservative range for a window of the heightfield by visiting a handful
+     * of ranges instead of every sample.
+     *
+     * Build it once, when the heightfield is created; it does not track
+     * later changes to the heights.
+     */
+    class ROCKY_EXPORT HeightfieldPyramid
+    {
+    public:
+        //! Construct an empty (invalid) pyramid
+        HeightfieldPyramid() = default;
+
+        //! Build a pyramid over a heightfield, in any encoding.
+        //! NO_DATA_VALUE samples are left out of the ranges.
+        explicit HeightfieldPyramid(const Heightfield* heightfield);
+
+        //! Whether the pyramid holds any data
+        bool valid() const {
+            return !_levels.empty();
+        }
+
+        //! Number of levels, including the bottom level
+        unsigned numLevels() const {
+            return (unsigned)_levels.size();
+        }
+
+        //! Conservative range of the heights in a window of the heightfield.
+        //! @param u0, v0, u1, v1 Window in normalized [0..1] coordinates
+        //!    (same as Heightfield::heightAtUV)
+        //! @param out_min, out_max Range of heights in the window
+        //! @return False if the window holds no valid heights
+        bool heightRange(
+            double u0, double v0, double u1, double v1,
+            float& out_min, float& out_max) const;
+
+        //! Memory used by the pyramid, in bytes
+        std::size_t sizeInBytes() const;
+
+    private:
+        struct Range {
+            float min, max;
+        };
+
+        struct Level {
+            unsigned cols, rows;
+            std::vector<Range> ranges;
+        };
+
+        std::vector<Level> _levels;
+        unsigned _cols = 0, _rows = 0; // grid cells in the heightfield
+    };
+}
@@ -157,6 +157,67 @@ Horizon::isVisible(double x, double y, double z, double radius) const
     return false;
 }
 
+bool
+Horizon::computeOcclusionPoint(const Ellipsoid& em, const glm::dvec3* points, std::size_t count, glm::dvec3& out_point)
+{
+    if (points == nullptr || count == 0)
+        return false;
+
+    // Work in "scaled space" where the ellipsoid is a unit sphere.
+    glm::dvec3 scale(1.0 / em.semiMajorAxis(), 1.0 / em.semiMajorAxis(), 1.0 / em.semiMinorAxis());
+
+    // The occlusion point lies along the direction to the center of the points.
+    glm::dvec3 center(0, 0, 0);
+    for (std::size_t i = 0; i < count; ++i)
+        center += points[i];
+
+    if (center == glm::dvec3(0, 0, 0))
+        return false;
+
+    glm::dvec3 direction = glm::normalize(center * scale);
+
+    // For each point, find how far out along that direction a point must be to
+    // share its horizon; the farthest one covers them all.
+    double magnitude = 0.0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        glm::dvec3 p = points[i] * scale;
+        double pmag2 = std::max(glm::dot(p, p), 1.0);
+        double pmag = sqrt(pmag2);
+
+        glm::dvec3 pdir = glm::normalize(p);
+        double cosAlpha = glm::dot(pdir, direction);
+        double sinAlpha = glm::length(glm::cross(pdir, direction));
+        double cosBeta = 1.0 / pmag;
+        double sinBeta = sqrt(pmag2 - 1.0) * cosBeta;
+
+        double denom = cosAlpha * cosBeta - sinAlpha * sinBeta;
+        if (denom <= 0.0)
+            return false;
+
+        magnitude = std::max(magnitude, 1.0 / denom);
+    }
+
+    out_point = (direction * magnitude) / scale;
+    return true;
+}
+
+bool
+Horizon::isOcclusionPointVisible(const glm::dvec3& point) const
+{
+    if (_valid == false)
+        return true;
+
+    // Same as the horizon plane and cone tests in isVisible, for a single point
+    glm::dvec3 VT = (point - _eye) * _scale;
+
+    double VTdotVC = glm::dot(VT, _VC);
+    if (VTdotVC <= _VHmag2)
+        return true;
+
+    return (VTdotVC * VTdotVC) / glm::dot(VT, VT) <= _VHmag2;
+}
+
 #if 0
 bool
 Horizon::getPlane(osg::Plane& out_plane) const
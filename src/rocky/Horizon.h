@@ -45,6 +45,27 @@ namespace ROCKY_NAMESPACE
         //! @return true if the point is visible
         bool isVisible(double x, double y, double z, double radius = 0.0) const;
 
+        //! Computes a "horizon occlusion point" for a set of points. If the
+        //! occlusion point is below the horizon, so are all of the points,
+        //! which makes it a one-point horizon test for a whole tile.
+        //! ref: https://cesium.com/blog/2013/05/09/computing-the-horizon-occlusion-point/
+        //! @param ellipsoid Ellipsoid that defines the horizon
+        //! @param points Points in geocentric coordinates
+        //! @param count Number of points
+        //! @param out_point Occlusion point in geocentric coordinates
+        //! @return False if there is no such point, e.g. when the points
+        //!    span too much of the ellipsoid; never cull those by horizon
+        static bool computeOcclusionPoint(
+            const Ellipsoid& ellipsoid,
+            const glm::dvec3* points,
+            std::size_t count,
+            glm::dvec3& out_point);
+
+        //! Whether an occlusion point (see computeOcclusionPoint) is visible
+        //! over the horizon. If not, neither is anything it was computed for.
+        //! @param point Occlusion point in geocentric coordinates
+        bool isOcclusionPointVisible(const glm::dvec3& point) const;
+
         //! Sets the output variable to the horizon plane plane with its
         //! normal pointing at the eye.
         // bool getPlane(osg::Plane& out_plane) const;
@@ -4,6 +4,11 @@
  * MIT License
  */
 #include "Image.h"
+#include "Metrics.h"
+#include "ImageCompressor.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 using namespace ROCKY_NAMESPACE;
 
@@ -59,23 +64,78 @@ namespace
                 *sptr++ = (T)pixel[i];
         }
     };
+
+    struct HALF {
+        static void read(Image::Pixel& pixel, unsigned char* ptr, int n) {
+            std::uint16_t* sptr = (std::uint16_t*)ptr;
+            for (int i = 0; i < n; ++i)
+                pixel[i] = util::half_to_float(*sptr++);
+        }
+        static void write(const Image::Pixel& pixel, unsigned char* ptr, int n) {
+            std::uint16_t* sptr = (std::uint16_t*)ptr;
+            for (int i = 0; i < n; ++i)
+                *sptr++ = util::float_to_half(pixel[i]);
+        }
+    };
+
+    // Block-compressed formats do not support per-pixel access;
+    // use util::ImageCompressor to convert them.
+    struct BLOCK {
+        static void read(Image::Pixel& pixel, unsigned char* ptr, int n) {
+            pixel = Image::Pixel(0, 0, 0, 0);
+        }
+        static void write(const Image::Pixel& pixel, unsigned char* ptr, int n) {
+            // nop
+        }
+    };
+
+    // flips the first rows (of 4) of 3-bit indices in a BC4-style (BC3 alpha, BC4, BC5) block.
+    inline void flipBC4Block(uchar* block, unsigned rows)
+    {
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 6; ++i)
+            bits |= (std::uint64_t)block[2 + i] << (8 * i);
+
+        std::uint64_t flipped = bits;
+        for (unsigned row = 0; row < rows; ++row)
+        {
+            flipped &= ~(0xFFFull << (12 * row));
+            flipped |= ((bits >> (12 * (rows - 1 - row))) & 0xFFF) << (12 * row);
+        }
+
+        for (int i = 0; i < 6; ++i)
+            block[2 + i] = (uchar)(flipped >> (8 * i));
+    }
+
+    // flips the first rows (of 4) of 2-bit indices in a BC1 block.
+    inline void flipBC1Block(uchar* block, unsigned rows)
+    {
+        std::reverse(block + 4, block + 4 + rows);
+    }
 }
 
 // static member
-Image::Layout Image::_layouts[7] =
-{
-    { &NORM8<uchar>::read, &NORM8<uchar>::write, 1, 1, R8_UNORM },
-    { &NORM8<uchar>::read, &NORM8<uchar>::write, 2, 2, R8G8_UNORM },
-    { &NORM8<uchar>::read, &NORM8<uchar>::write, 3, 3, R8G8B8_UNORM },
-    { &NORM8<uchar>::read, &NORM8<uchar>::write, 4, 4, R8G8B8A8_UNORM },
-    { &NORM16<ushort>::read, &NORM16<ushort>::write, 1, 2, R16_UNORM },
-    { &FLOAT<float>::read, &FLOAT<float>::write, 1, 4, R32_SFLOAT },
-    { &FLOAT<double>::read, &FLOAT<double>::write, 1, 8, R64_SFLOAT }
+Image::Layout Image::_layouts[Image::NUM_PIXEL_FORMATS] =
+{
+    { &NORM8<uchar>::read, &NORM8<uchar>::write, 1, 1, R8_UNORM, 1, 1 },
+    { &NORM8<uchar>::read, &NORM8<uchar>::write, 2, 2, R8G8_UNORM, 1, 2 },
+    { &NORM8<uchar>::read, &NORM8<uchar>::write, 3, 3, R8G8B8_UNORM, 1, 3 },
+    { &NORM8<uchar>::read, &NORM8<uchar>::write, 4, 4, R8G8B8A8_UNORM, 1, 4 },
+    { &NORM16<ushort>::read, &NORM16<ushort>::write, 1, 2, R16_UNORM, 1, 2 },
+    { &FLOAT<float>::read, &FLOAT<float>::write, 1, 4, R32_SFLOAT, 1, 4 },
+    { &FLOAT<double>::read, &FLOAT<double>::write, 1, 8, R64_SFLOAT, 1, 8 },
+    { &HALF::read, &HALF::write, 1, 2, R16_SFLOAT, 1, 2 },
+    { &BLOCK::read, &BLOCK::write, 4, 0, BC1_RGBA_UNORM, 4, 8 },
+    { &BLOCK::read, &BLOCK::write, 4, 0, BC3_UNORM, 4, 16 },
+    { &BLOCK::read, &BLOCK::write, 1, 0, BC4_UNORM, 4, 8 },
+    { &BLOCK::read, &BLOCK::write, 2, 0, BC5_UNORM, 4, 16 },
+    { &BLOCK::read, &BLOCK::write, 4, 0, BC7_UNORM, 4, 16 }
 };
 
 Image::Image() :
     super(),
     _width(0), _height(0), _depth(0),
+    _mipmapLevels(1),
     _pixelFormat(R8G8B8A8_UNORM),
     _data(nullptr)
 {
@@ -86,21 +146,26 @@ Image::Image(
     PixelFormat format,
     unsigned cols,
     unsigned rows,
-    unsigned depth) :
+    unsigned depth,
+    unsigned mipmapLevels) :
     
     super(),
     _width(0), _height(0), _depth(0),
+    _mipmapLevels(1),
     _pixelFormat(R8G8B8A8_UNORM),
     _data(nullptr)
 {
-    allocate(format, cols, rows, depth);
+    allocate(format, cols, rows, depth, mipmapLevels);
 }
 
 Image::Image(const Image& rhs) :
-    super(rhs)
+    super(rhs),
+    _data(nullptr),
+    _valueScale(rhs._valueScale),
+    _valueOffset(rhs._valueOffset)
 {
-    allocate(rhs.pixelFormat(), rhs.width(), rhs.height(), rhs.depth());
-    memcpy(_data, rhs._data, sizeInBytes());
+    allocate(rhs.pixelFormat(), rhs.width(), rhs.height(), rhs.depth(), rhs.mipmapLevels());
+    memcpy(_data, rhs._data, totalSizeInBytes());
 }
 
 Image::Image(Image&& rhs)
@@ -108,7 +173,10 @@ Image::Image(Image&& rhs)
     _width = rhs._width;
     _height = rhs._height;
     _depth = rhs._depth;
+    _mipmapLevels = rhs._mipmapLevels;
     _pixelFormat = rhs._pixelFormat;
+    _valueScale = rhs._valueScale;
+    _valueOffset = rhs._valueOffset;
     _data = rhs.releaseData();
 }
 
@@ -122,7 +190,18 @@ bool
 Image::hasAlphaChannel() const
 {
     return
-        pixelFormat() == R8G8B8A8_UNORM;
+        pixelFormat() == R8G8B8A8_UNORM ||
+        pixelFormat() == BC1_RGBA_UNORM ||
+        pixelFormat() == BC3_UNORM ||
+        pixelFormat() == BC7_UNORM;
+}
+
+bool
+Image::compressed(PixelFormat format)
+{
+    return
+        (unsigned)format < NUM_PIXEL_FORMATS &&
+        _layouts[format].block_size > 1;
 }
 
 shared_ptr<Image>
@@ -131,12 +210,15 @@ Image::clone() const
     ROCKY_SOFT_ASSERT_AND_RETURN(_data, nullptr);
 
     auto clone = Image::create(
-        pixelFormat(), width(), height(), depth());
+        pixelFormat(), width(), height(), depth(), mipmapLevels());
 
     memcpy(
         clone->data<unsigned char*>(),
         _data,
-        sizeInBytes());
+        totalSizeInBytes());
+
+    clone->_valueScale = _valueScale;
+    clone->_valueOffset = _valueOffset;
 
     return clone;
 }
@@ -146,7 +228,8 @@ Image::allocate(
     PixelFormat pixelFormat_,
     unsigned width_,
     unsigned height_,
-    unsigned depth_)
+    unsigned depth_,
+    unsigned mipmapLevels_)
 {
     ROCKY_SOFT_ASSERT_AND_RETURN(
         width_ > 0 && height_ > 0 && depth_ > 0 &&
@@ -157,13 +240,14 @@ Image::allocate(
     _height = height_;
     _depth = depth_;
     _pixelFormat = pixelFormat_;
+    _mipmapLevels = clamp(mipmapLevels_, 1u, maxMipmapLevels(width_, height_));
 
     auto layout = _layouts[pixelFormat()];
 
     if (_data)
         delete[] _data;
 
-    _data = new unsigned char[sizeInBytes()];
+    _data = new unsigned char[totalSizeInBytes()];
 
     // simple init for one-byte images
     if (sizeInBytes() > 0)
@@ -178,6 +262,7 @@ Image::releaseData()
     _width = 0;
     _height = 0;
     _depth = 0;
+    _mipmapLevels = 1;
     return released;
 }
 
@@ -190,7 +275,8 @@ Image::copyAsSubImage(
     if (!valid() || !dst || !dst->valid() ||
         dst_start_col + width() > dst->width() ||
         dst_start_row + height() > dst->height() ||
-        depth() != dst->depth())
+        depth() != dst->depth() ||
+        compressed() || dst->compressed())
     {
         return false;
     }
@@ -211,29 +297,118 @@ Image::copyAsSubImage(
     return true;
 }
 
-void
+bool
 Image::flipVerticalInPlace()
 {
-    ROCKY_TODO("handle compressed pixel formats");
+    if (compressed())
+    {
+        // Blocks flip in place when every pixel row stays in its block row.
+        // BC7 blocks can't, and neither can a partial block row unless it's the
+        // only one; those images go through the decoder instead.
+        bool inPlace = pixelFormat() != BC7_UNORM;
+        for (unsigned level = 0; level < mipmapLevels() && inPlace; ++level)
+            inPlace = mipmapHeight(level) <= blockSize() || mipmapHeight(level) % blockSize() == 0;
 
-    auto layerBytes = sizeInBytes() / depth();
-    auto rowBytes = rowSizeInBytes();
-    auto halfRows = height() / 2;
+        if (!inPlace)
+            return flipCompressedVerticalByDecoding();
+
+        for (unsigned level = 0; level < mipmapLevels(); ++level)
+            flipCompressedVerticalInPlace(level);
+
+        return true;
+    }
+
+    for (unsigned level = 0; level < mipmapLevels(); ++level)
+    {
+        auto layerBytes = sizeof_miplevel(level) / depth();
+        auto rowBytes = mipmapWidth(level) * blockSizeInBytes();
+        auto rows = mipmapHeight(level);
+        auto halfRows = rows / 2;
+
+        for (unsigned d = 0; d < depth(); ++d)
+        {
+            auto layer = data_at_miplevel(level) + d * layerBytes;
+            for (unsigned row = 0; row < halfRows; ++row)
+            {
+                auto antirow = rows - 1 - row;
+                auto row1 = layer + row*rowBytes;
+                auto row2 = layer + antirow*rowBytes;
+                for (unsigned b = 0; b < rowBytes; ++b, ++row1, ++row2)
+                    std::swap(*row1, *row2);
+            }
+        }
+    }
+    return true;
+}
+
+void
+Image::flipCompressedVerticalInPlace(unsigned level)
+{
+    // Swap the rows of blocks, then flip the index rows within each block.
+    // A level shorter than a block only flips the rows it has, so its
+    // padding rows stay at the bottom.
+    auto rowBytes = ((mipmapWidth(level) + blockSize() - 1) / blockSize()) * blockSizeInBytes();
+    auto blockRows = (mipmapHeight(level) + blockSize() - 1) / blockSize();
+    auto layerBytes = rowBytes * blockRows;
+    auto blockBytes = blockSizeInBytes();
+    auto rows = std::min(mipmapHeight(level), blockSize());
 
     for (unsigned d = 0; d < depth(); ++d)
     {
-        unsigned layerOffset = d * layerBytes;
-        for (unsigned row = 0; row < halfRows; ++row)
+        auto layer = data_at_miplevel(level) + d * layerBytes;
+
+        for (unsigned row = 0; row < blockRows / 2; ++row)
         {
-            auto antirow = height() - 1 - row;
-            auto row1 = data<uchar>() + layerOffset + row*rowBytes;
-            auto row2 = data<uchar>() + layerOffset + antirow*rowBytes;
-            for (unsigned b = 0; b < rowBytes; ++b, ++row1, ++row2)
-                std::swap(*row1, *row2);
+            auto row1 = layer + row * rowBytes;
+            auto row2 = layer + (blockRows - 1 - row) * rowBytes;
+            std::swap_ranges(row1, row1 + rowBytes, row2);
+        }
+
+        for (uchar* block = layer; block < layer + layerBytes; block += blockBytes)
+        {
+            switch (pixelFormat())
+            {
+            case BC1_RGBA_UNORM:
+                flipBC1Block(block, rows);
+                break;
+            case BC3_UNORM:
+                flipBC4Block(block, rows);
+                flipBC1Block(block + 8, rows);
+                break;
+            case BC4_UNORM:
+                flipBC4Block(block, rows);
+                break;
+            case BC5_UNORM:
+                flipBC4Block(block, rows);
+                flipBC4Block(block + 8, rows);
+                break;
+            default:
+                break;
+            }
         }
     }
 }
 
+bool
+Image::flipCompressedVerticalByDecoding()
+{
+    util::ImageCompressor compressor;
+
+    auto decoded = compressor.decompress(clone());
+    if (decoded.status.failed())
+        return false;
+
+    decoded.value->flipVerticalInPlace();
+
+    auto encoded = compressor.compress(decoded.value, pixelFormat());
+    if (encoded.status.failed())
+        return false;
+
+    ROCKY_SOFT_ASSERT_AND_RETURN(encoded.value->totalSizeInBytes() == totalSizeInBytes(), false);
+    memcpy(_data, encoded.value->data<uchar>(), totalSizeInBytes());
+    return true;
+}
+
 void
 Image::fill(const Image::Pixel& value)
 {
@@ -242,3 +417,240 @@ Image::fill(const Image::Pixel& value)
             for (unsigned s = 0; s < width(); ++s)
                 write(value, s, t, r);
 }
+
+namespace
+{
+    // Lookup tables for converting between sRGB-encoded bytes and linear floats
+    struct SRGBTables
+    {
+        float toLinear[256];
+        uchar toSRGB[16384];
+
+        SRGBTables()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                float c = (float)i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < 16384; ++i)
+            {
+                float c = (float)i / 16383.0f;
+                float e = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                toSRGB[i] = (uchar)(clamp(e, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+
+        inline uchar encode(float c) const {
+            return toSRGB[(int)(clamp(c, 0.0f, 1.0f) * 16383.0f + 0.5f)];
+        }
+    };
+
+    const SRGBTables& srgbTables()
+    {
+        static const SRGBTables tables;
+        return tables;
+    }
+
+    // modified Bessel function of the first kind, order 0
+    inline double bessel_i0(double x)
+    {
+        double sum = 1.0, term = 1.0, q = x * x * 0.25;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= q / (double)(k * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Taps of a Kaiser-windowed sinc for 2:1 decimation. Output pixel x sits
+    // between source pixels 2x and 2x+1, so the taps cover 2x-2 .. 2x+3.
+    struct KaiserKernel
+    {
+        static constexpr int size = 6;
+        float weights[size];
+
+        KaiserKernel(double alpha = 4.0, double radius = 3.0)
+        {
+            double total = 0.0;
+            for (int i = 0; i < size; ++i)
+            {
+                double d = (double)(i - 2) - 0.5; // distance from the output center, in source pixels
+                double x = d * 0.5; // ... in output pixels
+                double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+                double r = d / radius;
+                double window = bessel_i0(alpha * std::sqrt(std::max(0.0, 1.0 - r * r))) / bessel_i0(alpha);
+                weights[i] = (float)(sinc * window);
+                total += weights[i];
+            }
+            for (int i = 0; i < size; ++i)
+                weights[i] = (float)(weights[i] / total);
+        }
+    };
+
+    // Halves an interleaved float image (n components per pixel) in each dimension.
+    // Edges are clamped; a dimension of 1 stays 1.
+    void downsample(
+        const std::vector<float>& src, unsigned sw, unsigned sh,
+        std::vector<float>& dst, unsigned dw, unsigned dh,
+        unsigned n, Image::MipmapFilter filter, std::vector<float>& temp)
+    {
+        dst.resize(dw * dh * n);
+
+        if (filter == Image::BOX)
+        {
+            for (unsigned y = 0; y < dh; ++y)
+            {
+                const float* row0 = &src[std::min(2 * y, sh - 1) * sw * n];
+                const float* row1 = &src[std::min(2 * y + 1, sh - 1) * sw * n];
+                float* out = &dst[y * dw * n];
+
+                for (unsigned x = 0; x < dw; ++x)
+                {
+                    unsigned x0 = std::min(2 * x, sw - 1) * n;
+                    unsigned x1 = std::min(2 * x + 1, sw - 1) * n;
+                    for (unsigned c = 0; c < n; ++c)
+                        *out++ = 0.25f * (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]);
+                }
+            }
+        }
+        else
+        {
+            static const KaiserKernel kernel;
+
+            // horizontal pass into temp (dw x sh)
+            temp.assign(dw * sh * n, 0.0f);
+            for (unsigned y = 0; y < sh; ++y)
+            {
+                const float* row = &src[y * sw * n];
+                float* out = &temp[y * dw * n];
+                for (unsigned x = 0; x < dw; ++x, out += n)
+                {
+                    for (int k = 0; k < KaiserKernel::size; ++k)
+                    {
+                        int sx = clamp((int)(2 * x) + k - 2, 0, (int)sw - 1);
+                        const float* in = row + sx * n;
+                        for (unsigned c = 0; c < n; ++c)
+                            out[c] += kernel.weights[k] * in[c];
+                    }
+                }
+            }
+
+            // vertical pass into dst (dw x dh)
+            std::fill(dst.begin(), dst.end(), 0.0f);
+            const unsigned rowLen = dw * n;
+            for (unsigned y = 0; y < dh; ++y)
+            {
+                float* out = &dst[y * rowLen];
+                for (int k = 0; k < KaiserKernel::size; ++k)
+                {
+                    int sy = clamp((int)(2 * y) + k - 2, 0, (int)sh - 1);
+                    const float* in = &temp[sy * rowLen];
+                    const float w = kernel.weights[k];
+                    for (unsigned i = 0; i < rowLen; ++i)
+                        out[i] += w * in[i];
+                }
+            }
+        }
+    }
+}
+
+unsigned
+Image::maxMipmapLevels(unsigned width, unsigned height)
+{
+    unsigned levels = 1;
+    while ((std::max(width, height) >> levels) > 0)
+        ++levels;
+    return levels;
+}
+
+bool
+Image::generateMipmaps(MipmapFilter filter, bool srgb)
+{
+    ROCKY_PROFILING_ZONE;
+    ROCKY_SOFT_ASSERT_AND_RETURN(valid(), false);
+
+    if (compressed())
+        return false;
+
+    // grow the buffer to hold the whole chain, keeping the base level
+    auto base = _data;
+    auto baseSize = sizeInBytes();
+    _mipmapLevels = maxMipmapLevels(width(), height());
+    _data = new unsigned char[totalSizeInBytes()];
+    memcpy(_data, base, baseSize);
+    delete[] base;
+
+    const auto& layout = _layouts[pixelFormat()];
+    const unsigned n = layout.num_components;
+    const unsigned bpp = layout.bytes_per_pixel;
+
+    // 8-bit formats are first in the enum
+    const bool bytes = pixelFormat() <= R8G8B8A8_UNORM;
+    const auto& tables = srgbTables();
+
+    // which components hold gamma-encoded color (alpha is always linear)
+    bool gamma[4] = { false, false, false, false };
+    for (unsigned c = 0; c < n; ++c)
+        gamma[c] = srgb && bytes && !(n == 4 && c == 3) && !(n == 2 && c == 1);
+
+    std::vector<float> src, dst, temp;
+    Pixel pixel;
+
+    for (unsigned r = 0; r < depth(); ++r)
+    {
+        // decode the base level to linear floats
+        const unsigned count = width() * height();
+        const uchar* in = data_at_miplevel(0) + r * count * bpp;
+        src.resize(count * n);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (bytes)
+            {
+                for (unsigned c = 0; c < n; ++c)
+                    src[i * n + c] = gamma[c] ? tables.toLinear[in[i * n + c]] : (float)in[i * n + c] * denorm_8;
+            }
+            else
+            {
+                layout.read(pixel, const_cast<uchar*>(in) + i * bpp, n);
+                for (unsigned c = 0; c < n; ++c)
+                    src[i * n + c] = pixel[c];
+            }
+        }
+
+        // filter each level from the previous one, staying in float
+        // so that rounding doesn't accumulate down the chain
+        for (unsigned level = 1; level < mipmapLevels(); ++level)
+        {
+            unsigned sw = mipmapWidth(level - 1), sh = mipmapHeight(level - 1);
+            unsigned dw = mipmapWidth(level), dh = mipmapHeight(level);
+
+            downsample(src, sw, sh, dst, dw, dh, n, filter, temp);
+
+            uchar* out = data_at_miplevel(level) + r * dw * dh * bpp;
+            for (unsigned i = 0; i < dw * dh; ++i)
+            {
+                if (bytes)
+                {
+                    for (unsigned c = 0; c < n; ++c)
+                    {
+                        out[i * n + c] = gamma[c] ?
+                            tables.encode(dst[i * n + c]) :
+                            (uchar)(clamp(dst[i * n + c], 0.0f, 1.0f) * norm_8 + 0.5f);
+                    }
+                }
+                else
+                {
+                    for (unsigned c = 0; c < n; ++c)
+                        pixel[c] = dst[i * n + c];
+                    layout.write(pixel, out + i * bpp, n);
+                }
+            }
+
+            std::swap(src, dst);
+        }
+    }
+
+    return true;
+}
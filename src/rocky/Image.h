@@ -29,6 +29,11 @@ namespace ROCKY_NAMESPACE
             CUBICSPLINE
         };
 
+        enum MipmapFilter {
+            BOX,
+            KAISER
+        };
+
         enum PixelFormat {
             R8_UNORM,
             R8G8_UNORM,
@@ -37,6 +42,12 @@ namespace ROCKY_NAMESPACE
             R16_UNORM,
             R32_SFLOAT,
             R64_SFLOAT,
+            R16_SFLOAT,
+            BC1_RGBA_UNORM,
+            BC3_UNORM,
+            BC4_UNORM,
+            BC5_UNORM,
+            BC7_UNORM,
             NUM_PIXEL_FORMATS,
             UNDEFINED
         };
@@ -56,9 +67,19 @@ namespace ROCKY_NAMESPACE
         //! Pixel format (see PixelFormat enum)
         PixelFormat pixelFormat() const { return _pixelFormat; }
 
+        //! Number of mipmap levels, including the base image
+        unsigned mipmapLevels() const { return _mipmapLevels; }
+
         //! Whether there's an alpha channel
         bool hasAlphaChannel() const;
 
+        //! Whether the pixel format is block-compressed (BCn).
+        //! Compressed images cannot be read or written per-pixel.
+        inline bool compressed() const;
+
+        //! Whether a pixel format is block-compressed (BCn)
+        static bool compressed(PixelFormat format);
+
     public:
         //! Construct an empty (invalid) image
         Image();
@@ -69,7 +90,8 @@ namespace ROCKY_NAMESPACE
             PixelFormat format,
             unsigned s,
             unsigned t,
-            unsigned r = 1);
+            unsigned r = 1,
+            unsigned mipmapLevels = 1);
 
         //! Copy constructor
         Image(const Image& rhs);
@@ -129,15 +151,40 @@ namespace ROCKY_NAMESPACE
             unsigned t,
             unsigned layer = 0);
 
-        //! Size of this image in bytes
+        //! Size of this image in bytes (base level only)
         inline unsigned sizeInBytes() const;
 
+        //! Size of this image in bytes including all mipmap levels
+        inline unsigned totalSizeInBytes() const;
+
+        //! Width of a mipmap level
+        inline unsigned mipmapWidth(unsigned level) const;
+
+        //! Height of a mipmap level
+        inline unsigned mipmapHeight(unsigned level) const;
+
+        //! Size of a mipmap level in bytes
+        inline unsigned sizeof_miplevel(unsigned level) const;
+
+        //! Pointer to the start of a mipmap level
+        inline unsigned char* data_at_miplevel(unsigned level);
+
+        //! Const pointer to the start of a mipmap level
+        inline const unsigned char* data_at_miplevel(unsigned level) const;
+
         //! Size of this image in pixels
         inline unsigned sizeInPixels() const;
 
-        //! Size of a row in bytes
+        //! Size of a row in bytes. For compressed formats this is
+        //! the size of one row of blocks.
         inline unsigned rowSizeInBytes() const;
 
+        //! Width and height of a compression block in pixels (1 if uncompressed)
+        inline unsigned blockSize() const;
+
+        //! Size of a compression block in bytes (pixel size if uncompressed)
+        inline unsigned blockSizeInBytes() const;
+
         //! Size of each pixel component in bytes
         inline unsigned componentSizeInBytes() const;
 
@@ -156,8 +203,27 @@ namespace ROCKY_NAMESPACE
             unsigned width,
             unsigned height) const;
 
-        //! Inverts the pixels in the T dimension
-        void flipVerticalInPlace();
+        //! Inverts the pixels in the T dimension.
+        //! BC7 images, and block-compressed images whose height isn't a whole
+        //! number of blocks, are decoded, flipped and encoded again, which loses
+        //! some quality. Returns false if the image could not be decoded.
+        bool flipVerticalInPlace();
+
+        //! Number of mipmap levels in a full chain for an image of the given size
+        static unsigned maxMipmapLevels(
+            unsigned width,
+            unsigned height);
+
+        //! Generates a full mipmap chain (down to 1x1) and stores it after the
+        //! base level, replacing any existing mipmaps. Compressed images are
+        //! not supported, so generate mipmaps before compressing.
+        //! @param filter Downsampling filter
+        //! @param srgb Whether the 8-bit color channels hold sRGB-encoded values,
+        //!   in which case filtering happens in linear space
+        //! @return True upon success
+        bool generateMipmaps(
+            MipmapFilter filter = BOX,
+            bool srgb = true);
 
         //! Copy this entire image to a sub-location in another image
         bool copyAsSubImage(
@@ -202,14 +268,20 @@ namespace ROCKY_NAMESPACE
 
     protected:
         unsigned _width, _height, _depth;
+        unsigned _mipmapLevels;
         PixelFormat _pixelFormat;
         unsigned char* _data;
 
+        // decoding for quantized values (see Heightfield): value = stored * scale + offset
+        float _valueScale = 1.0f;
+        float _valueOffset = 0.0f;
+
         void allocate(
             PixelFormat format,
             unsigned s,
             unsigned t,
-            unsigned r);
+            unsigned r,
+            unsigned mipmapLevels = 1);
 
         struct Layout {
             void(*read)(Pixel&, unsigned char*, int);
@@ -217,11 +289,13 @@ namespace ROCKY_NAMESPACE
             int num_components;
             int bytes_per_pixel;
             PixelFormat format;
+            int block_size;
+            int bytes_per_block;
         };
-        static Layout _layouts[7];
+        static Layout _layouts[NUM_PIXEL_FORMATS];
 
-        inline unsigned sizeof_miplevel(unsigned level) const;
-        inline unsigned char* data_at_miplevel(unsigned level);
+        void flipCompressedVerticalInPlace(unsigned level);
+        bool flipCompressedVerticalByDecoding();
     };
 
 
@@ -272,13 +346,46 @@ namespace ROCKY_NAMESPACE
     {
         _layouts[pixelFormat()].write(
             pixel,
-            _data + (width()*height()*r + height() * t + s)*_layouts[pixelFormat()].bytes_per_pixel,
+            _data + (width()*height()*r + width()*t + s)*_layouts[pixelFormat()].bytes_per_pixel,
             _layouts[pixelFormat()].num_components);
     }
 
+    bool Image::compressed() const
+    {
+        return _layouts[pixelFormat()].block_size > 1;
+    }
+
+    unsigned Image::blockSize() const
+    {
+        return _layouts[pixelFormat()].block_size;
+    }
+
+    unsigned Image::blockSizeInBytes() const
+    {
+        return _layouts[pixelFormat()].bytes_per_block;
+    }
+
     unsigned Image::sizeInBytes() const
     {
-        return sizeInPixels() * _layouts[pixelFormat()].bytes_per_pixel;
+        return sizeof_miplevel(0);
+    }
+
+    unsigned Image::totalSizeInBytes() const
+    {
+        unsigned total = 0;
+        for (unsigned i = 0; i < mipmapLevels(); ++i)
+            total += sizeof_miplevel(i);
+        return total;
+    }
+
+    unsigned Image::mipmapWidth(unsigned level) const
+    {
+        return std::max(width() >> level, 1u);
+    }
+
+    unsigned Image::mipmapHeight(unsigned level) const
+    {
+        return std::max(height() >> level, 1u);
     }
 
     unsigned Image::sizeInPixels() const
@@ -288,20 +395,33 @@ namespace ROCKY_NAMESPACE
 
     unsigned Image::rowSizeInBytes() const
     {
-        return width() * _layouts[pixelFormat()].bytes_per_pixel;
+        auto b = blockSize();
+        return ((width() + b - 1) / b) * blockSizeInBytes();
     }
 
     unsigned char* Image::data_at_miplevel(unsigned m)
     {
         auto d = _data;
-        for (int i = 0; i < (int)m; ++i)
+        for (unsigned i = 0; i < m; ++i)
+            d += sizeof_miplevel(i);
+        return d;
+    }
+
+    const unsigned char* Image::data_at_miplevel(unsigned m) const
+    {
+        auto d = _data;
+        for (unsigned i = 0; i < m; ++i)
             d += sizeof_miplevel(i);
         return d;
     }
 
     unsigned Image::sizeof_miplevel(unsigned level) const
     {
-        return (width() * height() * depth()) >> level;
+        auto b = blockSize();
+        return
+            ((mipmapWidth(level) + b - 1) / b) *
+            ((mipmapHeight(level) + b - 1) / b) *
+            depth() * blockSizeInBytes();
     }
 
     unsigned Image::numComponents() const
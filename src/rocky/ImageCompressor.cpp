@@ -0,0 +1,912 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "ImageCompressor.h"
+#include "Metrics.h"
+#include "Utils.h"
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+
+using namespace ROCKY_NAMESPACE;
+using namespace ROCKY_NAMESPACE::util;
+
+namespace
+{
+    using uchar = unsigned char;
+
+    // A 4x4 block of RGBA pixels
+    using Block = uchar[16][4];
+
+    // BC7 index interpolation weights (out of 64)
+    constexpr int bc7_weights2[4] = { 0, 21, 43, 64 };
+    constexpr int bc7_weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    constexpr int bc7_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct BitWriter
+    {
+        uchar* out;
+        unsigned pos = 0;
+        BitWriter(uchar* out_) : out(out_) { std::memset(out, 0, 16); }
+        void put(unsigned value, unsigned bits) {
+            for (unsigned i = 0; i < bits; ++i, ++pos)
+                out[pos >> 3] |= ((value >> i) & 1) << (pos & 7);
+        }
+    };
+
+    struct BitReader
+    {
+        const uchar* in;
+        unsigned pos = 0;
+        BitReader(const uchar* in_) : in(in_) { }
+        unsigned get(unsigned bits) {
+            unsigned value = 0;
+            for (unsigned i = 0; i < bits; ++i, ++pos)
+                value |= ((in[pos >> 3] >> (pos & 7)) & 1) << i;
+            return value;
+        }
+    };
+
+    // Gathers a 4x4 block of RGBA pixels, replicating the edge pixels
+    // when the block hangs off the edge of the image.
+    void fetchBlock(const Image& image, unsigned level, unsigned bx, unsigned by, unsigned layer, Block& out)
+    {
+        // the 8-bit unorm formats are first in the enum and we can read them directly.
+        // Other formats go through Image::read, which only sees the base level.
+        const bool bytes = image.pixelFormat() <= Image::R8G8B8A8_UNORM;
+        const unsigned n = image.numComponents();
+        const unsigned width = image.mipmapWidth(level), height = image.mipmapHeight(level);
+        const uchar* data = image.data_at_miplevel(level);
+        Image::Pixel pixel;
+
+        for (unsigned j = 0; j < 4; ++j)
+        {
+            unsigned t = std::min(by * 4 + j, height - 1);
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                unsigned s = std::min(bx * 4 + i, width - 1);
+                auto& p = out[j * 4 + i];
+                if (bytes)
+                {
+                    auto ptr = data + ((layer * height + t) * width + s) * n;
+                    p[0] = ptr[0];
+                    p[1] = n > 1 ? ptr[1] : 0;
+                    p[2] = n > 2 ? ptr[2] : 0;
+                    p[3] = n > 3 ? ptr[3] : 255;
+                }
+                else
+                {
+                    pixel = Image::Pixel(0, 0, 0, 1);
+                    image.read(pixel, s, t, layer);
+                    for (int c = 0; c < 4; ++c)
+                        p[c] = (uchar)(clamp(pixel[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+                }
+            }
+        }
+    }
+
+    // Writes a decoded 4x4 block into an 8-bit image, clipping at the edges.
+    void storeBlock(Image& image, unsigned level, unsigned bx, unsigned by, unsigned layer, const Block& in)
+    {
+        const unsigned n = image.numComponents();
+        const unsigned width = image.mipmapWidth(level), height = image.mipmapHeight(level);
+        uchar* data = image.data_at_miplevel(level);
+
+        for (unsigned j = 0; j < 4 && by * 4 + j < height; ++j)
+        {
+            unsigned t = by * 4 + j;
+            for (unsigned i = 0; i < 4 && bx * 4 + i < width; ++i)
+            {
+                unsigned s = bx * 4 + i;
+                auto ptr = data + ((layer * height + t) * width + s) * n;
+                for (unsigned c = 0; c < n; ++c)
+                    ptr[c] = in[j * 4 + i][c];
+            }
+        }
+    }
+
+    // Finds the endpoints of the line that best fits a set of pixels, by projecting
+    // them onto the principal axis of their covariance (found by power iteration).
+    template<int C>
+    void fitLine(const Block& px, const bool* use, float* lo, float* hi)
+    {
+        float mean[C] = { }, minv[C], maxv[C];
+        for (int c = 0; c < C; ++c)
+            minv[c] = 255.0f, maxv[c] = 0.0f;
+
+        int count = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (!use[i]) continue;
+            for (int c = 0; c < C; ++c)
+            {
+                mean[c] += px[i][c];
+                minv[c] = std::min(minv[c], (float)px[i][c]);
+                maxv[c] = std::max(maxv[c], (float)px[i][c]);
+            }
+            ++count;
+        }
+        for (int c = 0; c < C; ++c)
+            mean[c] /= (float)count;
+
+        float cov[C][C] = { };
+        for (int i = 0; i < 16; ++i)
+        {
+            if (!use[i]) continue;
+            float d[C];
+            for (int c = 0; c < C; ++c)
+                d[c] = (float)px[i][c] - mean[c];
+            for (int a = 0; a < C; ++a)
+                for (int b = 0; b < C; ++b)
+                    cov[a][b] += d[a] * d[b];
+        }
+
+        // start from the bounding box diagonal
+        float axis[C];
+        for (int c = 0; c < C; ++c)
+            axis[c] = maxv[c] - minv[c];
+
+        for (int iter = 0; iter < 8; ++iter)
+        {
+            float v[C] = { }, m = 0.0f;
+            for (int a = 0; a < C; ++a)
+            {
+                for (int b = 0; b < C; ++b)
+                    v[a] += cov[a][b] * axis[b];
+                m = std::max(m, std::abs(v[a]));
+            }
+            if (m < 1e-6f)
+                break;
+            for (int c = 0; c < C; ++c)
+                axis[c] = v[c] / m;
+        }
+
+        float len2 = 0.0f;
+        for (int c = 0; c < C; ++c)
+            len2 += axis[c] * axis[c];
+
+        if (len2 < 1e-12f)
+        {
+            for (int c = 0; c < C; ++c)
+                lo[c] = hi[c] = mean[c];
+            return;
+        }
+
+        float tmin = FLT_MAX, tmax = -FLT_MAX;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (!use[i]) continue;
+            float t = 0.0f;
+            for (int c = 0; c < C; ++c)
+                t += ((float)px[i][c] - mean[c]) * axis[c];
+            tmin = std::min(tmin, t);
+            tmax = std::max(tmax, t);
+        }
+
+        for (int c = 0; c < C; ++c)
+        {
+            lo[c] = clamp(mean[c] + axis[c] * tmin / len2, 0.0f, 255.0f);
+            hi[c] = clamp(mean[c] + axis[c] * tmax / len2, 0.0f, 255.0f);
+        }
+    }
+
+    // Solves for the endpoints that minimize the squared error of pixels
+    // whose positions (0..1) along the line are already known.
+    template<int C>
+    bool leastSquares(const Block& px, const bool* use, const float* w, float* lo, float* hi)
+    {
+        float A = 0, B = 0, D = 0, X[C] = { }, Y[C] = { };
+        for (int i = 0; i < 16; ++i)
+        {
+            if (!use[i]) continue;
+            float a = 1.0f - w[i], b = w[i];
+            A += a * a, B += a * b, D += b * b;
+            for (int c = 0; c < C; ++c)
+                X[c] += a * px[i][c], Y[c] += b * px[i][c];
+        }
+
+        float det = A * D - B * B;
+        if (std::abs(det) < 1e-6f)
+            return false;
+
+        for (int c = 0; c < C; ++c)
+        {
+            lo[c] = clamp((D * X[c] - B * Y[c]) / det, 0.0f, 255.0f);
+            hi[c] = clamp((A * Y[c] - B * X[c]) / det, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    inline std::uint16_t to565(const float* c)
+    {
+        int r = clamp((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+        int g = clamp((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+        int b = clamp((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+        return (std::uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    inline void from565(std::uint16_t v, int* c)
+    {
+        int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+        c[0] = (r << 3) | (r >> 2);
+        c[1] = (g << 2) | (g >> 4);
+        c[2] = (b << 3) | (b >> 2);
+    }
+
+    // Builds the BC1 color palette; returns the number of opaque entries.
+    inline int colorPalette(std::uint16_t c0, std::uint16_t c1, bool fourColorOnly, int pal[4][4])
+    {
+        from565(c0, pal[0]);
+        from565(c1, pal[1]);
+        pal[0][3] = pal[1][3] = 255;
+
+        if (c0 > c1 || fourColorOnly)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                pal[2][c] = (2 * pal[0][c] + pal[1][c] + 1) / 3;
+                pal[3][c] = (pal[0][c] + 2 * pal[1][c] + 1) / 3;
+            }
+            pal[2][3] = pal[3][3] = 255;
+            return 4;
+        }
+        else
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                pal[2][c] = (pal[0][c] + pal[1][c]) / 2;
+                pal[3][c] = 0;
+            }
+            pal[2][3] = 255, pal[3][3] = 0;
+            return 3;
+        }
+    }
+
+    // Encodes the 8-byte BC1 color block. When alpha is true, pixels with alpha < 128
+    // use BC1's punch-through transparent index. The BC3 color block is always
+    // decoded in four-color mode, hence fourColorOnly.
+    void encodeColorBlock(const Block& px, uchar* out, bool alpha, bool fourColorOnly)
+    {
+        bool use[16];
+        int opaque = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            use[i] = !alpha || px[i][3] >= 128;
+            if (use[i]) ++opaque;
+        }
+
+        if (opaque == 0)
+        {
+            // c0 <= c1 selects three-color mode, and index 3 is transparent
+            std::memset(out, 0, 4);
+            std::memset(out + 4, 0xFF, 4);
+            return;
+        }
+
+        bool transparent = opaque < 16;
+
+        float lo[3], hi[3];
+        fitLine<3>(px, use, lo, hi);
+
+        if (!transparent)
+        {
+            // one refinement pass: snap each pixel to the nearest palette
+            // position along the line, then re-fit the endpoints.
+            float d[3] = { hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] };
+            float len2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            if (len2 > 0.0f)
+            {
+                float w[16];
+                for (int i = 0; i < 16; ++i)
+                {
+                    float t = ((px[i][0] - lo[0]) * d[0] + (px[i][1] - lo[1]) * d[1] + (px[i][2] - lo[2]) * d[2]) / len2;
+                    w[i] = std::round(clamp(t, 0.0f, 1.0f) * 3.0f) / 3.0f;
+                }
+                leastSquares<3>(px, use, w, lo, hi);
+            }
+        }
+
+        std::uint16_t c0 = to565(hi), c1 = to565(lo);
+
+        // four-color mode needs c0 > c1; punch-through alpha needs c0 <= c1.
+        if ((!transparent && c0 < c1) || (transparent && c0 > c1))
+            std::swap(c0, c1);
+
+        int pal[4][4];
+        int numColors = colorPalette(c0, c1, fourColorOnly, pal);
+
+        std::uint32_t indices = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 3;
+            if (use[i])
+            {
+                int bestError = INT_MAX;
+                for (int k = 0; k < numColors; ++k)
+                {
+                    int e =
+                        (pal[k][0] - px[i][0]) * (pal[k][0] - px[i][0]) +
+                        (pal[k][1] - px[i][1]) * (pal[k][1] - px[i][1]) +
+                        (pal[k][2] - px[i][2]) * (pal[k][2] - px[i][2]);
+                    if (e < bestError)
+                        bestError = e, best = k;
+                }
+            }
+            indices |= (std::uint32_t)best << (2 * i);
+        }
+
+        out[0] = c0 & 0xFF, out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF, out[3] = c1 >> 8;
+        for (int i = 0; i < 4; ++i)
+            out[4 + i] = (uchar)(indices >> (8 * i));
+    }
+
+    void decodeColorBlock(const uchar* in, Block& out, bool fourColorOnly)
+    {
+        std::uint16_t c0 = in[0] | (in[1] << 8);
+        std::uint16_t c1 = in[2] | (in[3] << 8);
+        int pal[4][4];
+        colorPalette(c0, c1, fourColorOnly, pal);
+
+        std::uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((std::uint32_t)in[7] << 24);
+        for (int i = 0; i < 16; ++i)
+        {
+            auto& p = pal[(indices >> (2 * i)) & 3];
+            for (int c = 0; c < 4; ++c)
+                out[i][c] = (uchar)p[c];
+        }
+    }
+
+    inline void channelPalette(int r0, int r1, int* pal)
+    {
+        pal[0] = r0, pal[1] = r1;
+        if (r0 > r1)
+        {
+            for (int i = 2; i < 8; ++i)
+                pal[i] = ((8 - i) * r0 + (i - 1) * r1 + 3) / 7;
+        }
+        else
+        {
+            for (int i = 2; i < 6; ++i)
+                pal[i] = ((6 - i) * r0 + (i - 1) * r1 + 2) / 5;
+            pal[6] = 0, pal[7] = 255;
+        }
+    }
+
+    // Encodes one channel (BC4, BC5, and the BC3 alpha block)
+    void encodeChannelBlock(const Block& px, int channel, uchar* out)
+    {
+        int lo = 255, hi = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            lo = std::min(lo, (int)px[i][channel]);
+            hi = std::max(hi, (int)px[i][channel]);
+        }
+
+        int pal[8];
+        channelPalette(hi, lo, pal);
+
+        std::uint64_t indices = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = INT_MAX;
+            for (int k = 0; k < 8; ++k)
+            {
+                int e = std::abs(pal[k] - (int)px[i][channel]);
+                if (e < bestError)
+                    bestError = e, best = k;
+            }
+            indices |= (std::uint64_t)best << (3 * i);
+        }
+
+        out[0] = (uchar)hi, out[1] = (uchar)lo;
+        for (int i = 0; i < 6; ++i)
+            out[2 + i] = (uchar)(indices >> (8 * i));
+    }
+
+    void decodeChannelBlock(const uchar* in, int channel, Block& out)
+    {
+        int pal[8];
+        channelPalette(in[0], in[1], pal);
+
+        std::uint64_t indices = 0;
+        for (int i = 0; i < 6; ++i)
+            indices |= (std::uint64_t)in[2 + i] << (8 * i);
+
+        for (int i = 0; i < 16; ++i)
+            out[i][channel] = (uchar)pal[(indices >> (3 * i)) & 7];
+    }
+
+    // Picks the 7-bit endpoint and shared p-bit that best represent an RGBA color.
+    inline void quantizeBC7(const float* v, uchar* e, unsigned& pbit)
+    {
+        float bestError = FLT_MAX;
+        for (unsigned p = 0; p < 2; ++p)
+        {
+            uchar q[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c)
+            {
+                int q7 = clamp((int)std::round((v[c] - (float)p) * 0.5f), 0, 127);
+                q[c] = (uchar)((q7 << 1) | p);
+                error += (q[c] - v[c]) * (q[c] - v[c]);
+            }
+            if (error < bestError)
+            {
+                bestError = error, pbit = p;
+                std::memcpy(e, q, 4);
+            }
+        }
+    }
+
+    inline int bc7Interpolate(int e0, int e1, int w)
+    {
+        return ((64 - w) * e0 + w * e1 + 32) >> 6;
+    }
+
+    // Assigns the best 4-bit index to each pixel; returns the total squared error.
+    int bc7Indices(const Block& px, const uchar e[2][4], unsigned* indices)
+    {
+        int pal[16][4];
+        for (int k = 0; k < 16; ++k)
+            for (int c = 0; c < 4; ++c)
+                pal[k][c] = bc7Interpolate(e[0][c], e[1][c], bc7_weights4[k]);
+
+        int total = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestError = INT_MAX;
+            for (unsigned k = 0; k < 16; ++k)
+            {
+                int error = 0;
+                for (int c = 0; c < 4; ++c)
+                    error += (pal[k][c] - px[i][c]) * (pal[k][c] - px[i][c]);
+                if (error < bestError)
+                    bestError = error, indices[i] = k;
+            }
+            total += bestError;
+        }
+        return total;
+    }
+
+    // Encodes a BC7 block using mode 6 (one subset, RGBA, 7-bit endpoints
+    // plus per-endpoint p-bits, 4-bit indices).
+    void encodeBC7(const Block& px, uchar* out)
+    {
+        bool use[16];
+        std::fill(use, use + 16, true);
+
+        float lo[4], hi[4];
+        fitLine<4>(px, use, lo, hi);
+
+        uchar e[2][4];
+        unsigned p[2];
+        unsigned indices[16];
+        quantizeBC7(lo, e[0], p[0]);
+        quantizeBC7(hi, e[1], p[1]);
+        int error = bc7Indices(px, e, indices);
+
+        // one refinement pass; keep it only if it helps
+        float w[16];
+        for (int i = 0; i < 16; ++i)
+            w[i] = (float)bc7_weights4[indices[i]] / 64.0f;
+
+        if (error > 0 && leastSquares<4>(px, use, w, lo, hi))
+        {
+            uchar e2[2][4];
+            unsigned p2[2];
+            unsigned indices2[16];
+            quantizeBC7(lo, e2[0], p2[0]);
+            quantizeBC7(hi, e2[1], p2[1]);
+            if (bc7Indices(px, e2, indices2) < error)
+            {
+                std::memcpy(e, e2, sizeof(e));
+                std::memcpy(p, p2, sizeof(p));
+                std::memcpy(indices, indices2, sizeof(indices));
+            }
+        }
+
+        // the anchor (first) index is stored without its high bit,
+        // so swap the endpoints if necessary to clear it.
+        if (indices[0] & 8)
+        {
+            for (int c = 0; c < 4; ++c)
+                std::swap(e[0][c], e[1][c]);
+            std::swap(p[0], p[1]);
+            for (int i = 0; i < 16; ++i)
+                indices[i] = 15 - indices[i];
+        }
+
+        BitWriter bits(out);
+        bits.put(1 << 6, 7); // mode 6
+        for (int c = 0; c < 4; ++c)
+        {
+            bits.put(e[0][c] >> 1, 7);
+            bits.put(e[1][c] >> 1, 7);
+        }
+        bits.put(p[0], 1);
+        bits.put(p[1], 1);
+        bits.put(indices[0], 3);
+        for (int i = 1; i < 16; ++i)
+            bits.put(indices[i], 4);
+    }
+
+    // BC7 two-subset partitions; bit i is the subset of pixel i
+    constexpr std::uint16_t bc7_partitions2[64] = {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+        0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+        0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+        0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+        0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22 };
+
+    // BC7 three-subset partitions; bits 2i and 2i+1 are the subset of pixel i
+    constexpr std::uint32_t bc7_partitions3[64] = {
+        0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+        0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+        0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+        0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+        0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+        0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+        0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+        0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254 };
+
+    // BC7 anchor pixels: the second subset of a two-subset partition, and the
+    // second and third subsets of a three-subset partition. (The first subset's
+    // anchor is always pixel 0.) Anchor indices drop their high bit.
+    constexpr uchar bc7_anchors2[64] = {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15 };
+
+    constexpr uchar bc7_anchors3a[64] = {
+         3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+         3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+         8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+         3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3 };
+
+    constexpr uchar bc7_anchors3b[64] = {
+        15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+        15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+        15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+        15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8 };
+
+    // Layout of each BC7 mode
+    struct BC7Mode
+    {
+        unsigned subsets;
+        unsigned partitionBits;
+        unsigned rotationBits;
+        unsigned indexSelectionBits;
+        unsigned colorBits;
+        unsigned alphaBits;
+        unsigned endpointPBits;     // one p-bit per endpoint
+        unsigned sharedPBits;       // one p-bit per subset
+        unsigned indexBits;
+        unsigned indexBits2;        // second index set (modes 4 and 5)
+    };
+
+    constexpr BC7Mode bc7_modes[8] = {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 } };
+
+    inline const int* bc7Weights(unsigned indexBits)
+    {
+        return indexBits == 2 ? bc7_weights2 : indexBits == 3 ? bc7_weights3 : bc7_weights4;
+    }
+
+    // Decodes a BC7 block in any of the eight modes. Returns false for the
+    // reserved mode (a zero first byte), leaving the block transparent black.
+    bool decodeBC7(const uchar* in, Block& out)
+    {
+        unsigned m = 0;
+        while (m < 8 && !(in[0] & (1 << m)))
+            ++m;
+
+        if (m == 8)
+        {
+            std::memset(out, 0, sizeof(Block));
+            return false;
+        }
+
+        const BC7Mode& mode = bc7_modes[m];
+        BitReader bits(in);
+        bits.get(m + 1);
+
+        unsigned partition = bits.get(mode.partitionBits);
+        unsigned rotation = bits.get(mode.rotationBits);
+        unsigned indexSelection = bits.get(mode.indexSelectionBits);
+
+        // endpoints, channel by channel: subset 0 low and high, subset 1 low and high...
+        const unsigned numEndpoints = mode.subsets * 2;
+        int e[6][4];
+        for (unsigned c = 0; c < 4; ++c)
+        {
+            unsigned n = c < 3 ? mode.colorBits : mode.alphaBits;
+            for (unsigned i = 0; i < numEndpoints; ++i)
+                e[i][c] = n > 0 ? bits.get(n) : 255;
+        }
+
+        // p-bits append one more bit of precision
+        unsigned pbits[6] = { };
+        if (mode.endpointPBits)
+            for (unsigned i = 0; i < numEndpoints; ++i)
+                pbits[i] = bits.get(1);
+        else if (mode.sharedPBits)
+            for (unsigned s = 0; s < mode.subsets; ++s)
+                pbits[2 * s] = pbits[2 * s + 1] = bits.get(1);
+
+        // expand the endpoints to 8 bits by replicating their high bits
+        const unsigned pbit = mode.endpointPBits | mode.sharedPBits;
+        for (unsigned i = 0; i < numEndpoints; ++i)
+        {
+            for (unsigned c = 0; c < 4; ++c)
+            {
+                unsigned n = c < 3 ? mode.colorBits : mode.alphaBits;
+                if (n == 0)
+                    continue;
+                int v = pbit ? (e[i][c] << 1) | (int)pbits[i] : e[i][c];
+                n += pbit;
+                v <<= 8 - n;
+                e[i][c] = v | (v >> n);
+            }
+        }
+
+        // subset and anchor of each pixel
+        unsigned subset[16] = { };
+        bool anchor[16] = { };
+        anchor[0] = true;
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            if (mode.subsets == 2)
+                subset[i] = (bc7_partitions2[partition] >> i) & 1;
+            else if (mode.subsets == 3)
+                subset[i] = (bc7_partitions3[partition] >> (2 * i)) & 3;
+        }
+        if (mode.subsets == 2)
+            anchor[bc7_anchors2[partition]] = true;
+        else if (mode.subsets == 3)
+            anchor[bc7_anchors3a[partition]] = anchor[bc7_anchors3b[partition]] = true;
+
+        unsigned indices[16], indices2[16];
+        for (unsigned i = 0; i < 16; ++i)
+            indices[i] = bits.get(mode.indexBits - (anchor[i] ? 1 : 0));
+        if (mode.indexBits2)
+            for (unsigned i = 0; i < 16; ++i)
+                indices2[i] = bits.get(mode.indexBits2 - (i == 0 ? 1 : 0));
+
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            const int* e0 = e[2 * subset[i]];
+            const int* e1 = e[2 * subset[i] + 1];
+
+            if (mode.indexBits2)
+            {
+                // separate color and alpha indices; the selection bit swaps them
+                bool swap = indexSelection != 0;
+                const int* colorWeights = bc7Weights(swap ? mode.indexBits2 : mode.indexBits);
+                const int* alphaWeights = bc7Weights(swap ? mode.indexBits : mode.indexBits2);
+                unsigned ci = swap ? indices2[i] : indices[i];
+                unsigned ai = swap ? indices[i] : indices2[i];
+                for (int c = 0; c < 3; ++c)
+                    out[i][c] = (uchar)bc7Interpolate(e0[c], e1[c], colorWeights[ci]);
+                out[i][3] = (uchar)bc7Interpolate(e0[3], e1[3], alphaWeights[ai]);
+            }
+            else
+            {
+                const int* weights = bc7Weights(mode.indexBits);
+                for (int c = 0; c < 4; ++c)
+                    out[i][c] = (uchar)bc7Interpolate(e0[c], e1[c], weights[indices[i]]);
+            }
+
+            // rotation swaps alpha with one of the color channels
+            if (rotation > 0)
+                std::swap(out[i][3], out[i][rotation - 1]);
+        }
+        return true;
+    }
+
+    void encodeBlock(Image::PixelFormat format, const Block& px, uchar* out)
+    {
+        switch (format)
+        {
+        case Image::BC1_RGBA_UNORM:
+            encodeColorBlock(px, out, true, false);
+            break;
+        case Image::BC3_UNORM:
+            encodeChannelBlock(px, 3, out);
+            encodeColorBlock(px, out + 8, false, true);
+            break;
+        case Image::BC4_UNORM:
+            encodeChannelBlock(px, 0, out);
+            break;
+        case Image::BC5_UNORM:
+            encodeChannelBlock(px, 0, out);
+            encodeChannelBlock(px, 1, out + 8);
+            break;
+        case Image::BC7_UNORM:
+            encodeBC7(px, out);
+            break;
+        default:
+            break;
+        }
+    }
+
+    bool decodeBlock(Image::PixelFormat format, const uchar* in, Block& px)
+    {
+        switch (format)
+        {
+        case Image::BC1_RGBA_UNORM:
+            decodeColorBlock(in, px, false);
+            return true;
+        case Image::BC3_UNORM:
+            decodeColorBlock(in + 8, px, true);
+            decodeChannelBlock(in, 3, px);
+            return true;
+        case Image::BC4_UNORM:
+            decodeChannelBlock(in, 0, px);
+            return true;
+        case Image::BC5_UNORM:
+            decodeChannelBlock(in, 0, px);
+            decodeChannelBlock(in + 8, 1, px);
+            return true;
+        case Image::BC7_UNORM:
+            return decodeBC7(in, px);
+        default:
+            return false;
+        }
+    }
+}
+
+Result<shared_ptr<Image>>
+ImageCompressor::compress(shared_ptr<Image> image, Image::PixelFormat format) const
+{
+    ROCKY_PROFILING_ZONE;
+
+    if (!image || !image->valid())
+        return Status(Status::ResourceUnavailable, "Invalid image");
+
+    if (!Image::compressed(format))
+        return Status(Status::ConfigurationError, "Target is not a compressed pixel format");
+
+    if (image->pixelFormat() == format)
+        return image;
+
+    if (image->compressed())
+    {
+        auto decompressed = decompress(image);
+        if (decompressed.status.failed())
+            return decompressed.status;
+        image = decompressed.value;
+    }
+
+    if (image->pixelFormat() > Image::R8G8B8A8_UNORM && image->mipmapLevels() > 1)
+        return Status(Status::ConfigurationError, "Mipmapped images must be 8-bit to compress");
+
+    auto output = Image::create(format, image->width(), image->height(), image->depth(), image->mipmapLevels());
+    const Image& source = *image;
+
+    for (unsigned level = 0; level < output->mipmapLevels(); ++level)
+    {
+        const unsigned blocksWide = (output->mipmapWidth(level) + 3) / 4;
+        const unsigned blocksHigh = (output->mipmapHeight(level) + 3) / 4;
+        const unsigned rowBytes = blocksWide * output->blockSizeInBytes();
+        uchar* data = output->data_at_miplevel(level);
+
+        util::parallel_for(pool, blocksHigh * image->depth(), blockRowsPerTask, "encode image blocks",
+            [&](unsigned first, unsigned last)
+            {
+                Block px;
+                for (unsigned row = first; row < last; ++row)
+                {
+                    auto out = data + row * rowBytes;
+                    for (unsigned bx = 0; bx < blocksWide; ++bx, out += output->blockSizeInBytes())
+                    {
+                        fetchBlock(source, level, bx, row % blocksHigh, row / blocksHigh, px);
+                        encodeBlock(format, px, out);
+                    }
+                }
+            });
+    }
+
+    return output;
+}
+
+Result<shared_ptr<Image>>
+ImageCompressor::decompress(shared_ptr<Image> image) const
+{
+    ROCKY_PROFILING_ZONE;
+
+    if (!image || !image->valid())
+        return Status(Status::ResourceUnavailable, "Invalid image");
+
+    if (!image->compressed())
+        return image;
+
+    auto format =
+        image->pixelFormat() == Image::BC4_UNORM ? Image::R8_UNORM :
+        image->pixelFormat() == Image::BC5_UNORM ? Image::R8G8_UNORM :
+        Image::R8G8B8A8_UNORM;
+
+    auto output = Image::create(format, image->width(), image->height(), image->depth(), image->mipmapLevels());
+    std::atomic_bool ok = { true };
+
+    for (unsigned level = 0; level < image->mipmapLevels(); ++level)
+    {
+        const unsigned blocksWide = (image->mipmapWidth(level) + 3) / 4;
+        const unsigned blocksHigh = (image->mipmapHeight(level) + 3) / 4;
+        const unsigned rowBytes = blocksWide * image->blockSizeInBytes();
+        const uchar* data = image->data_at_miplevel(level);
+
+        util::parallel_for(pool, blocksHigh * image->depth(), blockRowsPerTask, "decode image blocks",
+            [&](unsigned first, unsigned last)
+            {
+                Block px;
+                for (unsigned row = first; row < last; ++row)
+                {
+                    auto in = data + row * rowBytes;
+                    for (unsigned bx = 0; bx < blocksWide; ++bx, in += image->blockSizeInBytes())
+                    {
+                        if (!decodeBlock(image->pixelFormat(), in, px))
+                            ok = false;
+                        storeBlock(*output, level, bx, row % blocksHigh, row / blocksHigh, px);
+                    }
+                }
+            });
+    }
+
+    if (!ok)
+        return Status(Status::ResourceUnavailable, "Unsupported compressed block encoding");
+
+    return output;
+}
+
+Image::PixelFormat
+ImageCompressor::format(const std::string& in_name, const Image* image)
+{
+    auto name = toLower(in_name);
+
+    if (name == "bc1") return Image::BC1_RGBA_UNORM;
+    if (name == "bc3") return Image::BC3_UNORM;
+    if (name == "bc4") return Image::BC4_UNORM;
+    if (name == "bc5") return Image::BC5_UNORM;
+    if (name == "bc7") return Image::BC7_UNORM;
+
+    if (name == "auto" && image && image->valid())
+    {
+        if (image->compressed())
+            return image->pixelFormat();
+
+        if (image->numComponents() == 1)
+            return Image::BC4_UNORM;
+
+        if (image->numComponents() == 2)
+            return Image::BC5_UNORM;
+
+        // BC1 is half the size; use it unless there's real translucency.
+        if (image->pixelFormat() == Image::R8G8B8A8_UNORM)
+        {
+            auto ptr = image->data<uchar>();
+            for (unsigned i = 0; i < image->sizeInPixels(); ++i)
+            {
+                if (ptr[i * 4 + 3] != 0 && ptr[i * 4 + 3] != 255)
+                    return Image::BC7_UNORM;
+            }
+        }
+        return Image::BC1_RGBA_UNORM;
+    }
+
+    return Image::UNDEFINED;
+}
@@ -0,0 +1,63 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/Image.h>
+#include <rocky/Status.h>
+#include <rocky/Threading.h>
+
+namespace ROCKY_NAMESPACE
+{
+    namespace util
+    {
+        /**
+        * CPU encoder and decoder for the GPU block-compressed (BCn) image formats.
+        *
+        * Encoding works on 8-bit unorm sources and splits the image into rows of
+        * 4x4 blocks that can be encoded in parallel. BC7 encoding uses mode 6
+        * (single subset RGBA) only; the decoder understands all eight modes.
+        * All mipmap levels are processed.
+        */
+        class ROCKY_EXPORT ImageCompressor
+        {
+        public:
+            //! Job pool in which to run encoding tasks. If null, all work
+            //! happens on the calling thread. Don't use a pool that the
+            //! calling thread itself belongs to, since the caller waits
+            //! on the results.
+            jobs::jobpool* pool = nullptr;
+
+            //! Number of rows of 4x4 blocks to encode per task
+            unsigned blockRowsPerTask = 16;
+
+        public:
+            //! Encodes an image into a block-compressed format.
+            //! An image that is already in the requested format passes through unchanged.
+            //! @param image Image to compress
+            //! @param format Target format, one of the BCn pixel formats
+            //! @return Compressed image, or an error status
+            Result<shared_ptr<Image>> compress(
+                shared_ptr<Image> image,
+                Image::PixelFormat format) const;
+
+            //! Decodes a block-compressed image. The output format is R8G8B8A8_UNORM
+            //! for BC1/BC3/BC7, R8_UNORM for BC4, and R8G8_UNORM for BC5.
+            //! An uncompressed image passes through unchanged.
+            //! @param image Image to decompress
+            //! @return Decompressed image, or an error status
+            Result<shared_ptr<Image>> decompress(
+                shared_ptr<Image> image) const;
+
+            //! Resolves a compression method name ("bc1", "bc3", "bc4", "bc5",
+            //! "bc7" or "auto") to a pixel format. "auto" picks a format based
+            //! on the image's channels and alpha content.
+            //! Returns UNDEFINED for "none", an empty string, or an unknown name.
+            static Image::PixelFormat format(
+                const std::string& name,
+                const Image* image = nullptr);
+        };
+    }
+}
@@ -100,6 +100,10 @@ Instance::Instance()
     //    Log()->warn("Environment variable PROJ_DATA is not set");
     //}
 
+    // Pre-build the coordinate operations nearly every app uses, so the
+    // job threads don't stall on PROJ database lookups when the first tiles load.
+    SRS::warmUp({ SRS::WGS84, SRS::ECEF, SRS::SPHERICAL_MERCATOR, SRS::PLATE_CARREE });
+
     _global_status = StatusOK;
 }
 
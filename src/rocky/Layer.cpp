@@ -11,6 +11,13 @@ using namespace ROCKY_NAMESPACE;
 
 #define LC "[Layer] \"" << getName() << "\" "
 
+namespace
+{
+    // changes to remember for dirtyExtents(); anything older counts as
+    // a change to the whole layer
+    constexpr std::size_t max_dirty_extents = 256u;
+}
+
 Layer::Layer() :
     super()
 {
@@ -74,9 +81,42 @@ Layer::dirty()
 }
 
 void
-Layer::bumpRevision()
+Layer::dirty(const GeoExtent& extent)
+{
+    bumpRevision(extent);
+}
+
+void
+Layer::bumpRevision(const GeoExtent& extent)
+{
+    std::scoped_lock lock(_dirtyExtentsMutex);
+
+    _dirtyExtents.emplace_back(++_revision, extent);
+
+    if (_dirtyExtents.size() > max_dirty_extents)
+        _dirtyExtents.pop_front();
+}
+
+bool
+Layer::dirtyExtents(Revision since, std::vector<GeoExtent>& extents) const
 {
-    ++_revision;
+    std::scoped_lock lock(_dirtyExtentsMutex);
+
+    // every revision after "since" must still be on record
+    if (since < _revision && (_dirtyExtents.empty() || _dirtyExtents.front().first > since + 1))
+        return false;
+
+    for (auto& [revision, extent] : _dirtyExtents)
+    {
+        if (revision > since)
+        {
+            if (!extent.valid())
+                return false;
+
+            extents.push_back(extent);
+        }
+    }
+    return true;
 }
 
 void
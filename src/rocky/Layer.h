@@ -8,8 +8,10 @@
 #include <rocky/Common.h>
 #include <rocky/Callbacks.h>
 #include <rocky/DateTime.h>
+#include <rocky/GeoExtent.h>
 #include <rocky/IOTypes.h>
 #include <rocky/Status.h>
+#include <deque>
 #include <vector>
 #include <shared_mutex>
 
@@ -158,6 +160,18 @@ namespace ROCKY_NAMESPACE
         //! invalidate caches.
         virtual void dirty();
 
+        //! Increment the revision number for this layer, reporting that
+        //! only the data within an extent changed. The terrain then reloads
+        //! just the tiles that intersect it.
+        virtual void dirty(const GeoExtent& extent);
+
+        //! Extents reported to dirty() since a revision of this layer.
+        //! @param since Revision after which to collect the changes
+        //! @param extents Receives the extents
+        //! @return False if a change since then covered the whole layer, or
+        //!    came too long ago to remember; in that case extents is incomplete
+        bool dirtyExtents(Revision since, std::vector<GeoExtent>& extents) const;
+
         //! Name of the layer type for serialization use
         const std::string& getConfigKey() const {
             return _configKey;
@@ -197,6 +211,8 @@ namespace ROCKY_NAMESPACE
         mutable Status _status;
         Hints _hints;
         std::atomic<Revision> _revision;
+        std::deque<std::pair<Revision, GeoExtent>> _dirtyExtents;
+        mutable std::mutex _dirtyExtentsMutex;
         std::string _runtimeCacheId;
         mutable std::shared_mutex _state_mutex;
         bool _isClosing;
@@ -208,7 +224,9 @@ namespace ROCKY_NAMESPACE
 
     protected:
 
-        void bumpRevision();
+        //! Increments the revision, recording the extent that changed
+        //! (GeoExtent::INVALID for the whole layer)
+        void bumpRevision(const GeoExtent& extent = GeoExtent::INVALID);
 
         //! subclass access to a mutex that serializes the 
         //! Layer open and close methods with respect to any asynchronous
@@ -9,6 +9,8 @@
 #include <glm/ext.hpp>
 #include <iterator>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -350,6 +352,68 @@ namespace ROCKY_NAMESPACE
             return x + 1;
         }
 
+        //! Converts a 32-bit float to an IEEE 16-bit half float, rounding to
+        //! the nearest even value. Values beyond the half range become infinity.
+        inline std::uint16_t float_to_half(float value)
+        {
+            std::uint32_t f;
+            std::memcpy(&f, &value, 4);
+            const std::uint32_t sign = f & 0x80000000u;
+            f ^= sign;
+
+            std::uint16_t h;
+            if (f >= (143u << 23)) // >= 65536: inf or nan
+            {
+                h = f > (255u << 23) ? 0x7e00 : 0x7c00;
+            }
+            else if (f < (113u << 23)) // subnormal or zero
+            {
+                const std::uint32_t magic_bits = 126u << 23;
+                float m, t;
+                std::memcpy(&m, &magic_bits, 4);
+                std::memcpy(&t, &f, 4);
+                t += m;
+                std::memcpy(&f, &t, 4);
+                h = (std::uint16_t)(f - magic_bits);
+            }
+            else
+            {
+                const std::uint32_t odd = (f >> 13) & 1u;
+                f += 0xc8000fffu + odd; // rebias the exponent and round
+                h = (std::uint16_t)(f >> 13);
+            }
+            return h | (std::uint16_t)(sign >> 16);
+        }
+
+        //! Converts an IEEE 16-bit half float to a 32-bit float.
+        inline float half_to_float(std::uint16_t value)
+        {
+            const std::uint32_t shifted_exp = 0x7c00u << 13;
+            std::uint32_t f = (value & 0x7fffu) << 13;
+            const std::uint32_t exp = f & shifted_exp;
+            f += (127u - 15u) << 23;
+
+            if (exp == shifted_exp) // inf or nan
+            {
+                f += (128u - 16u) << 23;
+            }
+            else if (exp == 0) // subnormal or zero
+            {
+                const std::uint32_t magic_bits = 113u << 23;
+                float m, t;
+                f += 1u << 23;
+                std::memcpy(&m, &magic_bits, 4);
+                std::memcpy(&t, &f, 4);
+                t -= m;
+                std::memcpy(&f, &t, 4);
+            }
+
+            f |= (std::uint32_t)(value & 0x8000u) << 16;
+            float result;
+            std::memcpy(&result, &f, 4);
+            return result;
+        }
+
         template<typename... Args>
         inline double smallest(Args... a) {
             double r = DBL_MAX;
@@ -7,6 +7,8 @@
 #include "TileKey.h"
 #include "Math.h"
 #include "json.h"
+#include <mutex>
+#include <unordered_map>
 
 using namespace ROCKY_NAMESPACE;
 using namespace ROCKY_NAMESPACE::util;
@@ -22,6 +24,23 @@ const double MERC_MAXY = 20037508.34278925;
 const double MERC_WIDTH = MERC_MAXX - MERC_MINX;
 const double MERC_HEIGHT = MERC_MAXY - MERC_MINY;
 
+namespace
+{
+    // Hands out the same id to every profile with a given definition. Keyed on
+    // the full JSON rather than its hash, so two different profiles never share one.
+    unsigned profile_id(const std::string& definition)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, unsigned> ids;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& id = ids[definition];
+        if (id == 0)
+            id = (unsigned)ids.size();
+        return id;
+    }
+}
+
 void
 Profile::setup(
     const SRS& srs,
@@ -81,6 +100,16 @@ Profile::setup(
         JSON temp = to_json();
         _shared->_fullSignature = util::make_string() << std::hex << util::hashString(temp);
         _shared->_hash = std::hash<std::string>()(temp);
+        _shared->_id = profile_id(temp);
+
+        // tile sizes are needed constantly by tile keys, so tabulate them once.
+        double lod0_width = _shared->_extent.width() / (double)tx;
+        double lod0_height = _shared->_extent.height() / (double)ty;
+        for (unsigned lod = 0; lod < _shared->_tileDimensions.size(); ++lod)
+        {
+            double factor = double(1u << lod);
+            _shared->_tileDimensions[lod] = std::make_pair(lod0_width / factor, lod0_height / factor);
+        }
     }
 }
 
@@ -96,7 +125,7 @@ Profile::operator == (const Profile& rhs) const
     if (!valid() || !rhs.valid())
         return false;
 
-    if (_shared == rhs._shared)
+    if (_shared == rhs._shared || _shared->_id == rhs._shared->_id)
         return true;
 
     if (_shared->_wellKnownName == rhs._shared->_wellKnownName)
@@ -169,6 +198,11 @@ Profile::srs() const {
     return _shared->_extent.srs();
 }
 
+unsigned
+Profile::id() const {
+    return _shared->_id;
+}
+
 const GeoExtent&
 Profile::extent() const {
     return _shared->_extent;
@@ -232,20 +266,30 @@ Profile::getAllKeysAtLOD(
 
 GeoExtent
 Profile::tileExtent(unsigned lod, unsigned tileX, unsigned tileY) const
+{
+    Box b = tileBounds(lod, tileX, tileY);
+    return GeoExtent(srs(), b.xmin, b.ymin, b.xmax, b.ymax);
+}
+
+Box
+Profile::tileBounds(unsigned lod, unsigned tileX, unsigned tileY) const
 {
     auto [width, height] = tileDimensions(lod);
 
-    double xmin = extent().xMin() + (width * (double)tileX);
-    double ymax = extent().yMax() - (height * (double)tileY);
+    double xmin = _shared->_extent.xMin() + (width * (double)tileX);
+    double ymax = _shared->_extent.yMax() - (height * (double)tileY);
     double xmax = xmin + width;
     double ymin = ymax - height;
 
-    return GeoExtent(srs(), xmin, ymin, xmax, ymax);
+    return Box(xmin, ymin, xmax, ymax);
 }
 
 std::pair<double,double>
 Profile::tileDimensions(unsigned int lod) const
 {
+    if (lod < _shared->_tileDimensions.size())
+        return _shared->_tileDimensions[lod];
+
     double out_width  = _shared->_extent.width() / (double)_shared->_numTilesWideAtLod0;
     double out_height = _shared->_extent.height() / (double)_shared->_numTilesHighAtLod0;
 
@@ -366,6 +410,30 @@ Profile::clampAndTransformExtent(const GeoExtent& input, bool* out_clamped) cons
     }    
 }
 
+std::vector<GeoExtent>
+Profile::clampAndTransformExtents(const std::vector<GeoExtent>& input) const
+{
+    std::vector<GeoExtent> output(input.size());
+    GeoExtent::transformArray(input.data(), input.size(), srs(), output.data());
+
+    for (std::size_t i = 0; i < input.size(); ++i)
+    {
+        if (!input[i].valid())
+            output[i] = GeoExtent::INVALID;
+
+        else if (input[i].isWholeEarth())
+            output[i] = extent();
+
+        else if (output[i].valid())
+            output[i] = output[i].intersectionSameSRS(extent());
+
+        else // out of bounds; take the slow path through lat/long
+            output[i] = clampAndTransformExtent(input[i]);
+    }
+
+    return output;
+}
+
 unsigned
 Profile::getEquivalentLOD(const Profile& rhsProfile, unsigned rhsLOD) const
 {
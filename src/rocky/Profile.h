@@ -7,6 +7,7 @@
 
 #include <rocky/Common.h>
 #include <rocky/GeoExtent.h>
+#include <array>
 #include <vector>
 
 namespace ROCKY_NAMESPACE
@@ -62,6 +63,10 @@ namespace ROCKY_NAMESPACE
         //! @return Spatial reference system underlying this profile.
         const SRS& srs() const;
 
+        //! Process-wide id of this profile. Profiles with the same signature
+        //! share an id; zero means invalid.
+        unsigned id() const;
+
         //! @return Given an x-resolution, specified in the profile's SRS units, calculates and
         //! returns the closest LOD level.
         unsigned getLevelOfDetailForHorizResolution(
@@ -94,6 +99,16 @@ namespace ROCKY_NAMESPACE
             unsigned tileX,
             unsigned tileY) const;
 
+        //! @return Bounds of a tile in this profile's SRS. Cheaper than tileExtent()
+        //! since it neither validates nor carries the SRS.
+        //! @param lod Level of detail for which to calculate tile bounds
+        //! @param tileX X tile index
+        //! @param tile& Y tile index
+        Box tileBounds(
+            unsigned lod,
+            unsigned tileX,
+            unsigned tileY) const;
+
         //! Gets whether the two profiles can be treated as equivalent.
         //! @param rhs Comparison profile
         //bool isEquivalentTo(const Profile& rhs) const;
@@ -122,6 +137,10 @@ namespace ROCKY_NAMESPACE
         //! if the transformation fails.
         GeoExtent clampAndTransformExtent( const GeoExtent& input, bool* out_clamped =0L ) const;
 
+        //! Same as clampAndTransformExtent, for many extents at once. The common case
+        //! goes through a single bulk transformation per source SRS.
+        std::vector<GeoExtent> clampAndTransformExtents(const std::vector<GeoExtent>& input) const;
+
         //! Returns a readable description of the profile.
         JSON to_json() const;
 
@@ -180,6 +199,8 @@ namespace ROCKY_NAMESPACE
             std::string _fullSignature;
             std::string _horizSignature;
             std::size_t _hash;
+            unsigned    _id = 0;
+            std::array<std::pair<double, double>, 32> _tileDimensions;
         };
         shared_ptr<Data> _shared;
     };
@@ -5,10 +5,16 @@
  */
 #include "SRS.h"
 #include "Math.h"
+#include "Geoid.h"
 #include "Threading.h"
 #include "Instance.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
+#include <mutex>
 #include <proj.h>
 
 #define LC "[SRS] "
@@ -43,390 +49,587 @@ namespace
     const Box empty_box = { };
     const std::string empty_string = { };
 
-    //! Entry in the per-thread SRS data cache
-    struct SRSEntry
+    //! create a PJ projection object based on the provided definition string,
+    //! which may be a proj string, a WKT string, an espg identifer, or a well-known alias
+    //! like "spherical-mercator" or "wgs84".
+    PJ* create_pj(PJ_CONTEXT* ctx, const std::string& def)
     {
-        PJ* pj = nullptr;
-        PJ_TYPE horiz_crs_type;
-        optional<Box> bounds;
-        std::string wkt;
-        std::string proj;
-        Ellipsoid ellipsoid = { };
-        std::string error;
-    };
-
-    //! SRS data factory and PROJ main interface
-    struct SRSFactory : public std::unordered_map<std::string, SRSEntry>
-    {
-        //! destroy cache entries and threading context upon descope
-        ~SRSFactory()
+        std::string to_try = def;
+        std::string ndef = util::toLower(def);
+
+        //TODO: Think about epsg:4979, which is supposedly a 3D version of epsg::4326.
+
+        // process some common aliases
+        if (ndef == "wgs84" || ndef == "global-geodetic")
+            to_try = "epsg:4979";
+        else if (ndef == "spherical-mercator")
+            to_try = "epsg:3785";
+        else if (ndef == "geocentric" || ndef == "ecef")
+            to_try = "epsg:4978";
+        else if (ndef == "plate-carree" || ndef == "plate-carre")
+            to_try = "epsg:32663";
+
+        // try to determine whether this ia WKT so we can use the right create function
+        auto wkt_dialect = proj_context_guess_wkt_dialect(ctx, to_try.c_str());
+        if (wkt_dialect != PJ_GUESSED_NOT_WKT)
         {
-            for (auto iter = begin(); iter != end(); ++iter)
+            return proj_create_from_wkt(ctx, to_try.c_str(), nullptr, nullptr, nullptr);
+        }
+        else
+        {
+            // if it's a PROJ string, be sure to add the +type=crs
+            if (contains(ndef, "+proj"))
             {
-                if (iter->second.pj)
+                if (!contains(ndef, "proj=pipeline") && !contains(ndef, "type=crs"))
                 {
-                    proj_destroy(iter->second.pj);
+                    to_try += " +type=crs";
                 }
             }
-
-            if (g_pj_thread_local_context)
-                proj_context_destroy(g_pj_thread_local_context);
-        }
-
-        PJ_CONTEXT* threading_context()
-        {
-            if (g_pj_thread_local_context == nullptr)
+            else
             {
-                g_pj_thread_local_context = proj_context_create();
-                proj_log_func(g_pj_thread_local_context, nullptr, redirect_proj_log);
+                // perhaps it's an EPSG string, in which case we must lower-case it so it
+                // works on case-sensitive file systems
+                // https://github.com/pyproj4/pyproj/blob/9283f962e4792da2a7f05ba3735c1ed7f3479502/pyproj/crs/crs.py#L111
+                util::replace_in_place(to_try, "+init=EPSG", "+init=epsg");
             }
-            return g_pj_thread_local_context;
-        }
 
-        const std::string& get_error_message(const std::string& def)
-        {
-            auto iter = find(def);
-            if (iter == end())
-                return empty_string; // shouldn't happen
-            else
-                return iter->second.error;
+            return proj_create(ctx, to_try.c_str());
         }
+    }
 
-        //! retrieve or create a PJ projection object based on the provided definition string,
-        //! which may be a proj string, a WKT string, an espg identifer, or a well-known alias
-        //! like "spherical-mercator" or "wgs84".
-        SRSEntry& get_or_create(const std::string& def)
+    //! create a transformation object between two PJ's. Any PROJ string used
+    //! to build it goes into "proj", and any error message into "error".
+    PJ* create_operation(PJ_CONTEXT* ctx, PJ* p1, PJ* p2, const std::string& def, std::string& proj, std::string& error)
+    {
+        PJ* pj = nullptr;
+
+        if (p1 && p2)
         {
-            ROCKY_PROFILE_FUNCTION();
+            bool p1_is_crs = proj_is_crs(p1);
+            bool p2_is_crs = proj_is_crs(p2);
+            bool normalize_to_gis_coords = true;
 
-            auto ctx = threading_context();
+            PJ_TYPE p1_type = proj_get_type(p1);
+            PJ_TYPE p2_type = proj_get_type(p2);
 
-            auto iter = find(def);
-            if (iter == end())
+            if (p1_is_crs && p2_is_crs)
             {
-                PJ* pj = nullptr;
-
-                std::string to_try = def;
-                std::string ndef = util::toLower(def);
-
-                //TODO: Think about epsg:4979, which is supposedly a 3D version of epsg::4326.
-
-                // process some common aliases
-                if (ndef == "wgs84" || ndef == "global-geodetic")
-                    to_try = "epsg:4979";
-                else if (ndef == "spherical-mercator")
-                    to_try = "epsg:3785";
-                else if (ndef == "geocentric" || ndef == "ecef")
-                    to_try = "epsg:4978";
-                else if (ndef == "plate-carree" || ndef == "plate-carre")
-                    to_try = "epsg:32663";
-
-                // try to determine whether this ia WKT so we can use the right create function
-                auto wkt_dialect = proj_context_guess_wkt_dialect(ctx, to_try.c_str());
-                if (wkt_dialect != PJ_GUESSED_NOT_WKT)
+                // Check for an illegal operation (PROJ 9.1.0). We do this because
+                // proj_create_crs_to_crs_from_pj() will succeed even though the operation will not
+                // process the Z input.
+                if (p1_type == PJ_TYPE_GEOGRAPHIC_2D_CRS && p2_type == PJ_TYPE_COMPOUND_CRS)
                 {
-                    pj = proj_create_from_wkt(ctx, to_try.c_str(), nullptr, nullptr, nullptr);
+                    std::string warning = "Warning, \"" + def + "\" transforms from GEOGRAPHIC_2D_CRS to COMPOUND_CRS. Z values will be discarded. Use a GEOGRAPHIC_3D_CRS instead";
+                    redirect_proj_log(nullptr, 0, warning.c_str());
                 }
-                else
-                {
-                    // if it's a PROJ string, be sure to add the +type=crs
-                    if (contains(ndef, "+proj"))
-                    {
-                        if (!contains(ndef, "proj=pipeline") && !contains(ndef, "type=crs"))
-                        {
-                            to_try += " +type=crs";
-                        }
-                    }
-                    else
-                    {
-                        // perhaps it's an EPSG string, in which case we must lower-case it so it
-                        // works on case-sensitive file systems
-                        // https://github.com/pyproj4/pyproj/blob/9283f962e4792da2a7f05ba3735c1ed7f3479502/pyproj/crs/crs.py#L111
-                        util::replace_in_place(to_try, "+init=EPSG", "+init=epsg");
-                    }
 
-                    pj = proj_create(ctx, to_try.c_str());
+                // if they are both CRS's, just make a transform operation.
+                pj = proj_create_crs_to_crs_from_pj(ctx, p1, p2, nullptr, nullptr);
+
+                if (pj && proj_get_type(pj) != PJ_TYPE_UNKNOWN)
+                {
+                    const char* pcstr = proj_as_proj_string(ctx, pj, PJ_PROJ_5, nullptr);
+                    if (pcstr) proj = pcstr;
                 }
+            }
 
-                // store in the cache (even if it failed)
-                SRSEntry& new_entry = (*this)[def];
-                new_entry.pj = pj;
+            else if (p1_is_crs && !p2_is_crs)
+            {
+                PJ_TYPE type = proj_get_type(p1);
 
-                if (pj == nullptr)
+                if (type == PJ_TYPE_GEOGRAPHIC_2D_CRS || type == PJ_TYPE_GEOGRAPHIC_3D_CRS)
                 {
-                    // store any error in the cache entry
-                    auto err_no = proj_context_errno(ctx);
-                    new_entry.error = proj_errno_string(err_no);
+                    proj =
+                        "+proj=pipeline"
+                        " +step +proj=unitconvert +xy_in=deg +xy_out=rad"
+                        " +step " + std::string(proj_as_proj_string(ctx, p2, PJ_PROJ_5, nullptr));
+
+                    pj = proj_create(ctx, proj.c_str());
+
+                    normalize_to_gis_coords = false;
                 }
                 else
                 {
-                    // extract the type
-                    PJ_TYPE type = proj_get_type(pj);
-                    if (type == PJ_TYPE_COMPOUND_CRS)
-                    {
-                        PJ* horiz = proj_crs_get_sub_crs(ctx, pj, 0);
-                        if (horiz)
-                            new_entry.horiz_crs_type = proj_get_type(horiz);
-                    }
-                    else new_entry.horiz_crs_type = type;
-
-                    // extract the ellipsoid parameters.
-                    // if this fails, the entry will contain the default WGS84 ellipsoid, and that is ok.
-                    PJ* ellps = proj_get_ellipsoid(ctx, pj);
-                    if (ellps)
-                    {
-                        double semi_major, semi_minor, inv_flattening;
-                        int is_semi_minor_computed;
-                        proj_ellipsoid_get_parameters(ctx, ellps, &semi_major, &semi_minor, &is_semi_minor_computed, &inv_flattening);
-                        proj_destroy(ellps);
-                        new_entry.ellipsoid = Ellipsoid(semi_major, semi_minor);
-                    }
+                    proj =
+                        "+proj=pipeline"
+                        " +step +proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +towgs84=0,0,0"
+                        " +step +proj=unitconvert +xy_in=deg +xy_out=rad"
+                        " +step " + std::string(proj_as_proj_string(ctx, p2, PJ_PROJ_5, nullptr)) +
+                        " +step +proj=unitconvert +xy_in=rad +xy_out=deg";
 
-                    // extract the WKT
-                    const char* wkt = proj_as_wkt(ctx, pj, PJ_WKT2_2019, nullptr);
-                    if (wkt)
-                        new_entry.wkt = wkt;
+                    pj = proj_create(ctx, proj.c_str());
 
-                    // extract the PROJ string
-                    const char* proj = proj_as_proj_string(ctx, pj, PJ_PROJ_5, nullptr);
-                    if (proj)
-                        new_entry.proj = proj;
+                    normalize_to_gis_coords = false;
                 }
+            }
+
+            else if (!p1_is_crs && p2_is_crs)
+            {
+                proj =
+                    "+proj=pipeline"
+                    " +step +inv " + std::string(proj_as_proj_string(ctx, p1, PJ_PROJ_5, nullptr)) +
+                    " +step " + std::string(proj_as_proj_string(ctx, p2, PJ_PROJ_5, nullptr)) +
+                    " +step +proj=unitconvert +xy_in=rad +xy_out=deg";
 
-                return new_entry;
+                pj = proj_create(ctx, proj.c_str());
+
+                normalize_to_gis_coords = false;
             }
+
             else
             {
-                return iter->second;
+                proj =
+                    "+proj=pipeline"
+                    " +step +inv " + std::string(proj_as_proj_string(ctx, p1, PJ_PROJ_5, nullptr)) +
+                    " +step " + std::string(proj_as_proj_string(ctx, p2, PJ_PROJ_5, nullptr));
+
+                pj = proj_create(ctx, proj.c_str());
+
+                normalize_to_gis_coords = false;
+            }
+
+            // integrate forward and backward vdatum conversions if necessary.
+            if (pj && normalize_to_gis_coords)
+            {
+                // re-order the coordinates to GIS standard long=x, lat=y
+                PJ* normalized = proj_normalize_for_visualization(ctx, pj);
+                proj_destroy(pj);
+                pj = normalized;
             }
         }
 
-        //! fetch the projection type
-        PJ_TYPE get_horiz_crs_type(const std::string& def)
+        if (!pj && error.empty())
         {
-            ROCKY_PROFILE_FUNCTION();
-            return get_or_create(def).horiz_crs_type;
+            auto err_no = proj_context_errno(ctx);
+            if (err_no != 0)
+            {
+                error = proj_errno_string(err_no);
+                //Instance::log().warn << error << " (\"" << def << "\")" << std::endl;
+            }
         }
 
-        //! fetch the ellipsoid associated with an SRS definition
-        //! that was previously created
-        const Ellipsoid& get_ellipsoid(const std::string& def)
+        return pj;
+    }
+
+    //! Source of unique per-thread factory serial numbers (never reused)
+    std::atomic<std::uint32_t> g_srs_factory_serial = { 0 };
+}
+
+//! Interned SRS definition. Everything but the lazily computed members
+//! is immutable once the record is published by the registry.
+struct SRS::Record
+{
+    unsigned id = 0;
+    unsigned equivalenceId = 0;
+    std::string definition;
+    PJ* pj = nullptr; // belongs to the registry context; only use under the registry lock
+    PJ_TYPE horiz_crs_type = PJ_TYPE_UNKNOWN;
+    Ellipsoid ellipsoid = { };
+    std::string name;
+    std::string wkt;
+    std::string proj;
+    std::string error;
+
+    mutable std::once_flag boundsOnce;
+    mutable Box bounds = { };
+    mutable std::atomic<const Record*> geo = { nullptr };
+    mutable std::atomic<const Record*> geocentric = { nullptr };
+
+    // geographic CRS compounded with a vertical CRS (heights above a geoid)
+    bool verticalDatum = false;
+    mutable std::once_flag ellipsoidalOnce;
+    mutable const Record* ellipsoidal = nullptr; // same CRS with ellipsoidal heights
+    mutable std::once_flag geoidOnce;
+    mutable shared_ptr<Geoid> geoid;
+};
+
+namespace
+{
+    //! Process-wide table of interned SRS definitions. Each unique definition
+    //! string is parsed once; its metadata is extracted up front and it is assigned
+    //! to an equivalence class so that SRS comparisons are integer compares.
+    struct SRSRegistry
+    {
+        std::mutex mutex;
+        PJ_CONTEXT* ctx = nullptr;
+        std::deque<SRS::Record> records; // stable addresses
+        std::unordered_map<std::string, const SRS::Record*> index;
+        std::vector<const SRS::Record*> classes; // one representative per equivalence class
+
+        //! Transformation objects shared by all threads (as templates for per-thread clones)
+        struct Operation
         {
-            ROCKY_PROFILE_FUNCTION();
-            return get_or_create(def).ellipsoid;
+            PJ* pj = nullptr;
+            std::string proj;
+            std::string error;
         };
+        std::unordered_map<std::uint64_t, Operation> operations;
 
-        //! Get the computed bounds of a projection (or guess at them)
-        const Box& get_bounds(const std::string& def)
+        SRSRegistry()
         {
-            ROCKY_PROFILE_FUNCTION();
-
-            auto ctx = threading_context();
+            ctx = proj_context_create();
+            proj_log_func(ctx, nullptr, redirect_proj_log);
+        }
 
-            SRSEntry& entry = get_or_create(def);
+        //! retrieve or create the record for a definition. Caller must hold the mutex.
+        const SRS::Record* intern(const std::string& def)
+        {
+            auto iter = index.find(def);
+            if (iter != index.end())
+                return iter->second;
 
-            if (entry.pj == nullptr)
-                return empty_box;
+            ROCKY_PROFILE_FUNCTION();
 
-            if (entry.bounds.has_value())
-                return entry.bounds.value();
+            records.emplace_back();
+            SRS::Record& r = records.back();
+            r.id = (unsigned)records.size();
+            r.definition = def;
+            r.pj = create_pj(ctx, def);
 
-            double west_lon, south_lat, east_lon, north_lat;
-            if (proj_get_area_of_use(ctx, entry.pj, &west_lon, &south_lat, &east_lon, &north_lat, nullptr) &&
-                west_lon > -1000)
+            if (r.pj == nullptr)
             {
-                // always returns lat/long, so transform back to this srs
-                auto xform = get_or_create_operation("wgs84", def); // don't call proj_destroy on this
-                PJ_COORD LL = proj_trans(xform, PJ_FWD, PJ_COORD{ west_lon, south_lat, 0.0, 0.0 });
-                PJ_COORD UR = proj_trans(xform, PJ_FWD, PJ_COORD{ east_lon, north_lat, 0.0, 0.0 });
-                entry.bounds = Box(LL.xyz.x, LL.xyz.y, UR.xyz.x, UR.xyz.y);
+                // store any error in the record
+                auto err_no = proj_context_errno(ctx);
+                r.error = proj_errno_string(err_no);
             }
             else
             {
-                // We will have to make an educated guess.
-                if (entry.horiz_crs_type == PJ_TYPE_GEOGRAPHIC_2D_CRS || entry.horiz_crs_type == PJ_TYPE_GEOGRAPHIC_3D_CRS)
-                {
-                    entry.bounds = Box(-180, -90, 180, 90);
-                }
-                else if (entry.horiz_crs_type != PJ_TYPE_GEOCENTRIC_CRS)
+                // extract the type
+                PJ_TYPE type = proj_get_type(r.pj);
+                if (type == PJ_TYPE_COMPOUND_CRS)
                 {
-                    if (contains(entry.proj, "proj=utm"))
+                    PJ* horiz = proj_crs_get_sub_crs(ctx, r.pj, 0);
+                    if (horiz)
                     {
-                        if (contains(entry.proj, "+south"))
-                            entry.bounds = Box(166000, 1116915, 834000, 10000000);
-                        else
-                            entry.bounds = Box(166000, 0, 834000, 9330000);
+                        r.horiz_crs_type = proj_get_type(horiz);
+                        r.verticalDatum =
+                            r.horiz_crs_type == PJ_TYPE_GEOGRAPHIC_2D_CRS ||
+                            r.horiz_crs_type == PJ_TYPE_GEOGRAPHIC_3D_CRS;
+                        proj_destroy(horiz);
                     }
+                }
+                else r.horiz_crs_type = type;
 
-                    else if (contains(entry.proj, "proj=merc"))
-                    {
-                        // values found empirically 
-                        entry.bounds = Box(-20037508.342789244, -20048966.104014594, 20037508.342789244, 20048966.104014594);
-                    }
+                // extract the ellipsoid parameters.
+                // if this fails, the record will contain the default WGS84 ellipsoid, and that is ok.
+                PJ* ellps = proj_get_ellipsoid(ctx, r.pj);
+                if (ellps)
+                {
+                    double semi_major, semi_minor, inv_flattening;
+                    int is_semi_minor_computed;
+                    proj_ellipsoid_get_parameters(ctx, ellps, &semi_major, &semi_minor, &is_semi_minor_computed, &inv_flattening);
+                    proj_destroy(ellps);
+                    r.ellipsoid = Ellipsoid(semi_major, semi_minor);
+                }
 
-                    else if (contains(entry.proj, "proj=qsc"))
+                const char* name = proj_get_name(r.pj);
+                if (name)
+                    r.name = name;
+
+                // extract the WKT
+                const char* wkt = proj_as_wkt(ctx, r.pj, PJ_WKT2_2019, nullptr);
+                if (wkt)
+                    r.wkt = wkt;
+
+                // extract the PROJ string
+                const char* proj = proj_as_proj_string(ctx, r.pj, PJ_PROJ_5, nullptr);
+                if (proj)
+                    r.proj = proj;
+
+                // find the equivalence class, or start a new one
+                for (auto rep : classes)
+                {
+                    if (proj_is_equivalent_to_with_ctx(ctx, rep->pj, r.pj, PJ_COMP_EQUIVALENT))
                     {
-                        // maximum possible values, I think
-                        entry.bounds = Box(
-                            -entry.ellipsoid.semiMajorAxis(),
-                            -entry.ellipsoid.semiMinorAxis(),
-                            entry.ellipsoid.semiMajorAxis(),
-                            entry.ellipsoid.semiMinorAxis());
+                        r.equivalenceId = rep->equivalenceId;
+                        break;
                     }
                 }
+
+                if (r.equivalenceId == 0)
+                {
+                    classes.push_back(&r);
+                    r.equivalenceId = (unsigned)classes.size();
+                }
             }
 
-            return entry.bounds.value();
+            index[def] = &r;
+            return &r;
         }
 
-        const std::string& get_wkt(const std::string& def)
+        //! retrieve or create the shared transformation object between two records.
+        //! Caller must hold the mutex.
+        const Operation& get_or_create_operation(const SRS::Record* from, const SRS::Record* to)
         {
+            std::uint64_t key = ((std::uint64_t)from->id << 32) | (std::uint64_t)to->id;
+            auto iter = operations.find(key);
+            if (iter != operations.end())
+                return iter->second;
+
             ROCKY_PROFILE_FUNCTION();
 
-            auto iter = find(def);
-            if (iter == end())
+            auto& op = operations[key];
+            op.pj = create_operation(ctx, from->pj, to->pj, from->definition + "->" + to->definition, op.proj, op.error);
+            return op;
+        }
+
+        //! The horizontal part of a compound CRS, promoted to 3D so that it carries
+        //! ellipsoidal heights. Caller must hold the mutex.
+        const SRS::Record* ellipsoidal_counterpart(const SRS::Record& r)
+        {
+            const SRS::Record* result = nullptr;
+            PJ* horiz = proj_crs_get_sub_crs(ctx, r.pj, 0);
+            if (horiz)
             {
-                get_or_create(def);
-                iter = find(def);
-                if (iter == end())
-                    return empty_string;
+                PJ* horiz3d = proj_crs_promote_to_3D(ctx, nullptr, horiz);
+                if (horiz3d)
+                {
+                    const char* wkt = proj_as_wkt(ctx, horiz3d, PJ_WKT2_2019, nullptr);
+                    if (wkt)
+                        result = intern(wkt);
+                    proj_destroy(horiz3d);
+                }
+                proj_destroy(horiz);
             }
-            return iter->second.wkt;
+            return result;
         }
 
-        //! retrieve or create a transformation object
-        PJ* get_or_create_operation(const std::string& firstDef, const std::string& secondDef)
+        //! Cell size in degrees of the finest available grid that any operation
+        //! between two records could use; zero if none uses a grid (or PROJ can't
+        //! say). Caller must hold the mutex.
+        double grid_resolution(const SRS::Record* from, const SRS::Record* to)
         {
-            ROCKY_PROFILE_FUNCTION();
-
-            auto ctx = threading_context();
+            double result = 0.0;
 
-            PJ* pj = nullptr;
-            std::string proj;
-            std::string error;
+            auto factory = proj_create_operation_factory_context(ctx, nullptr);
+            if (!factory)
+                return result;
 
-            // make a unique identifer for the transformation
-            std::string def = firstDef + "->" + secondDef;
+            proj_operation_factory_context_set_grid_availability_use(ctx, factory,
+                PROJ_GRID_AVAILABILITY_DISCARD_OPERATION_IF_MISSING_GRID);
 
-            auto iter = find(def);
-
-            if (iter == end())
+            PJ_OBJ_LIST* ops = proj_create_operations(ctx, from->pj, to->pj, factory);
+            if (ops)
             {
-                PJ* p1 = get_or_create(firstDef).pj;
-                PJ* p2 = get_or_create(secondDef).pj;
-                if (p1 && p2)
+                for (int i = 0; i < proj_list_get_count(ops); ++i)
                 {
-                    bool p1_is_crs = proj_is_crs(p1);
-                    bool p2_is_crs = proj_is_crs(p2);
-                    bool normalize_to_gis_coords = true;
-
-                    PJ_TYPE p1_type = proj_get_type(p1);
-                    PJ_TYPE p2_type = proj_get_type(p2);
+                    PJ* op = proj_list_get(ctx, ops, i);
+                    if (!op)
+                        continue;
 
-                    if (p1_is_crs && p2_is_crs)
+                    for (int g = 0; g < proj_coordoperation_get_grid_used_count(ctx, op); ++g)
                     {
-                        // Check for an illegal operation (PROJ 9.1.0). We do this because
-                        // proj_create_crs_to_crs_from_pj() will succeed even though the operation will not
-                        // process the Z input.
-                        if (p1_type == PJ_TYPE_GEOGRAPHIC_2D_CRS && p2_type == PJ_TYPE_COMPOUND_CRS)
+                        const char* name = nullptr;
+                        int available = 0;
+                        if (proj_coordoperation_get_grid_used(ctx, op, g, &name, nullptr, nullptr, nullptr, nullptr, nullptr, &available) &&
+                            name && available)
                         {
-                            std::string warning = "Warning, \"" + def + "\" transforms from GEOGRAPHIC_2D_CRS to COMPOUND_CRS. Z values will be discarded. Use a GEOGRAPHIC_3D_CRS instead";
-                            redirect_proj_log(nullptr, 0, warning.c_str());
+                            // cell sizes of geographic grids are in radians
+                            auto info = proj_grid_info(name);
+                            double cell = util::rad2deg(std::min(info.cs_lon, info.cs_lat));
+                            if (cell > 0.0 && (result == 0.0 || cell < result))
+                                result = cell;
                         }
+                    }
+                    proj_destroy(op);
+                }
+                proj_list_destroy(ops);
+            }
+            proj_operation_factory_context_destroy(factory);
 
-                        // if they are both CRS's, just make a transform operation.
-                        pj = proj_create_crs_to_crs_from_pj(ctx, p1, p2, nullptr, nullptr);
+            return result;
+        }
 
-                        if (pj && proj_get_type(pj) != PJ_TYPE_UNKNOWN)
-                        {
-                            const char* pcstr = proj_as_proj_string(ctx, pj, PJ_PROJ_5, nullptr);
-                            if (pcstr) proj = pcstr;
-                        }
-                    }
+        //! Get the computed bounds of a projection (or guess at them). Caller must hold the mutex.
+        Box compute_bounds(const SRS::Record& r)
+        {
+            double west_lon, south_lat, east_lon, north_lat;
+            if (proj_get_area_of_use(ctx, r.pj, &west_lon, &south_lat, &east_lon, &north_lat, nullptr) &&
+                west_lon > -1000)
+            {
+                // always returns lat/long, so transform back to this srs
+                PJ* xform = get_or_create_operation(intern("wgs84"), &r).pj;
+                if (xform)
+                {
+                    PJ_COORD LL = proj_trans(xform, PJ_FWD, PJ_COORD{ west_lon, south_lat, 0.0, 0.0 });
+                    PJ_COORD UR = proj_trans(xform, PJ_FWD, PJ_COORD{ east_lon, north_lat, 0.0, 0.0 });
+                    return Box(LL.xyz.x, LL.xyz.y, UR.xyz.x, UR.xyz.y);
+                }
+            }
 
-                    else if (p1_is_crs && !p2_is_crs)
-                    {
-                        PJ_TYPE type = proj_get_type(p1);
+            // We will have to make an educated guess.
+            if (r.horiz_crs_type == PJ_TYPE_GEOGRAPHIC_2D_CRS || r.horiz_crs_type == PJ_TYPE_GEOGRAPHIC_3D_CRS)
+            {
+                return Box(-180, -90, 180, 90);
+            }
+            else if (r.horiz_crs_type != PJ_TYPE_GEOCENTRIC_CRS)
+            {
+                if (contains(r.proj, "proj=utm"))
+                {
+                    if (contains(r.proj, "+south"))
+                        return Box(166000, 1116915, 834000, 10000000);
+                    else
+                        return Box(166000, 0, 834000, 9330000);
+                }
 
-                        if (type == PJ_TYPE_GEOGRAPHIC_2D_CRS || type == PJ_TYPE_GEOGRAPHIC_3D_CRS)
-                        {
-                            proj =
-                                "+proj=pipeline"
-                                " +step +proj=unitconvert +xy_in=deg +xy_out=rad"
-                                " +step " + std::string(proj_as_proj_string(ctx, p2, PJ_PROJ_5, nullptr));
+                else if (contains(r.proj, "proj=merc"))
+                {
+                    // values found empirically 
+                    return Box(-20037508.342789244, -20048966.104014594, 20037508.342789244, 20048966.104014594);
+                }
 
-                            pj = proj_create(ctx, proj.c_str());
+                else if (contains(r.proj, "proj=qsc"))
+                {
+                    // maximum possible values, I think
+                    return Box(
+                        -r.ellipsoid.semiMajorAxis(),
+                        -r.ellipsoid.semiMinorAxis(),
+                        r.ellipsoid.semiMajorAxis(),
+                        r.ellipsoid.semiMinorAxis());
+                }
+            }
 
-                            normalize_to_gis_coords = false;
-                        }
-                        else
-                        {
-                            proj =
-                                "+proj=pipeline"
-                                " +step +proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs +towgs84=0,0,0"
-                                " +step +proj=unitconvert +xy_in=deg +xy_out=rad"
-                                " +step " + std::string(proj_as_proj_string(ctx, p2, PJ_PROJ_5, nullptr)) +
-                                " +step +proj=unitconvert +xy_in=rad +xy_out=deg";
+            return { };
+        }
+    };
 
-                            pj = proj_create(ctx, proj.c_str());
+    //! Whether an SRS is longitude/latitude on WGS84. Only the 3D variant
+    //! carries ellipsoidal height, so "height_aware" excludes EPSG:4326.
+    bool is_wgs84_geodetic(const SRS& srs, bool height_aware)
+    {
+        static const SRS wgs84_2d("epsg:4326");
 
-                            normalize_to_gis_coords = false;
-                        }
-                    }
+        return srs.valid() && (
+            srs.equivalenceId() == SRS::WGS84.equivalenceId() ||
+            (!height_aware && srs.equivalenceId() == wgs84_2d.equivalenceId()));
+    }
 
-                    else if (!p1_is_crs && p2_is_crs)
-                    {
-                        proj =
-                            "+proj=pipeline"
-                            " +step +inv " + std::string(proj_as_proj_string(ctx, p1, PJ_PROJ_5, nullptr)) +
-                            " +step " + std::string(proj_as_proj_string(ctx, p2, PJ_PROJ_5, nullptr)) +
-                            " +step +proj=unitconvert +xy_in=rad +xy_out=deg";
+    // radius of the sphere used by spherical ("web") mercator
+    constexpr double mercator_radius = 6378137.0;
 
-                        pj = proj_create(ctx, proj.c_str());
+    inline double wrap_longitude(double lon)
+    {
+        if (lon >= -180.0 && lon <= 180.0)
+            return lon;
+        lon = fmod(lon + 180.0, 360.0);
+        return (lon < 0.0 ? lon + 360.0 : lon) - 180.0;
+    }
 
-                        normalize_to_gis_coords = false;
-                    }
+    // Deliberately never destroyed, so that SRS objects stay usable
+    // during static destruction.
+    SRSRegistry& srs_registry()
+    {
+        static SRSRegistry* instance = new SRSRegistry();
+        return *instance;
+    }
 
-                    else
-                    {
-                        proj =
-                            "+proj=pipeline"
-                            " +step +inv " + std::string(proj_as_proj_string(ctx, p1, PJ_PROJ_5, nullptr)) +
-                            " +step " + std::string(proj_as_proj_string(ctx, p2, PJ_PROJ_5, nullptr));
+    //! Lattice spacing (degrees) of a cached geoid whose grid resolution is unknown
+    constexpr double default_geoid_spacing = 0.25;
 
-                        pj = proj_create(ctx, proj.c_str());
+    //! Finest lattice spacing (degrees) worth caching: 5 arc-minutes is a 4321 x 2161
+    //! lattice, held as floats in about 37 MB. Finer grids (like EGM2008's) stay with PROJ.
+    constexpr double finest_geoid_spacing = 1.0 / 12.0;
 
-                        normalize_to_gis_coords = false;
-                    }
+    //! Lattice points to transform at once while building a cached geoid; at 24 bytes
+    //! a point, this bounds the scratch memory to about 1.5 MB on top of the result.
+    constexpr std::size_t geoid_chunk_points = 65536;
 
-                    // integrate forward and backward vdatum conversions if necessary.
-                    if (pj && normalize_to_gis_coords)
-                    {
-                        // re-order the coordinates to GIS standard long=x, lat=y
-                        pj = proj_normalize_for_visualization(ctx, pj);
-                    }
-                }
+    //! Record of the ellipsoidal-height version of an SRS; the record itself
+    //! if it has no vertical datum, or nullptr if PROJ cannot provide one.
+    const SRS::Record* ellipsoidal_record(const SRS::Record* r)
+    {
+        if (!r->verticalDatum)
+            return r;
+
+        std::call_once(r->ellipsoidalOnce, [r]()
+            {
+                auto& registry = srs_registry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                r->ellipsoidal = registry.ellipsoidal_counterpart(*r);
+            });
+
+        return r->ellipsoidal;
+    }
 
-                if (!pj && error.empty())
+    //! Per-thread clones of the shared transformation objects,
+    //! since PJ objects may not be used from more than one thread at a time.
+    struct SRSFactory
+    {
+        //! identifies this thread's factory in cached operation handles
+        const std::uint32_t serial = ++g_srs_factory_serial;
+
+        //! operation handles by slot, and slots by (from id, to id)
+        std::vector<PJ*> operations;
+        std::unordered_map<std::uint64_t, std::uint32_t> operation_slots;
+
+        //! destroy cache entries and threading context upon descope
+        ~SRSFactory()
+        {
+            for (auto pj : operations)
+            {
+                if (pj)
                 {
-                    auto err_no = proj_context_errno(ctx);
-                    if (err_no != 0)
-                    {
-                        error = proj_errno_string(err_no);
-                        //Instance::log().warn << error << " (\"" << def << "\")" << std::endl;
-                    }
+                    proj_destroy(pj);
                 }
+            }
+
+            if (g_pj_thread_local_context)
+                proj_context_destroy(g_pj_thread_local_context);
+        }
+
+        PJ_CONTEXT* threading_context()
+        {
+            if (g_pj_thread_local_context == nullptr)
+            {
+                g_pj_thread_local_context = proj_context_create();
+                proj_log_func(g_pj_thread_local_context, nullptr, redirect_proj_log);
+            }
+            return g_pj_thread_local_context;
+        }
+
+        //! slot of the transformation object between two SRS's in this thread's factory
+        std::uint32_t get_operation_slot(const SRS& from, const SRS& to)
+        {
+            std::uint64_t key = ((std::uint64_t)from.id() << 32) | (std::uint64_t)to.id();
+            auto iter = operation_slots.find(key);
+            if (iter != operation_slots.end())
+                return iter->second;
+
+            ROCKY_PROFILE_FUNCTION();
 
-                auto& new_entry = (*this)[def];
-                new_entry.pj = pj;
-                new_entry.proj = proj;
-                new_entry.error = error;
+            auto ctx = threading_context();
+            PJ* pj = nullptr;
+            bool built = false;
+            {
+                // the first thread to need an operation builds it; the rest just clone it.
+                auto& registry = srs_registry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                auto& shared = registry.get_or_create_operation(
+                    registry.intern(from.definition()),
+                    registry.intern(to.definition()));
+
+                if (shared.pj)
+                {
+                    built = true;
+                    pj = proj_clone(ctx, shared.pj);
+                }
             }
-            else
+
+            if (built && !pj)
             {
-                pj = iter->second.pj;
+                // cloning failed, so build a private copy from scratch.
+                PJ* p1 = create_pj(ctx, from.definition());
+                PJ* p2 = create_pj(ctx, to.definition());
+                std::string proj, error;
+                pj = create_operation(ctx, p1, p2, from.definition() + "->" + to.definition(), proj, error);
+                if (p1) proj_destroy(p1);
+                if (p2) proj_destroy(p2);
             }
-            return pj;
+
+            auto slot = (std::uint32_t)operations.size();
+            operations.push_back(pj);
+            operation_slots[key] = slot;
+            return slot;
         }
     };
 
@@ -450,27 +653,63 @@ SRS::projVersion()
     return std::to_string(PROJ_VERSION_MAJOR) + "." + std::to_string(PROJ_VERSION_MINOR);
 }
 
+void
+SRS::warmUp(const std::vector<SRS>& list)
+{
+    ROCKY_PROFILE_FUNCTION();
+
+    {
+        auto& registry = srs_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        for (auto& from : list)
+        {
+            for (auto& to : list)
+            {
+                if (from.valid() && to.valid() && from != to)
+                {
+                    registry.get_or_create_operation(from._record, to._record);
+                }
+            }
+        }
+    }
+
+    // vertical datum grids are sampled through the operations above
+    for (auto& srs : list)
+    {
+        srs.geoid();
+    }
+}
+
 SRS::SRS()
 {
     //nop
 }
 
-SRS::SRS(const std::string& h) :
-    _definition(h)
+SRS::SRS(const std::string& h)
 {
-    PJ* pj = g_srs_factory.get_or_create(h).pj;
-    _valid = (pj != nullptr);
+    if (!h.empty())
+    {
+        auto& registry = srs_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        *this = SRS(registry.intern(h));
+    }
+}
 
-    if (_valid)
+SRS::SRS(const Record* record) :
+    _record(record)
+{
+    if (_record && _record->pj)
     {
         // cache things that get called a LOT
-        auto type = g_srs_factory.get_horiz_crs_type(h);
-        
+        _valid = true;
+        _equivalenceId = _record->equivalenceId;
+
         _isGeodetic =
-            type == PJ_TYPE_GEOGRAPHIC_2D_CRS ||
-            type == PJ_TYPE_GEOGRAPHIC_3D_CRS;
+            _record->horiz_crs_type == PJ_TYPE_GEOGRAPHIC_2D_CRS ||
+            _record->horiz_crs_type == PJ_TYPE_GEOGRAPHIC_3D_CRS;
 
-        _isGeocentric = type == PJ_TYPE_GEOCENTRIC_CRS;
+        _isGeocentric = _record->horiz_crs_type == PJ_TYPE_GEOCENTRIC_CRS;
     }
 }
 
@@ -479,12 +718,22 @@ SRS::~SRS()
     //nop
 }
 
+const std::string&
+SRS::definition() const
+{
+    return _record ? _record->definition : empty_string;
+}
+
+unsigned
+SRS::id() const
+{
+    return _record ? _record->id : 0;
+}
+
 const char*
 SRS::name() const
 {
-    PJ* pj = g_srs_factory.get_or_create(_definition).pj;
-    if (!pj) return "";
-    return proj_get_name(pj);
+    return _record ? _record->name.c_str() : "";
 }
 
 bool
@@ -502,40 +751,13 @@ SRS::isGeocentric() const
 bool
 SRS::isProjected() const
 {
-    if (!valid())
-        return false;
-
-    auto type = g_srs_factory.get_horiz_crs_type(definition());
-    return
-        type == PJ_TYPE_PROJECTED_CRS;
-}
-
-bool
-SRS::isEquivalentTo(const SRS& rhs) const
-{
-    if (definition().empty() || rhs.definition().empty())
-        return false;
-
-    PJ* pj1 = g_srs_factory.get_or_create(definition()).pj;
-    if (!pj1) return false;
-
-    PJ* pj2 = g_srs_factory.get_or_create(rhs.definition()).pj;
-    if (!pj2) return false;
-
-    return proj_is_equivalent_to_with_ctx(
-        g_srs_factory.threading_context(), pj1, pj2, PJ_COMP_EQUIVALENT);
-}
-
-bool
-SRS::isHorizEquivalentTo(const SRS& rhs) const
-{
-    return isEquivalentTo(rhs);
+    return valid() && _record->horiz_crs_type == PJ_TYPE_PROJECTED_CRS;
 }
 
 const std::string&
 SRS::wkt() const
 {
-    return g_srs_factory.get_wkt(definition());
+    return _record ? _record->wkt : empty_string;
 }
 
 const Units&
@@ -547,13 +769,99 @@ SRS::units() const
 const Ellipsoid&
 SRS::ellipsoid() const
 {
-    return g_srs_factory.get_ellipsoid(definition());
+    return _record ? _record->ellipsoid : default_ellipsoid;
 }
 
 const Box&
 SRS::bounds() const
 {
-    return g_srs_factory.get_bounds(definition());
+    if (!valid())
+        return empty_box;
+
+    std::call_once(_record->boundsOnce, [this]()
+        {
+            auto& registry = srs_registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            _record->bounds = registry.compute_bounds(*_record);
+        });
+
+    return _record->bounds;
+}
+
+shared_ptr<Geoid>
+SRS::geoid() const
+{
+    if (!valid() || !_record->verticalDatum)
+        return nullptr;
+
+    std::call_once(_record->geoidOnce, [this]()
+        {
+            ROCKY_PROFILE_FUNCTION();
+
+            auto ellipsoidal = ellipsoidal_record(_record);
+            if (!ellipsoidal)
+                return;
+
+            // Sample the datum's undulation on a global lattice with the spacing of
+            // the datum's own grid, by converting zero orthometric heights to
+            // ellipsoidal heights. Grids too fine to hold globally stay with PROJ.
+            double spacing = default_geoid_spacing;
+            {
+                auto& registry = srs_registry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                double cell = registry.grid_resolution(_record, ellipsoidal);
+                if (cell > 0.0)
+                    spacing = cell;
+            }
+
+            if (spacing < finest_geoid_spacing - 1e-9)
+            {
+                Log()->info("Vertical datum grid for \"" + std::string(name()) + "\" is too fine to cache; using PROJ for height conversions");
+                return;
+            }
+
+            const unsigned cols = (unsigned)std::round(360.0 / spacing) + 1;
+            const unsigned rows = (unsigned)std::round(180.0 / spacing) + 1;
+            const double dx = 360.0 / (double)(cols - 1), dy = 180.0 / (double)(rows - 1);
+
+            // The operation is built by hand so that it never takes a fast path.
+            SRSOperation op;
+            op._from = *this;
+            op._to = SRS(ellipsoidal);
+
+            auto hf = Heightfield::create(cols, rows);
+            auto heights = hf->data<float>();
+
+            // transform the lattice a few rows at a time, straight into the heightfield
+            const unsigned chunkRows = std::max(1u, (unsigned)(geoid_chunk_points / cols));
+            std::vector<glm::dvec3> chunk((std::size_t)chunkRows * cols);
+
+            bool ok = op.valid();
+            for (unsigned r0 = 0; ok && r0 < rows; r0 += chunkRows)
+            {
+                const unsigned r1 = std::min(rows, r0 + chunkRows);
+                const std::size_t count = (std::size_t)(r1 - r0) * cols;
+
+                for (unsigned r = r0; r < r1; ++r)
+                    for (unsigned c = 0; c < cols; ++c)
+                        chunk[(std::size_t)(r - r0) * cols + c] = glm::dvec3(-180.0 + dx * c, -90.0 + dy * r, 0.0);
+
+                ok = op.transformArray(chunk.data(), count);
+
+                for (std::size_t i = 0; ok && i < count; ++i)
+                    heights[(std::size_t)r0 * cols + i] = (float)chunk[i].z;
+            }
+
+            if (!ok)
+            {
+                Log()->warn("Vertical datum grid unavailable for \"" + std::string(name()) + "\"; using PROJ for height conversions");
+                return;
+            }
+
+            _record->geoid = Geoid::create(name(), hf, Units::METERS);
+        });
+
+    return _record->geoid;
 }
 
 SRSOperation
@@ -565,6 +873,33 @@ SRS::to(const SRS& rhs) const
         result._from = *this;
         result._to = rhs;
         result._nop = (result._from == result._to);
+
+        // recognize the common pairs that have closed-form solutions
+        if (!result._nop)
+        {
+            if (is_wgs84_geodetic(*this, true) && rhs.equivalenceId() == SRS::ECEF.equivalenceId())
+                result._fastPath = SRSOperation::FastPath::GeodeticToGeocentric;
+            else if (equivalenceId() == SRS::ECEF.equivalenceId() && is_wgs84_geodetic(rhs, true))
+                result._fastPath = SRSOperation::FastPath::GeocentricToGeodetic;
+            else if (is_wgs84_geodetic(*this, false) && rhs.equivalenceId() == SRS::SPHERICAL_MERCATOR.equivalenceId())
+                result._fastPath = SRSOperation::FastPath::GeodeticToMercator;
+            else if (equivalenceId() == SRS::SPHERICAL_MERCATOR.equivalenceId() && is_wgs84_geodetic(rhs, false))
+                result._fastPath = SRSOperation::FastPath::MercatorToGeodetic;
+            else if (_isGeodetic && rhs._isGeodetic && (_record->verticalDatum || rhs._record->verticalDatum))
+            {
+                // same horizontal datum, different heights: shift z by the difference
+                // between the two geoids and leave x and y alone.
+                auto lhs_ellipsoidal = ellipsoidal_record(_record);
+                auto rhs_ellipsoidal = ellipsoidal_record(rhs._record);
+                if (lhs_ellipsoidal && rhs_ellipsoidal &&
+                    lhs_ellipsoidal->equivalenceId == rhs_ellipsoidal->equivalenceId &&
+                    (!_record->verticalDatum || geoid()) &&
+                    (!rhs._record->verticalDatum || rhs.geoid()))
+                {
+                    result._fastPath = SRSOperation::FastPath::VerticalDatum;
+                }
+            }
+        }
         return result;
     }
     return result;
@@ -578,31 +913,43 @@ SRS::geoSRS() const
     if (isGeodetic())
         return *this;
 
-    auto& def = g_srs_factory.get_or_create(_definition);
+    if (!valid())
+        return SRS();
 
-    PJ* pj = def.pj;
-    if (pj)
+    auto geo = _record->geo.load();
+    if (!geo)
     {
+        auto& registry = srs_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        std::string def;
         if (isGeocentric())
         {
             // A bit hacky but it works.
             // We do this because proj_crs_get_geodetic_crs() on a geocentric CRS
             // just returns the same geocentric CRS. Is that a bug in proj?
-            std::string proj = def.proj;
-            util::replace_in_place(proj, "+proj=geocent", "+proj=longlat");
-            return SRS(proj);
+            def = _record->proj;
+            util::replace_in_place(def, "+proj=geocent", "+proj=longlat");
         }
-        auto ctx = g_srs_factory.threading_context();
-
-        PJ* pjgeo = proj_crs_get_geodetic_crs(ctx, pj);
-        if (pjgeo)
+        else
         {
-            std::string wkt = proj_as_wkt(ctx, pjgeo, PJ_WKT2_2019, nullptr);
-            proj_destroy(pjgeo);
-            return SRS(wkt);
+            PJ* pjgeo = proj_crs_get_geodetic_crs(registry.ctx, _record->pj);
+            if (pjgeo)
+            {
+                const char* wkt = proj_as_wkt(registry.ctx, pjgeo, PJ_WKT2_2019, nullptr);
+                if (wkt)
+                    def = wkt;
+                proj_destroy(pjgeo);
+            }
         }
+
+        if (def.empty())
+            return SRS(); // invalid
+
+        geo = registry.intern(def);
+        _record->geo = geo;
     }
-    return SRS(); // invalid
+    return SRS(geo);
 }
 
 SRS
@@ -610,20 +957,31 @@ SRS::geocentricSRS() const
 {
     ROCKY_PROFILE_FUNCTION();
 
-    auto& def = g_srs_factory.get_or_create(_definition);
-    if (def.pj)
+    if (!valid())
+        return SRS();
+
+    auto geocentric = _record->geocentric.load();
+    if (!geocentric)
     {
-        auto ctx = g_srs_factory.threading_context();
-        PJ* pjgeo = proj_crs_get_geodetic_crs(ctx, def.pj);
-        if (pjgeo)
-        {
-            std::string proj = proj_as_proj_string(ctx, pjgeo, PJ_PROJ_5, nullptr);
-            util::replace_in_place(proj, "+proj=longlat", "+proj=geocent");
-            proj_destroy(pjgeo);
-            return SRS(proj);
-        }
+        auto& registry = srs_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        PJ* pjgeo = proj_crs_get_geodetic_crs(registry.ctx, _record->pj);
+        if (!pjgeo)
+            return SRS();
+
+        const char* pcstr = proj_as_proj_string(registry.ctx, pjgeo, PJ_PROJ_5, nullptr);
+        std::string proj = pcstr ? pcstr : "";
+        proj_destroy(pjgeo);
+
+        if (proj.empty())
+            return SRS();
+
+        util::replace_in_place(proj, "+proj=longlat", "+proj=geocent");
+        geocentric = registry.intern(proj);
+        _record->geocentric = geocentric;
     }
-    return SRS();
+    return SRS(geocentric);
 }
 
 glm::dmat4
@@ -725,14 +1083,14 @@ SRS::transformUnits(
 const std::string&
 SRS::errorMessage() const
 {
-    return g_srs_factory.get_error_message(definition());
+    return _record ? _record->error : empty_string;
 }
 
 std::string
 SRS::string() const
 {
     if (valid())
-        return g_srs_factory.get_or_create(definition()).proj;
+        return _record->proj;
     else
         return "";
 }
@@ -742,13 +1100,36 @@ SRSOperation::SRSOperation()
     // nop
 }
 
+SRSOperation::SRSOperation(const SRSOperation& rhs) :
+    _from(rhs._from),
+    _to(rhs._to),
+    _nop(rhs._nop),
+    _fastPath(rhs._fastPath),
+    _handle(rhs._handle.load(std::memory_order_relaxed))
+{
+    //nop
+}
+
 SRSOperation&
-SRSOperation::operator=(SRSOperation&& rhs)
+SRSOperation::operator=(const SRSOperation& rhs)
 {
     _from = rhs._from;
     _to = rhs._to;
+    _nop = rhs._nop;
+    _fastPath = rhs._fastPath;
+    _handle = rhs._handle.load(std::memory_order_relaxed);
+    return *this;
+}
+
+SRSOperation&
+SRSOperation::operator=(SRSOperation&& rhs)
+{
+    *this = rhs;
     rhs._from = { };
     rhs._to = { };
+    rhs._nop = false;
+    rhs._fastPath = FastPath::None;
+    rhs._handle = 0;
     return *this;
 }
 
@@ -760,20 +1141,44 @@ SRSOperation::~SRSOperation()
 bool
 SRSOperation::valid() const
 {
-    return _from.valid() && _to.valid() && get_handle() != nullptr;
+    return _from.valid() && _to.valid() && (isFastPath() || get_handle() != nullptr);
+}
+
+SRSOperation
+SRSOperation::withoutFastPath() const
+{
+    SRSOperation result(*this);
+    result._fastPath = FastPath::None;
+    result._handle = 0;
+    return result;
 }
 
 void*
 SRSOperation::get_handle() const
 {
-    return (void*)g_srs_factory.get_or_create_operation(
-        _from.definition(),
-        _to.definition());
+    // closed-form operations don't use PROJ
+    if (isFastPath())
+        return nullptr;
+
+    // The cached value is the owning factory's serial number and the slot of the
+    // handle in that factory. Serials are never reused, so a value cached by another
+    // thread (or by a thread that has since exited) simply fails to match.
+    auto& factory = g_srs_factory;
+    std::uint64_t cached = _handle.load(std::memory_order_relaxed);
+    if ((std::uint32_t)(cached >> 32) == factory.serial)
+        return factory.operations[(std::uint32_t)cached];
+
+    auto slot = factory.get_operation_slot(_from, _to);
+    _handle.store(((std::uint64_t)factory.serial << 32) | slot, std::memory_order_relaxed);
+    return factory.operations[slot];
 }
 
 bool
 SRSOperation::forward(void* handle, double& x, double& y, double& z) const
 {
+    if (isFastPath())
+        return fast(false, &x, &y, &z, 0, 1);
+
     if (handle)
     {
         proj_errno_reset((PJ*)handle);
@@ -794,6 +1199,9 @@ SRSOperation::forward(void* handle, double& x, double& y, double& z) const
 bool
 SRSOperation::forward(void* handle, double* x, double* y, double* z, std::size_t stride, std::size_t count) const
 {
+    if (isFastPath())
+        return fast(false, x, y, z, stride, count);
+
     if (handle)
     {
         proj_errno_reset((PJ*)handle);
@@ -820,6 +1228,9 @@ SRSOperation::forward(void* handle, double* x, double* y, double* z, std::size_t
 bool
 SRSOperation::inverse(void* handle, double& x, double& y, double& z) const
 {
+    if (isFastPath())
+        return fast(true, &x, &y, &z, 0, 1);
+
     if (handle)
     {
         proj_errno_reset((PJ*)handle);
@@ -840,6 +1251,9 @@ SRSOperation::inverse(void* handle, double& x, double& y, double& z) const
 bool
 SRSOperation::inverse(void* handle, double* x, double* y, double* z, std::size_t stride, std::size_t count) const
 {
+    if (isFastPath())
+        return fast(true, x, y, z, stride, count);
+
     if (handle)
     {
         proj_errno_reset((PJ*)handle);
@@ -862,9 +1276,123 @@ SRSOperation::inverse(void* handle, double* x, double* y, double* z, std::size_t
         return false;
 }
 
+bool
+SRSOperation::fast(bool inverse, double* x, double* y, double* z, std::size_t stride, std::size_t count) const
+{
+    auto path = _fastPath;
+    if (inverse)
+    {
+        path =
+            path == FastPath::GeodeticToGeocentric ? FastPath::GeocentricToGeodetic :
+            path == FastPath::GeocentricToGeodetic ? FastPath::GeodeticToGeocentric :
+            path == FastPath::GeodeticToMercator ? FastPath::MercatorToGeodetic :
+            path == FastPath::MercatorToGeodetic ? FastPath::GeodeticToMercator :
+            path;
+    }
+
+    // stride is in bytes, as with proj_trans_generic
+    auto advance = [stride](double*& p) { p = (double*)((char*)p + stride); };
+    std::size_t errors = 0;
+
+    switch (path)
+    {
+    case FastPath::GeodeticToGeocentric:
+    {
+        auto& ellipsoid = SRS::WGS84.ellipsoid();
+        for (std::size_t i = 0; i < count; ++i, advance(x), advance(y), advance(z))
+        {
+            auto p = ellipsoid.geodeticToGeocentric(glm::dvec3(*x, *y, *z));
+            *x = p.x, *y = p.y, *z = p.z;
+        }
+        break;
+    }
+    case FastPath::GeocentricToGeodetic:
+    {
+        auto& ellipsoid = SRS::WGS84.ellipsoid();
+        for (std::size_t i = 0; i < count; ++i, advance(x), advance(y), advance(z))
+        {
+            auto p = ellipsoid.geocentricToGeodetic(glm::dvec3(*x, *y, *z));
+            *x = p.x, *y = p.y, *z = p.z;
+        }
+        break;
+    }
+    case FastPath::GeodeticToMercator:
+    {
+        for (std::size_t i = 0; i < count; ++i, advance(x), advance(y))
+        {
+            if (*y >= -90.0 && *y <= 90.0)
+            {
+                *x = mercator_radius * util::deg2rad(wrap_longitude(*x));
+                *y = mercator_radius * std::log(std::tan(0.25 * M_PI + 0.5 * util::deg2rad(*y)));
+            }
+            else
+            {
+                *x = *y = HUGE_VAL;
+                ++errors;
+            }
+        }
+        break;
+    }
+    case FastPath::MercatorToGeodetic:
+    {
+        for (std::size_t i = 0; i < count; ++i, advance(x), advance(y))
+        {
+            *x = wrap_longitude(util::rad2deg(*x / mercator_radius));
+            *y = util::rad2deg(atan(sinh(*y / mercator_radius)));
+        }
+        break;
+    }
+    case FastPath::VerticalDatum:
+    {
+        // ellipsoidal h = H_from + N_from = H_to + N_to
+        auto from_geoid = _from.geoid();
+        auto to_geoid = _to.geoid();
+        const double sign = inverse ? -1.0 : 1.0;
+
+        constexpr std::size_t chunk = 256;
+        glm::dvec3 points[chunk];
+        float from_N[chunk], to_N[chunk];
+
+        for (std::size_t first = 0; first < count; first += chunk)
+        {
+            std::size_t n = std::min(chunk, count - first);
+
+            for (std::size_t i = 0; i < n; ++i, advance(x), advance(y))
+                points[i] = glm::dvec3(*x, *y, 0.0);
+
+            if (from_geoid)
+                from_geoid->getHeights(points, n, from_N);
+            else
+                std::fill(from_N, from_N + n, 0.0f);
+
+            if (to_geoid)
+                to_geoid->getHeights(points, n, to_N);
+            else
+                std::fill(to_N, to_N + n, 0.0f);
+
+            for (std::size_t i = 0; i < n; ++i, advance(z))
+                *z += sign * ((double)from_N[i] - (double)to_N[i]);
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    if (errors > 0)
+    {
+        _lastError = "Invalid latitude";
+        return false;
+    }
+    return true;
+}
+
 std::string
 SRSOperation::string() const
 {
+    if (isFastPath())
+        return withoutFastPath().string();
+
     return std::string(
         proj_as_proj_string(g_pj_thread_local_context, (PJ*)get_handle(), PJ_PROJ_5, nullptr));
 }
@@ -8,10 +8,13 @@
 #include <rocky/Common.h>
 #include <rocky/Units.h>
 #include <rocky/Ellipsoid.h>
+#include <atomic>
+#include <cstdint>
 
 namespace ROCKY_NAMESPACE
 {
     class SRSOperation;
+    class Geoid;
 
     /**
     * Spatial reference system.
@@ -58,8 +61,16 @@ namespace ROCKY_NAMESPACE
         const char* name() const;
 
         //! Definition used to initialize this SRS
-        const std::string& definition() const {
-            return _definition;
+        const std::string& definition() const;
+
+        //! Id of this SRS's interned definition. SRS objects created from
+        //! the same definition string share an id. Zero for an empty SRS.
+        unsigned id() const;
+
+        //! Id shared by every SRS that is equivalent to this one, regardless
+        //! of the definition string that created it. Zero if invalid.
+        unsigned equivalenceId() const {
+            return _equivalenceId;
         }
 
         //! Whether this is a valid SRS
@@ -97,12 +108,21 @@ namespace ROCKY_NAMESPACE
         //! Bounding box, if known
         const Box& bounds() const;
 
+        //! Undulation grid of this SRS's vertical datum, sampled from PROJ once
+        //! and kept for the life of the process. nullptr if the SRS has no
+        //! vertical datum or the datum's grid is unavailable.
+        shared_ptr<Geoid> geoid() const;
+
         //! Whether this SRS is mathematically equivalent to another SRS
         //! without taking vertical datums into account.
-        bool isHorizEquivalentTo(const SRS& rhs) const;
+        bool isHorizEquivalentTo(const SRS& rhs) const {
+            return isEquivalentTo(rhs);
+        }
 
         //! Whether this SRS is mathematically equivalent to another SRS
-        bool isEquivalentTo(const SRS& rhs) const;
+        bool isEquivalentTo(const SRS& rhs) const {
+            return _valid && rhs._valid && _equivalenceId == rhs._equivalenceId;
+        }
 
         //! Equality is the same as equivalency
         bool operator == (const SRS& rhs) const {
@@ -150,9 +170,22 @@ namespace ROCKY_NAMESPACE
         //! Version of PROJ we use
         static std::string projVersion();
 
+        //! Builds the shared PROJ objects for the operations between every pair
+        //! of SRS's in a list, so threads that use them later only need to clone
+        //! them, and caches the vertical datum grid of each. Safe to call from any thread.
+        static void warmUp(const std::vector<SRS>& list);
+
+    public:
+        //! Interned definition and its cached metadata (internal)
+        struct Record;
+
     private:
-        //! Create an SRS from an initialization string.
-        std::string _definition;
+        explicit SRS(const Record* record);
+
+        //! Shared, immutable record for this SRS's definition.
+        //! Records live for the life of the process so copying an SRS is cheap.
+        const Record* _record = nullptr;
+        unsigned _equivalenceId = 0;
         bool _valid = false;
         bool _isGeodetic = false;
         bool _isGeocentric = false;
@@ -224,7 +257,7 @@ namespace ROCKY_NAMESPACE
         //! @return True if all transformations succeeded
         template<typename DVEC3>
         bool transformArray(DVEC3* inout, std::size_t count) const {
-            return _nop ? true : forward(get_handle(),
+            return (_nop || count == 0) ? true : forward(get_handle(),
                 &inout[0][0], &inout[0][1], &inout[0][2], sizeof(DVEC3), count);
         }
 
@@ -253,7 +286,7 @@ namespace ROCKY_NAMESPACE
         //! @return True if all transformations succeeded
         template<typename DVEC3>
         bool inverseArray(DVEC3* inout, std::size_t count) const {
-            return _nop ? true : inverse(get_handle(),
+            return (_nop || count == 0) ? true : inverse(get_handle(),
                 &inout[0][0], &inout[0][1], &inout[0][2], sizeof(DVEC3), count);
         }
 
@@ -266,25 +299,51 @@ namespace ROCKY_NAMESPACE
         //! (for debugging purposes)
         std::string string() const;
 
+        //! Whether this operation runs a built-in closed-form conversion
+        //! (geodetic <> geocentric, geodetic <> spherical mercator on WGS84,
+        //! or a height shift between vertical datums via cached geoid grids)
+        //! instead of calling into PROJ
+        bool isFastPath() const {
+            return _fastPath != FastPath::None;
+        }
+
+        //! Copy of this operation that always runs through PROJ
+        SRSOperation withoutFastPath() const;
+
         // copy/move ops
-        SRSOperation(const SRSOperation& rhs) = default;
-        SRSOperation& operator=(const SRSOperation&) = default;
-        SRSOperation(SRSOperation&& rhs) { *this = rhs; }
+        SRSOperation(const SRSOperation& rhs);
+        SRSOperation& operator=(const SRSOperation&);
+        SRSOperation(SRSOperation&& rhs) { *this = std::move(rhs); }
         SRSOperation& operator=(SRSOperation&&);
         ~SRSOperation();
 
     private:
+        enum class FastPath : unsigned char {
+            None,
+            GeodeticToGeocentric,
+            GeocentricToGeodetic,
+            GeodeticToMercator,
+            MercatorToGeodetic,
+            VerticalDatum
+        };
+
         SRS _from;
         SRS _to;
         bool _nop = false;
+        FastPath _fastPath = FastPath::None;
         mutable std::string _lastError;
 
+        //! Per-thread PROJ handle resolved on first use (see get_handle)
+        mutable std::atomic<std::uint64_t> _handle = { 0 };
+
         void* get_handle() const;
         bool forward(void* handle, double& x, double& y, double& z) const;
         bool inverse(void* handle, double& x, double& y, double& z) const;
 
         bool forward(void* handle, double* x, double* y, double* z, std::size_t stride, std::size_t count) const;
         bool inverse(void* handle, double* x, double* y, double* z, std::size_t stride, std::size_t count) const;
+
+        bool fast(bool inverse, double* x, double* y, double* z, std::size_t stride, std::size_t count) const;
         friend class SRS;
     };
 }
@@ -127,6 +127,40 @@ namespace ROCKY_NAMESPACE
                 _list.splice(_list.begin(), _list, _sentryptr);
                 _sentryptr = _list.begin();
             }
+
+            //! Same as flush, but visits the non-visited records starting
+            //! with the least recently used one.
+            inline void flushOldestFirst(
+                unsigned maxCount,
+                std::function<bool(T& obj)> dispose)
+            {
+                ListIterator i = _list.end();
+                unsigned count = 0;
+
+                while (count < maxCount && --i != _sentryptr)
+                {
+                    ListEntry& le = *i;
+
+                    bool disposed = true;
+
+                    if (dispose != nullptr)
+                        disposed = dispose(le._data);
+
+                    if (disposed)
+                    {
+                        delete static_cast<Token*>(le._token);
+
+                        // erase returns the record after the removed one, so the
+                        // next decrement lands on the record before it.
+                        i = _list.erase(i);
+                        ++count;
+                    }
+                }
+
+                // reset the sentry.
+                _list.splice(_list.begin(), _list, _sentryptr);
+                _sentryptr = _list.begin();
+            }
         };
     }
 }
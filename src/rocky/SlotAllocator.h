@@ -0,0 +1,81 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+#include <rocky/Common.h>
+#include <vector>
+#include <algorithm>
+
+namespace ROCKY_NAMESPACE
+{
+    namespace util
+    {
+        /**
+        * Hands out integer slots in [0..capacity) and takes them back,
+        * reusing released slots before touching fresh ones. Suits anything
+        * addressed by index, like the layers of a texture array or the
+        * elements of a GPU buffer. Not thread-safe.
+        */
+        class SlotAllocator
+        {
+        public:
+            //! Construct an allocator with a number of slots
+            SlotAllocator(unsigned capacity = 0u) :
+                _capacity(capacity) { }
+
+            //! Take a slot.
+            //! @return Slot index, or -1 if all slots are in use
+            int allocate()
+            {
+                if (!_free.empty())
+                {
+                    int slot = _free.back();
+                    _free.pop_back();
+                    return slot;
+                }
+                return _end < _capacity ? (int)_end++ : -1;
+            }
+
+            //! Return a slot for reuse
+            void release(int slot)
+            {
+                if (slot >= 0 && (unsigned)slot < _end)
+                    _free.push_back(slot);
+            }
+
+            //! Add slots. The capacity never shrinks.
+            void grow(unsigned capacity)
+            {
+                _capacity = std::max(_capacity, capacity);
+            }
+
+            //! Total number of slots
+            unsigned capacity() const {
+                return _capacity;
+            }
+
+            //! Number of slots in use
+            unsigned size() const {
+                return _end - (unsigned)_free.size();
+            }
+
+            //! Whether every slot is in use
+            bool full() const {
+                return _free.empty() && _end >= _capacity;
+            }
+
+            //! One past the highest slot ever handed out; slots
+            //! at or above this have never held anything
+            unsigned end() const {
+                return _end;
+            }
+
+        private:
+            unsigned _capacity;
+            unsigned _end = 0u;
+            std::vector<int> _free;
+        };
+    }
+}
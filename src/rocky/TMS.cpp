@@ -459,7 +459,7 @@ TileMap::getURI(const TileKey& tilekey, bool invertY) const
 bool
 TileMap::intersectsKey(const TileKey& tilekey) const
 {
-    Box b = tilekey.extent().bounds();
+    Box b = tilekey.bounds();
 
     bool inter = intersects(
         minX, minY, maxX, maxY,
@@ -744,65 +744,79 @@ TMS::Driver::open(
     return StatusOK;
 }
 
+URI
+TMS::Driver::tileURI(const URI& uri, const TileKey& key, bool invertY, bool isMapboxRGB) const
+{
+    URI imageURI(tileMap.getURI(key, invertY), uri.context());
+    if (!imageURI.empty() && isMapboxRGB)
+    {
+        if (imageURI.full().find('?') == std::string::npos)
+            imageURI = URI(imageURI.full() + "?mapbox=true", uri.context());
+        else
+            imageURI = URI(imageURI.full() + "&mapbox=true", uri.context());
+    }
+    return imageURI;
+}
+
+Result<Content>
+TMS::Driver::readContent(const URI& uri, const TileKey& key, bool invertY, bool isMapboxRGB, const IOOptions& io) const
+{
+    if (!tileMap.valid() || key.levelOfDetail() > tileMap.maxLevel)
+        return Status(Status::ResourceUnavailable);
+
+    URI imageURI = tileURI(uri, key, invertY, isMapboxRGB);
+    if (imageURI.empty())
+        return Status(Status::ResourceUnavailable);
+
+    auto fetch = imageURI.read(io);
+    if (fetch.status.failed())
+        return fetch.status;
+
+    return fetch.value;
+}
+
 Result<shared_ptr<Image>>
 TMS::Driver::read(const URI& uri, const TileKey& key, bool invertY, bool isMapboxRGB, const IOOptions& io) const
 {
-    shared_ptr<Image> image;
-    URI imageURI;
-
-    // create the URI from the tile map?
-    if (tileMap.valid() && key.levelOfDetail() <= tileMap.maxLevel)
+    auto content = readContent(uri, key, invertY, isMapboxRGB, io);
+    if (content.status.failed())
     {
-        imageURI = URI(tileMap.getURI(key, invertY), uri.context());
-        if (!imageURI.empty() && isMapboxRGB)
-        {
-            if (imageURI.full().find('?') == std::string::npos)
-                imageURI = URI(imageURI.full() + "?mapbox=true", uri.context());
-            else
-                imageURI = URI(imageURI.full() + "&mapbox=true", uri.context());
-        }
+        return content.status;
+    }
 
-        auto fetch = imageURI.read(io);
-        if (fetch.status.failed())
-        {
-            return fetch.status;
-        }
+    return decode(content.value, key, io);
+}
 
-        std::istringstream buf(fetch->data);
-        auto image_rr = io.services.readImageFromStream(buf, fetch->contentType, io);
+Result<shared_ptr<Image>>
+TMS::Driver::decode(const Content& content, const TileKey& key, const IOOptions& io) const
+{
+    std::istringstream buf(content.data);
+    auto image_rr = io.services.readImageFromStream(buf, content.contentType, io);
 
-        if (image_rr.status.failed())
-        {
-            return image_rr.status;
-        }
+    if (image_rr.status.failed())
+    {
+        return image_rr.status;
+    }
 
-        image = image_rr.value;
+    if (image_rr.value)
+    {
+        return image_rr.value;
+    }
 
-        if (!image)
-        {
-            if (imageURI.empty() || !tileMap.intersectsKey(key))
-            {
-                // We couldn't read the image from the URL or the cache, so check to see
-                // whether the given key is less than the max level of the tilemap
-                // and create a transparent image.
-                if (key.levelOfDetail() <= tileMap.maxLevel)
-                {
-                    ROCKY_TODO("");
-                    return Image::create(Image::R8G8B8A8_UNORM, 1, 1);
+    // We couldn't decode the tile, so if the key is outside the tile map,
+    // create a transparent image.
+    if (!tileMap.intersectsKey(key))
+    {
+        ROCKY_TODO("");
+        return Image::create(Image::R8G8B8A8_UNORM, 1, 1);
 
-                    //if (_isCoverage)
-                    //    return LandCover::createEmptyImage();
-                    //else
-                    //    return ImageUtils::createEmptyImage();
-                }
-            }
-        }
+        //if (_isCoverage)
+        //    return LandCover::createEmptyImage();
+        //else
+        //    return ImageUtils::createEmptyImage();
     }
 
-    if (image)
-        return image;
-    else
-        return Status(Status::ResourceUnavailable);
+    return Status(Status::ResourceUnavailable);
 }
 
 #endif // ROCKY_HAS_TMS
\ No newline at end of file
@@ -128,6 +128,21 @@ namespace ROCKY_NAMESPACE
                 bool isMapboxRGB,
                 const IOOptions& io) const;
 
+            //! Fetches the raw, still-encoded tile data without decoding it
+            //! into an image.
+            Result<Content> readContent(
+                const URI& uri,
+                const TileKey& key,
+                bool invertY,
+                bool isMapboxRGB,
+                const IOOptions& io) const;
+
+            //! Decodes tile data fetched with readContent() into an image.
+            Result<shared_ptr<Image>> decode(
+                const Content& content,
+                const TileKey& key,
+                const IOOptions& io) const;
+
             bool write(
                 const URI& uri,
                 const TileKey& key,
@@ -141,6 +156,8 @@ namespace ROCKY_NAMESPACE
         private:
             bool _forceRGBWrites;
 
+            URI tileURI(const URI& uri, const TileKey& key, bool invertY, bool isMapboxRGB) const;
+
             //bool resolveWriter(const std::string& format);
         };
     }
@@ -7,6 +7,7 @@
 #ifdef ROCKY_HAS_TMS
 
 #include "Instance.h"
+#include "TerrainRGB.h"
 #include "json.h"
 
 using namespace ROCKY_NAMESPACE;
@@ -38,6 +39,7 @@ TMSElevationLayer::construct(const JSON& conf)
     get_to(j, "uri", uri);
     get_to(j, "format", format);
     get_to(j, "invert_y", invertY);
+    get_to(j, "decode_png_directly", decodePNGDirectly);
 }
 
 JSON
@@ -47,6 +49,7 @@ TMSElevationLayer::to_json() const
     set(j, "uri", uri);
     set(j, "format", format);
     set(j, "invert_y", invertY);
+    set(j, "decode_png_directly", decodePNGDirectly);
     return j.dump();
 }
 
@@ -101,8 +104,44 @@ TMSElevationLayer::createHeightfieldImplementation(const TileKey& key, const IOO
     if (!isOpen())
         return status();
 
+    auto failed = [&](const Status& s)
+        {
+            if (s.code == Status::ServiceUnavailable)
+            {
+                setStatus(s);
+                Log()->warn(LC "Layer \"" + name() + "\" : " + s.message);
+            }
+            return s;
+        };
+
+    bool isMapboxRGB = _encoding.has_value(Encoding::MapboxRGB);
+
     // request
-    auto r = _driver.read(uri, key, invertY, _encoding == Encoding::MapboxRGB, io);
+    auto content = _driver.readContent(uri, key, invertY, isMapboxRGB, io);
+
+    if (content.status.failed())
+    {
+        return failed(content.status);
+    }
+
+    // RGB-encoded PNG tiles can skip the intermediate image entirely:
+    if (decodePNGDirectly == true &&
+        (isMapboxRGB || _encoding.has_value(Encoding::Terrarium)) &&
+        TerrainRGB::isPNG(content.value.data))
+    {
+        auto hf = TerrainRGB::decodePNG(
+            content.value.data,
+            isMapboxRGB ? TerrainRGB::Format::Mapbox : TerrainRGB::Format::Terrarium);
+
+        if (hf.status.ok())
+        {
+            return GeoHeightfield(hf.value, key.extent());
+        }
+        // otherwise fall back on the image reader below.
+    }
+
+    // decode the data we already have; never fetch it again.
+    auto r = _driver.decode(content.value, key, io);
 
     if (r.status.ok())
     {
@@ -112,19 +151,13 @@ TMSElevationLayer::createHeightfieldImplementation(const TileKey& key, const IOO
         }
         else // assume Image::R8G8B8_UNORM?
         {
-            auto hf = decodeMapboxRGB(r.value);
+            auto hf = decodeRGB(r.value);
             return GeoHeightfield(hf, key.extent());
         }
     }
     else
     {
-        if (r.status.code == Status::ServiceUnavailable)
-        {
-            setStatus(r.status);
-            Log()->warn(LC "Layer \"" + name() + "\" : " + r.status.message);
-        }
-
-        return r.status;
+        return failed(r.status);
     }
 }
 
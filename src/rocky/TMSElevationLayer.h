@@ -32,6 +32,10 @@ namespace ROCKY_NAMESPACE
 
         optional<Encoding> encoding;
 
+        //! Whether to decode MapboxRGB and Terrarium PNG tiles straight into
+        //! heightfields instead of going through an intermediate image
+        optional<bool> decodePNGDirectly = true;
+
     public: // Layer
 
         Status openImplementation(const IOOptions& io) override;
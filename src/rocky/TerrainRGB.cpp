@@ -0,0 +1,255 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "TerrainRGB.h"
+#include "Metrics.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace ROCKY_NAMESPACE;
+using namespace ROCKY_NAMESPACE::util;
+
+namespace
+{
+    // Fixed-stride loops so the compiler can unroll and vectorize them.
+    template<unsigned N>
+    void decodeMapbox(const unsigned char* p, unsigned width, float* out)
+    {
+        for (unsigned x = 0; x < width; ++x, p += N)
+        {
+            std::int32_t value = ((std::int32_t)p[0] << 16) | ((std::int32_t)p[1] << 8) | (std::int32_t)p[2];
+            float h = -10000.0f + (float)value * 0.1f;
+            out[x] = (h < -9999.0f || h > 999999.0f) ? NO_DATA_VALUE : h;
+        }
+    }
+
+    template<unsigned N>
+    void decodeTerrarium(const unsigned char* p, unsigned width, float* out)
+    {
+        for (unsigned x = 0; x < width; ++x, p += N)
+        {
+            out[x] = ((float)p[0] * 256.0f + (float)p[1] + (float)p[2] * (1.0f / 256.0f)) - 32768.0f;
+        }
+    }
+
+    inline std::uint32_t readBE32(const unsigned char* p)
+    {
+        return ((std::uint32_t)p[0] << 24) | ((std::uint32_t)p[1] << 16) | ((std::uint32_t)p[2] << 8) | (std::uint32_t)p[3];
+    }
+
+    inline unsigned char paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        return (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+    }
+
+    // Reverses the PNG filter on one scanline, in place, given the previous
+    // (already unfiltered) scanline. Returns false for an unknown filter type.
+    bool unfilter(unsigned char filter, unsigned char* row, const unsigned char* prev, unsigned length, unsigned bpp)
+    {
+        switch (filter)
+        {
+        case 0: // none
+            return true;
+        case 1: // sub
+            for (unsigned i = bpp; i < length; ++i)
+                row[i] += row[i - bpp];
+            return true;
+        case 2: // up
+            for (unsigned i = 0; i < length; ++i)
+                row[i] += prev[i];
+            return true;
+        case 3: // average
+            for (unsigned i = 0; i < bpp; ++i)
+                row[i] += prev[i] >> 1;
+            for (unsigned i = bpp; i < length; ++i)
+                row[i] += (unsigned char)(((unsigned)row[i - bpp] + (unsigned)prev[i]) >> 1);
+            return true;
+        case 4: // paeth
+            for (unsigned i = 0; i < bpp; ++i)
+                row[i] += prev[i];
+            for (unsigned i = bpp; i < length; ++i)
+                row[i] += paeth(row[i - bpp], prev[i], prev[i - bpp]);
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+void
+TerrainRGB::decodeRow(const unsigned char* pixels, unsigned numComponents, unsigned width, Format format, float* out)
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(numComponents == 3 || numComponents == 4, void());
+
+    if (format == Format::Mapbox)
+    {
+        if (numComponents == 3)
+            decodeMapbox<3>(pixels, width, out);
+        else
+            decodeMapbox<4>(pixels, width, out);
+    }
+    else
+    {
+        if (numComponents == 3)
+            decodeTerrarium<3>(pixels, width, out);
+        else
+            decodeTerrarium<4>(pixels, width, out);
+    }
+}
+
+shared_ptr<Heightfield>
+TerrainRGB::decode(const Image* image, Format format)
+{
+    ROCKY_PROFILING_ZONE;
+
+    if (!image || !image->valid() ||
+        (image->pixelFormat() != Image::R8G8B8_UNORM && image->pixelFormat() != Image::R8G8B8A8_UNORM))
+    {
+        return nullptr;
+    }
+
+    auto hf = Heightfield::create(image->width(), image->height());
+    auto pixels = image->data<unsigned char>();
+    auto heights = hf->data<float>();
+
+    for (unsigned t = 0; t < image->height(); ++t)
+    {
+        decodeRow(
+            pixels + t * image->rowSizeInBytes(),
+            image->numComponents(),
+            image->width(),
+            format,
+            heights + t * hf->width());
+    }
+
+    return hf;
+}
+
+bool
+TerrainRGB::isPNG(const std::string& data)
+{
+    return data.size() >= 8 && memcmp(data.data(), "\x89PNG\r\n\x1a\n", 8) == 0;
+}
+
+Result<shared_ptr<Heightfield>>
+TerrainRGB::decodePNG(const std::string& data, Format format)
+{
+#ifdef ROCKY_HAS_ZLIB
+    ROCKY_PROFILING_ZONE;
+
+    if (!isPNG(data))
+        return Status(Status::ResourceUnavailable, "Not a PNG file");
+
+    // walk the chunks, collecting the header, palette and image data.
+    // (CRCs go unchecked since the zlib stream carries its own checksum.)
+    auto bytes = reinterpret_cast<const unsigned char*>(data.data());
+    unsigned width = 0, height = 0;
+    unsigned char bitDepth = 0, colorType = 0, interlace = 0;
+    std::vector<unsigned char> palette;
+    std::string compressed;
+
+    for (std::size_t pos = 8; pos + 12 <= data.size(); )
+    {
+        std::uint32_t length = readBE32(bytes + pos);
+        if (pos + 12 + (std::size_t)length > data.size())
+            return Status(Status::GeneralError, "Truncated PNG chunk");
+
+        const char* type = data.data() + pos + 4;
+        auto chunk = bytes + pos + 8;
+
+        if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+        {
+            width = readBE32(chunk);
+            height = readBE32(chunk + 4);
+            bitDepth = chunk[8];
+            colorType = chunk[9];
+            interlace = chunk[12];
+        }
+        else if (memcmp(type, "PLTE", 4) == 0)
+        {
+            palette.assign(chunk, chunk + length);
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+        {
+            compressed.append((const char*)chunk, length);
+        }
+        else if (memcmp(type, "IEND", 4) == 0)
+        {
+            break;
+        }
+
+        pos += 12 + (std::size_t)length;
+    }
+
+    if (width == 0 || height == 0 || width > 16384 || height > 16384)
+        return Status(Status::GeneralError, "Invalid PNG dimensions");
+
+    unsigned bpp =
+        colorType == 2 ? 3u :  // RGB
+        colorType == 6 ? 4u :  // RGBA
+        colorType == 3 ? 1u :  // palette
+        0u;
+
+    if (bitDepth != 8 || bpp == 0 || interlace != 0 || (colorType == 3 && palette.size() < 3))
+        return Status(Status::ResourceUnavailable, "Unsupported PNG layout");
+
+    std::string raw;
+    std::istringstream in(compressed);
+    if (!ZLibCompressor().decompress(in, raw))
+        return Status(Status::GeneralError, "Corrupt PNG image data");
+
+    unsigned stride = width * bpp;
+    if (raw.size() < (std::size_t)(stride + 1) * height)
+        return Status(Status::GeneralError, "Truncated PNG image data");
+
+    auto hf = Heightfield::create(width, height);
+
+    std::vector<unsigned char> prev(stride, 0), rgb;
+    if (colorType == 3)
+        rgb.resize(width * 3);
+
+    for (unsigned y = 0; y < height; ++y)
+    {
+        auto row = reinterpret_cast<unsigned char*>(&raw[(std::size_t)y * (stride + 1)]);
+        auto scanline = row + 1;
+
+        if (!unfilter(row[0], scanline, prev.data(), stride, bpp))
+            return Status(Status::GeneralError, "Invalid PNG filter");
+
+        const unsigned char* pixels = scanline;
+        unsigned components = bpp;
+
+        if (colorType == 3)
+        {
+            unsigned entries = (unsigned)palette.size() / 3;
+            for (unsigned x = 0; x < width; ++x)
+            {
+                unsigned i = std::min((unsigned)scanline[x], entries - 1) * 3;
+                rgb[x * 3 + 0] = palette[i + 0];
+                rgb[x * 3 + 1] = palette[i + 1];
+                rgb[x * 3 + 2] = palette[i + 2];
+            }
+            pixels = rgb.data();
+            components = 3;
+        }
+
+        // PNG rows run top-down; heightfield rows run bottom-up
+        decodeRow(pixels, components, width, format, hf->data<float>() + (height - 1 - y) * width);
+
+        memcpy(prev.data(), scanline, stride);
+    }
+
+    return hf;
+#else
+    return Status(Status::ServiceUnavailable, "PNG decoding requires zlib");
+#endif
+}
@@ -0,0 +1,65 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/Heightfield.h>
+#include <rocky/Status.h>
+
+namespace ROCKY_NAMESPACE
+{
+    namespace util
+    {
+        /**
+        * Decoders for elevation data packed into the color channels of 8-bit
+        * RGB imagery:
+        *
+        *   Mapbox Terrain-RGB: height = -10000 + (R * 65536 + G * 256 + B) * 0.1
+        *   Terrarium:          height = (R * 256 + G + B / 256) - 32768
+        *
+        * Decoding works on the raw 8-bit pixel buffers and writes straight into
+        * the heightfield. PNG tiles can also skip the intermediate image entirely.
+        */
+        class ROCKY_EXPORT TerrainRGB
+        {
+        public:
+            enum class Format {
+                Mapbox,
+                Terrarium
+            };
+
+            //! Decodes one row of pixels into heights.
+            //! @param pixels 8-bit pixel data
+            //! @param numComponents Bytes per pixel (3 for RGB, 4 for RGBA)
+            //! @param width Number of pixels in the row
+            //! @param format Encoding of the pixels
+            //! @param out Receives "width" heights
+            static void decodeRow(
+                const unsigned char* pixels,
+                unsigned numComponents,
+                unsigned width,
+                Format format,
+                float* out);
+
+            //! Decodes an R8G8B8_UNORM or R8G8B8A8_UNORM image into a heightfield.
+            //! Returns nullptr for any other pixel format.
+            static shared_ptr<Heightfield> decode(
+                const Image* image,
+                Format format);
+
+            //! Decodes an 8-bit, non-interlaced RGB, RGBA or palette PNG file
+            //! directly into a heightfield, one scanline at a time.
+            //! Requires zlib support (ROCKY_HAS_ZLIB).
+            //! @param data Bytes of the PNG file
+            //! @param format Encoding of the pixels
+            static Result<shared_ptr<Heightfield>> decodePNG(
+                const std::string& data,
+                Format format);
+
+            //! Whether the data starts with the PNG file signature
+            static bool isPNG(const std::string& data);
+        };
+    }
+}
@@ -10,6 +10,7 @@
 #include <rocky/Math.h>
 #include <rocky/GeoImage.h>
 #include <rocky/GeoHeightfield.h>
+#include <rocky/HeightfieldPyramid.h>
 #include <vector>
 
 namespace ROCKY_NAMESPACE
@@ -53,12 +54,15 @@ namespace ROCKY_NAMESPACE
 
         bool includesElevation() const;
 
+        bool includesColor() const;
+
         bool includesConstraints() const;
 
     private:
         using LayerTable = std::unordered_map<UID, Revision>;
         LayerTable _layers;
         bool _includesElevation;
+        bool _includesColor;
         bool _includesConstraints;
         optional<bool> _progressive;
     };
@@ -89,6 +93,9 @@ namespace ROCKY_NAMESPACE
             float maxHeight = -FLT_MAX;
             GeoHeightfield heightfield;
             //shared_ptr<Heightfield> heightfield;
+
+            //! Min/max pyramid over the heightfield, for bounding tiles
+            shared_ptr<HeightfieldPyramid> pyramid;
         };
 
         struct ROCKY_EXPORT NormalMap : public Tile
@@ -113,6 +120,11 @@ namespace ROCKY_NAMESPACE
         //! Imagery and other surface coloring layers
         ColorLayer::Vector colorLayers;
 
+        //! Per-layer imagery behind a composited color layer, kept when a
+        //! layer is dynamic so that an update can recomposite the layers
+        //! that did not change without fetching them again
+        ColorLayer::Vector colorLayerSources;
+
         //! Elevation data
         Elevation elevation;
 
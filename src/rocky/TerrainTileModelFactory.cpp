@@ -8,6 +8,7 @@
 #include "Metrics.h"
 #include "ElevationLayer.h"
 #include "ImageLayer.h"
+#include "ImageCompressor.h"
 
 #define LC "[TerrainTileModelFactory] "
 
@@ -15,21 +16,26 @@ using namespace ROCKY_NAMESPACE;
 
 namespace
 {
+    // The layer may share its heightfield with its cache, so this
+    // only copies it when there are values to replace.
     void replace_nodata_values(GeoHeightfield& geohf)
     {
         auto grid = geohf.heightfield();
         if (grid)
         {
-            for (unsigned col = 0; col < grid->height(); ++col)
-            {
-                for (unsigned row = 0; row < grid->width(); ++row)
+            bool hasNoData = false;
+            const Heightfield* constGrid = grid.get();
+            constGrid->forEachHeight([&](float h) { hasNoData = hasNoData || h == NO_DATA_VALUE; });
+            if (!hasNoData)
+                return;
+
+            grid = grid->decode();
+            grid->forEachHeight([](float& h)
                 {
-                    if (grid->heightAt(col, row) == NO_DATA_VALUE)
-                    {
-                        grid->heightAt(col, row) = 0.0f;
-                    }
-                }
-            }
+                    if (h == NO_DATA_VALUE)
+                        h = 0.0f;
+                });
+            geohf = GeoHeightfield(grid, geohf.extent());
         }
     }
 }
@@ -37,6 +43,7 @@ namespace
 CreateTileManifest::CreateTileManifest()
 {
     _includesElevation = false;
+    _includesColor = false;
     _includesConstraints = false;
     _progressive.set_default(false);
 }
@@ -53,6 +60,11 @@ CreateTileManifest::insert(shared_ptr<Layer> layer)
             _includesElevation = true;
         }
 
+        else if (ImageLayer::cast(layer))
+        {
+            _includesColor = true;
+        }
+
         //else if (std::dynamic_pointer_cast<TerrainConstraintLayer>(layer))
         //{
         //    _includesConstraints = true;
@@ -69,10 +81,9 @@ CreateTileManifest::empty() const
 bool
 CreateTileManifest::inSyncWith(const Map* map) const
 {
-#if 0
     for(auto& iter : _layers)
     {
-        auto layer = map->getLayerByUID(iter.first);
+        auto layer = map->layers().withUID(iter.first);
 
         // note: if the layer is null, it was removed, so let it pass.
         if (layer && layer->revision() != iter.second)
@@ -80,23 +91,20 @@ CreateTileManifest::inSyncWith(const Map* map) const
             return false;
         }
     }
-#endif
     return true;
 }
 
 void
 CreateTileManifest::updateRevisions(const Map* map)
 {
-#if 0
     for (auto& iter : _layers)
     {
-        auto layer = map->getLayerByUID(iter.first);
+        auto layer = map->layers().withUID(iter.first);
         if (layer)
         {
             iter.second = layer->revision();
         }
     }
-#endif
 }
 
 bool
@@ -117,6 +125,12 @@ CreateTileManifest::includesElevation() const
     return empty() || _includesElevation;
 }
 
+bool
+CreateTileManifest::includesColor() const
+{
+    return empty() || _includesColor;
+}
+
 bool
 CreateTileManifest::includesConstraints() const
 {
@@ -153,6 +167,13 @@ TerrainTileModelFactory::createTileModel(
     // assemble all the components:
     addColorLayers(model, map, key, manifest, io, false);
 
+    if (mipmapColorLayers)
+    {
+        generateMipmaps(model);
+    }
+
+    compressColorLayers(model);
+
     unsigned border = 0u;
     addElevation(model, map, key, manifest, border, io);
 
@@ -212,17 +233,39 @@ TerrainTileModelFactory::addColorLayers(
 {
     ROCKY_PROFILING_ZONE;
 
+    if (!manifest.includesColor())
+        return;
+
     int order = 0;
 
-    // fetch the candidate layers:
-    auto layers = map->layers().get([&manifest](const shared_ptr<Layer>& layer)
+    // fetch the candidate layers. Layers outside the manifest stay in,
+    // since compositing needs them all; they come from reuseColorLayers
+    // when possible.
+    auto layers = map->layers().get([](const shared_ptr<Layer>& layer)
         {
             return
                 layer->isOpen() &&
-                layer->renderType() == layer->RENDERTYPE_TERRAIN_SURFACE &&
-                manifest.includes(layer.get());
+                layer->renderType() == layer->RENDERTYPE_TERRAIN_SURFACE;
         });
 
+    auto add = [&](std::shared_ptr<ImageLayer> layer, bool fallback)
+        {
+            if (!manifest.includes(layer.get()))
+            {
+                for (auto& reuse : reuseColorLayers)
+                {
+                    if (reuse.layer == layer && reuse.image.valid())
+                    {
+                        model.colorLayers.push_back(reuse);
+                        if (layer->dynamic())
+                            model.requiresUpdate = true;
+                        return;
+                    }
+                }
+            }
+            addImageLayer(key, layer, fallback, model, io);
+        };
+
     // first collect the image layers that have intersecting data.
     std::vector<std::shared_ptr<ImageLayer>> intersecting_layers;
     for (auto layer : layers)
@@ -242,7 +285,7 @@ TerrainTileModelFactory::addColorLayers(
     {
         // if only one layer intersects we will not need to composite
         // so just get the raw data for this key if there is any.
-        addImageLayer(key, intersecting_layers.front(), false, model, io);
+        add(intersecting_layers.front(), false);
     }
 
     else if (intersecting_layers.size() > 1)
@@ -264,12 +307,15 @@ TerrainTileModelFactory::addColorLayers(
         {
             for (auto layer : intersecting_layers)
             {
-                addImageLayer(key, layer, true, model, io);
+                add(layer, true);
             }
 
             // now composite them.
             if (compositeColorLayers && model.colorLayers.size() > 1)
             {
+                if (model.requiresUpdate)
+                    model.colorLayerSources = model.colorLayers;
+
                 auto& base_image = model.colorLayers.front().image;
                 TerrainTileModel::Tile tile = model.colorLayers.front();
 
@@ -283,7 +329,20 @@ TerrainTileModelFactory::addColorLayers(
                 GeoImage image(comp_image, key.extent());
                 std::vector<GeoImage> sources;
                 for (auto& i : model.colorLayers)
+                {
+                    // compositing needs pixel access, so expand any block-compressed sources
+                    if (i.image.valid() && i.image.image()->compressed())
+                    {
+                        auto expanded = util::ImageCompressor().decompress(i.image.image());
+                        if (expanded.status.failed())
+                        {
+                            Log()->warn("Dropping \"" + (i.layer ? i.layer->name() : std::string()) + "\" from the composite: " + expanded.status.message);
+                            continue;
+                        }
+                        i.image = GeoImage(expanded.value, i.image.extent());
+                    }
                     sources.push_back(std::move(i.image));
+                }
 
                 image.composite(sources);
 
@@ -301,6 +360,80 @@ TerrainTileModelFactory::addColorLayers(
 }
 
 
+void
+TerrainTileModelFactory::generateMipmaps(
+    TerrainTileModel& model)
+{
+    ROCKY_PROFILING_ZONE;
+
+    for (auto& colorLayer : model.colorLayers)
+    {
+        auto image = colorLayer.image.image();
+        if (!image || image->compressed() || image->mipmapLevels() > 1)
+            continue;
+
+        // copy first, since the layer may be sharing the image with a cache
+        auto mipmapped = image->clone();
+        if (mipmapped->generateMipmaps(mipmapFilter, true))
+        {
+            colorLayer.image = GeoImage(mipmapped, colorLayer.image.extent());
+        }
+    }
+}
+
+void
+TerrainTileModelFactory::compressColorLayers(
+    TerrainTileModel& model)
+{
+    ROCKY_PROFILING_ZONE;
+
+    util::ImageCompressor compressor;
+    compressor.pool = compressionPool;
+
+    // Without GPU support, nothing stays compressed, including imagery
+    // that arrives that way from its source.
+    if (!blockCompressionSupported)
+    {
+        for (auto& colorLayer : model.colorLayers)
+        {
+            if (colorLayer.image.valid() && colorLayer.image.image()->compressed())
+            {
+                auto result = compressor.decompress(colorLayer.image.image());
+                if (result.status.ok())
+                    colorLayer.image = GeoImage(result.value, colorLayer.image.extent());
+                else
+                    Log()->warn("Texture decompression failed: " + result.status.message);
+            }
+        }
+        return;
+    }
+
+    for (auto& colorLayer : model.colorLayers)
+    {
+        if (!colorLayer.image.valid() || colorLayer.image.image()->compressed())
+            continue;
+
+        // a lone layer may request its own compression method
+        std::string method = textureCompression;
+        auto imageLayer = ImageLayer::cast(colorLayer.layer);
+        if (imageLayer && model.colorLayers.size() == 1 && !imageLayer->getCompressionMethod().empty())
+            method = imageLayer->getCompressionMethod();
+
+        auto format = util::ImageCompressor::format(method, colorLayer.image.image().get());
+        if (format == Image::UNDEFINED)
+            continue;
+
+        auto result = compressor.compress(colorLayer.image.image(), format);
+        if (result.status.ok())
+        {
+            colorLayer.image = GeoImage(result.value, colorLayer.image.extent());
+        }
+        else
+        {
+            Log()->warn("Texture compression failed: " + result.status.message);
+        }
+    }
+}
 
 TerrainTileModel::Elevation
 TerrainTileModelFactory::createElevationModel(
@@ -325,7 +458,12 @@ TerrainTileModelFactory::createElevationModel(
         {
             replace_nodata_values(result.value);
 
+            if (elevationEncoding != Image::R32_SFLOAT)
+                result.value = result.value.encode(elevationEncoding);
+
             model.heightfield = std::move(result.value);
+            model.pyramid = std::make_shared<HeightfieldPyramid>(
+                model.heightfield.heightfield().get());
             model.revision = layer->revision();
             model.key = key;
         }
@@ -356,26 +494,8 @@ TerrainTileModelFactory::addElevation(
     ROCKY_PROFILING_ZONE;
     ROCKY_PROFILING_ZONE_TEXT("Elevation");
 
-    bool needElevation = manifest.includesElevation();
-
-    auto layers = map->layers().all();
-
-    if (layers.empty())
-        return false;
-
-    int combinedRevision = map->revision();
-    if (!manifest.empty())
-    {
-        for (const auto& layer : layers)
-        {
-            if (needElevation == false && manifest.includes(layer.get()))
-            {
-                needElevation = true;
-            }
-            combinedRevision += layer->revision();
-        }
-    }
-    if (!needElevation)
+    // a manifest of color layers alone leaves the elevation as it was
+    if (!manifest.includesElevation())
         return false;
 
     auto layer = map->layers().firstOfType<ElevationLayer>();
@@ -391,7 +511,12 @@ TerrainTileModelFactory::addElevation(
         {
             replace_nodata_values(result.value);
 
+            if (elevationEncoding != Image::R32_SFLOAT)
+                result.value = result.value.encode(elevationEncoding);
+
             model.elevation.heightfield = std::move(result.value);
+            model.elevation.pyramid = std::make_shared<HeightfieldPyramid>(
+                model.elevation.heightfield.heightfield().get());
             model.elevation.revision = layer->revision();
             model.elevation.key = key;
         }
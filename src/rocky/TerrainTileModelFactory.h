@@ -6,6 +6,7 @@
 #pragma once
 
 #include <rocky/TerrainTileModel.h>
+#include <rocky/Threading.h>
 #include <unordered_map>
 
 namespace ROCKY_NAMESPACE
@@ -25,6 +26,32 @@ namespace ROCKY_NAMESPACE
         //! Whether to composite all color layers into one
         bool compositeColorLayers = true;
 
+        //! Whether to generate mipmaps for color layers (before any compression)
+        bool mipmapColorLayers = false;
+
+        //! Filter to use when generating color layer mipmaps
+        Image::MipmapFilter mipmapFilter = Image::BOX;
+
+        //! GPU block compression to apply to color layers after compositing
+        //! ("none", "bc1", "bc3", "bc7", or "auto"). An image layer's own
+        //! texture_compression option takes precedence when it's the only layer.
+        std::string textureCompression;
+
+        //! Whether the GPU can sample block-compressed textures. If not,
+        //! textures stay uncompressed whatever the compression method.
+        bool blockCompressionSupported = true;
+
+        //! Job pool in which to run texture compression (optional)
+        jobs::jobpool* compressionPool = nullptr;
+
+        //! Encoding of the elevation heightfield (R32_SFLOAT, or the compact
+        //! R16_UNORM or R16_SFLOAT encodings; see Heightfield::encode)
+        Image::PixelFormat elevationEncoding = Image::R32_SFLOAT;
+
+        //! Per-layer imagery to composite in place of fetching it again, for
+        //! layers the manifest leaves out (see TerrainTileModel::colorLayerSources)
+        TerrainTileModel::ColorLayer::Vector reuseColorLayers;
+
     public:
         TerrainTileModelFactory();
 
@@ -54,6 +81,12 @@ namespace ROCKY_NAMESPACE
             const IOOptions& io,
             bool standalone);
 
+        void generateMipmaps(
+            TerrainTileModel& model);
+
+        void compressColorLayers(
+            TerrainTileModel& model);
+
         bool addElevation(
             TerrainTileModel& model,
             const Map* map,
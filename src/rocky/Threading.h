@@ -6,6 +6,8 @@
 #pragma once
 #include <rocky/Common.h>
 #include <unordered_set>
+#include <atomic>
+#include <algorithm>
 
 #define WEEJOBS_NAMESPACE jobs
 #define WEEJOBS_EXPORT ROCKY_EXPORT
@@ -115,6 +117,44 @@ namespace ROCKY_NAMESPACE
             T _key;
             bool _active;
         };
+
+        //! Calls func(first, last) over consecutive ranges of [0, count), each at most
+        //! "grain" long, spreading the ranges across a job pool. The calling thread
+        //! works too, and returns once all ranges are done. With a null pool
+        //! everything runs on the calling thread. Don't pass a pool that the calling
+        //! thread belongs to, since the caller blocks on the pool's work.
+        template<typename FUNC>
+        void parallel_for(jobs::jobpool* pool, std::size_t count, std::size_t grain, const std::string& name, const FUNC& func)
+        {
+            grain = std::max(grain, (std::size_t)1);
+            std::size_t numTasks = (count + grain - 1) / grain;
+
+            if (pool == nullptr || numTasks <= 1)
+            {
+                if (count > 0)
+                    func((std::size_t)0, count);
+                return;
+            }
+
+            std::atomic<std::size_t> next = { 0u };
+            auto work = [&]()
+            {
+                for (std::size_t task = next++; task < numTasks; task = next++)
+                    func(task * grain, std::min((task + 1) * grain, count));
+            };
+
+            auto group = jobs::jobgroup::create();
+            std::size_t helpers = std::min(numTasks - 1, (std::size_t)std::max(pool->concurrency(), 1u));
+            for (std::size_t i = 0; i < helpers; ++i)
+            {
+                jobs::dispatch(
+                    std::function<void()>(work),
+                    jobs::context{ name, pool, {}, group });
+            }
+
+            work();
+            group->join();
+        }
     }
 
 } // namepsace rocky::util
@@ -0,0 +1,357 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "TileCoverage.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+using namespace ROCKY_NAMESPACE;
+
+namespace
+{
+    // largest per-tile table to allocate (one byte per tile)
+    constexpr std::size_t max_table_size = 1u << 18;
+
+    // deep-only extents covering more tiles than this at the deepest table
+    // are tested on every deep query instead of being bucketed
+    constexpr std::size_t max_bucket_span = 4096;
+
+    // tolerance, in tiles, so that extents aligned to tile edges
+    // do not spill into the neighboring tiles
+    constexpr double edge_epsilon = 1e-6;
+
+    // table values: 0 = no data, 1 = only extents whose minLevel is deeper,
+    // 2 + maxLevel, or 255 = no maxLevel
+    constexpr unsigned char overlap_only = 1;
+    constexpr unsigned char unlimited = 255;
+
+    inline unsigned char encode(const DataExtent& de)
+    {
+        if (!de.maxLevel().has_value())
+            return unlimited;
+        return (unsigned char)(std::min(de.maxLevel().value(), 252u) + 2u);
+    }
+
+    inline TileCoverage::Coverage decode(unsigned char code)
+    {
+        TileCoverage::Coverage result;
+        result.overlaps = code > 0;
+        result.intersects = code > overlap_only;
+        result.maxLevel = code == unlimited ? UINT_MAX : code > overlap_only ? (unsigned)code - 2u : 0u;
+        return result;
+    }
+
+    //! Inclusive range of tile columns and rows (rows count from the top)
+    struct Range
+    {
+        int c0 = 0, c1 = -1, r0 = 0, r1 = -1;
+
+        bool empty() const {
+            return c1 < c0 || r1 < r0;
+        }
+        std::size_t size() const {
+            return empty() ? 0 : (std::size_t)(c1 - c0 + 1) * (std::size_t)(r1 - r0 + 1);
+        }
+        bool contains(int c, int r) const {
+            return c >= c0 && c <= c1 && r >= r0 && r <= r1;
+        }
+    };
+
+    //! Tiles at a level that a box overlaps or, if "whole", that lie entirely inside it.
+    Range tileRange(const Profile& profile, const Box& b, unsigned lod, bool whole)
+    {
+        auto [width, height] = profile.tileDimensions(lod);
+        auto [nx, ny] = profile.numTiles(lod);
+        auto& ex = profile.extent();
+
+        auto clamp_cols = [nx = nx](double v) { return std::max(-1.0, std::min(v, (double)nx + 1.0)); };
+        auto clamp_rows = [ny = ny](double v) { return std::max(-1.0, std::min(v, (double)ny + 1.0)); };
+
+        double u0 = clamp_cols((b.xmin - ex.xMin()) / width);
+        double u1 = clamp_cols((b.xmax - ex.xMin()) / width);
+        double v0 = clamp_rows((ex.yMax() - b.ymax) / height);
+        double v1 = clamp_rows((ex.yMax() - b.ymin) / height);
+
+        Range r;
+        if (whole)
+        {
+            r.c0 = (int)std::ceil(u0 - edge_epsilon), r.c1 = (int)std::floor(u1 + edge_epsilon) - 1;
+            r.r0 = (int)std::ceil(v0 - edge_epsilon), r.r1 = (int)std::floor(v1 + edge_epsilon) - 1;
+        }
+        else
+        {
+            r.c0 = (int)std::floor(u0 + edge_epsilon), r.c1 = (int)std::ceil(u1 - edge_epsilon) - 1;
+            r.r0 = (int)std::floor(v0 + edge_epsilon), r.r1 = (int)std::ceil(v1 - edge_epsilon) - 1;
+
+            // degenerate (zero-width or zero-height) boxes still touch one tile
+            if (r.c1 < r.c0 && u1 >= u0) r.c1 = r.c0;
+            if (r.r1 < r.r0 && v1 >= v0) r.r1 = r.r0;
+        }
+
+        r.c0 = std::max(r.c0, 0), r.c1 = std::min(r.c1, (int)nx - 1);
+        r.r0 = std::max(r.r0, 0), r.r1 = std::min(r.r1, (int)ny - 1);
+        return r;
+    }
+}
+
+TileCoverage::TileCoverage(const Profile& profile, const DataExtentList& extents) :
+    _profile(profile)
+{
+    ROCKY_PROFILE_FUNCTION();
+
+    if (!profile.valid())
+        return;
+
+    // one table per level, down to the size limit
+    unsigned levels = 0;
+    for (; levels < 24; ++levels)
+    {
+        auto [nx, ny] = profile.numTiles(levels);
+        if ((std::size_t)nx * (std::size_t)ny > max_table_size)
+            break;
+    }
+    if (levels == 0)
+        return;
+
+    const unsigned deepest = levels - 1;
+
+    // Extents that cover a tile entirely are recorded once, at the shallowest
+    // level where they do so, in "whole"; the final pass below pushes those
+    // down to the tiles underneath. This keeps the cost of inserting a large
+    // extent proportional to its perimeter rather than its area.
+    std::vector<std::vector<unsigned char>> whole(levels);
+    _tables.resize(levels);
+    for (unsigned lod = 0; lod < levels; ++lod)
+    {
+        auto [nx, ny] = profile.numTiles(lod);
+        _tables[lod].assign((std::size_t)nx * (std::size_t)ny, 0);
+        whole[lod].assign((std::size_t)nx * (std::size_t)ny, 0);
+    }
+
+    // (deepest-level tile, entry) pairs, grouped into _buckets at the end
+    std::vector<std::pair<unsigned, unsigned>> bucketed;
+
+    auto insert = [&](const GeoExtent& part, const DataExtent& de)
+    {
+        Box bounds(part.xMin(), part.yMin(), part.xMax(), part.yMax());
+        unsigned minLevel = de.minLevel().value_or(0u);
+        unsigned char code = encode(de);
+
+        // below the tables, partly covered tiles need exact tests:
+        auto add_entry = [&]()
+        {
+            _entries.push_back(Entry{ bounds, minLevel, code });
+            return (unsigned)_entries.size() - 1;
+        };
+
+        // Records "value" in the tiles the extent touches at levels [first, last].
+        // Only the real coverage at the deepest level needs exact tests below it.
+        auto cover = [&](unsigned first, unsigned last, unsigned char value)
+        {
+            Range previous; // whole tiles at the previous level
+            int entry = -1;
+
+            for (unsigned lod = first; lod <= last; ++lod)
+            {
+                auto nx = profile.numTiles(lod).first;
+                auto touched = tileRange(profile, bounds, lod, false);
+                auto inside = tileRange(profile, bounds, lod, true);
+
+                // tiles under a whole tile of the previous level get it in the final pass
+                Range inherited;
+                if (!previous.empty())
+                    inherited = Range{ 2 * previous.c0, 2 * previous.c1 + 1, 2 * previous.r0, 2 * previous.r1 + 1 };
+
+                for (int r = touched.r0; r <= touched.r1; ++r)
+                {
+                    for (int c = touched.c0; c <= touched.c1; ++c)
+                    {
+                        if (inherited.contains(c, r))
+                        {
+                            c = inherited.c1;
+                            continue;
+                        }
+
+                        std::size_t i = (std::size_t)r * nx + (std::size_t)c;
+                        if (inside.contains(c, r))
+                        {
+                            whole[lod][i] = std::max(whole[lod][i], value);
+                        }
+                        else
+                        {
+                            _tables[lod][i] = std::max(_tables[lod][i], value);
+
+                            if (lod == deepest && value == code)
+                            {
+                                if (entry < 0)
+                                    entry = (int)add_entry();
+                                bucketed.emplace_back((unsigned)i, (unsigned)entry);
+                            }
+                        }
+                    }
+                }
+
+                previous = inside;
+            }
+        };
+
+        // levels above the extent's minLevel only learn that it overlaps them
+        if (minLevel > 0)
+            cover(0, std::min(minLevel - 1, deepest), overlap_only);
+
+        if (minLevel > deepest)
+        {
+            auto touched = tileRange(profile, bounds, deepest, false);
+            if (touched.empty())
+                return;
+
+            unsigned e = add_entry();
+            if (touched.size() > max_bucket_span)
+            {
+                _wide.push_back(e);
+                return;
+            }
+
+            auto nx = profile.numTiles(deepest).first;
+            for (int r = touched.r0; r <= touched.r1; ++r)
+                for (int c = touched.c0; c <= touched.c1; ++c)
+                    bucketed.emplace_back((unsigned)r * nx + (unsigned)c, e);
+            return;
+        }
+
+        cover(minLevel, deepest, code);
+    };
+
+    // work in the profile's SRS, splitting anything that crosses the antimeridian
+    auto extentsInProfile = profile.clampAndTransformExtents(
+        std::vector<GeoExtent>(extents.begin(), extents.end()));
+
+    for (std::size_t i = 0; i < extents.size(); ++i)
+    {
+        const GeoExtent& ex = extentsInProfile[i];
+        if (!ex.valid())
+            continue;
+
+        if (ex.srs().isGeodetic() && ex.crossesAntimeridian())
+        {
+            GeoExtent west, east;
+            ex.splitAcrossAntimeridian(west, east);
+            if (west.valid())
+                insert(west, extents[i]);
+            if (east.valid())
+                insert(east, extents[i]);
+        }
+        else
+        {
+            insert(ex, extents[i]);
+        }
+    }
+
+    // push whole-tile coverage down to the tiles underneath, then fold it into the tables
+    for (unsigned lod = 1; lod < levels; ++lod)
+    {
+        auto [nx, ny] = profile.numTiles(lod);
+        auto parent_nx = profile.numTiles(lod - 1).first;
+        auto& parents = whole[lod - 1];
+        auto& children = whole[lod];
+
+        for (unsigned r = 0; r < ny; ++r)
+        {
+            for (unsigned c = 0; c < nx; ++c)
+            {
+                auto& child = children[(std::size_t)r * nx + c];
+                child = std::max(child, parents[(std::size_t)(r >> 1) * parent_nx + (c >> 1)]);
+            }
+        }
+    }
+
+    for (unsigned lod = 0; lod < levels; ++lod)
+    {
+        auto& table = _tables[lod];
+        for (std::size_t i = 0; i < table.size(); ++i)
+            table[i] = std::max(table[i], whole[lod][i]);
+    }
+
+    _whole = std::move(whole[deepest]);
+
+    // counting sort of the bucketed entries by tile
+    _bucketStart.assign(_whole.size() + 1, 0);
+    for (auto& b : bucketed)
+        ++_bucketStart[b.first + 1];
+    for (std::size_t i = 1; i < _bucketStart.size(); ++i)
+        _bucketStart[i] += _bucketStart[i - 1];
+
+    _buckets.resize(bucketed.size());
+    std::vector<unsigned> next(_bucketStart.begin(), _bucketStart.end() - 1);
+    for (auto& b : bucketed)
+        _buckets[next[b.first]++] = b.second;
+}
+
+TileCoverage::Coverage
+TileCoverage::coverage(const TileKey& key) const
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(key.valid() && key.profile() == _profile, Coverage());
+
+    unsigned lod = key.levelOfDetail();
+    if (lod < _tables.size())
+    {
+        auto nx = _profile.numTiles(lod).first;
+        return decode(_tables[lod][(std::size_t)key.tileY() * nx + key.tileX()]);
+    }
+
+    return coverage(key.bounds(), lod);
+}
+
+TileCoverage::Coverage
+TileCoverage::coverage(const Box& bounds, unsigned lod) const
+{
+    if (_tables.empty() || !bounds.valid())
+        return { };
+
+    unsigned char code = 0;
+
+    if (lod < _tables.size())
+    {
+        auto touched = tileRange(_profile, bounds, lod, false);
+        auto nx = _profile.numTiles(lod).first;
+        auto& table = _tables[lod];
+
+        for (int r = touched.r0; r <= touched.r1; ++r)
+            for (int c = touched.c0; c <= touched.c1; ++c)
+                code = std::max(code, table[(std::size_t)r * nx + (std::size_t)c]);
+    }
+    else
+    {
+        unsigned deepest = (unsigned)_tables.size() - 1;
+        auto touched = tileRange(_profile, bounds, deepest, false);
+        auto nx = _profile.numTiles(deepest).first;
+
+        auto test = [&](unsigned e)
+        {
+            auto& entry = _entries[e];
+            auto value = entry.minLevel <= lod ? entry.code : overlap_only;
+            if (value > code && entry.bounds.intersects(bounds))
+                code = value;
+        };
+
+        for (int r = touched.r0; r <= touched.r1; ++r)
+        {
+            for (int c = touched.c0; c <= touched.c1; ++c)
+            {
+                std::size_t i = (std::size_t)r * nx + (std::size_t)c;
+                code = std::max(code, _whole[i]);
+
+                for (unsigned b = _bucketStart[i]; b < _bucketStart[i + 1]; ++b)
+                    test(_buckets[b]);
+            }
+        }
+
+        for (auto e : _wide)
+            test(e);
+    }
+
+    return decode(code);
+}
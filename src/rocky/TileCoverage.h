@@ -0,0 +1,87 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/Profile.h>
+#include <rocky/TileKey.h>
+#include <vector>
+
+namespace ROCKY_NAMESPACE
+{
+    /**
+     * Where a tiled data source has data, laid out over the tiles of its profile.
+     *
+     * Each level of detail, down to a size limit, gets a table with one byte
+     * per tile recording the deepest data level among the data extents that
+     * overlap that tile. A lookup at those levels is a single table read. Keys
+     * below the deepest table fall back on exact tests against the extents
+     * that only partly cover their ancestor tile in that table. Tiles above
+     * an extent's minLevel record only that the extent overlaps them.
+     *
+     * The index is immutable once built and can be shared between threads.
+     */
+    class ROCKY_EXPORT TileCoverage
+    {
+    public:
+        //! What the index knows about one tile
+        struct Coverage
+        {
+            //! Whether any data extent overlaps the tile. Extents whose
+            //! minLevel is deeper than the tile's level do not count.
+            bool intersects = false;
+
+            //! Whether any data extent overlaps the tile, whatever its minLevel
+            bool overlaps = false;
+
+            //! Highest maxLevel among the overlapping extents;
+            //! UINT_MAX if any of them has no maxLevel.
+            unsigned maxLevel = 0;
+        };
+
+        //! Empty index
+        TileCoverage() = default;
+
+        //! Builds the index for a profile. Extents are clamped to the
+        //! profile and transformed to its SRS as needed.
+        TileCoverage(
+            const Profile& profile,
+            const DataExtentList& extents);
+
+        //! Profile this index was built for
+        const Profile& profile() const {
+            return _profile;
+        }
+
+        //! Coverage of a tile key in this index's profile
+        Coverage coverage(const TileKey& key) const;
+
+        //! Coverage of an area at a level of detail.
+        //! @param bounds Area in the profile's SRS
+        //! @param lod Level of detail in the profile
+        Coverage coverage(const Box& bounds, unsigned lod) const;
+
+        //! Number of levels of detail with per-tile tables
+        unsigned tableLevels() const {
+            return (unsigned)_tables.size();
+        }
+
+    private:
+        struct Entry
+        {
+            Box bounds;
+            unsigned minLevel;
+            unsigned char code;
+        };
+
+        Profile _profile;
+        std::vector<std::vector<unsigned char>> _tables; // per lod, row-major from the top
+        std::vector<unsigned char> _whole; // deepest level, from extents covering entire tiles
+        std::vector<Entry> _entries; // extents that need exact tests below the tables
+        std::vector<unsigned> _bucketStart; // deepest-level tile => first of its entries in _buckets
+        std::vector<unsigned> _buckets; // entries, grouped by deepest-level tile
+        std::vector<unsigned> _wide; // entries spanning too many tiles to bucket
+    };
+}
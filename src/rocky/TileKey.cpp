@@ -63,13 +63,7 @@ TileKey::extent() const
     if (!valid())
         return GeoExtent::INVALID;
 
-    auto[width, height] = _profile.tileDimensions(_lod);
-    double xmin = _profile.extent().xMin() + (width * (double)_x);
-    double ymax = _profile.extent().yMax() - (height * (double)_y);
-    double xmax = xmin + width;
-    double ymin = ymax - height;
-
-    return GeoExtent( _profile.srs(), xmin, ymin, xmax, ymax );
+    return _profile.tileExtent(_lod, _x, _y);
 }
 
 const std::string
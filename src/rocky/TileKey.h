@@ -7,13 +7,55 @@
 
 #include <rocky/Common.h>
 #include <rocky/Profile.h>
+#include <rocky/Math.h>
 #include <string>
+#include <cstdint>
 #include <functional> // std::hash
+#include <type_traits>
 
 namespace ROCKY_NAMESPACE
 {
     class GeoPoint;
 
+    /**
+     * Compact, trivially copyable identifier of a tile. Instead of a Profile it
+     * carries the profile's id (Profile::id), so it copies, hashes and compares
+     * like a handful of integers. Use Profile::tileBounds() to get its extent.
+     */
+    struct TileID
+    {
+        std::uint32_t lod = 0;
+        std::uint32_t x = 0;
+        std::uint32_t y = 0;
+        std::uint32_t profile = 0; // zero = invalid
+
+        bool valid() const {
+            return profile != 0;
+        }
+
+        bool operator == (const TileID& rhs) const {
+            return lod == rhs.lod && x == rhs.x && y == rhs.y && profile == rhs.profile;
+        }
+
+        bool operator != (const TileID& rhs) const {
+            return !operator==(rhs);
+        }
+
+        bool operator < (const TileID& rhs) const {
+            if (lod != rhs.lod) return lod < rhs.lod;
+            if (x != rhs.x) return x < rhs.x;
+            if (y != rhs.y) return y < rhs.y;
+            return profile < rhs.profile;
+        }
+
+        std::size_t hash() const {
+            return util::hash_value_unsigned(
+                ((std::uint64_t)lod << 32) | profile,
+                ((std::uint64_t)x << 32) | y);
+        }
+    };
+    static_assert(std::is_trivially_copyable<TileID>::value, "TileID must stay trivially copyable");
+
     /**
      * Uniquely identifies a single tile on the map, relative to a Profile.
      * Profiles have an origin of 0,0 at the top left.
@@ -118,6 +160,17 @@ namespace ROCKY_NAMESPACE
         //! Gets the geospatial extents of the tile represented by this key.
         const GeoExtent extent() const;
 
+        //! Bounds of the tile in its profile's SRS. Cheaper than extent() when
+        //! you do not need a GeoExtent.
+        Box bounds() const {
+            return _profile.tileBounds(_lod, _x, _y);
+        }
+
+        //! Compact identifier of this key
+        TileID id() const {
+            return TileID{ _lod, _x, _y, _profile.id() };
+        }
+
         unsigned tileX() const { return _x; }
 
         unsigned tileY() const { return _y; }
@@ -188,6 +241,13 @@ namespace ROCKY_NAMESPACE
 }
 
 namespace std {
+    // std::hash specialization for TileID
+    template<> struct hash<rocky::TileID> {
+        inline size_t operator()(const rocky::TileID& value) const {
+            return value.hash();
+        }
+    };
+
     // std::hash specialization for TileKey
     template<> struct hash<rocky::TileKey> {
         inline size_t operator()(const rocky::TileKey& value) const {
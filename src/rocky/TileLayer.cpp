@@ -6,7 +6,6 @@
 #include "TileLayer.h"
 #include "TileKey.h"
 #include "Map.h"
-#include "rtree.h"
 #include "json.h"
 
 using namespace ROCKY_NAMESPACE;
@@ -14,11 +13,6 @@ using namespace ROCKY_NAMESPACE::util;
 
 #define LC "[TileLayer] \"" << name().value() << "\" "
 
-namespace
-{
-    using DataExtentsIndex = RTree<DataExtent, double, 2>;
-}
-
 TileLayer::TileLayer() :
     super()
 {
@@ -43,7 +37,6 @@ TileLayer::construct(const JSON& conf)
     get_to(j, "tile_size", _tileSize);
 
     _writingRequested = false;
-    _dataExtentsIndex = nullptr;
 }
 
 JSON
@@ -61,10 +54,7 @@ TileLayer::to_json() const
 
 TileLayer::~TileLayer()
 {
-    if (_dataExtentsIndex)
-    {
-        delete static_cast<DataExtentsIndex*>(_dataExtentsIndex);
-    }    
+    //nop
 }
 
 void TileLayer::setMinLevel(unsigned value) {
@@ -201,6 +191,12 @@ void
 TileLayer::setProfile(const Profile& profile)
 {
     _profile = profile;
+
+    // build the vertical datum grid now rather than on the first transform
+    if (profile.valid())
+    {
+        SRS::warmUp({ profile.srs() });
+    }
 }
 
 void
@@ -267,7 +263,7 @@ TileLayer::isKeyInLegalRange(const TileKey& key) const
         {
             // calculate the resolution in the layer's profile, which can
             // be different that the key's profile.
-            double resKey = key.extent().width() / (double)tileSize();
+            double resKey = key.bounds().width() / (double)tileSize();
             double resLayer = SRS::transformUnits(resKey, key.profile().srs(), profile().srs(), Angle());
 
             if (_maxResolution.has_value() && _maxResolution > resLayer)
@@ -313,7 +309,7 @@ TileLayer::isKeyInVisualRange(const TileKey& key) const
         {
             // calculate the resolution in the layer's profile, which can
             // be different that the key's profile.
-            double resKey = key.extent().width() / (double)tileSize();
+            double resKey = key.bounds().width() / (double)tileSize();
             double resLayer = SRS::transformUnits(resKey, key.profile().srs(), profile().srs(), Angle());
 
             if (_maxResolution.has_value() && _maxResolution > resLayer)
@@ -365,11 +361,9 @@ TileLayer::dirtyDataExtents()
 {
     _dataExtentsUnion = GeoExtent::INVALID;
 
-    if (_dataExtentsIndex)
-    {
-        delete static_cast<DataExtentsIndex*>(_dataExtentsIndex);
-        _dataExtentsIndex = nullptr;
-    }
+    // queries already in flight keep the old index alive
+    std::atomic_store(&_coverage, shared_ptr<TileCoverage>());
+    _foreignKeyExtents.setCapacity(1024);
 }
 
 const DataExtent&
@@ -436,7 +430,7 @@ TileLayer::bestAvailableTileKey(
         {
             // calculate the resolution in the layer's profile, which can
             // be different that the key's profile.
-            double resKey = key.extent().width() / (double)tileSize();
+            double resKey = key.bounds().width() / (double)tileSize();
             double resLayer = SRS::transformUnits(resKey, key.profile().srs(), profile().srs(), Angle());
 
             if (_maxResolution.has_value() && _maxResolution > resLayer)
@@ -457,199 +451,107 @@ TileLayer::bestAvailableTileKey(
         return localLOD > MDL ? key.createAncestorKey(MDL) : key;
     }
 
-    // Reject if the extents don't overlap at all.
-    // (Note: this does not consider min/max levels, only spatial extents)
-    if (!dataExtentsUnion().intersects(key.extent()))
+    auto c = coverage(key, localLOD);
+
+    if (!c.intersects)
     {
         return TileKey::INVALID;
     }
 
-    bool     intersects = false;
-    unsigned highestLOD = 0;
+    // Is our key at a lower or equal LOD than the max key in the extents?
+    // If so, our key is good.
+    if (localLOD <= c.maxLevel)
+    {
+        return localLOD > MDL ? key.createAncestorKey(MDL) : key;
+    }
 
-    double a_min[2], a_max[2];
-    // Build the index if needed.
-    if (!_dataExtentsIndex)
+    // for a normal dataset, dataset max takes priority over MDL.
+    unsigned maxAvailableLOD = std::min(c.maxLevel, MDL);
+    return key.createAncestorKey(std::min(key.levelOfDetail(), maxAvailableLOD));
+}
+
+shared_ptr<TileCoverage>
+TileLayer::coverageIndex() const
+{
+    // readers never lock once the index exists
+    auto index = std::atomic_load(&_coverage);
+    if (!index)
     {
         std::unique_lock WRITE(_dataMutex);
 
-        if (!_dataExtentsIndex) // Double check
+        index = std::atomic_load(&_coverage);
+        if (!index) // Double check
         {
-            //ROCKY_INFO << LC << "Building data extents index with " << _dataExtents.size() << " extents" << std::endl;
-            DataExtentsIndex* dataExtentsIndex = new DataExtentsIndex();
-            for (auto de = _dataExtents.begin(); de != _dataExtents.end(); ++de)
-            {
-                // Build the index in the SRS of this layer
-                GeoExtent extentInLayerSRS = profile().clampAndTransformExtent(*de);
-
-                if (extentInLayerSRS.srs().isGeodetic() && extentInLayerSRS.crossesAntimeridian())
-                {
-                    GeoExtent west, east;
-                    extentInLayerSRS.splitAcrossAntimeridian(west, east);
-                    if (west.valid())
-                    {
-                        DataExtent new_de(west);
-                        new_de.minLevel() = de->minLevel();
-                        new_de.maxLevel() = de->maxLevel();
-                        a_min[0] = new_de.xMin(), a_min[1] = new_de.yMin();
-                        a_max[0] = new_de.xMax(), a_max[1] = new_de.yMax();
-                        dataExtentsIndex->Insert(a_min, a_max, new_de);
-                    }
-                    if (east.valid())
-                    {
-                        DataExtent new_de(east);
-                        new_de.minLevel() = de->minLevel();
-                        new_de.maxLevel() = de->maxLevel();
-                        a_min[0] = new_de.xMin(), a_min[1] = new_de.yMin();
-                        a_max[0] = new_de.xMax(), a_max[1] = new_de.yMax();
-                        dataExtentsIndex->Insert(a_min, a_max, new_de);
-                    }
-                }
-                else
-                {
-                    a_min[0] = extentInLayerSRS.xMin(), a_min[1] = extentInLayerSRS.yMin();
-                    a_max[0] = extentInLayerSRS.xMax(), a_max[1] = extentInLayerSRS.yMax();
-                    dataExtentsIndex->Insert(a_min, a_max, *de);
-                }
-            }
-            _dataExtentsIndex = dataExtentsIndex;
+            index = std::make_shared<TileCoverage>(profile(), _dataExtents);
+            std::atomic_store(&_coverage, index);
         }
     }
+    return index;
+}
 
-    // Transform the key extent to the SRS of this layer to do the index search
-    GeoExtent keyExtentInLayerSRS = profile().clampAndTransformExtent(key.extent());
-
-    a_min[0] = keyExtentInLayerSRS.xMin(); a_min[1] = keyExtentInLayerSRS.yMin();
-    a_max[0] = keyExtentInLayerSRS.xMax(); a_max[1] = keyExtentInLayerSRS.yMax();
-
-    DataExtentsIndex* index = static_cast<DataExtentsIndex*>(_dataExtentsIndex);
-
-    TileKey bestKey;
-    index->Search(a_min, a_max, [&](const DataExtent& de) {
-        // check that the extent isn't higher-resolution than our key:
-        if (!de.minLevel().has_value() || localLOD >= (int)de.minLevel().value())
-        {
-            // Got an intersetion; now test the LODs:
-            intersects = true;
+TileCoverage::Coverage
+TileLayer::coverage(const TileKey& key) const
+{
+    if (!key.valid())
+        return { };
 
-            // If the maxLevel is not set, there's not enough information
-            // so just assume our key might be good.
-            if (!de.maxLevel().has_value())
-            {
-                bestKey = localLOD > MDL ? key.createAncestorKey(MDL) : key;
-                return false; //Stop searching, we've found a key
-            }
+    // We must use the equivalent lod b/c the input key can be in any profile.
+    unsigned localLOD = profile().valid() ?
+        profile().getEquivalentLOD(key.profile(), key.levelOfDetail()) :
+        key.levelOfDetail();
 
-            // Is our key at a lower or equal LOD than the max key in this extent?
-            // If so, our key is good.
-            else if (localLOD <= (int)de.maxLevel().value())
-            {
-                bestKey = localLOD > MDL ? key.createAncestorKey(MDL) : key;
-                return false; //Stop searching, we've found a key
-            }
+    return coverage(key, localLOD);
+}
 
-            // otherwise, record the highest encountered LOD that
-            // intersects our key.
-            else if (de.maxLevel().value() > highestLOD)
-            {
-                highestLOD = de.maxLevel().value();
-            }                        
-        }
-        return true; // Continue searching
-    });
+TileCoverage::Coverage
+TileLayer::coverage(const TileKey& key, unsigned localLOD) const
+{
+    auto index = coverageIndex();
 
-    if (bestKey.valid())
+    if (key.profile() == index->profile())
     {
-        return bestKey;
+        return index->coverage(key);
     }
 
-    if ( intersects )
+    // Keys from other profiles need their extent in this layer's SRS.
+    // Cache those since the same keys come back frame after frame.
+    auto id = key.id();
+    GeoExtent keyExtent = _foreignKeyExtents.get(id);
+    if (!keyExtent.valid())
     {
-        // for a normal dataset, dataset max takes priority over MDL.
-        unsigned maxAvailableLOD = std::min(highestLOD, MDL);
-        return key.createAncestorKey(std::min(key.levelOfDetail(), maxAvailableLOD));
-    }
+        keyExtent = index->profile().clampAndTransformExtent(key.extent());
+        if (!keyExtent.valid())
+            return { };
 
-    return TileKey::INVALID;
-}
+        _foreignKeyExtents.put(id, keyExtent);
+    }
 
-void
-TileLayer::buildDataExtentsIfNeeded() const
-{
-    // Build the index if needed.
-    if (!_dataExtentsIndex)
+    auto query = [&](const GeoExtent& ex)
     {
-        std::unique_lock WRITE(_dataMutex);
-
-        if (!_dataExtentsIndex) // Double check
-        {
-            double a_min[2], a_max[2];
-
-            //ROCKY_INFO << LC << "Building data extents index with " << _dataExtents.size() << " extents" << std::endl;
-            DataExtentsIndex* dataExtentsIndex = new DataExtentsIndex();
-            for (auto de = _dataExtents.begin(); de != _dataExtents.end(); ++de)
-            {
-                // Build the index in the SRS of this layer
-                GeoExtent extentInLayerSRS = profile().clampAndTransformExtent(*de);
-
-                if (extentInLayerSRS.srs().isGeodetic() && extentInLayerSRS.crossesAntimeridian())
-                {
-                    GeoExtent west, east;
-                    extentInLayerSRS.splitAcrossAntimeridian(west, east);
-                    if (west.valid())
-                    {
-                        DataExtent new_de(west);
-                        new_de.minLevel() = de->minLevel();
-                        new_de.maxLevel() = de->maxLevel();
-                        a_min[0] = new_de.xMin(), a_min[1] = new_de.yMin();
-                        a_max[0] = new_de.xMax(), a_max[1] = new_de.yMax();
-                        dataExtentsIndex->Insert(a_min, a_max, new_de);
-                    }
-                    if (east.valid())
-                    {
-                        DataExtent new_de(east);
-                        new_de.minLevel() = de->minLevel();
-                        new_de.maxLevel() = de->maxLevel();
-                        a_min[0] = new_de.xMin(), a_min[1] = new_de.yMin();
-                        a_max[0] = new_de.xMax(), a_max[1] = new_de.yMax();
-                        dataExtentsIndex->Insert(a_min, a_max, new_de);
-                    }
-                }
-                else
-                {
-                    a_min[0] = extentInLayerSRS.xMin(), a_min[1] = extentInLayerSRS.yMin();
-                    a_max[0] = extentInLayerSRS.xMax(), a_max[1] = extentInLayerSRS.yMax();
-                    dataExtentsIndex->Insert(a_min, a_max, *de);
-                }
-            }
+        return index->coverage(Box(ex.xMin(), ex.yMin(), ex.xMax(), ex.yMax()), localLOD);
+    };
 
-            _dataExtentsIndex = dataExtentsIndex;
-        }
+    if (keyExtent.srs().isGeodetic() && keyExtent.crossesAntimeridian())
+    {
+        GeoExtent west, east;
+        keyExtent.splitAcrossAntimeridian(west, east);
+        TileCoverage::Coverage a, b;
+        if (west.valid()) a = query(west);
+        if (east.valid()) b = query(east);
+        a.overlaps = a.overlaps || b.overlaps;
+        a.maxLevel = a.intersects && b.intersects ? std::max(a.maxLevel, b.maxLevel) : a.intersects ? a.maxLevel : b.maxLevel;
+        a.intersects = a.intersects || b.intersects;
+        return a;
     }
+
+    return query(keyExtent);
 }
 
 bool
 TileLayer::intersects(const TileKey& key) const
 {
-    bool got_intersection = false;
-    double a_min[2], a_max[2];
-
-    buildDataExtentsIfNeeded();
-
-    // We must use the equivalent lod b/c the input key can be in any profile.
-    unsigned localLOD = profile().valid() ?
-        profile().getEquivalentLOD(key.profile(), key.levelOfDetail()) :
-        key.levelOfDetail();
-
-    // Transform the key extent to the SRS of this layer to do the index search
-    GeoExtent keyExtentInLayerSRS = profile().clampAndTransformExtent(key.extent());
-
-    a_min[0] = keyExtentInLayerSRS.xMin(); a_min[1] = keyExtentInLayerSRS.yMin();
-    a_max[0] = keyExtentInLayerSRS.xMax(); a_max[1] = keyExtentInLayerSRS.yMax();
-
-    DataExtentsIndex* index = static_cast<DataExtentsIndex*>(_dataExtentsIndex);
-
-    return index->Search(a_min, a_max) > 0;
+    // spatial test only; minLevel is for bestAvailableTileKey to consider
+    return coverage(key).overlaps;
 }
 
 bool
@@ -10,6 +10,8 @@
 #include <rocky/VisibleLayer.h>
 #include <rocky/Profile.h>
 #include <rocky/TileKey.h>
+#include <rocky/TileCoverage.h>
+#include <rocky/LRUCache.h>
 
 namespace ROCKY_NAMESPACE
 {
@@ -91,8 +93,14 @@ namespace ROCKY_NAMESPACE
     public: // Data availability methods
 
         //! True is the tile key intersects the data extents of this layer.
+        //! Only the extents' areas count, not their min/max levels.
         bool intersects(const TileKey& key) const;
 
+        //! Data extents of this layer that overlap a tile key, in any profile.
+        //! Answered from an index of the data extents over this layer's profile,
+        //! which is built on first use.
+        TileCoverage::Coverage coverage(const TileKey& key) const;
+
         /**
          * Given a TileKey, returns a TileKey representing the best known available.
          * For example, if the input TileKey exceeds the layer's max LOD, the return
@@ -179,13 +187,20 @@ namespace ROCKY_NAMESPACE
         // Figure out the cache settings for this layer.
         void establishCacheSettings();
 
-        void buildDataExtentsIfNeeded() const;
+        shared_ptr<TileCoverage> coverageIndex() const;
+
+        TileCoverage::Coverage coverage(const TileKey& key, unsigned localLOD) const;
 
         // general purpose data protector
         mutable std::shared_mutex _dataMutex;
         DataExtentList _dataExtents;
         mutable DataExtent _dataExtentsUnion;
-        mutable void* _dataExtentsIndex;
+
+        // index of _dataExtents; use std::atomic_load/atomic_store
+        mutable shared_ptr<TileCoverage> _coverage;
+
+        // keys from other profiles, in this layer's SRS
+        mutable util::LRUCache<TileID, GeoExtent> _foreignKeyExtents{ 1024 };
 
         // The cache ID used at runtime. This will either be the cacheId found in
         // the TileLayerOptions, or a dynamic cacheID generated at runtime.
@@ -72,6 +72,13 @@ Application::ctor(int& argc, char** argv)
     mapNode->terrainSettings().minLevelOfDetail = 1;
     mapNode->terrainSettings().screenSpaceError = 135.0f;
 
+    // crack-free tile edges with minimal skirts
+    if (commandLine.read({ "--normalize-edges" }))
+    {
+        mapNode->terrainSettings().normalizeEdges = true;
+        mapNode->terrainSettings().skirtRatio = TerrainSettings::minNormalizedSkirtRatio;
+    }
+
     // wireframe overlay
     if (commandLine.read({ "--wire" }))
         instance.runtime().shaderCompileSettings->defines.insert("RK_WIREFRAME_OVERLAY");
@@ -120,6 +120,13 @@ DisplayManager::addWindow(vsg::ref_ptr<vsg::Window> window, vsg::ref_ptr<vsg::Vi
     auto commandgraph = vsg::CommandGraph::create(window);
     _commandGraphByWindow[window] = commandgraph;
 
+    // Streamed uploads record ahead of the render passes,
+    // since transfers can't happen inside one.
+    if (app)
+    {
+        commandgraph->addChild(app->instance.runtime().uploader);
+    }
+
     bool user_provied_view = view.valid();
     vsg::ref_ptr<vsg::Camera> camera;
 
@@ -219,6 +226,24 @@ DisplayManager::addWindow(vsg::ref_ptr<vsg::WindowTraits> traits)
 
     auto window = vsg::Window::create(traits);
 
+    // Block-compressed (BCn) textures for terrain imagery, if the device can
+    // sample them. The window creates its device later, from the traits.
+    if (!traits->device)
+    {
+        VkPhysicalDeviceFeatures features = {};
+        auto physicalDevice = window->getOrCreatePhysicalDevice();
+        if (physicalDevice)
+            vkGetPhysicalDeviceFeatures(physicalDevice->vk(), &features);
+
+        traits->deviceFeatures->get().textureCompressionBC = features.textureCompressionBC;
+
+        if (!features.textureCompressionBC)
+            Log()->info("Device does not support BC texture compression; textures stay uncompressed");
+
+        if (app)
+            app->instance.runtime().textureCompressionBC = (features.textureCompressionBC == VK_TRUE);
+    }
+
     addWindow(window);
 
     return window;
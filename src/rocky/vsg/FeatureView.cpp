@@ -136,7 +136,7 @@ namespace
 
             // transform:
             auto feature_to_world = feature.srs.to(SRS::ECEF);
-            feature_to_world.transformRange(tessellated.begin(), tessellated.end());
+            feature_to_world.transformArray(tessellated.data(), tessellated.size());
 
             // make the line attachment:
             line.push(tessellated.begin(), tessellated.end());
@@ -188,7 +188,7 @@ namespace
             auto& part = iter.next();
             if (!part.points.empty())
             {
-                feature_to_geo.transformRange(part.points.begin(), part.points.end());
+                feature_to_geo.transformArray(part.points.data(), part.points.size());
                 geo_to_gnomonic(part.points.begin(), part.points.end(), centroid, gnomonic_scale);
                 local_ex.expandBy(part.points.begin(), part.points.end());
             }
@@ -271,7 +271,7 @@ namespace
         gnomonic_to_geo(m.verts.begin(), m.verts.end(), centroid, gnomonic_scale);
 
         // And into the final projection:
-        feature_to_ecef.transformRange(m.verts.begin(), m.verts.end());
+        feature_to_ecef.transformArray(m.verts.data(), m.verts.size());
 
         auto color = styles.mesh_function(feature).color;
 
@@ -172,6 +172,9 @@ namespace
         // .webp: RIFF ???? WEBP
         // .ico   00 00 01 00
         //        00 00 02 00 ( cursor files )
+        // .dds:  DDS
+        // .ktx:  AB 4B 54 58 20 31 31 BB
+        // .ktx2: AB 4B 54 58 20 32 30 BB
         switch (data[0])
         {
         case '\xFF':
@@ -196,6 +199,14 @@ namespace
 
         case 'R':
             return (!strncmp((const char*)data, "RIFF", 4)) ? "image/webp" : "";
+
+        case 'D':
+            return (!strncmp((const char*)data, "DDS ", 4)) ? "image/vnd-ms.dds" : "";
+
+        case '\xAB':
+            return
+                (!strncmp((const char*)data, "\xABKTX 20\xBB", 8)) ? "image/ktx2" :
+                (!strncmp((const char*)data, "\xABKTX 11\xBB", 8)) ? "image/ktx" : "";
         }
 
         return { };
@@ -292,9 +303,13 @@ InstanceVSG::InstanceVSG() :
     // map of mime-types to extensions that VSG can understand
     static const std::unordered_map<std::string, std::string> ext_for_mime_type = {
         { "image/bmp", ".bmp" },
+        { "image/vnd-ms.dds", ".dds" },
+        { "image/dds", ".dds" },
         { "image/gif", ".gif" },
         { "image/jpg", ".jpg" },
         { "image/jpeg", ".jpg" },
+        { "image/ktx", ".ktx" },
+        { "image/ktx2", ".ktx2" },
         { "image/png", ".png" },
         { "image/tga", ".tga" },
         { "image/tif", ".tif" },
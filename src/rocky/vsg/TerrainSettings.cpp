@@ -22,14 +22,25 @@ TerrainSettings::TerrainSettings(const JSON& conf)
     get_to(j, "min_seconds_before_unload", minSecondsBeforeUnload);
     get_to(j, "min_frames_before_unload", minFramesBeforeUnload);
     get_to(j, "min_tiles_before_unload", minResidentTilesBeforeUnload);
+    get_to(j, "min_range_before_unload", minRangeBeforeUnload);
+    get_to(j, "max_tiles_to_unload_per_frame", maxTilesToUnloadPerFrame);
+    get_to(j, "memory_budget", memoryBudget);
     get_to(j, "cast_shadows", castShadows);
     get_to(j, "tile_pixel_size", tilePixelSize);
     get_to(j, "skirt_ratio", skirtRatio);
     get_to(j, "color", color);
     get_to(j, "normalize_edges", normalizeEdges);
+    get_to(j, "max_edge_fixups_per_frame", maxEdgeFixupsPerFrame);
     get_to(j, "morph_terrain", morphTerrain);
     get_to(j, "morph_imagery", morphImagery);
     get_to(j, "concurrency", concurrency);
+    get_to(j, "prefetch_seconds", prefetchSeconds);
+    get_to(j, "horizon_culling", horizonCulling);
+    get_to(j, "mipmap_imagery", mipmapImagery);
+    get_to(j, "texture_compression", textureCompression);
+    get_to(j, "elevation_encoding", elevationEncoding);
+    get_to(j, "instancing", instancing);
+    get_to(j, "atlas_layers", atlasLayers);
 }
 
 JSON
@@ -46,13 +57,24 @@ TerrainSettings::to_json() const
     set(j, "min_seconds_before_unload", minSecondsBeforeUnload);
     set(j, "min_frames_before_unload", minFramesBeforeUnload);
     set(j, "min_tiles_before_unload", minResidentTilesBeforeUnload);
+    set(j, "min_range_before_unload", minRangeBeforeUnload);
+    set(j, "max_tiles_to_unload_per_frame", maxTilesToUnloadPerFrame);
+    set(j, "memory_budget", memoryBudget);
     set(j, "cast_shadows", castShadows);
     set(j, "tile_pixel_size", tilePixelSize);
     set(j, "skirt_ratio", skirtRatio);
     set(j, "color", color);
     set(j, "normalize_edges", normalizeEdges);
+    set(j, "max_edge_fixups_per_frame", maxEdgeFixupsPerFrame);
     set(j, "morph_terrain", morphTerrain);
     set(j, "morph_imagery", morphImagery);
     set(j, "concurrency", concurrency);
+    set(j, "prefetch_seconds", prefetchSeconds);
+    set(j, "horizon_culling", horizonCulling);
+    set(j, "mipmap_imagery", mipmapImagery);
+    set(j, "texture_compression", textureCompression);
+    set(j, "elevation_encoding", elevationEncoding);
+    set(j, "instancing", instancing);
+    set(j, "atlas_layers", atlasLayers);
     return j.dump();
 }
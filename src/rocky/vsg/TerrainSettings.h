@@ -63,6 +63,13 @@ namespace ROCKY_NAMESPACE
         //! Minimum number of terrain tiles to keep in memory before expiring usused data
         optional<unsigned> minResidentTilesBeforeUnload = 0;
 
+        //! Memory (megabytes) that resident terrain tiles may use, counting
+        //! their textures on the GPU, the data they loaded on the CPU, and
+        //! the shared tile geometry. Tiles the camera no longer needs stay
+        //! resident, in case it returns, until this is exceeded; then the
+        //! least recently used go first. Zero expires unused tiles right away.
+        optional<unsigned> memoryBudget = 0;
+
         //! Whether the terrain should cast shadows on itself
         optional<bool> castShadows = false;
 
@@ -71,7 +78,7 @@ namespace ROCKY_NAMESPACE
 
         //! Ratio of skirt height to tile width. The "skirt" is geometry extending
         //! down from the edge of terrain tiles meant to hide cracks between adjacent
-        //! levels of detail. A value of 0 means no skirt.
+        //! levels of detail. A value of 0 means no skirt (but see normalizeEdges).
         optional<float> skirtRatio = 0.0f;
 
         //! Color of the untextured globe (where no imagery is displayed)
@@ -80,12 +87,26 @@ namespace ROCKY_NAMESPACE
         //! Whether to generate normal map textures. Default is true
         optional<bool> useNormalMaps = true;
 
-        //! Whether to average normal vectors on tile boundaries. Doing so reduces the
-        //! the appearance of seams when using lighting, but requires extra CPU work.
+        //! Whether to make the elevation of adjacent terrain tiles agree along their
+        //! edges: tiles at the same level of detail share the same edge samples, and
+        //! a tile next to a coarser one follows its edge. Tiles then meet without
+        //! cracks almost everywhere, so the skirts can shrink to minNormalizedSkirtRatio,
+        //! at the cost of some CPU work and a second copy of each tile's elevation.
+        //! Neighbors come from the resident tiles, so a tile still drawing in place of
+        //! its resident subtiles, or r16 elevation (quantized edges), needs that skirt.
         optional<bool> normalizeEdges = false;
 
-        //! Whether to morph terrain data between terrain tile LODs.
-        //! This feature is not available when using screen-space error LOD
+        //! Smallest skirtRatio the terrain uses when normalizeEdges is on
+        static constexpr float minNormalizedSkirtRatio = 0.005f;
+
+        //! Maximum number of terrain tiles to normalize again each frame because
+        //! a neighbor changed or expired (see normalizeEdges)
+        optional<unsigned> maxEdgeFixupsPerFrame = 64u;
+
+        //! Whether to morph terrain data between terrain tile LODs, so that tiles
+        //! do not pop as they subdivide. Morphing finishes where the screen-space
+        //! error test switches LODs, which brings in tiles a little earlier; in
+        //! exchange, a larger screenSpaceError is far less noticeable.
         optional<bool> morphTerrain = false;
 
         //! Whether to morph imagery between terrain tile LODs.
@@ -95,6 +116,40 @@ namespace ROCKY_NAMESPACE
         //! Target concurrency of terrain data loading operations.
         optional<unsigned> concurrency = 4;
 
+        //! How far ahead, in seconds, to predict the camera's motion and start
+        //! loading the tiles it is heading toward. Such loads run at a lower
+        //! priority and are abandoned if the camera goes elsewhere. Zero disables.
+        optional<float> prefetchSeconds = 1.0f;
+
+        //! Whether to skip tiles that are hidden behind the horizon of a
+        //! geocentric map, using each tile's horizon occlusion point.
+        optional<bool> horizonCulling = true;
+
+        //! Whether to generate mipmaps for terrain color textures when loading them.
+        optional<bool> mipmapImagery = true;
+
+        //! GPU block compression to apply to terrain color textures after
+        //! compositing: "none", "bc1", "bc3", "bc7", or "auto".
+        //! Data that arrives already compressed (KTX2, DDS) passes through as-is.
+        optional<std::string> textureCompression = std::string("none");
+
+        //! Storage for terrain elevation data on the CPU and GPU: "float",
+        //! "r16" (16 bits quantized over each tile's height range) or "half".
+        //! The 16-bit encodings halve elevation memory and upload cost.
+        optional<std::string> elevationEncoding = std::string("float");
+
+        //! Whether to draw terrain tiles with instancing: tile textures go into
+        //! shared texture arrays and per-tile data into one buffer, so that all
+        //! visible tiles sharing a geometry draw together in one call. This cuts
+        //! the CPU cost of recording thousands of tiles. The textures stream in
+        //! through Runtime::uploader, so its budget bounds the upload cost per frame.
+        optional<bool> instancing = false;
+
+        //! Most layers in each of the texture arrays that hold tile textures when
+        //! instancing. Every Vulkan device supports at least 256; many support 2048.
+        //! Tiles that don't fit render the usual way.
+        optional<unsigned> atlasLayers = 256;
+
     public: // internal runtime settings, not serialized.
 
         //! TEMPORARY.
@@ -12,6 +12,21 @@
 
 using namespace ROCKY_NAMESPACE;
 
+namespace
+{
+    // vertex data of a pooled geometry; the index buffer is shared by the whole pool
+    std::size_t vertexBytes(const SharedGeometry& geom)
+    {
+        std::size_t bytes = 0u;
+        for (auto& array : geom.arrays)
+        {
+            if (array && array->data)
+                bytes += array->data->dataSize();
+        }
+        return bytes;
+    }
+}
+
 GeometryPool::GeometryPool(const SRS& worldSRS) :
     _worldSRS(worldSRS)
 {
@@ -43,6 +58,7 @@ GeometryPool::getPooledGeometry(const TileKey& tileKey, const Settings& settings
         if (_defaultIndices == nullptr)
         {
             _defaultIndices = createIndices(settings);
+            _sizeInBytes += _defaultIndices->dataSize();
         }
     }
 
@@ -78,7 +94,8 @@ GeometryPool::getPooledGeometry(const TileKey& tileKey, const Settings& settings
             if (out.valid()) //&& !meshEditor.hasEdits())
             {
                 std::scoped_lock lock(_mutex);
-                _sharedGeometries.emplace(geomKey, out);
+                if (_sharedGeometries.emplace(geomKey, out).second)
+                    _sizeInBytes += vertexBytes(*out);
             }
         }
     }
@@ -221,18 +238,41 @@ namespace
             tile_to_world = tile_extent.srs().to(worldSRS);
         }
 
-        inline glm::dvec3 unitToWorld(const glm::dvec3& unit) const
+        //! World coordinates and up vectors for a size x size grid spanning
+        //! the tile, in row-major order, computed in bulk.
+        inline void gridToWorld(unsigned size, glm::dvec3* world, glm::dvec3* up) const
         {
-            // unit to tile:
-            glm::dvec3 tile(
-                unit.x * tile_extent.width() + tile_extent.xmin(),
-                unit.y * tile_extent.height() + tile_extent.ymin(),
-                unit.z);
+            unsigned count = size * size;
+            for (unsigned row = 0; row < size; ++row)
+            {
+                double ny = (float)row / (float)(size - 1);
+                for (unsigned col = 0; col < size; ++col)
+                {
+                    double nx = (float)col / (float)(size - 1);
+                    world[row * size + col] = glm::dvec3(
+                        nx * tile_extent.width() + tile_extent.xmin(),
+                        ny * tile_extent.height() + tile_extent.ymin(),
+                        0.0);
+                }
+            }
+
+            if (tile_to_world.to().isGeocentric())
+            {
+                tile_to_world.transformArray(world, count);
+                tile_to_world.to().ellipsoid().geocentricToUpVectors(world, up, count);
+            }
+            else
+            {
+                // no ellipsoid in a projected world, so see where a point one unit up lands:
+                for (unsigned i = 0; i < count; ++i)
+                    up[i] = glm::dvec3(world[i].x, world[i].y, 1.0);
 
-            glm::dvec3 world;
-            tile_to_world(tile, world);
+                tile_to_world.transformArray(world, count);
+                tile_to_world.transformArray(up, count);
 
-            return world;
+                for (unsigned i = 0; i < count; ++i)
+                    up[i] = glm::normalize(up[i] - world[i]);
+            }
         }
     };
 
@@ -303,14 +343,18 @@ GeometryPool::createGeometry(const TileKey& tileKey, const Settings& settings, C
     else // default mesh - no constraints
 #endif
     {
-        glm::dvec3 unit;
-        glm::dvec3 world;
         glm::dvec3 local;
-        glm::dvec3 world_plus_one;
         glm::dvec3 normal;
 
         Locator locator(tileKey.extent(), _worldSRS);
 
+        // positions and normals for the whole surface in one go:
+        std::vector<glm::dvec3> world(numVertsInSurface);
+        std::vector<glm::dvec3> up(numVertsInSurface);
+        locator.gridToWorld(tileSize, world.data(), up.data());
+
+        glm::dmat3 world2local_rotation(world2local);
+
         for (unsigned row = 0; row < tileSize; ++row)
         {
             float ny = (float)row / (float)(tileSize - 1);
@@ -319,9 +363,7 @@ GeometryPool::createGeometry(const TileKey& tileKey, const Settings& settings, C
                 float nx = (float)col / (float)(tileSize - 1);
                 unsigned i = row * tileSize + col;
 
-                unit = { nx, ny, 0.0 };
-                world = locator.unitToWorld(unit);
-                local = world2local * world;
+                local = world2local * world[i];
                 verts->set(i, vsg::vec3(local.x, local.y, local.z));
 
                 expandSphereToInclude(tileBound, vsg::dvec3(local.x, local.y, local.z));
@@ -330,21 +372,20 @@ GeometryPool::createGeometry(const TileKey& tileKey, const Settings& settings, C
                 float marker = VERTEX_VISIBLE;
                 uvs->set(i, vsg::vec3(nx, ny, marker));
 
-                unit.z = 1.0;
-                world_plus_one = locator.unitToWorld(unit);
-                normal = glm::normalize((world2local*world_plus_one) - local);
+                normal = glm::normalize(world2local_rotation * up[i]);
                 normals->set(i, vsg::vec3(normal.x, normal.y, normal.z));
 
-                // neighbor:
+                // neighbor: the vertex this one collapses onto in the parent
+                // tile's grid, which is always one we have already visited
                 if (neighbors)
                 {
-                    auto& modelNeighborLTP = (*verts)[verts->size() - getMorphNeighborIndexOffset(col, row, tileSize)];
+                    auto& modelNeighborLTP = (*verts)[i + 1 - getMorphNeighborIndexOffset(col, row, tileSize)];
                     neighbors->set(i, modelNeighborLTP);
                 }
 
                 if (neighborNormals)
                 {
-                    auto& modelNeighborNormalLTP = (*normals)[normals->size() - getMorphNeighborIndexOffset(col, row, tileSize)];
+                    auto& modelNeighborNormalLTP = (*normals)[i + 1 - getMorphNeighborIndexOffset(col, row, tileSize)];
                     neighborNormals->set(i, modelNeighborNormalLTP);
                 }
             }
@@ -378,8 +419,14 @@ GeometryPool::createGeometry(const TileKey& tileKey, const Settings& settings, C
         // the geometry:
         auto geom = SharedGeometry::create();
 
-        geom->assignArrays(vsg::DataList{
-            verts, normals, uvs, neighbors, neighborNormals });
+        // the neighbor arrays exist only when morphing
+        vsg::DataList arrays{ verts, normals, uvs };
+        if (neighbors)
+            arrays.push_back(neighbors);
+        if (neighborNormals)
+            arrays.push_back(neighborNormals);
+
+        geom->assignArrays(arrays);
 
         geom->assignIndices(indices);
 
@@ -397,6 +444,25 @@ GeometryPool::createGeometry(const TileKey& tileKey, const Settings& settings, C
         geom->proxy_uvs = uvs;
         geom->proxy_indices = indices;
 
+        // bounds of each quadrant; a vertex on a dividing line belongs to the
+        // quadrants on both sides. With an even tile size no vertex lies on the
+        // lines, so the nearest ones on each side go to both quadrants instead.
+        const float slack = (tileSize % 2) == 0 ? 1.0f / (float)(tileSize - 1) : 0.0f;
+        for (unsigned i = 0; i < numVerts; ++i)
+        {
+            auto& uv = (*uvs)[i];
+            for (unsigned q = 0; q < 4; ++q)
+            {
+                bool east = (q & 1) != 0, north = q < 2;
+                if ((east ? uv.x >= 0.5f - slack : uv.x <= 0.5f + slack) &&
+                    (north ? uv.y >= 0.5f - slack : uv.y <= 0.5f + slack))
+                {
+                    geom->proxy_vertBounds[q].add(vsg::dvec3((*verts)[i]));
+                    geom->proxy_normalBounds[q].add(vsg::dvec3((*normals)[i]));
+                }
+            }
+        }
+
         return geom;
     }
 }
@@ -406,6 +472,7 @@ GeometryPool::clear()
 {
     std::scoped_lock lock(_mutex);
     _sharedGeometries.clear();
+    _sizeInBytes = _defaultIndices ? _defaultIndices->dataSize() : 0u;
 }
 
 void
@@ -416,9 +483,14 @@ GeometryPool::sweep(Runtime& runtime)
     for (auto& entry : _sharedGeometries)
     {
         if (entry.second->referenceCount() > 1)
+        {
             temp.emplace(entry.first, entry.second);
+        }
         else
+        {
+            _sizeInBytes -= vertexBytes(*entry.second);
             runtime.dispose(entry.second);
+        }
 
     }
     _sharedGeometries.swap(temp);
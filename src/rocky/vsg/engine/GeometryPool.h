@@ -40,6 +40,12 @@ namespace ROCKY_NAMESPACE
         vsg::ref_ptr<vsg::vec3Array> proxy_normals;
         vsg::ref_ptr<vsg::vec3Array> proxy_uvs;
         vsg::ref_ptr<vsg::ushortArray> proxy_indices;
+
+        //! Bounds of the vertices (at zero height) and of the vertex normals
+        //! of each quadrant of the tile, in the tile's local frame. SurfaceNode
+        //! extrudes them by a height range to bound the elevated surface.
+        vsg::dbox proxy_vertBounds[4];
+        vsg::dbox proxy_normalBounds[4];
     };
 
 
@@ -163,12 +169,16 @@ namespace ROCKY_NAMESPACE
         //! Number of geometries in the pool
         inline std::size_t size() const;
 
+        //! Memory used by the geometries in the pool, in bytes
+        inline std::size_t sizeInBytes() const;
+
     private:
 
         SRS _worldSRS;
         mutable util::Gate<GeometryKey> _keygate;
         mutable std::mutex _mutex;
         SharedGeometries _sharedGeometries;
+        std::size_t _sizeInBytes = 0u;
         vsg::ref_ptr<vsg::ushortArray> _defaultIndices;
         Settings _defaultIndicesSettings;
 
@@ -195,5 +205,9 @@ namespace ROCKY_NAMESPACE
         return _sharedGeometries.size();
     }
 
+    std::size_t GeometryPool::sizeInBytes() const {
+        return _sizeInBytes;
+    }
+
 }
 
@@ -121,6 +121,8 @@ Runtime::Runtime()
 
     _priorityUpdateQueue = PriorityUpdateQueue::create();
 
+    uploader = StreamingUploader::create();
+
     // initialize the deferred deletion collection.
     // a large number of frames ensures objects will be safely destroyed and
     // and we won't have too many deletions per frame.
@@ -231,6 +233,9 @@ Runtime::update()
         }
     }
 
+    // close the frame's uploads
+    uploader->update(*this);
+
     // process the deferred unref list
     //if (viewer->getFrameStamp()->frameCount % 5 == 0)
     {
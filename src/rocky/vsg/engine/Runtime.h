@@ -6,6 +6,7 @@
 #pragma once
 
 #include <rocky/vsg/Common.h>
+#include <rocky/vsg/engine/StreamingUploader.h>
 #include <rocky/Instance.h>
 #include <rocky/IOTypes.h>
 #include <rocky/Threading.h>
@@ -71,6 +72,16 @@ namespace ROCKY_NAMESPACE
         //! By default Runtime uses its own round-robin object disposer
         std::function<void(vsg::ref_ptr<vsg::Object>)> disposer;
 
+        //! Whether the device was created with block-compressed (BCn) texture
+        //! support; without it, textures stay uncompressed. DisplayManager sets
+        //! this when it creates the device; set it yourself if you create your own.
+        bool textureCompressionBC = false;
+
+        //! Streams image data to the GPU under a per-frame budget.
+        //! Record it in each command graph ahead of the render graphs;
+        //! DisplayManager does this for you.
+        vsg::ref_ptr<StreamingUploader> uploader;
+
     public:
 
         //! Queue a function to run during the update pass
@@ -0,0 +1,328 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "StreamingUploader.h"
+#include "Runtime.h"
+
+#include <rocky/Metrics.h>
+#include <vsg/app/Viewer.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ROCKY_NAMESPACE;
+
+#define LC "[StreamingUploader] "
+
+namespace
+{
+    // satisfies the offset alignment of copies into any format, compressed or not
+    constexpr VkDeviceSize staging_alignment = 16u;
+
+    VkImageMemoryBarrier barrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+    {
+        VkImageMemoryBarrier b = {};
+        b.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        b.srcAccessMask = srcAccess;
+        b.dstAccessMask = dstAccess;
+        b.oldLayout = oldLayout;
+        b.newLayout = newLayout;
+        b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.image = image;
+        b.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+        return b;
+    }
+
+    // Extent of a mipmap level. Copies of compressed images may take a
+    // partial block like this one, since it reaches the edge of the level.
+    VkExtent3D mipExtent(const VkExtent3D& extent, uint32_t level)
+    {
+        return VkExtent3D{
+            std::max(extent.width >> level, 1u),
+            std::max(extent.height >> level, 1u),
+            1u };
+    }
+}
+
+void
+StreamingUploader::initialize(vsg::ref_ptr<vsg::Image> image)
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(image, void());
+
+    std::scoped_lock lock(_mutex);
+    _batch.fresh.emplace_back(image);
+}
+
+void
+StreamingUploader::copy(vsg::ref_ptr<vsg::Image> source, vsg::ref_ptr<vsg::Image> destination, uint32_t layers)
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(source && destination, void());
+
+    std::scoped_lock lock(_mutex);
+    _batch.fresh.emplace_back(destination);
+    _batch.copies.push_back(Copy{ source, destination, layers });
+}
+
+bool
+StreamingUploader::upload(const void* data, std::size_t size, vsg::ref_ptr<vsg::Image> image, uint32_t layer)
+{
+    return upload(&data, &size, 1u, image, layer);
+}
+
+bool
+StreamingUploader::upload(const void* const* levels, const std::size_t* sizes, uint32_t numLevels, vsg::ref_ptr<vsg::Image> image, uint32_t layer)
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(levels && sizes && numLevels > 0u && image, false);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::scoped_lock lock(_mutex);
+
+    auto locked = std::chrono::steady_clock::now();
+    _lockWait += locked - start;
+
+    if (!_mapped)
+        return false;
+
+    // each level starts on an aligned offset
+    auto align = [](std::size_t offset) {
+        return (offset + staging_alignment - 1) & ~(staging_alignment - 1);
+    };
+
+    std::size_t end = _used;
+    for (uint32_t m = 0; m < numLevels; ++m)
+    {
+        ROCKY_SOFT_ASSERT_AND_RETURN(levels[m], false);
+        end = align(end) + sizes[m];
+    }
+
+    if (end > _regionSize)
+        return false;
+
+    std::size_t size = 0u;
+    for (uint32_t m = 0; m < numLevels; ++m)
+    {
+        std::size_t begin = align(_used);
+        std::size_t offset = _region * _regionSize + begin;
+        std::memcpy(_mapped + offset, levels[m], sizes[m]);
+        _used = begin + sizes[m];
+        size += sizes[m];
+
+        _batch.uploads.push_back(Upload{ image, layer, m, offset });
+    }
+
+    _batch.staging = _staging;
+
+    _bytes += size;
+    _copy += std::chrono::steady_clock::now() - locked;
+    return true;
+}
+
+bool
+StreamingUploader::fits(std::size_t size, uint32_t numLevels) const
+{
+    // worst case, each level pads up to the alignment
+    return size + (std::size_t)numLevels * (staging_alignment - 1) <= bytesPerFrame;
+}
+
+void
+StreamingUploader::update(Runtime& runtime)
+{
+    std::scoped_lock lock(_mutex);
+
+    _lastBytes = _bytes;
+    _lastLockWait = std::chrono::duration_cast<std::chrono::microseconds>(_lockWait);
+    _lastCopy = std::chrono::duration_cast<std::chrono::microseconds>(_copy);
+    _bytes = 0u;
+    _lockWait = { };
+    _copy = { };
+
+    ROCKY_PROFILING_PLOT("Upload bytes", (int64_t)_lastBytes);
+    ROCKY_PROFILING_PLOT("Upload lock wait microseconds", (int64_t)_lastLockWait.count());
+    ROCKY_PROFILING_PLOT("Upload copy microseconds", (int64_t)_lastCopy.count());
+
+    if (!runtime.viewer || runtime.viewer->windows().empty())
+        return;
+
+    auto& window = runtime.viewer->windows().front();
+    auto device = window->getDevice();
+    if (!device || window->numFrames() == 0)
+        return;
+
+    // One region per frame in flight, plus the one being filled. The
+    // viewer waits for a frame's fence before reusing its slot, so by the
+    // time a region comes around again, the GPU has copied out of it.
+    unsigned regions = (unsigned)window->numFrames() + 1u;
+
+    if (_staging && _regions == regions && _regionSize == bytesPerFrame)
+        return;
+
+    // don't pull the rug out from under data that's waiting to go
+    if (!_batch.uploads.empty())
+        return;
+
+    VkDeviceSize size = (VkDeviceSize)regions * bytesPerFrame;
+
+    auto staging = vsg::createBufferAndMemory(
+        device,
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_SHARING_MODE_EXCLUSIVE,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    void* mapped = nullptr;
+    auto memory = staging ? staging->getDeviceMemory(device->deviceID) : nullptr;
+    if (!memory || memory->map(staging->getMemoryOffset(device->deviceID), size, 0, &mapped) != VK_SUCCESS)
+    {
+        Log()->warn(LC "Unable to allocate " + std::to_string(size) + " bytes of staging memory");
+        return;
+    }
+
+    // stays mapped for good
+    runtime.dispose(_staging);
+    _staging = staging;
+    _mapped = reinterpret_cast<std::uint8_t*>(mapped);
+    _regions = regions;
+    _regionSize = bytesPerFrame;
+    _region = 0u;
+    _used = 0u;
+}
+
+void
+StreamingUploader::record(vsg::CommandBuffer& commandBuffer) const
+{
+    Batch batch;
+    {
+        std::scoped_lock lock(_mutex);
+
+        if (_batch.empty())
+            return;
+
+        std::swap(batch, _batch);
+
+        // the next frame fills the next region
+        if (_regions > 0u)
+            _region = (_region + 1u) % _regions;
+        _used = 0u;
+    }
+
+    auto deviceID = commandBuffer.deviceID;
+
+    // An image the compiler hasn't seen yet has nothing to write to;
+    // that only happens if its owner forgot to compile it.
+    auto ready = [deviceID](const vsg::ref_ptr<vsg::Image>& image) {
+        return image->vk(deviceID) != VK_NULL_HANDLE;
+    };
+
+    // Each destination goes to TRANSFER_DST for the duration, from
+    // UNDEFINED if new or from SHADER_READ_ONLY otherwise; sources of
+    // copies go to TRANSFER_SRC. All return to SHADER_READ_ONLY after.
+    std::vector<const vsg::Image*> touched;
+    std::vector<VkImageMemoryBarrier> before, after;
+
+    auto destination = [&](const vsg::ref_ptr<vsg::Image>& image, bool fresh)
+    {
+        if (std::find(touched.begin(), touched.end(), image.get()) != touched.end())
+            return;
+        touched.push_back(image.get());
+
+        auto vk = image->vk(deviceID);
+        before.push_back(barrier(vk,
+            fresh ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            fresh ? 0 : VK_ACCESS_SHADER_READ_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT));
+        after.push_back(barrier(vk,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_SHADER_READ_BIT));
+    };
+
+    for (auto& image : batch.fresh)
+        if (ready(image))
+            destination(image, true);
+
+    for (auto& copy : batch.copies)
+    {
+        if (ready(copy.source) && ready(copy.destination))
+        {
+            auto vk = copy.source->vk(deviceID);
+            before.push_back(barrier(vk,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT));
+            after.push_back(barrier(vk,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                0,
+                VK_ACCESS_SHADER_READ_BIT));
+        }
+    }
+
+    for (auto& upload : batch.uploads)
+        if (ready(upload.image))
+            destination(upload.image, false);
+
+    if (before.empty())
+        return;
+
+    const VkPipelineStageFlags shaders = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+        shaders, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr,
+        (uint32_t)before.size(), before.data());
+
+    for (auto& copy : batch.copies)
+    {
+        if (ready(copy.source) && ready(copy.destination))
+        {
+            std::vector<VkImageCopy> regions;
+            uint32_t levels = std::min(copy.source->mipLevels, copy.destination->mipLevels);
+            for (uint32_t m = 0; m < levels; ++m)
+            {
+                VkImageCopy region = {};
+                region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, m, 0, copy.layers };
+                region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, m, 0, copy.layers };
+                region.extent = mipExtent(copy.source->extent, m);
+                regions.push_back(region);
+            }
+
+            vkCmdCopyImage(commandBuffer,
+                copy.source->vk(deviceID), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                copy.destination->vk(deviceID), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                (uint32_t)regions.size(), regions.data());
+        }
+    }
+
+    if (batch.staging)
+    {
+        auto staging = batch.staging->vk(deviceID);
+
+        for (auto& upload : batch.uploads)
+        {
+            if (ready(upload.image))
+            {
+                VkBufferImageCopy region = {};
+                region.bufferOffset = upload.offset;
+                region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, upload.mipLevel, upload.layer, 1 };
+                region.imageExtent = mipExtent(upload.image->extent, upload.mipLevel);
+
+                vkCmdCopyBufferToImage(commandBuffer,
+                    staging,
+                    upload.image->vk(deviceID), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &region);
+            }
+        }
+    }
+
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, shaders, 0,
+        0, nullptr, 0, nullptr,
+        (uint32_t)after.size(), after.data());
+}
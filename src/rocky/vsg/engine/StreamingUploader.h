@@ -0,0 +1,140 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/vsg/Common.h>
+#include <vsg/commands/Command.h>
+#include <vsg/state/Buffer.h>
+#include <vsg/state/Image.h>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace ROCKY_NAMESPACE
+{
+    class Runtime;
+
+    /**
+     * Streams image data to the GPU through one persistent staging buffer,
+     * under a budget of bytes per frame.
+     *
+     * The staging buffer is a ring with one region per frame in flight, plus
+     * the region being filled. Data staged during the update goes into the
+     * current region; the uploader then records the copies ahead of the
+     * render passes, so the data is ready for the frame that staged it, and
+     * the region comes around again once the GPU is done with it.
+     *
+     * Target images are device-local with no CPU data of their own. The
+     * uploader owns their layouts and leaves them ready for sampling
+     * (SHADER_READ_ONLY_OPTIMAL) outside its copies.
+     *
+     * Record it in each command graph, ahead of the render graphs;
+     * DisplayManager does this for every window. It records its copies
+     * once per frame, in whichever command graph comes first. The copies
+     * therefore run on the graphics queue, not a dedicated transfer queue.
+     *
+     * Only the terrain tile atlas streams through the uploader. Tiles that
+     * render on their own, and everything else, still upload their data
+     * when compiled (see Runtime::compile), outside its budget.
+     */
+    class ROCKY_EXPORT StreamingUploader : public vsg::Inherit<vsg::Command, StreamingUploader>
+    {
+    public:
+        //! Most bytes to stage in a frame. A change takes effect
+        //! once the staged data goes out.
+        std::size_t bytesPerFrame = 8u * 1024u * 1024u;
+
+        //! Readies a new image for sampling. Call in the frame that
+        //! first uses the image, unless it's the destination of a copy.
+        void initialize(vsg::ref_ptr<vsg::Image> image);
+
+        //! Copies the first layers of one image, all mipmap levels, to a new
+        //! image on the GPU, e.g. to carry over the contents of a texture array that grew.
+        void copy(vsg::ref_ptr<vsg::Image> source, vsg::ref_ptr<vsg::Image> destination, uint32_t layers);
+
+        //! Stages the data of one layer of an image, first mipmap level only.
+        //! @return False if the frame's budget is spent or the staging buffer
+        //!    doesn't exist yet; try again in the next frame
+        bool upload(const void* data, std::size_t size, vsg::ref_ptr<vsg::Image> image, uint32_t layer);
+
+        //! Stages the data of one layer of an image, one pointer and size per
+        //! mipmap level from the first; the levels go in the same frame or not at all.
+        //! @return False if the frame's budget is spent or the staging buffer
+        //!    doesn't exist yet; try again in the next frame
+        bool upload(const void* const* levels, const std::size_t* sizes, uint32_t numLevels, vsg::ref_ptr<vsg::Image> image, uint32_t layer);
+
+        //! Whether an upload of some size, in some number of mipmap
+        //! levels, could ever fit in a frame
+        bool fits(std::size_t size, uint32_t numLevels = 1u) const;
+
+        //! Bytes staged in the last frame
+        std::size_t bytesUploaded() const {
+            return _lastBytes;
+        }
+
+        //! Time upload() spent waiting for the uploader's lock in the last frame
+        std::chrono::microseconds lockWaitTime() const {
+            return _lastLockWait;
+        }
+
+        //! Time upload() spent copying data into the staging buffer in the last frame
+        std::chrono::microseconds copyTime() const {
+            return _lastCopy;
+        }
+
+        //! Publishes the frame's metrics and (re)allocates the staging
+        //! buffer as needed. Runtime::update calls this once per frame.
+        void update(Runtime& runtime);
+
+        void record(vsg::CommandBuffer& commandBuffer) const override;
+
+    private:
+        struct Upload
+        {
+            vsg::ref_ptr<vsg::Image> image;
+            uint32_t layer;
+            uint32_t mipLevel;
+            VkDeviceSize offset; // in the staging buffer
+        };
+
+        struct Copy
+        {
+            vsg::ref_ptr<vsg::Image> source;
+            vsg::ref_ptr<vsg::Image> destination;
+            uint32_t layers;
+        };
+
+        // everything to record in one frame
+        struct Batch
+        {
+            vsg::ref_ptr<vsg::Buffer> staging;
+            std::vector<vsg::ref_ptr<vsg::Image>> fresh;
+            std::vector<Copy> copies;
+            std::vector<Upload> uploads;
+
+            bool empty() const {
+                return fresh.empty() && copies.empty() && uploads.empty();
+            }
+        };
+
+        mutable std::mutex _mutex;
+        vsg::ref_ptr<vsg::Buffer> _staging;
+        std::uint8_t* _mapped = nullptr;
+        std::size_t _regionSize = 0u;
+        unsigned _regions = 0u;
+        mutable unsigned _region = 0u; // region being filled
+        mutable std::size_t _used = 0u; // bytes filled in that region
+        mutable Batch _batch;
+
+        std::size_t _bytes = 0u;
+        std::chrono::steady_clock::duration _lockWait = { };
+        std::chrono::steady_clock::duration _copy = { };
+        std::size_t _lastBytes = 0u;
+        std::chrono::microseconds _lastLockWait = { };
+        std::chrono::microseconds _lastCopy = { };
+    };
+}
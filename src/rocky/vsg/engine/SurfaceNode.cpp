@@ -22,6 +22,24 @@ using namespace ROCKY_NAMESPACE;
 // uncomment to draw each tile's tight bounding box
 //#define RENDER_TILE_BBOX
 
+namespace
+{
+    // Bounds the surface over vertices within one box, with normals within another,
+    // raised along their normals by any height in [hmin, hmax].
+    vsg::dbox extrude(const vsg::dbox& verts, const vsg::dbox& normals, double hmin, double hmax)
+    {
+        vsg::dbox result;
+        for (int i = 0; i < 3; ++i)
+        {
+            double a = normals.min[i] * hmin, b = normals.min[i] * hmax;
+            double c = normals.max[i] * hmin, d = normals.max[i] * hmax;
+            result.min[i] = verts.min[i] + std::min(std::min(a, b), std::min(c, d));
+            result.max[i] = verts.max[i] + std::max(std::max(a, b), std::max(c, d));
+        }
+        return result;
+    }
+}
+
 //..............................................................
 
 
@@ -37,20 +55,41 @@ SurfaceNode::SurfaceNode(const TileKey& tilekey, const SRS& worldSRS, Runtime& r
     glm::dmat4 local2world = worldSRS.localToWorldMatrix(glm::dvec3(centroid.x, centroid.y, centroid.z));
 
     this->matrix = to_vsg(local2world);
+
+    _geocentric = worldSRS.isGeocentric();
+    if (_geocentric)
+        _ellipsoid = worldSRS.ellipsoid();
 }
 
 void
-SurfaceNode::setElevation(shared_ptr<Image> raster, const glm::dmat4& scaleBias)
+SurfaceNode::setElevation(shared_ptr<Image> raster, const glm::dmat4& scaleBias, shared_ptr<HeightfieldPyramid> pyramid)
 {
     _elevationRaster = raster;
     _elevationMatrix = scaleBias;
+    _elevationPyramid = pyramid;
+
+    if (raster && !pyramid)
+    {
+        if (auto heightfield = Heightfield::cast_from(raster.get()))
+            _elevationPyramid = std::make_shared<HeightfieldPyramid>(heightfield);
+    }
+
     _boundsDirty = true;
 }
 
-#define corner(N) vsg::dvec3( \
-    (N & 0x1) ? _localbbox.max.x : _localbbox.min.x, \
-    (N & 0x2) ? _localbbox.max.y : _localbbox.min.y, \
-    (N & 0x4) ? _localbbox.max.z : _localbbox.min.z)
+double
+SurfaceNode::distanceToSubtiles(vsg::State* state, const vsg::dvec3& eyeOffset) const
+{
+    // the eye in world coordinates
+    auto eye = vsg::inverse(state->modelviewMatrixStack.top()) * vsg::dvec3(0, 0, 0) + eyeOffset;
+
+    return TerrainTilePolicy::distanceToSubtiles(_bounds, to_glm(eye));
+}
+
+#define corner(BOX, N) vsg::dvec3( \
+    (N & 0x1) ? BOX.max.x : BOX.min.x, \
+    (N & 0x2) ? BOX.max.y : BOX.min.y, \
+    (N & 0x4) ? BOX.max.z : BOX.min.z)
 
 void
 SurfaceNode::recomputeBound()
@@ -69,24 +108,14 @@ SurfaceNode::recomputeBound()
 
     // locate the geometry
     auto geom = static_cast<vsg::Group*>(children.front().get())->children.front()->cast<SharedGeometry>();
-    ROCKY_SOFT_ASSERT_AND_RETURN(geom, void());
-
-    auto verts = geom->proxy_verts;
-    auto normals = geom->proxy_normals;
-    auto uvs = geom->proxy_uvs;
-    
-    ROCKY_SOFT_ASSERT_AND_RETURN(verts && normals && uvs, void());
+    ROCKY_SOFT_ASSERT_AND_RETURN(geom && geom->proxy_vertBounds[0].valid(), void());
 
-    if (_proxyMesh.size() < verts->size())
-    {
-        _proxyMesh.resize(verts->size());
-    }
+    // height range under each quadrant
+    float minHeight[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float maxHeight[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
-    if (_elevationRaster)
+    if (_elevationPyramid)
     {
-        // yes, this is safe...for now :)
-        auto heightfield = Heightfield::cast_from(_elevationRaster.get());
-
         double
             scaleU = _elevationMatrix[0][0],
             scaleV = _elevationMatrix[1][1],
@@ -95,36 +124,30 @@ SurfaceNode::recomputeBound()
 
         ROCKY_SOFT_ASSERT_AND_RETURN(!equiv(scaleU, 0.0) && !equiv(scaleV, 0.0), void());
 
-        for (int i = 0; i < verts->size(); ++i)
+        for (unsigned q = 0; q < 4; ++q)
         {
-            if (((int)uvs->at(i).z & VERTEX_HAS_ELEVATION) == 0)
-            {
-                float h = heightfield->heightAtUV(
-                    clamp(uvs->at(i).x * scaleU + biasU, 0.0, 1.0),
-                    clamp(uvs->at(i).y * scaleV + biasV, 0.0, 1.0),
-                    Heightfield::NEAREST);
-
-                auto& v = verts->at(i);
-                auto& n = normals->at(i);
-                _proxyMesh[i] = v + n * h;
-            }
-            else
+            // same layout as the child keys (see TileKey::createChildKey)
+            double u0 = (q & 1) ? 0.5 : 0.0, v0 = (q < 2) ? 0.5 : 0.0;
+
+            if (!_elevationPyramid->heightRange(
+                u0 * scaleU + biasU, v0 * scaleV + biasV,
+                (u0 + 0.5) * scaleU + biasU, (v0 + 0.5) * scaleV + biasV,
+                minHeight[q], maxHeight[q]))
             {
-                _proxyMesh[i] = (*verts)[i];
+                minHeight[q] = maxHeight[q] = 0.0f;
             }
         }
     }
 
-    else
+    // a box for each child, and the tile's box around all four.
+    for (unsigned q = 0; q < 4; ++q)
     {
-        // no elevation? just copy the verts into the proxy
-        std::copy(verts->begin(), verts->end(), _proxyMesh.begin());
-    }
+        _childLocalbbox[q] = extrude(
+            geom->proxy_vertBounds[q],
+            geom->proxy_normalBounds[q],
+            minHeight[q], maxHeight[q]);
 
-    // build the bbox around the mesh.
-    for (auto& vert : _proxyMesh)
-    {
-        _localbbox.add(vert);
+        _localbbox.add(_childLocalbbox[q]);
     }
 
     auto& m = this->matrix;
@@ -134,37 +157,26 @@ SurfaceNode::recomputeBound()
     double radius = 0.5 * vsg::length(_localbbox.max - _localbbox.min);
     worldBoundingSphere.set(center, radius);
 
-    // Compute the medians of each potential child node:
-    // Top points go first since these are the most likely to be visible
-    // during the isVisible check.
-    _worldPoints = {
-
-        // top:
-        m * corner(4),
-        m * corner(5),
-        m * corner(6),
-        m * corner(7),
-
-        // bottom:
-        m * corner(0),
-        m * corner(1),
-        m * corner(2),
-        m * corner(3),
-
-        // top midpoints
-        m * ((corner(4) + corner(5)) * 0.5),
-        m * ((corner(5) + corner(7)) * 0.5),
-        m * ((corner(7) + corner(6)) * 0.5),
-        m * ((corner(4) + corner(6)) * 0.5),
-        m * ((corner(4) + corner(7)) * 0.5),
-
-        // bottom midpoints
-        m * ((corner(0) + corner(1)) * 0.5),
-        m * ((corner(1) + corner(3)) * 0.5),
-        m * ((corner(3) + corner(2)) * 0.5),
-        m * ((corner(0) + corner(2)) * 0.5),
-        m * ((corner(0) + corner(3)) * 0.5)
-    };
+    // World space corners of each box. Top corners go first since these
+    // are the most likely to be visible during the isVisible check.
+    const vsg::dbox* boxes[5] = { &_localbbox,
+        &_childLocalbbox[0], &_childLocalbbox[1], &_childLocalbbox[2], &_childLocalbbox[3] };
+
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        auto& box = *boxes[b];
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            _bounds.corners[b][i] = to_glm(m * corner(box, (4 + i)));
+            _bounds.corners[b][4 + i] = to_glm(m * corner(box, i));
+        }
+
+        if (_geocentric)
+        {
+            _bounds.hasOcclusionPoint[b] = Horizon::computeOcclusionPoint(
+                _ellipsoid, _bounds.corners[b], 8, _bounds.occlusionPoints[b]);
+        }
+    }
 
     // Adjust the horizon ellipsoid based on the minimum Z value of the tile;
     // necessary because a tile that's below the ellipsoid (ocean floor, e.g.)
@@ -10,7 +10,9 @@
 #include <rocky/SRS.h>
 #include <rocky/TileKey.h>
 #include <rocky/Horizon.h>
+#include <rocky/HeightfieldPyramid.h>
 #include <rocky/vsg/engine/Utils.h>
+#include <rocky/vsg/engine/TerrainTilePolicy.h>
 #include <vsg/nodes/MatrixTransform.h>
 #include <vsg/vk/State.h>
 #include <vsg/maths/vec3.h>
@@ -33,9 +35,14 @@ namespace ROCKY_NAMESPACE
             Runtime& runtime);
 
         //! Update the elevation raster associated with this tile
+        //! @param raster Heightfield image
+        //! @param scaleBias Maps the tile's (u,v) into the raster
+        //! @param pyramid Min/max pyramid of the raster, for the bounds;
+        //!    built here if empty
         void setElevation(
             shared_ptr<Image> raster,
-            const glm::dmat4& scaleBias);
+            const glm::dmat4& scaleBias,
+            shared_ptr<HeightfieldPyramid> pyramid = nullptr);
 
         //! Elevation raster representing this surface
         shared_ptr<Image> getElevationRaster() const {
@@ -49,7 +56,8 @@ namespace ROCKY_NAMESPACE
         
         //! World-space visibility check (includes bounding box
         //! and horizon checks)
-        inline bool isVisible(vsg::State* state) const;
+        //! @param horizonCulling Whether to cull tiles behind the horizon
+        inline bool isVisible(vsg::State* state, bool horizonCulling = true) const;
      
 #if 0
         // A box can have 4 children. 
@@ -65,14 +73,9 @@ namespace ROCKY_NAMESPACE
         }
 #endif
 
-        bool anyChildBoxWithinRange(float range, vsg::State* state) const
-        {
-            for (unsigned i = 0u; i < 18u; ++i) {
-                if (distanceTo(_worldPoints[i], state) <= range)
-                    return true;
-            }
-            return false;
-        }
+        //! Distance from the eye to the nearest of the boxes of the tile's four children
+        //! @param eyeOffset Moves the eye by this much (world coordinates) for the test
+        double distanceToSubtiles(vsg::State* state, const vsg::dvec3& eyeOffset = { 0, 0, 0 }) const;
 
         void recomputeBound();
 
@@ -86,48 +89,38 @@ namespace ROCKY_NAMESPACE
         int _lastFramePassedCull;
         shared_ptr<Image> _elevationRaster;
         glm::dmat4 _elevationMatrix;
-        std::vector<vsg::dvec3> _worldPoints;
+        shared_ptr<HeightfieldPyramid> _elevationPyramid;
         vsg::dbox _localbbox;
+        vsg::dbox _childLocalbbox[4];
         bool _boundsDirty;
         Runtime& _runtime;
-        std::vector<vsg::vec3> _proxyMesh;
+
+        // world space boxes of the tile and of its children, with their
+        // horizon occlusion points (geocentric maps only)
+        TerrainTilePolicy::Bounds _bounds;
+        Ellipsoid _ellipsoid;
+        bool _geocentric;
     };
 
 
-    bool SurfaceNode::isVisible(vsg::State* state) const
+    bool SurfaceNode::isVisible(vsg::State* state, bool horizonCulling) const
     {
-        // bounding box visibility check; this is much tighter than the bounding
-        // sphere. _frustumStack.top() contains the frustum in world coordinates.
+        // _frustumStack.top() contains the frustum in world coordinates.
         // https://github.com/vsg-dev/VulkanSceneGraph/blob/master/include/vsg/vk/State.h#L267
-        // The first 8 points in _worldPoints are the 8 corners of the bounding box
-        // in world coordinates.
         // Note: POLYTOPE_SIZE is defined in vsg plane.h
         auto& frustum = state->_frustumStack.top();
-        int p;
-        for (int f = 0; f < POLYTOPE_SIZE; ++f) {
-            for (p = 0; p < 8; ++p)
-                if (vsg::distance(frustum.face[f], _worldPoints[p]) > 0.0) // visible?
-                    break;
-            if (p == 8)
-                return false;
+
+        glm::dvec4 planes[POLYTOPE_SIZE];
+        for (int f = 0; f < POLYTOPE_SIZE; ++f)
+        {
+            auto& face = frustum.face[f];
+            planes[f] = glm::dvec4(face.n.x, face.n.y, face.n.z, face.p);
         }
 
-        // still good? check against the horizon.
         shared_ptr<Horizon> horizon;
-        if (state->getValue("horizon", horizon))
-        {
-            for (p = 0; p < 4; ++p)
-            {
-                auto& wp = _worldPoints[p];
-                if (horizon->isVisible(wp.x, wp.y, wp.z))
-                    return true;
-            }
+        if (horizonCulling)
+            state->getValue("horizon", horizon);
 
-            return false;
-        }
-        else
-        {
-            return true;
-        }
+        return TerrainTilePolicy::isVisible(_bounds, planes, POLYTOPE_SIZE, horizon.get());
     }
 }
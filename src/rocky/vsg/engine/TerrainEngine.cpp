@@ -27,8 +27,13 @@ TerrainEngine::TerrainEngine(
     settings(new_settings),
     geometryPool(worldSRS),
     tiles(new_map->profile(), new_settings, host),
-    stateFactory(new_runtime)
+    stateFactory(new_runtime, new_settings)
 {
     auto total_threads = std::thread::hardware_concurrency();
     jobs::get_pool(loadSchedulerName)->set_concurrency(total_threads/2);
+
+    if (settings.textureCompression != "none")
+    {
+        jobs::get_pool(compressSchedulerName)->set_concurrency(std::max(total_threads/4, 1u));
+    }
 }
@@ -54,5 +54,8 @@ namespace ROCKY_NAMESPACE
 
         //! name of job arena used to load data
         std::string loadSchedulerName = "terrain.load";
+
+        //! name of job arena used to block-compress textures
+        std::string compressSchedulerName = "terrain.compress";
     };
 }
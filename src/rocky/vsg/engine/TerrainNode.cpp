@@ -5,8 +5,11 @@
  */
 #include "TerrainNode.h"
 #include "TerrainTileNode.h"
+#include "TerrainTileAtlas.h"
 #include "TerrainEngine.h"
+#include "Utils.h"
 #include <rocky/IOTypes.h>
+#include <rocky/Metrics.h>
 #include <rocky/Map.h>
 #include <rocky/TileKey.h>
 
@@ -64,6 +67,22 @@ TerrainNode::createRootTiles(const IOOptions& io)
     // remove everything and start over
     this->children.clear();
 
+    // Normalized edges still crack where a tile draws in place of its subtiles,
+    // or by the quantization error of r16 elevation, so keep a minimal skirt.
+    if (normalizeEdges.value())
+    {
+        if (elevationEncoding.value() == "r16")
+        {
+            Log()->warn("Normalized edges with r16 elevation still differ by the quantization error; keeping skirts");
+        }
+
+        if (skirtRatio.value() < minNormalizedSkirtRatio)
+        {
+            Log()->info("Raising the skirt ratio to " + std::to_string(minNormalizedSkirtRatio) + " to cover the edges normalization misses");
+            skirtRatio = minNormalizedSkirtRatio;
+        }
+    }
+
     // create a new context for this map
     engine = std::make_shared<TerrainEngine>(
         map,
@@ -85,6 +104,18 @@ TerrainNode::createRootTiles(const IOOptions& io)
     stateGroup->addChild(_tilesRoot);
     this->addChild(stateGroup);
 
+    // tiles in the atlas queue up while the tiles record,
+    // then draw together under their own pipeline.
+    if (engine->stateFactory.atlas)
+    {
+        auto instancedStateGroup = engine->stateFactory.createInstancedStateGroup();
+        if (instancedStateGroup)
+        {
+            this->addChild(instancedStateGroup);
+            engine->runtime.compile(instancedStateGroup);
+        }
+    }
+
     // once the pipeline exists, we can start creating tiles.
     std::vector<TileKey> keys;
     Profile::getAllKeysAtLOD(this->minLevelOfDetail, engine->map->profile(), keys);
@@ -125,7 +156,42 @@ TerrainNode::update(const vsg::FrameStamp* fs, const IOOptions& io)
             engine->tiles.update(fs, io, engine);
             engine->geometryPool.sweep(engine->runtime);
         }
+
+        if (engine->stateFactory.atlas)
+            engine->stateFactory.atlas->update(engine->runtime);
     }
+
+    _recordTime = std::chrono::microseconds(_recordingTime.exchange(0));
+    ROCKY_PROFILING_PLOT("Terrain record microseconds", (int64_t)_recordTime.count());
+
+    _trianglesDrawn = _trianglesRecording.exchange(0);
+    ROCKY_PROFILING_PLOT("Terrain triangles", (int64_t)_trianglesDrawn);
+}
+
+void
+TerrainNode::accept(vsg::RecordTraversal& rv) const
+{
+    auto start = std::chrono::steady_clock::now();
+
+    if (engine && prefetchSeconds.value() > 0.0f)
+    {
+        // eye point in the terrain's own (world) coordinates
+        auto eye = vsg::inverse(rv.getState()->modelviewMatrixStack.top()) * vsg::dvec3(0, 0, 0);
+
+        // keep predictions within half the eye's height, since a camera
+        // closing in on the ground slows down rather than going through it
+        double altitude = _worldSRS.isGeocentric() ?
+            _worldSRS.ellipsoid().geocentricToGeodetic(to_glm(eye)).z :
+            eye.z;
+
+        engine->tiles.trackCamera(to_glm(eye), 0.5 * std::abs(altitude), rv);
+    }
+
+    Inherit::accept(rv);
+
+    // views may record in parallel
+    _recordingTime += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
 }
 
 void
@@ -133,3 +199,22 @@ TerrainNode::ping(TerrainTileNode* tile, const TerrainTileNode* parent, vsg::Rec
 {
     engine->tiles.ping(tile, parent, nv);
 }
+
+vsg::dvec3
+TerrainNode::predictedMotion(vsg::RecordTraversal& rv)
+{
+    return to_vsg(engine->tiles.predictedMotion(rv));
+}
+
+bool
+TerrainNode::drawInstanced(const TerrainTileNode* tile, vsg::RecordTraversal& rv)
+{
+    auto& atlas = engine->stateFactory.atlas;
+    return atlas && atlas->enqueue(tile, rv);
+}
+
+void
+TerrainNode::drawn(const TerrainTileNode* tile, vsg::RecordTraversal& rv)
+{
+    _trianglesRecording += tile->numTriangles;
+}
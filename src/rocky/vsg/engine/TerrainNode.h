@@ -11,6 +11,8 @@
 #include <rocky/Status.h>
 #include <rocky/SRS.h>
 #include <vsg/nodes/Group.h>
+#include <atomic>
+#include <chrono>
 
 namespace ROCKY_NAMESPACE
 {
@@ -41,6 +43,19 @@ namespace ROCKY_NAMESPACE
         //! Updates the terrain periodically at a safe time
         void update(const vsg::FrameStamp*, const IOOptions& io);
 
+        //! Tracks the camera, then records the terrain
+        void accept(vsg::RecordTraversal&) const override;
+
+        //! Time spent recording the terrain in the last frame, all views combined
+        std::chrono::microseconds recordTime() const {
+            return _recordTime;
+        }
+
+        //! Terrain triangles drawn in the last frame, all views combined
+        std::uint64_t trianglesDrawn() const {
+            return _trianglesDrawn;
+        }
+
         //! Status of this node; check that's it OK before using
         Status status;
 
@@ -63,6 +78,15 @@ namespace ROCKY_NAMESPACE
             return *this;
         }
 
+        //! TerrainTileHost interface
+        vsg::dvec3 predictedMotion(vsg::RecordTraversal&) override;
+
+        //! TerrainTileHost interface
+        bool drawInstanced(const TerrainTileNode* tile, vsg::RecordTraversal&) override;
+
+        //! TerrainTileHost interface
+        void drawn(const TerrainTileNode* tile, vsg::RecordTraversal&) override;
+
     private:
 
         //! Deserialize and initialize
@@ -73,5 +97,9 @@ namespace ROCKY_NAMESPACE
         Runtime& _runtime;
         vsg::ref_ptr<vsg::Group> _tilesRoot;
         SRS _worldSRS;
+        mutable std::atomic<std::int64_t> _recordingTime = { 0 }; // microseconds, this frame so far
+        std::chrono::microseconds _recordTime = { };
+        mutable std::atomic<std::uint64_t> _trianglesRecording = { 0 }; // this frame so far
+        std::uint64_t _trianglesDrawn = 0u;
     };
 }
@@ -0,0 +1,714 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "TerrainPagingSimulator.h"
+
+#include <rocky/Heightfield.h>
+#include <rocky/Map.h>
+#include <rocky/Math.h>
+#include <rocky/TerrainTileModelFactory.h>
+#include <rocky/json.h>
+
+#include <algorithm>
+#include <chrono>
+
+using namespace ROCKY_NAMESPACE;
+
+#define LC "[TerrainPagingSimulator] "
+
+namespace
+{
+    // samples per side of the grid used to bound a quadrant of a tile's surface
+    constexpr unsigned bounds_samples = 5;
+
+    // closest distance to the eye at which terrain is drawn
+    constexpr double near_plane = 1.0;
+
+    inline glm::dvec4 makePlane(const glm::dvec3& normal, const glm::dvec3& point)
+    {
+        auto n = glm::normalize(normal);
+        return glm::dvec4(n, -glm::dot(n, point));
+    }
+}
+
+TerrainPagingSimulator::TerrainPagingSimulator(shared_ptr<Map> map, const TerrainSettings& settings) :
+    _map(map),
+    _settings(settings)
+{
+    ROCKY_HARD_ASSERT(_map != nullptr);
+
+    // same choice of world SRS as the MapNode
+    auto& profile = _map->profile();
+    _worldSRS = profile.srs().isGeodetic() ? SRS::ECEF : profile.srs();
+    _profileToWorld = profile.srs().to(_worldSRS);
+    _geoToWorld = SRS::WGS84.to(_worldSRS);
+
+    _useHorizon = _worldSRS.isGeocentric();
+    if (_useHorizon)
+        _horizon.setEllipsoid(_worldSRS.ellipsoid());
+
+    reset();
+}
+
+void
+TerrainPagingSimulator::reset()
+{
+    _tiles.clear();
+    _tracker.reset();
+    _roots.clear();
+    _loadSubtiles.clear();
+    _unloadSubtiles.clear();
+    _loadData.clear();
+    _mergeData.clear();
+    _loading.clear();
+    _merging.clear();
+    _creating.clear();
+    _predictor.reset();
+    _predictedMotion = { 0, 0, 0 };
+    _frameCount = 0;
+
+    _morphRanges.clear();
+    for (unsigned lod = 0; lod <= _settings.maxLevelOfDetail + 1u; ++lod)
+        _morphRanges.push_back(TerrainTilePolicy::computeMorphRange(_map->profile(), lod));
+
+    std::vector<TileKey> keys;
+    Profile::getAllKeysAtLOD(_settings.minLevelOfDetail, _map->profile(), keys);
+
+    for (auto& key : keys)
+    {
+        auto tile = createTile(key, nullptr);
+        tile->doNotExpire = true;
+        _roots.push_back(tile);
+    }
+}
+
+TerrainPagingSimulator::TilePtr
+TerrainPagingSimulator::createTile(const TileKey& key, const Tile* parent) const
+{
+    auto tile = std::make_shared<Tile>();
+    tile->key = key;
+
+    // inherit the parent's elevation and textures, as TerrainTileNode::inheritFrom does
+    if (parent)
+    {
+        auto& w = parent->window;
+        double du = 0.5 * (w[2] - w[0]), dv = 0.5 * (w[3] - w[1]);
+        unsigned q = key.getQuadrant();
+        double u0 = w[0] + ((q & 1) ? du : 0.0), v0 = w[1] + ((q < 2) ? dv : 0.0);
+
+        tile->pyramid = parent->pyramid;
+        tile->window = glm::dvec4(u0, v0, u0 + du, v0 + dv);
+        for (unsigned i = 0; i < 3; ++i)
+            tile->textureBytes[i] = parent->textureBytes[i];
+    }
+    tile->residentBytes = tile->textureBytes[0] + tile->textureBytes[1] + tile->textureBytes[2];
+
+    computeBounds(*tile);
+    return tile;
+}
+
+void
+TerrainPagingSimulator::computeBounds(Tile& tile) const
+{
+    // Bound each quadrant of the tile in a local frame at its centroid, over the
+    // height range the pyramid gives for it, and the tile around all four; then
+    // take the same corners from those boxes that SurfaceNode uses for culling.
+    auto& ex = tile.key.extent();
+
+    GeoPoint centroid = ex.centroid();
+    centroid.transformInPlace(_worldSRS);
+    glm::dmat4 local2world = _worldSRS.localToWorldMatrix(glm::dvec3(centroid.x, centroid.y, centroid.z));
+    glm::dmat4 world2local = glm::inverse(local2world);
+
+    glm::dvec3 lmin[5], lmax[5];
+    lmin[0] = glm::dvec3(DBL_MAX), lmax[0] = glm::dvec3(-DBL_MAX);
+
+    for (unsigned q = 0; q < 4; ++q)
+    {
+        double s0 = (q & 1) ? 0.5 : 0.0, t0 = (q < 2) ? 0.5 : 0.0;
+
+        float minHeight = 0.0f, maxHeight = 0.0f;
+        if (tile.pyramid)
+        {
+            auto& w = tile.window;
+            double du = w[2] - w[0], dv = w[3] - w[1];
+            if (!tile.pyramid->heightRange(
+                w[0] + s0 * du, w[1] + t0 * dv, w[0] + (s0 + 0.5) * du, w[1] + (t0 + 0.5) * dv,
+                minHeight, maxHeight))
+            {
+                minHeight = maxHeight = 0.0f;
+            }
+        }
+
+        std::vector<glm::dvec3> grid;
+        grid.reserve(bounds_samples * bounds_samples * 2);
+        for (auto h : { (double)minHeight, (double)maxHeight })
+        {
+            for (unsigned r = 0; r < bounds_samples; ++r)
+            {
+                for (unsigned c = 0; c < bounds_samples; ++c)
+                {
+                    grid.emplace_back(
+                        ex.xMin() + ex.width() * (s0 + 0.5 * (double)c / (double)(bounds_samples - 1)),
+                        ex.yMin() + ex.height() * (t0 + 0.5 * (double)r / (double)(bounds_samples - 1)),
+                        h);
+                }
+            }
+        }
+        _profileToWorld.transformArray(grid.data(), grid.size());
+
+        lmin[1 + q] = glm::dvec3(DBL_MAX), lmax[1 + q] = glm::dvec3(-DBL_MAX);
+        for (auto& p : grid)
+        {
+            glm::dvec3 local(world2local * glm::dvec4(p, 1.0));
+            lmin[1 + q] = glm::min(lmin[1 + q], local);
+            lmax[1 + q] = glm::max(lmax[1 + q], local);
+        }
+
+        lmin[0] = glm::min(lmin[0], lmin[1 + q]);
+        lmax[0] = glm::max(lmax[0], lmax[1 + q]);
+    }
+
+    auto world = [&](const glm::dvec3& local) {
+        return glm::dvec3(local2world * glm::dvec4(local, 1.0));
+    };
+
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        for (unsigned n = 0; n < 8; ++n)
+        {
+            glm::dvec3 corner(
+                (n & 0x1) ? lmax[b].x : lmin[b].x,
+                (n & 0x2) ? lmax[b].y : lmin[b].y,
+                (n & 0x4) ? lmax[b].z : lmin[b].z);
+
+            // tops first
+            tile.bounds.corners[b][n ^ 0x4] = world(corner);
+        }
+
+        if (_useHorizon)
+        {
+            tile.bounds.hasOcclusionPoint[b] = Horizon::computeOcclusionPoint(
+                _worldSRS.ellipsoid(), tile.bounds.corners[b], 8, tile.bounds.occlusionPoints[b]);
+        }
+    }
+
+    tile.center = world((lmin[0] + lmax[0]) * 0.5);
+    tile.radius = 0.5 * glm::length(lmax[0] - lmin[0]);
+}
+
+TerrainPagingSimulator::Camera
+TerrainPagingSimulator::makeCamera(const Waypoint& wp) const
+{
+    Camera camera;
+
+    glm::dvec3 eye;
+    _geoToWorld.transform(glm::dvec3(wp.longitude, wp.latitude, wp.altitude), eye);
+    camera.eye = eye;
+
+    // east, north and up at the eye
+    glm::dmat4 frame = _worldSRS.localToWorldMatrix(eye);
+    glm::dvec3 east = glm::normalize(glm::dvec3(frame[0]));
+    glm::dvec3 north = glm::normalize(glm::dvec3(frame[1]));
+    glm::dvec3 up = glm::normalize(glm::dvec3(frame[2]));
+
+    double h = deg2rad(wp.heading), p = deg2rad(wp.pitch);
+    camera.look = glm::normalize(east * (sin(h) * cos(p)) + north * (cos(h) * cos(p)) + up * sin(p));
+    camera.right = glm::normalize(east * cos(h) - north * sin(h));
+    camera.up = glm::cross(camera.right, camera.look);
+
+    double tanV = tan(deg2rad(0.5 * fovy));
+    double tanH = tanV * (double)viewportWidth / (double)viewportHeight;
+    camera.tanHalfFovy = tanV;
+
+    camera.planes[0] = makePlane(camera.look * tanH + camera.right, eye);
+    camera.planes[1] = makePlane(camera.look * tanH - camera.right, eye);
+    camera.planes[2] = makePlane(camera.look * tanV + camera.up, eye);
+    camera.planes[3] = makePlane(camera.look * tanV - camera.up, eye);
+    camera.planes[4] = makePlane(camera.look, eye + camera.look * near_plane);
+
+    return camera;
+}
+
+void
+TerrainPagingSimulator::accept(const TilePtr& tile_ptr, const Camera& camera, Frame& stats)
+{
+    Tile& tile = *tile_ptr;
+    ++stats.tilesTraversed;
+
+    bool new_frame = tile.lastFrame != _frameCount;
+    tile.lastFrame = _frameCount;
+
+    float range = (float)glm::length(tile.center - camera.eye);
+    tile.lastRange = new_frame ? range : std::min(tile.lastRange, range);
+
+    bool subtilesExist = tile.subtiles == Tile::Subtiles::Ready;
+    if (subtilesExist)
+        tile.subdivision.needsSubtiles = false;
+
+    const Horizon* horizon = _useHorizon && _settings.horizonCulling.value() ? &_horizon : nullptr;
+
+    if (TerrainTilePolicy::isVisible(tile.bounds, camera.planes, 5, horizon))
+    {
+        // the subdivision test, with the eye optionally moved; the view
+        // distances are scaled as vsg::State::lodDistance scales them
+        auto shouldSubdivide = [&](const glm::dvec3& eyeOffset)
+        {
+            double lodDistance = glm::dot(tile.center - eyeOffset - camera.eye, camera.look) * camera.tanHalfFovy;
+            double subtileDistance = _settings.morphTerrain.value() ?
+                TerrainTilePolicy::distanceToSubtiles(tile.bounds, camera.eye + eyeOffset) * camera.tanHalfFovy : 0.0;
+
+            return TerrainTilePolicy::shouldSubdivide(
+                _settings, tile.key.levelOfDetail(), tile.radius, lodDistance, subtileDistance,
+                (double)viewportHeight, _morphRanges[tile.key.levelOfDetail() + 1]);
+        };
+
+        bool subtilesInRange = shouldSubdivide(glm::dvec3(0, 0, 0));
+
+        bool subtilesPredicted =
+            !subtilesInRange &&
+            _settings.prefetchSeconds.value() > 0.0f &&
+            shouldSubdivide(_predictedMotion);
+
+        auto traversal = TerrainTilePolicy::subdivide(
+            tile.subdivision, subtilesInRange, subtilesPredicted, subtilesExist, tile.subtiles != Tile::Subtiles::None);
+
+        if (traversal == TerrainTilePolicy::Traversal::Subtiles)
+        {
+            for (auto& child : tile.children)
+                accept(child, camera, stats);
+        }
+        else
+        {
+            ++stats.tilesDrawn;
+            stats.maxLevelDrawn = std::max(stats.maxLevelDrawn, tile.key.levelOfDetail());
+
+            if (subtilesInRange || tile.data != TerrainTilePolicy::Data::Merged)
+                ++stats.tilesBlurry;
+        }
+
+        if (traversal != TerrainTilePolicy::Traversal::Tile)
+        {
+            for (auto& child : tile.children)
+                ping(child, &tile);
+        }
+    }
+
+    if (tile.doNotExpire)
+        ping(tile_ptr, nullptr);
+}
+
+void
+TerrainPagingSimulator::ping(const TilePtr& tile, const Tile* parent)
+{
+    auto i = _tiles.find(tile->key);
+    if (i == _tiles.end())
+    {
+        _tiles[tile->key] = tile;
+        tile->trackerToken = _tracker.use(tile.get(), nullptr);
+    }
+    else
+    {
+        _tracker.use(tile.get(), tile->trackerToken);
+    }
+
+    auto requests = TerrainTilePolicy::requests(
+        tile->data,
+        tile->subdivision,
+        parent ? parent->data : TerrainTilePolicy::Data::Merged);
+
+    if (requests.loadSubtiles)
+        _loadSubtiles.push_back(tile->key);
+
+    if (requests.loadData)
+        _loadData.push_back(tile->key);
+
+    if (requests.mergeData)
+        _mergeData.push_back(tile->key);
+
+    if (requests.unloadSubtiles)
+        _unloadSubtiles.push_back(tile->key);
+}
+
+void
+TerrainPagingSimulator::unloadSubtiles(Tile& tile)
+{
+    for (auto& child : tile.children)
+        child = nullptr;
+    tile.subtiles = Tile::Subtiles::None;
+    tile.subdivision = { };
+}
+
+void
+TerrainPagingSimulator::update(const IOOptions& io, Frame& stats)
+{
+    bool requests =
+        !_loadSubtiles.empty() || !_unloadSubtiles.empty() ||
+        !_loadData.empty() || !_mergeData.empty();
+
+    auto priority = [](const std::weak_ptr<Tile>& weak)
+    {
+        auto tile = weak.lock();
+        return tile ? TerrainTilePolicy::priority(tile->lastRange, tile->key.levelOfDetail()) : -FLT_MAX;
+    };
+
+    // subtiles created last frame are added to the scene graph during this update
+    unsigned attached = 0;
+    for (auto& tile : _creating)
+    {
+        if (tile->subtiles == Tile::Subtiles::Creating)
+        {
+            tile->subtiles = Tile::Subtiles::Ready;
+            ++attached;
+        }
+    }
+    _creating.clear();
+
+    for (auto& key : _unloadSubtiles)
+    {
+        auto iter = _tiles.find(key);
+        if (iter != _tiles.end() && iter->second->subdivision.needsUnloadSubtiles)
+        {
+            unloadSubtiles(*iter->second);
+            ++stats.prefetchesCanceled;
+        }
+    }
+    _unloadSubtiles.clear();
+
+    for (auto& key : _loadSubtiles)
+    {
+        auto iter = _tiles.find(key);
+        if (iter != _tiles.end() && iter->second->subtiles == Tile::Subtiles::None)
+        {
+            auto& parent = iter->second;
+            for (unsigned quadrant = 0; quadrant < 4; ++quadrant)
+                parent->children[quadrant] = createTile(key.createChildKey(quadrant), parent.get());
+
+            parent->subtiles = Tile::Subtiles::Creating;
+            parent->subdivision.needsSubtiles = false;
+            _creating.push_back(parent);
+            ++stats.subtilesRequested;
+            if (parent->subdivision.subtilesPrefetched)
+                ++stats.subtilesPrefetched;
+        }
+    }
+    _loadSubtiles.clear();
+
+    for (auto& key : _loadData)
+    {
+        auto iter = _tiles.find(key);
+        if (iter != _tiles.end() && iter->second->data == TerrainTilePolicy::Data::None)
+        {
+            iter->second->data = TerrainTilePolicy::Data::Loading;
+            _loading.push_back(iter->second);
+        }
+    }
+    _loadData.clear();
+
+    for (auto& key : _mergeData)
+    {
+        auto iter = _tiles.find(key);
+        if (iter != _tiles.end() && iter->second->data == TerrainTilePolicy::Data::Loaded)
+        {
+            iter->second->data = TerrainTilePolicy::Data::Merging;
+            _merging.push_back(iter->second);
+        }
+    }
+    _mergeData.clear();
+
+    // loads whose tiles have expired are canceled
+    auto expired = [](const std::weak_ptr<Tile>& weak) { return weak.expired(); };
+    _loading.erase(std::remove_if(_loading.begin(), _loading.end(), expired), _loading.end());
+    _merging.erase(std::remove_if(_merging.begin(), _merging.end(), expired), _merging.end());
+
+    // run the highest-priority loads, up to the load concurrency
+    std::stable_sort(_loading.begin(), _loading.end(),
+        [&](const std::weak_ptr<Tile>& lhs, const std::weak_ptr<Tile>& rhs) {
+            return priority(lhs) > priority(rhs);
+        });
+
+    unsigned numLoads = std::min((unsigned)_loading.size(), std::max(_settings.concurrency.value(), 1u));
+
+    TerrainTileModelFactory factory;
+    factory.compositeColorLayers = true;
+    factory.mipmapColorLayers = _settings.mipmapImagery.value();
+    factory.textureCompression = _settings.textureCompression.value();
+    auto encoding = Heightfield::encoding(_settings.elevationEncoding.value());
+    if (encoding != Image::UNDEFINED)
+        factory.elevationEncoding = encoding;
+
+    for (unsigned i = 0; i < numLoads; ++i)
+    {
+        auto tile = _loading[i].lock();
+
+        auto start = std::chrono::steady_clock::now();
+        auto model = factory.createTileModel(_map.get(), tile->key, CreateTileManifest(), io);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto& loaded = tile->loadedTextureBytes;
+        if (model.colorLayers.size() > 0 && model.colorLayers[0].image.valid())
+            loaded[0] = model.colorLayers[0].image.image()->sizeInBytes();
+        if (model.elevation.heightfield.valid())
+            loaded[1] = model.elevation.heightfield.heightfield()->sizeInBytes();
+        if (model.normalMap.image.valid())
+            loaded[2] = model.normalMap.image.image()->sizeInBytes();
+        std::size_t bytes = loaded[0] + loaded[1] + loaded[2];
+
+        tile->loadedPyramid = model.elevation.pyramid;
+        if (tile->loadedPyramid)
+        {
+            auto& m = model.elevation.matrix;
+            tile->loadedWindow = glm::dvec4(m[3][0], m[3][1], m[3][0] + m[0][0], m[3][1] + m[1][1]);
+        }
+
+        tile->data = TerrainTilePolicy::Data::Loaded;
+
+        ++stats.loads;
+        stats.bytesLoaded += bytes;
+        stats.loadSeconds += elapsed.count();
+    }
+    _loading.erase(_loading.begin(), _loading.begin() + numLoads);
+
+    // one merge per frame, like the runtime's priority update queue
+    if (!_merging.empty())
+    {
+        auto best = std::max_element(_merging.begin(), _merging.end(),
+            [&](const std::weak_ptr<Tile>& lhs, const std::weak_ptr<Tile>& rhs) {
+                return priority(lhs) < priority(rhs);
+            });
+
+        auto tile = best->lock();
+        _merging.erase(best);
+
+        if (tile->loadedPyramid)
+        {
+            tile->pyramid = tile->loadedPyramid;
+            tile->window = tile->loadedWindow;
+            computeBounds(*tile);
+        }
+
+        // same accounting as TerrainTilePager: a GPU copy of every texture,
+        // plus the CPU copy of the data the tile loaded itself
+        std::size_t loadedBytes = 0;
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            if (tile->loadedTextureBytes[i] > 0)
+                tile->textureBytes[i] = tile->loadedTextureBytes[i];
+            loadedBytes += tile->loadedTextureBytes[i];
+        }
+        if (tile->loadedPyramid)
+            loadedBytes += tile->loadedPyramid->sizeInBytes();
+        tile->residentBytes = tile->textureBytes[0] + tile->textureBytes[1] + tile->textureBytes[2] + loadedBytes;
+
+        tile->data = TerrainTilePolicy::Data::Merged;
+        ++stats.merges;
+    }
+
+    // expire tiles that were not visited, as TerrainTilePager::update does
+    // (the simulator builds no geometry, so the pool's share is not counted)
+    std::size_t residentBytes = 0;
+    for (auto& entry : _tiles)
+        residentBytes += entry.second->residentBytes;
+
+    unsigned unloaded = 0;
+
+    const auto dispose = [&](Tile*& tile)
+    {
+        auto key = tile->key;
+        auto parent_iter = _tiles.find(key.createParentKey());
+        Tile* parent = parent_iter != _tiles.end() ? parent_iter->second.get() : nullptr;
+
+        TerrainTilePolicy::Usage usage;
+        usage.doNotExpire = tile->doNotExpire;
+        usage.orphaned = !parent || parent->children[key.getQuadrant()].get() != tile;
+        usage.range = tile->lastRange;
+
+        // a tile created but never visited has gone unused forever
+        if (tile->lastFrame == ~0u)
+        {
+            usage.framesUnused = ~0u;
+            usage.secondsUnused = DBL_MAX;
+        }
+        else
+        {
+            usage.framesUnused = _frameCount - tile->lastFrame;
+            usage.secondsUnused = (double)usage.framesUnused / frameRate;
+        }
+
+        auto expiry = TerrainTilePolicy::expire(_settings, usage, residentBytes, _tiles.size(), unloaded);
+
+        if (expiry == TerrainTilePolicy::Expiry::Keep)
+            return false;
+
+        if (expiry == TerrainTilePolicy::Expiry::ExpireWithSiblings)
+        {
+            unloadSubtiles(*parent);
+            ++unloaded;
+        }
+
+        residentBytes -= tile->residentBytes;
+        _tiles.erase(key);
+        ++stats.tilesExpired;
+        return true;
+    };
+
+    _tracker.flushOldestFirst(~0, dispose);
+
+    stats.residentBytes = residentBytes;
+    stats.tilesResident = (unsigned)_tiles.size();
+    stats.loadQueue = (unsigned)_loading.size();
+    stats.mergeQueue = (unsigned)_merging.size();
+    stats.settled =
+        !requests && attached == 0 && _creating.empty() &&
+        stats.loads == 0 && stats.merges == 0 && stats.tilesExpired == 0 &&
+        _loading.empty() && _merging.empty();
+}
+
+TerrainPagingSimulator::Frame
+TerrainPagingSimulator::frame(const Waypoint& wp, const IOOptions& io)
+{
+    Frame stats;
+    stats.frame = _frameCount;
+    stats.time = (double)_frameCount / frameRate;
+
+    auto camera = makeCamera(wp);
+    if (_useHorizon)
+        _horizon.setEye(camera.eye);
+
+    // same limit as TerrainNode: half the eye's height
+    _predictor.update(camera.eye, stats.time);
+    _predictedMotion = _predictor.displacement(_settings.prefetchSeconds.value(), 0.5 * std::abs(wp.altitude));
+
+    for (auto& root : _roots)
+        accept(root, camera, stats);
+
+    update(io, stats);
+
+    ++_frameCount;
+    return stats;
+}
+
+TerrainPagingSimulator::Report
+TerrainPagingSimulator::run(const std::vector<Waypoint>& path, const IOOptions& io)
+{
+    Report report;
+    ROCKY_SOFT_ASSERT_AND_RETURN(!path.empty(), report);
+
+    reset();
+
+    // camera pose at a time along the path, held at the last waypoint
+    auto sample = [&](double t)
+    {
+        if (t <= path.front().time)
+            return path.front();
+        for (std::size_t i = 1; i < path.size(); ++i)
+        {
+            auto& a = path[i - 1];
+            auto& b = path[i];
+            if (t <= b.time)
+            {
+                double u = b.time > a.time ? (t - a.time) / (b.time - a.time) : 1.0;
+                auto lerp = [u](double from, double to) { return from + (to - from) * u; };
+                Waypoint wp;
+                wp.time = t;
+                wp.longitude = lerp(a.longitude, b.longitude);
+                wp.latitude = lerp(a.latitude, b.latitude);
+                wp.altitude = lerp(a.altitude, b.altitude);
+                wp.heading = lerp(a.heading, b.heading);
+                wp.pitch = lerp(a.pitch, b.pitch);
+                return wp;
+            }
+        }
+        return path.back();
+    };
+
+    const double endTime = path.back().time;
+    unsigned framesAfterPath = 0;
+
+    while (true)
+    {
+        double t = (double)_frameCount / frameRate;
+        bool pathDone = t >= endTime;
+
+        auto stats = frame(sample(t), io);
+
+        report.peakTilesResident = std::max(report.peakTilesResident, stats.tilesResident);
+        report.peakResidentBytes = std::max(report.peakResidentBytes, stats.residentBytes);
+        report.totalBlurryTileFrames += stats.tilesBlurry;
+        report.totalTilesTraversed += stats.tilesTraversed;
+        report.totalBytesLoaded += stats.bytesLoaded;
+        report.totalLoads += stats.loads;
+        report.totalLoadSeconds += stats.loadSeconds;
+        report.frames.push_back(stats);
+
+        if (pathDone)
+        {
+            if (stats.settled)
+            {
+                report.converged = true;
+                report.framesToConverge = framesAfterPath;
+                report.secondsToConverge = (double)framesAfterPath / frameRate;
+                break;
+            }
+            if (++framesAfterPath > maxFramesAfterPath)
+                break;
+        }
+    }
+
+    if (!report.converged)
+    {
+        Log()->warn(LC "Terrain paging did not settle within " + std::to_string(maxFramesAfterPath) + " frames");
+    }
+
+    return report;
+}
+
+JSON
+TerrainPagingSimulator::Report::to_json() const
+{
+    auto j = json::object();
+
+    auto summary = json::object();
+    set(summary, "converged", converged);
+    set(summary, "frames_to_converge", framesToConverge);
+    set(summary, "seconds_to_converge", secondsToConverge);
+    set(summary, "peak_tiles_resident", peakTilesResident);
+    set(summary, "peak_resident_bytes", peakResidentBytes);
+    set(summary, "total_blurry_tile_frames", totalBlurryTileFrames);
+    set(summary, "total_tiles_traversed", totalTilesTraversed);
+    set(summary, "total_bytes_loaded", totalBytesLoaded);
+    set(summary, "total_loads", totalLoads);
+    set(summary, "total_load_seconds", totalLoadSeconds);
+    set(summary, "frames", frames.size());
+    j["summary"] = summary;
+
+    auto list = json::array();
+    for (auto& f : frames)
+    {
+        auto fj = json::object();
+        set(fj, "frame", f.frame);
+        set(fj, "time", f.time);
+        set(fj, "tiles_resident", f.tilesResident);
+        set(fj, "tiles_traversed", f.tilesTraversed);
+        set(fj, "tiles_drawn", f.tilesDrawn);
+        set(fj, "tiles_blurry", f.tilesBlurry);
+        set(fj, "max_level_drawn", f.maxLevelDrawn);
+        set(fj, "load_queue", f.loadQueue);
+        set(fj, "merge_queue", f.mergeQueue);
+        set(fj, "subtiles_requested", f.subtilesRequested);
+        set(fj, "subtiles_prefetched", f.subtilesPrefetched);
+        set(fj, "prefetches_canceled", f.prefetchesCanceled);
+        set(fj, "loads", f.loads);
+        set(fj, "merges", f.merges);
+        set(fj, "tiles_expired", f.tilesExpired);
+        set(fj, "bytes_loaded", f.bytesLoaded);
+        set(fj, "resident_bytes", f.residentBytes);
+        set(fj, "load_seconds", f.loadSeconds);
+        list.push_back(fj);
+    }
+    j["frames"] = list;
+
+    return j.dump();
+}
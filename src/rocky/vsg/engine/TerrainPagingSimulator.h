@@ -0,0 +1,216 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/vsg/Common.h>
+#include <rocky/vsg/TerrainSettings.h>
+#include <rocky/vsg/engine/TerrainTilePolicy.h>
+#include <rocky/CameraPredictor.h>
+#include <rocky/HeightfieldPyramid.h>
+#include <rocky/Horizon.h>
+#include <rocky/IOTypes.h>
+#include <rocky/SentryTracker.h>
+#include <rocky/TileKey.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ROCKY_NAMESPACE
+{
+    class Map;
+
+    /**
+     * Runs the terrain engine's tile selection and paging logic without a
+     * window, a GPU, or a scene graph, so paging behavior can be measured
+     * and compared from build to build.
+     *
+     * Each simulated frame does what a record traversal of the terrain does
+     * (frustum and horizon culling, subdivision, and the pager's "ping"
+     * requests), followed by what the pager's update does: it creates
+     * requested subtiles, loads tile data from the map, merges one loaded tile
+     * per frame, and expires tiles that were not visited. The decisions along
+     * the way are those of the terrain engine itself (see TerrainTilePolicy).
+     *
+     * The camera's motion is predicted the same way the terrain engine does
+     * it for TerrainSettings::prefetchSeconds.
+     *
+     * Data loads run synchronously, at most TerrainSettings::concurrency of
+     * them per frame in priority order, so that results measured in frames
+     * do not depend on the speed of the machine running the simulation.
+     */
+    class ROCKY_EXPORT TerrainPagingSimulator
+    {
+    public:
+        //! Camera pose at a point along a scripted path
+        struct Waypoint
+        {
+            double time = 0.0;       // seconds since the start of the path
+            double longitude = 0.0;  // degrees
+            double latitude = 0.0;   // degrees
+            double altitude = 1e7;   // meters above the ellipsoid
+            double heading = 0.0;    // degrees clockwise from north
+            double pitch = -90.0;    // degrees; -90 looks straight down
+        };
+
+        //! What happened in one frame
+        struct Frame
+        {
+            unsigned frame = 0;
+            double time = 0.0;
+            unsigned tilesResident = 0;
+            unsigned tilesTraversed = 0;   // tiles the cull traversal visited
+            unsigned tilesDrawn = 0;
+            unsigned tilesBlurry = 0;      // drawn without data, or coarser than the camera wants
+            unsigned maxLevelDrawn = 0;
+            unsigned loadQueue = 0;        // data loads waiting after this frame
+            unsigned mergeQueue = 0;       // merges waiting after this frame
+            unsigned subtilesRequested = 0;
+            unsigned subtilesPrefetched = 0; // of those requested, how many ahead of the camera
+            unsigned prefetchesCanceled = 0;
+            unsigned loads = 0;            // data loads completed this frame
+            unsigned merges = 0;           // merges completed this frame
+            unsigned tilesExpired = 0;
+            std::size_t bytesLoaded = 0;   // this frame
+            std::size_t residentBytes = 0; // textures and loaded data of the resident tiles
+            double loadSeconds = 0.0;      // time spent loading data this frame
+            bool settled = false;          // nothing was requested, created, loaded, merged or expired
+        };
+
+        //! Results of a run
+        struct Report
+        {
+            std::vector<Frame> frames;
+
+            //! Whether paging settled after the camera stopped
+            bool converged = false;
+
+            //! Frames and simulated seconds from the end of the path until
+            //! nothing was left to load, merge, or subdivide
+            unsigned framesToConverge = 0;
+            double secondsToConverge = 0.0;
+
+            unsigned peakTilesResident = 0;
+            std::size_t peakResidentBytes = 0;
+
+            //! Sum over all frames of the tiles drawn blurry; lower is better
+            unsigned totalBlurryTileFrames = 0;
+
+            //! Sum over all frames of the tiles traversed
+            unsigned totalTilesTraversed = 0;
+
+            std::size_t totalBytesLoaded = 0;
+            unsigned totalLoads = 0;
+            double totalLoadSeconds = 0.0;
+
+            //! Serialize the report
+            JSON to_json() const;
+        };
+
+    public:
+        //! Simulated frames per second
+        double frameRate = 60.0;
+
+        //! Viewport size in pixels
+        unsigned viewportWidth = 1920;
+        unsigned viewportHeight = 1080;
+
+        //! Vertical field of view in degrees
+        double fovy = 30.0;
+
+        //! Frames to keep running after the path ends, waiting for convergence
+        unsigned maxFramesAfterPath = 1200;
+
+    public:
+        //! Construct a simulator for a map.
+        TerrainPagingSimulator(
+            shared_ptr<Map> map,
+            const TerrainSettings& settings);
+
+        //! Flies the camera along a path (waypoints in time order) and
+        //! reports on each frame. Starts from an empty terrain.
+        Report run(
+            const std::vector<Waypoint>& path,
+            const IOOptions& io);
+
+        //! Simulates one frame with the camera at a waypoint.
+        Frame frame(
+            const Waypoint& camera,
+            const IOOptions& io);
+
+        //! Releases all tiles.
+        void reset();
+
+        //! Number of resident tiles
+        unsigned size() const {
+            return (unsigned)_tiles.size();
+        }
+
+    private:
+        struct Tile;
+        using TilePtr = std::shared_ptr<Tile>;
+
+        struct Tile
+        {
+            TileKey key;
+            bool doNotExpire = false;
+            shared_ptr<HeightfieldPyramid> pyramid;  // elevation ranges, as in the render model
+            glm::dvec4 window = { 0, 0, 1, 1 };      // tile's (u0, v0, u1, v1) in the pyramid
+            TerrainTilePolicy::Bounds bounds;
+            glm::dvec3 center;
+            double radius = 0.0;
+            float lastRange = FLT_MAX;
+            unsigned lastFrame = ~0u;
+            TerrainTilePolicy::Subdivision subdivision;
+            TerrainTilePolicy::Data data = TerrainTilePolicy::Data::None;
+            shared_ptr<HeightfieldPyramid> loadedPyramid;
+            glm::dvec4 loadedWindow = { 0, 0, 1, 1 };
+            std::size_t textureBytes[3] = { 0, 0, 0 }; // color, elevation, normal
+            std::size_t loadedTextureBytes[3] = { 0, 0, 0 };
+            std::size_t residentBytes = 0;
+            enum class Subtiles { None, Creating, Ready } subtiles = Subtiles::None;
+            TilePtr children[4];
+            void* trackerToken = nullptr;
+        };
+
+        struct Camera
+        {
+            glm::dvec3 eye, look, up, right;
+            glm::dvec4 planes[5]; // left, right, bottom, top, near
+            double tanHalfFovy;
+        };
+
+        shared_ptr<Map> _map;
+        const TerrainSettings& _settings;
+        SRS _worldSRS;
+        SRSOperation _profileToWorld;
+        SRSOperation _geoToWorld;
+        Horizon _horizon;
+        bool _useHorizon = false;
+        CameraPredictor _predictor;
+        glm::dvec3 _predictedMotion = { 0, 0, 0 };
+        unsigned _frameCount = 0;
+        std::vector<glm::fvec2> _morphRanges; // by LOD
+
+        std::unordered_map<TileKey, TilePtr> _tiles;
+        util::SentryTracker<Tile*> _tracker;
+        std::vector<TilePtr> _roots;
+
+        std::vector<TileKey> _loadSubtiles;
+        std::vector<TileKey> _unloadSubtiles;
+        std::vector<TileKey> _loadData;
+        std::vector<TileKey> _mergeData;
+        std::vector<std::weak_ptr<Tile>> _loading;
+        std::vector<std::weak_ptr<Tile>> _merging;
+        std::vector<TilePtr> _creating;
+
+        TilePtr createTile(const TileKey& key, const Tile* parent) const;
+        void computeBounds(Tile& tile) const;
+        Camera makeCamera(const Waypoint& wp) const;
+        void accept(const TilePtr& tile, const Camera& camera, Frame& stats);
+        void ping(const TilePtr& tile, const Tile* parent);
+        void unloadSubtiles(Tile& tile);
+        void update(const IOOptions& io, Frame& stats);
+    };
+}
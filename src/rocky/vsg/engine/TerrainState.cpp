@@ -5,10 +5,13 @@
  */
 #include "TerrainState.h"
 #include "Runtime.h"
+#include "TerrainTileAtlas.h"
 #include "TerrainTileNode.h"
 #include "Utils.h"
 #include "PipelineState.h"
 
+#include <rocky/vsg/TerrainSettings.h>
+
 #include <rocky/Color.h>
 #include <rocky/Heightfield.h>
 #include <rocky/Image.h>
@@ -31,6 +34,12 @@
 #define TILE_BUFFER_NAME "tile"
 #define TILE_BUFFER_BINDING 13
 
+// bindings of the atlas and the instances; see TerrainTileAtlas
+#define ELEVATION_ARRAY_NAME "elevation_tex_array"
+#define COLOR_ARRAY_NAME "color_tex_array"
+#define TILES_BUFFER_NAME "tiles"
+#define INSTANCES_BUFFER_NAME "instances"
+
 #define ATTR_VERTEX "in_vertex"
 #define ATTR_NORMAL "in_normal"
 #define ATTR_UV "in_uvw"
@@ -39,8 +48,9 @@
 
 using namespace ROCKY_NAMESPACE;
 
-TerrainState::TerrainState(Runtime& runtime) :
-    _runtime(runtime)
+TerrainState::TerrainState(Runtime& runtime, const TerrainSettings& settings) :
+    _runtime(runtime),
+    _settings(settings)
 {
     status = StatusOK;
 
@@ -56,6 +66,12 @@ TerrainState::TerrainState(Runtime& runtime) :
             "Did you set ROCKY_FILE_PATH to point at the rocky share folder?");
         return;
     }
+
+    // tiles that draw with instancing keep their textures and data here
+    if (_settings.instancing)
+    {
+        atlas = std::make_shared<TerrainTileAtlas>(_runtime, _settings);
+    }
 }
 
 void
@@ -67,11 +83,11 @@ TerrainState::createDefaultDescriptors()
 
     // color channel
     // TODO: more than one - make this an array?
-    // TODO: activate mipmapping
+    // Color tiles arrive with a CPU-generated mipmap chain (TerrainSettings::mipmapImagery)
     texturedefs.color = { COLOR_TEX_NAME, COLOR_TEX_BINDING, vsg::Sampler::create(), {} };
     texturedefs.color.sampler->minFilter = VK_FILTER_LINEAR;
     texturedefs.color.sampler->magFilter = VK_FILTER_LINEAR;
-    texturedefs.color.sampler->maxLod = 5;
+    texturedefs.color.sampler->maxLod = 16;
     texturedefs.color.sampler->mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     texturedefs.color.sampler->addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
     texturedefs.color.sampler->addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
@@ -178,14 +194,20 @@ TerrainState::createShaderSet() const
     shaderSet->addAttributeBinding(ATTR_VERTEX, "", 0, VK_FORMAT_R32G32B32_SFLOAT, vsg::vec3Array::create(1));
     shaderSet->addAttributeBinding(ATTR_NORMAL, "", 1, VK_FORMAT_R32G32B32_SFLOAT, vsg::vec3Array::create(1));
     shaderSet->addAttributeBinding(ATTR_UV, "", 2, VK_FORMAT_R32G32B32_SFLOAT, vsg::vec3Array::create(1));
-    //shaderSet->addAttributeBinding(ATTR_VERTEX_NEIGHBOR, "", 3, VK_FORMAT_R32G32B32A32_SFLOAT, vsg::vec3Array::create(1));
-    //shaderSet->addAttributeBinding(ATTR_NORMAL_NEIGHBOR, "", 4, VK_FORMAT_R32G32B32A32_SFLOAT, vsg::vec3Array::create(1));
+    shaderSet->addAttributeBinding(ATTR_VERTEX_NEIGHBOR, "RK_MORPH_TERRAIN", 3, VK_FORMAT_R32G32B32_SFLOAT, vsg::vec3Array::create(1));
+    shaderSet->addAttributeBinding(ATTR_NORMAL_NEIGHBOR, "RK_MORPH_TERRAIN", 4, VK_FORMAT_R32G32B32_SFLOAT, vsg::vec3Array::create(1));
 
     // "binding" (4th param) must match "layout(location=X) uniform" in the shader
     shaderSet->addUniformBinding(texturedefs.elevation.name, "", 0, texturedefs.elevation.uniform_binding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT, {});
     shaderSet->addUniformBinding(texturedefs.color.name, "", 0, texturedefs.color.uniform_binding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, {});
     shaderSet->addUniformBinding(texturedefs.normal.name, "", 0, texturedefs.normal.uniform_binding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, {});
     shaderSet->addUniformBinding(TILE_BUFFER_NAME, "", 0, TILE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, {});
+
+    // in place of the above when drawing with instancing:
+    shaderSet->addUniformBinding(ELEVATION_ARRAY_NAME, "RK_INSTANCED", TERRAIN_ATLAS_SET, TERRAIN_ATLAS_ELEVATION_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT, {});
+    shaderSet->addUniformBinding(COLOR_ARRAY_NAME, "RK_INSTANCED", TERRAIN_ATLAS_SET, TERRAIN_ATLAS_COLOR_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, {});
+    shaderSet->addUniformBinding(TILES_BUFFER_NAME, "RK_INSTANCED", TERRAIN_ATLAS_SET, TERRAIN_ATLAS_TILES_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, {});
+    shaderSet->addUniformBinding(INSTANCES_BUFFER_NAME, "RK_INSTANCED", TERRAIN_INSTANCES_SET, TERRAIN_INSTANCES_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, {});
     
     PipelineUtils::addViewDependentData(shaderSet, VK_SHADER_STAGE_FRAGMENT_BIT);
 
@@ -198,7 +220,7 @@ TerrainState::createShaderSet() const
 
 
 vsg::ref_ptr<vsg::GraphicsPipelineConfig>
-TerrainState::createPipelineConfig() const
+TerrainState::createPipelineConfig(bool instanced) const
 {
     ROCKY_SOFT_ASSERT_AND_RETURN(status.ok(), {});
 
@@ -214,20 +236,49 @@ TerrainState::createPipelineConfig() const
     config->enableArray(ATTR_NORMAL, VK_VERTEX_INPUT_RATE_VERTEX, 12);
     config->enableArray(ATTR_UV, VK_VERTEX_INPUT_RATE_VERTEX, 12);
 
-    // Temporary decriptors that we will use to set up the PipelineConfig.
-    // Note, we only use these for setup, and then throw them away!
-    // The ACTUAL descriptors we will make on a tile-by-tile basis.
+    if (_settings.morphTerrain || instanced)
+    {
+        // Clone the compile settings; enabling the neighbor arrays or the atlas
+        // adds their defines (RK_MORPH_TERRAIN, RK_INSTANCED), which belong
+        // to the terrain alone.
+        config->shaderHints = _runtime.shaderCompileSettings ?
+            vsg::ShaderCompileSettings::create(*_runtime.shaderCompileSettings) :
+            vsg::ShaderCompileSettings::create();
+    }
+
+    if (_settings.morphTerrain)
+    {
+        // the GeometryPool builds these arrays when morphing is on
+        config->enableArray(ATTR_VERTEX_NEIGHBOR, VK_VERTEX_INPUT_RATE_VERTEX, 12);
+        config->enableArray(ATTR_NORMAL_NEIGHBOR, VK_VERTEX_INPUT_RATE_VERTEX, 12);
+    }
+
+    if (instanced)
+    {
+        // The TerrainTileAtlas makes and binds these descriptors itself.
+        // There's no normal map; the shaders don't use it yet.
+        config->enableTexture(ELEVATION_ARRAY_NAME);
+        config->enableTexture(COLOR_ARRAY_NAME);
+        config->enableUniform(TILES_BUFFER_NAME);
+        config->enableUniform(INSTANCES_BUFFER_NAME);
+    }
+    else
+    {
+        // Temporary decriptors that we will use to set up the PipelineConfig.
+        // Note, we only use these for setup, and then throw them away!
+        // The ACTUAL descriptors we will make on a tile-by-tile basis.
 #if 0
-    config->assignTexture(textures.elevation.name, textures.elevation.defaultData, textures.elevation.sampler);
-    config->assignTexture(textures.color.name, textures.color.defaultData, textures.color.sampler);
-    config->assignTexture(textures.normal.name, textures.normal.defaultData, textures.normal.sampler);
+        config->assignTexture(textures.elevation.name, textures.elevation.defaultData, textures.elevation.sampler);
+        config->assignTexture(textures.color.name, textures.color.defaultData, textures.color.sampler);
+        config->assignTexture(textures.normal.name, textures.normal.defaultData, textures.normal.sampler);
 #else
-    config->enableTexture(texturedefs.elevation.name);
-    config->enableTexture(texturedefs.color.name);
-    config->enableTexture(texturedefs.normal.name);
+        config->enableTexture(texturedefs.elevation.name);
+        config->enableTexture(texturedefs.color.name);
+        config->enableTexture(texturedefs.normal.name);
 #endif
 
-    config->enableUniform(TILE_BUFFER_NAME);
+        config->enableUniform(TILE_BUFFER_NAME);
+    }
 
     PipelineUtils::enableViewDependentData(config);
 
@@ -246,7 +297,7 @@ TerrainState::createTerrainStateGroup()
     ROCKY_SOFT_ASSERT_AND_RETURN(status.ok(), { });
 
     // create the configurator object:
-    pipelineConfig = createPipelineConfig();
+    pipelineConfig = createPipelineConfig(false);
 
     ROCKY_SOFT_ASSERT_AND_RETURN(pipelineConfig, { });
 
@@ -260,10 +311,29 @@ TerrainState::createTerrainStateGroup()
     return stateGroup;
 }
 
+vsg::ref_ptr<vsg::StateGroup>
+TerrainState::createInstancedStateGroup()
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(status.ok(), { });
+    ROCKY_SOFT_ASSERT_AND_RETURN(atlas, { });
+
+    instancedPipelineConfig = createPipelineConfig(true);
+
+    ROCKY_SOFT_ASSERT_AND_RETURN(instancedPipelineConfig, { });
+
+    // The atlas binds its own descriptors and records the draws;
+    // the arrays use the same samplers as the tile textures.
+    return atlas->createStateGroup(
+        instancedPipelineConfig,
+        texturedefs.elevation.sampler,
+        texturedefs.color.sampler);
+}
+
 void
 TerrainState::updateTerrainTileDescriptors(
     const TerrainTileRenderModel& renderModel,
     vsg::ref_ptr<vsg::StateGroup> stategroup,
+    shared_ptr<TerrainTileAtlasEntry>& atlasEntry,
     Runtime& runtime) const
 {
     ROCKY_SOFT_ASSERT_AND_RETURN(status.ok(), void());
@@ -273,6 +343,38 @@ TerrainState::updateTerrainTileDescriptors(
     // Takes a tile's render model (which holds the raw image and matrix data)
     // and creates the necessary VK data to render that model.
 
+    // the per-tile uniform block:
+    TerrainTileDescriptors::Uniforms uniforms;
+    uniforms.elevation_matrix = renderModel.elevation.matrix;
+    uniforms.color_matrix = renderModel.color.matrix;
+    uniforms.normal_matrix = renderModel.normal.matrix;
+    uniforms.model_matrix = renderModel.modelMatrix;
+
+    // compact elevation encodings carry a per-tile scale and offset
+    if (auto hf = Heightfield::cast_from(renderModel.elevation.image.get()))
+    {
+        uniforms.elevation_decode = { hf->heightScale(), hf->heightOffset(), 0, 0 };
+    }
+
+    // how far each vertex morphs toward the parent tile; see TerrainTilePolicy::morphFactor
+    uniforms.morph = {
+        renderModel.morphRange[0],
+        renderModel.morphRange[1],
+        _settings.screenSpaceError.value(),
+        (float)_settings.tileSize.value() };
+
+    // Tiles in the atlas draw with the others, out of the atlas's own
+    // descriptors; the tile's state group stays empty.
+    atlasEntry = atlas ? atlas->add(renderModel, uniforms, atlasEntry) : nullptr;
+    if (atlasEntry)
+    {
+        for (auto& command : stategroup->stateCommands)
+            runtime.dispose(command);
+
+        stategroup->stateCommands.clear();
+        return;
+    }
+
     // copy the existing one:
     TerrainTileDescriptors dm = renderModel.descriptors;
 
@@ -342,13 +444,6 @@ TerrainState::updateTerrainTileDescriptors(
         }
     }
 
-    // the per-tile uniform block:
-    TerrainTileDescriptors::Uniforms uniforms;
-    uniforms.elevation_matrix = renderModel.elevation.matrix;
-    uniforms.color_matrix = renderModel.color.matrix;
-    uniforms.normal_matrix = renderModel.normal.matrix;
-    uniforms.model_matrix = renderModel.modelMatrix;
-
     vsg::ref_ptr<vsg::ubyteArray> data = vsg::ubyteArray::create(sizeof(uniforms));
     memcpy(data->dataPointer(), &uniforms, sizeof(uniforms));
     dm.uniforms = vsg::DescriptorBuffer::create(data, TILE_BUFFER_BINDING);
@@ -379,7 +474,8 @@ TerrainState::updateTerrainTileDescriptors(
     
     stategroup->stateCommands.clear();
 
-    // Need to compile the descriptors
+    // Need to compile the descriptors. This uploads the images too, outside
+    // the budget of Runtime::uploader, which only streams atlas images.
     runtime.compile(bind);
 
     // Temporary:
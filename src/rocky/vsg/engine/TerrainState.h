@@ -17,6 +17,9 @@
 namespace ROCKY_NAMESPACE
 {
     class Runtime;
+    class TerrainSettings;
+    class TerrainTileAtlas;
+    class TerrainTileAtlasEntry;
     class TerrainTileNode;
     class TerrainTileRenderModel;
 
@@ -34,15 +37,22 @@ namespace ROCKY_NAMESPACE
     {
     public:
         //! Initialize the factory
-        TerrainState(Runtime&);
+        TerrainState(Runtime&, const TerrainSettings&);
 
         //! Creates a state group for rendering terrain
         vsg::ref_ptr<vsg::StateGroup> createTerrainStateGroup();
 
-        //! Creates a state group for rendering a specific terrain tile
+        //! Creates a state group that draws the tiles in the atlas
+        //! with instancing. Only available when the atlas exists.
+        vsg::ref_ptr<vsg::StateGroup> createInstancedStateGroup();
+
+        //! Creates a state group for rendering a specific terrain tile.
+        //! When instancing, places the tile in the atlas instead if it fits
+        //! and leaves the state group empty.
         void updateTerrainTileDescriptors(
             const TerrainTileRenderModel& renderModel,
             vsg::ref_ptr<vsg::StateGroup> stategroup,
+            shared_ptr<TerrainTileAtlasEntry>& atlasEntry,
             Runtime& runtime) const;
 
         //! Status of the factory.
@@ -53,6 +63,13 @@ namespace ROCKY_NAMESPACE
         //! Config object for creating the terrain's graphics pipeline
         vsg::ref_ptr<vsg::GraphicsPipelineConfig> pipelineConfig;
 
+        //! Config object for the instanced graphics pipeline
+        vsg::ref_ptr<vsg::GraphicsPipelineConfig> instancedPipelineConfig;
+
+        //! Textures and data of the tiles that draw with instancing;
+        //! null unless TerrainSettings::instancing is set.
+        shared_ptr<TerrainTileAtlas> atlas;
+
         //! VSG parent shader set that we use to develop the terrain tile
         //! state group for each tile.
         vsg::ref_ptr<vsg::ShaderSet> shaderSet;
@@ -77,7 +94,9 @@ namespace ROCKY_NAMESPACE
         //! The configurator does not contain any ACTUAL decriptors (like
         //! textures and uniforms) but rather just prepares the ShaderSet
         //! to work with the specific decriptors you PLAN to provide.
-        vsg::ref_ptr<vsg::GraphicsPipelineConfig> createPipelineConfig() const;
+        //! @param instanced Whether to configure the pipeline that draws
+        //!    the tiles in the atlas
+        vsg::ref_ptr<vsg::GraphicsPipelineConfig> createPipelineConfig(bool instanced) const;
 
         //! Defines a single texutre and its (possible shared) sampler
         struct TextureDef
@@ -106,5 +125,6 @@ namespace ROCKY_NAMESPACE
         texturedefs;
 
         Runtime& _runtime;
+        const TerrainSettings& _settings;
     };
 }
@@ -0,0 +1,626 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "TerrainTileAtlas.h"
+#include "PipelineState.h"
+#include "Runtime.h"
+#include "Utils.h"
+
+#include <rocky/vsg/TerrainSettings.h>
+
+#include <vsg/commands/DrawIndexed.h>
+#include <vsg/state/DescriptorSet.h>
+#include <vsg/state/ImageView.h>
+
+using namespace ROCKY_NAMESPACE;
+
+#define LC "[TerrainTileAtlas] "
+
+namespace
+{
+    // layers in a texture array when it's first allocated
+    constexpr unsigned initial_layers = 32u;
+
+    // tiles in the tile buffer, and instances in each view's instance buffer, at first
+    constexpr unsigned initial_tiles = 256u;
+
+    // instance buffers kept ready for views that have yet to draw, so that
+    // tiles draw from a new view's first frame
+    constexpr unsigned spare_views = 2u;
+
+    // most vertex arrays in a tile geometry; see GeometryPool
+    constexpr unsigned max_arrays = 8u;
+
+    // Vulkan format of a texture array holding images of a pixel format.
+    // Three-channel formats are left out since devices seldom sample them.
+    VkFormat arrayFormat(Image::PixelFormat format)
+    {
+        switch (format)
+        {
+        case Image::R8_UNORM: return VK_FORMAT_R8_UNORM;
+        case Image::R8G8_UNORM: return VK_FORMAT_R8G8_UNORM;
+        case Image::R8G8B8A8_UNORM: return VK_FORMAT_R8G8B8A8_UNORM;
+        case Image::R16_UNORM: return VK_FORMAT_R16_UNORM;
+        case Image::R16_SFLOAT: return VK_FORMAT_R16_SFLOAT;
+        case Image::R32_SFLOAT: return VK_FORMAT_R32_SFLOAT;
+        case Image::BC1_RGBA_UNORM: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case Image::BC3_UNORM: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case Image::BC4_UNORM: return VK_FORMAT_BC4_UNORM_BLOCK;
+        case Image::BC5_UNORM: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case Image::BC7_UNORM: return VK_FORMAT_BC7_UNORM_BLOCK;
+        default: return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+    // A texture array that lives only on the GPU. Compiling it reserves
+    // its memory from VSG's device memory pools; the StreamingUploader
+    // fills it in.
+    vsg::ref_ptr<vsg::ImageInfo> createArray(VkFormat format, unsigned width, unsigned height, unsigned mipLevels, unsigned layers, vsg::ref_ptr<vsg::Sampler> sampler)
+    {
+        auto image = vsg::Image::create();
+        image->imageType = VK_IMAGE_TYPE_2D;
+        image->format = format;
+        image->extent = VkExtent3D{ width, height, 1 };
+        image->mipLevels = mipLevels;
+        image->arrayLayers = layers;
+        image->samples = VK_SAMPLE_COUNT_1_BIT;
+        image->tiling = VK_IMAGE_TILING_OPTIMAL;
+        image->usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        image->initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image->flags = 0;
+        image->sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        auto imageView = vsg::ImageView::create(image, VK_IMAGE_ASPECT_COLOR_BIT);
+        imageView->viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        imageView->subresourceRange.levelCount = mipLevels;
+        imageView->subresourceRange.layerCount = layers;
+
+        return vsg::ImageInfo::create(sampler, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    // Binds a tile geometry's vertex and index buffers, then draws some instances of it.
+    void drawInstances(const vsg::Geometry& geometry, uint32_t firstInstance, uint32_t instanceCount, vsg::CommandBuffer& commandBuffer)
+    {
+        auto deviceID = commandBuffer.deviceID;
+
+        VkBuffer buffers[max_arrays];
+        VkDeviceSize offsets[max_arrays];
+        uint32_t count = std::min((uint32_t)geometry.arrays.size(), max_arrays);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            buffers[i] = geometry.arrays[i]->buffer->vk(deviceID);
+            offsets[i] = geometry.arrays[i]->offset;
+        }
+        vkCmdBindVertexBuffers(commandBuffer, geometry.firstBinding, count, buffers, offsets);
+
+        // GeometryPool makes 16-bit indices
+        vkCmdBindIndexBuffer(commandBuffer, geometry.indices->buffer->vk(deviceID), geometry.indices->offset, VK_INDEX_TYPE_UINT16);
+
+        for (auto& command : geometry.commands)
+        {
+            auto draw = command->cast<vsg::DrawIndexed>();
+            if (draw)
+            {
+                vkCmdDrawIndexed(commandBuffer, draw->indexCount, instanceCount, draw->firstIndex, draw->vertexOffset, firstInstance);
+            }
+        }
+    }
+
+    // Records the tiles queued in an atlas.
+    class DrawTiles : public vsg::Inherit<vsg::Command, DrawTiles>
+    {
+    public:
+        DrawTiles(std::weak_ptr<const TerrainTileAtlas> in_atlas) :
+            atlas(in_atlas) { }
+
+        std::weak_ptr<const TerrainTileAtlas> atlas;
+
+        void record(vsg::CommandBuffer& commandBuffer) const override
+        {
+            auto a = atlas.lock();
+            if (a)
+                a->record(commandBuffer);
+        }
+    };
+}
+
+TerrainTileAtlasEntry::~TerrainTileAtlasEntry()
+{
+    if (_atlas)
+    {
+        std::scoped_lock lock(_atlas->_mutex);
+        _atlas->release(_atlas->_elevation, elevationLayer);
+        _atlas->release(_atlas->_color, colorLayer);
+        _atlas->_tileSlots.release(slot);
+    }
+}
+
+TerrainTileAtlas::TerrainTileAtlas(Runtime& runtime, const TerrainSettings& settings) :
+    _settings(settings),
+    _uploader(runtime.uploader)
+{
+    _elevation.binding = TERRAIN_ATLAS_ELEVATION_BINDING;
+    _color.binding = TERRAIN_ATLAS_COLOR_BINDING;
+}
+
+vsg::ref_ptr<vsg::StateGroup>
+TerrainTileAtlas::createStateGroup(
+    vsg::ref_ptr<vsg::GraphicsPipelineConfig> config,
+    vsg::ref_ptr<vsg::Sampler> elevationSampler,
+    vsg::ref_ptr<vsg::Sampler> colorSampler)
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(config, {});
+
+    std::scoped_lock lock(_mutex);
+
+    _config = config;
+    _elevation.sampler = elevationSampler;
+    _color.sampler = colorSampler;
+
+    // placeholders until the first images arrive; tiles without
+    // an image never sample its array.
+    for (auto* array : { &_elevation, &_color })
+    {
+        auto imageInfo = createArray(VK_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, 1, array->sampler);
+        array->image = imageInfo->imageView->image;
+        array->descriptor = vsg::DescriptorImage::create(imageInfo, array->binding, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        array->fresh = true;
+    }
+
+    resizeTiles(initial_tiles);
+
+    _bind = createBind();
+
+    // The pipeline, the view-dependent data, and the atlas itself;
+    // the instances come from each view's own descriptor set.
+    _stateGroup = vsg::StateGroup::create();
+    _stateGroup->add(config->bindGraphicsPipeline);
+    _stateGroup->add(PipelineUtils::createViewDependentBindCommand(config));
+    _stateGroup->add(_bind);
+    _stateGroup->addChild(DrawTiles::create(weak_from_this()));
+
+    return _stateGroup;
+}
+
+shared_ptr<TerrainTileAtlasEntry>
+TerrainTileAtlas::add(
+    const TerrainTileRenderModel& renderModel,
+    const TerrainTileDescriptors::Uniforms& uniforms,
+    shared_ptr<TerrainTileAtlasEntry> previous)
+{
+    std::scoped_lock lock(_mutex);
+
+    // Only take room that the GPU already has; the atlas grows during
+    // the update, and the tile draws on its own until it's reloaded.
+    int slot = _tileSlots.allocate();
+    if (slot < 0)
+    {
+        _tilesWantGrowth = true;
+        return {};
+    }
+
+    int elevationLayer = -1, colorLayer = -1;
+    if (!acquire(_elevation, renderModel.elevation.image, elevationLayer) ||
+        !acquire(_color, renderModel.color.image, colorLayer))
+    {
+        release(_elevation, elevationLayer);
+        _tileSlots.release(slot);
+        return {};
+    }
+
+    auto* tiles = reinterpret_cast<TileData*>(_tiles->dataPointer());
+    tiles[slot].uniforms = uniforms;
+    tiles[slot].layers = { elevationLayer, colorLayer, 0, 0 };
+    _tilesModified = true;
+
+    auto entry = std::make_shared<TerrainTileAtlasEntry>();
+    entry->slot = slot;
+    entry->elevationLayer = elevationLayer;
+    entry->colorLayer = colorLayer;
+    entry->_atlas = shared_from_this();
+    entry->_ready = resident(*entry);
+
+    // Until its images stream in, the tile keeps drawing with what it had
+    // (never more than one entry back, so waiting tiles don't pile up layers)
+    if (!entry->_ready)
+    {
+        if (previous && !previous->_ready)
+            previous = previous->_previous;
+
+        entry->_previous = previous;
+        _waiting.emplace_back(entry);
+    }
+
+    return entry;
+}
+
+bool
+TerrainTileAtlas::acquire(TextureArray& array, shared_ptr<Image> image, int& layer)
+{
+    layer = -1;
+
+    if (!image)
+        return true;
+
+    // tiles inheriting an image from an ancestor share its layer
+    auto iter = array.lookup.find(image.get());
+    if (iter != array.lookup.end())
+    {
+        layer = iter->second;
+        ++array.refs[layer];
+        return true;
+    }
+
+    // the first image decides the format and size of the whole array
+    if (array.format == Image::UNDEFINED && image->valid() && image->depth() == 1 &&
+        arrayFormat(image->pixelFormat()) != VK_FORMAT_UNDEFINED &&
+        _uploader->fits(image->sizeInBytes(), image->mipmapLevels()))
+    {
+        array.format = image->pixelFormat();
+        array.vkFormat = arrayFormat(image->pixelFormat());
+        array.width = image->width();
+        array.height = image->height();
+        array.mipLevels = image->mipmapLevels();
+    }
+
+    if (image->pixelFormat() != array.format ||
+        image->width() != array.width ||
+        image->height() != array.height ||
+        image->mipmapLevels() != array.mipLevels ||
+        image->depth() != 1)
+    {
+        return false;
+    }
+
+    int slot = array.layers.allocate();
+    if (slot < 0)
+    {
+        array.wantsGrowth = true;
+        return false;
+    }
+
+    array.refs[slot] = 1;
+    array.images[slot] = image;
+    array.resident[slot] = false;
+    array.lookup[image.get()] = slot;
+
+    // streams in during the update
+    _uploads.emplace_back(&array, slot);
+
+    layer = slot;
+    return true;
+}
+
+void
+TerrainTileAtlas::release(TextureArray& array, int layer)
+{
+    if (layer >= 0 && --array.refs[layer] == 0)
+    {
+        array.lookup.erase(array.images[layer].get());
+        array.images[layer] = nullptr;
+        array.resident[layer] = false;
+        array.layers.release(layer);
+    }
+}
+
+bool
+TerrainTileAtlas::resident(const TerrainTileAtlasEntry& entry) const
+{
+    return
+        (entry.elevationLayer < 0 || _elevation.resident[entry.elevationLayer]) &&
+        (entry.colorLayer < 0 || _color.resident[entry.colorLayer]);
+}
+
+void
+TerrainTileAtlas::resize(TextureArray& array, unsigned layers, Runtime& runtime)
+{
+    auto imageInfo = createArray(array.vkFormat, array.width, array.height, array.mipLevels, layers, array.sampler);
+    auto image = imageInfo->imageView->image;
+
+    // the layers in use carry over on the GPU; the placeholder has none
+    if (array.layers.capacity() > 0)
+        _uploader->copy(array.image, image, array.layers.capacity());
+    else
+        _uploader->initialize(image);
+
+    array.image = image;
+    array.fresh = false;
+    array.layers.grow(layers);
+    array.refs.resize(layers, 0u);
+    array.images.resize(layers, nullptr);
+    array.resident.resize(layers, false);
+
+    array.descriptor = vsg::DescriptorImage::create(
+        imageInfo,
+        array.binding,
+        0, // array element
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+}
+
+void
+TerrainTileAtlas::resizeTiles(unsigned count)
+{
+    auto data = vsg::ubyteArray::create(count * sizeof(TileData));
+    data->properties.dataVariance = vsg::DYNAMIC_DATA;
+
+    if (_tiles)
+    {
+        memcpy(data->dataPointer(), _tiles->dataPointer(), _tiles->dataSize());
+    }
+
+    _tiles = data;
+    _tileSlots.grow(count);
+
+    _tilesDescriptor = vsg::DescriptorBuffer::create(
+        _tiles,
+        TERRAIN_ATLAS_TILES_BINDING,
+        0, // array element
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+vsg::ref_ptr<vsg::BindDescriptorSet>
+TerrainTileAtlas::createBind() const
+{
+    auto descriptorSet = vsg::DescriptorSet::create(
+        _config->layout->setLayouts[TERRAIN_ATLAS_SET],
+        vsg::Descriptors{ _elevation.descriptor, _color.descriptor, _tilesDescriptor });
+
+    return vsg::BindDescriptorSet::create(
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        _config->layout,
+        TERRAIN_ATLAS_SET,
+        descriptorSet);
+}
+
+bool
+TerrainTileAtlas::enqueue(const TerrainTileNode* tile, vsg::RecordTraversal& rv) const
+{
+    if (!tile->atlasEntry)
+        return false;
+
+    // draws with the tile's previous entry until this one is ready
+    auto* entry = tile->atlasEntry.get();
+    if (!entry->_ready)
+        entry = entry->_previous.get();
+
+    auto* state = rv.getState();
+    auto& view = _views[state->_commandBuffer->viewID];
+
+    // a view drawing for the first time takes one of the spare instance buffers
+    if (!view.bind)
+    {
+        std::scoped_lock lock(_mutex);
+        if (!view.bind && !_spareViews.empty())
+        {
+            auto& spare = _spareViews.back();
+            view.instances = spare.instances;
+            view.bind = spare.bind;
+            view.capacity = spare.capacity;
+            _spareViews.pop_back();
+        }
+    }
+
+    // Should more new views than there are spares draw in the same frame,
+    // the rest get their instance buffers in the next update.
+    if (entry && view.bind && !tile->stategroup->children.empty())
+    {
+        auto geometry = tile->stategroup->children.front()->cast<vsg::Geometry>();
+        if (geometry)
+        {
+            // concatenate in double precision, as the record traversal would
+            vsg::mat4 modelview(state->modelviewMatrixStack.top() * tile->surface->matrix);
+
+            view.batches[geometry].push_back(Instance{
+                to_glm(modelview),
+                glm::uvec4((unsigned)entry->slot, 0, 0, 0) });
+        }
+    }
+
+    return true;
+}
+
+void
+TerrainTileAtlas::record(vsg::CommandBuffer& commandBuffer) const
+{
+    auto& view = _views[commandBuffer.viewID];
+    if (!view.bind)
+        return;
+
+    view.bind->record(commandBuffer);
+
+    // one draw per geometry, each taking a run of the view's instance buffer
+    auto* instances = reinterpret_cast<Instance*>(view.instances->dataPointer());
+    unsigned count = 0u, draws = 0u;
+
+    for (auto& [geometry, batch] : view.batches)
+    {
+        unsigned n = std::min((unsigned)batch.size(), view.capacity - count);
+        if (n > 0)
+        {
+            std::copy(batch.begin(), batch.begin() + n, instances + count);
+            drawInstances(*geometry, count, n, commandBuffer);
+            count += n;
+            ++draws;
+        }
+        batch.clear();
+    }
+
+    if (count > 0)
+    {
+        // sent to the GPU once the view is recorded
+        view.instances->dirty();
+    }
+
+    _tilesDrawn += count;
+    _drawCalls += draws;
+}
+
+void
+TerrainTileAtlas::update(Runtime& runtime)
+{
+    _lastTilesDrawn = _tilesDrawn.exchange(0u);
+    _lastDrawCalls = _drawCalls.exchange(0u);
+
+    if (!_config)
+        return;
+
+    // entries replaced by ready ones; they let go of their layers
+    // after the lock is released
+    std::vector<shared_ptr<TerrainTileAtlasEntry>> replaced;
+
+    std::scoped_lock lock(_mutex);
+
+    // grow whatever ran out of room since the last frame
+    const unsigned maxLayers = _settings.atlasLayers.value();
+    for (auto* array : { &_elevation, &_color })
+    {
+        if (array->wantsGrowth && array->format != Image::UNDEFINED && array->layers.capacity() < maxLayers)
+        {
+            resize(*array, std::min(std::max(2u * array->layers.capacity(), initial_layers), maxLayers), runtime);
+            _rebuild = true;
+        }
+        array->wantsGrowth = false;
+
+        if (array->fresh)
+        {
+            _uploader->initialize(array->image);
+            array->fresh = false;
+        }
+    }
+
+    if (_tilesWantGrowth)
+    {
+        resizeTiles(2u * _tileSlots.capacity());
+        _tilesWantGrowth = false;
+        _rebuild = true;
+    }
+
+    if (_rebuild)
+    {
+        auto bind = createBind();
+        runtime.compile(bind);
+
+        for (auto& command : _stateGroup->stateCommands)
+        {
+            if (command == _bind)
+                command = bind;
+        }
+
+        runtime.dispose(_bind);
+        _bind = bind;
+        _rebuild = false;
+    }
+
+    // stream new images to the GPU, oldest first, until the frame's budget runs out
+    while (!_uploads.empty())
+    {
+        auto& [array, layer] = _uploads.front();
+
+        // skip layers let go of (or already sent) since they were queued
+        auto& image = array->images[layer];
+        if (image && !array->resident[layer])
+        {
+            // every mipmap level, in the same frame
+            std::vector<const void*> levels(array->mipLevels);
+            std::vector<std::size_t> sizes(array->mipLevels);
+            for (unsigned m = 0; m < array->mipLevels; ++m)
+            {
+                levels[m] = image->data_at_miplevel(m);
+                sizes[m] = image->sizeof_miplevel(m);
+            }
+
+            if (!_uploader->upload(levels.data(), sizes.data(), array->mipLevels, array->image, layer))
+                break;
+
+            array->resident[layer] = true;
+        }
+
+        _uploads.pop_front();
+    }
+
+    // entries whose images have all arrived can draw
+    for (auto iter = _waiting.begin(); iter != _waiting.end(); )
+    {
+        auto entry = iter->lock();
+        if (entry && !resident(*entry))
+        {
+            ++iter;
+            continue;
+        }
+
+        if (entry)
+        {
+            entry->_ready = true;
+            replaced.emplace_back(std::move(entry->_previous));
+            replaced.emplace_back(std::move(entry));
+        }
+
+        iter = _waiting.erase(iter);
+    }
+
+    // the tile buffer is small next to the images, so it goes whole
+    if (_tilesModified)
+        _tiles->dirty();
+    _tilesModified = false;
+
+    // give each view room to draw every tile in the atlas
+    for (auto& view : _views)
+    {
+        if (view.capacity < _tileSlots.capacity())
+            resizeInstances(view, runtime);
+    }
+
+    for (auto& view : _spareViews)
+    {
+        if (view.capacity < _tileSlots.capacity())
+            resizeInstances(view, runtime);
+    }
+
+    while (_spareViews.size() < spare_views)
+    {
+        _spareViews.emplace_back();
+        resizeInstances(_spareViews.back(), runtime);
+    }
+}
+
+void
+TerrainTileAtlas::resizeInstances(ViewData& view, Runtime& runtime)
+{
+    view.capacity = _tileSlots.capacity();
+    view.instances = vsg::ubyteArray::create(view.capacity * sizeof(Instance));
+    view.instances->properties.dataVariance = vsg::DYNAMIC_DATA_TRANSFER_AFTER_RECORD;
+
+    auto descriptorSet = vsg::DescriptorSet::create(
+        _config->layout->setLayouts[TERRAIN_INSTANCES_SET],
+        vsg::Descriptors{ vsg::DescriptorBuffer::create(
+            view.instances,
+            TERRAIN_INSTANCES_BINDING,
+            0, // array element
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) });
+
+    auto bind = vsg::BindDescriptorSet::create(
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        _config->layout,
+        TERRAIN_INSTANCES_SET,
+        descriptorSet);
+
+    runtime.compile(bind);
+    runtime.dispose(view.bind);
+    view.bind = bind;
+}
+
+unsigned
+TerrainTileAtlas::size() const
+{
+    std::scoped_lock lock(_mutex);
+    return _tileSlots.size();
+}
+
+unsigned
+TerrainTileAtlas::backlog() const
+{
+    std::scoped_lock lock(_mutex);
+    return (unsigned)_uploads.size();
+}
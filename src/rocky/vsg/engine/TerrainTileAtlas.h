@@ -0,0 +1,234 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/vsg/Common.h>
+#include <rocky/vsg/engine/TerrainTileNode.h>
+#include <rocky/vsg/engine/ViewLocal.h>
+#include <rocky/vsg/engine/StreamingUploader.h>
+#include <rocky/SlotAllocator.h>
+#include <rocky/Image.h>
+
+#include <vsg/nodes/StateGroup.h>
+#include <vsg/state/BindDescriptorSet.h>
+#include <vsg/state/DescriptorBuffer.h>
+#include <vsg/state/DescriptorImage.h>
+#include <vsg/utils/GraphicsPipelineConfigurator.h>
+#include <vsg/app/RecordTraversal.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace ROCKY_NAMESPACE
+{
+    class Runtime;
+    class TerrainSettings;
+    class TerrainTileAtlas;
+
+    // Shader binding sets and binding points of the atlas.
+    // See rocky.terrain.vert and rocky.terrain.frag
+    constexpr int TERRAIN_ATLAS_SET = 0;
+    constexpr int TERRAIN_ATLAS_ELEVATION_BINDING = 14;
+    constexpr int TERRAIN_ATLAS_COLOR_BINDING = 15;
+    constexpr int TERRAIN_ATLAS_TILES_BINDING = 16;
+    constexpr int TERRAIN_INSTANCES_SET = 2;
+    constexpr int TERRAIN_INSTANCES_BINDING = 0;
+
+    /**
+     * A terrain tile's place in the TerrainTileAtlas: a slot in the tile
+     * buffer and the texture layers holding its images. Destroying the
+     * entry gives them back.
+     *
+     * An entry is ready once its images are on the GPU. Until then the
+     * tile draws with the entry it replaced, if that one was ready.
+     */
+    class ROCKY_VSG_INTERNAL TerrainTileAtlasEntry
+    {
+    public:
+        ~TerrainTileAtlasEntry();
+
+        //! Slot of the tile's data in the tile buffer
+        int slot = -1;
+
+        //! Texture array layer of the tile's elevation image, or -1 for none
+        int elevationLayer = -1;
+
+        //! Texture array layer of the tile's color image, or -1 for none
+        int colorLayer = -1;
+
+    private:
+        shared_ptr<TerrainTileAtlas> _atlas;
+        shared_ptr<TerrainTileAtlasEntry> _previous;
+        bool _ready = false;
+        friend class TerrainTileAtlas;
+    };
+
+    /**
+     * Holds the textures and data of terrain tiles in a few shared GPU
+     * resources, so that visible tiles sharing a geometry can draw with
+     * one instanced call instead of binding a descriptor set and drawing
+     * tile by tile. See TerrainSettings::instancing.
+     *
+     * Each texture type lives in a 2D texture array with one layer per image;
+     * tiles that inherit an image from an ancestor share its layer. Per-tile
+     * data (texture matrices, layers, morph range) lives in one storage buffer.
+     * During the record traversal, tiles queue themselves by geometry and the
+     * atlas's state group records one draw per geometry.
+     *
+     * The arrays take the format, size and mipmap levels of the first image
+     * of each type. Tiles with images that don't match, or that don't fit,
+     * render the usual way.
+     *
+     * The arrays live on the GPU only, in device memory that VSG sub-allocates
+     * from its pools. New images stream in through the Runtime's
+     * StreamingUploader, oldest first, as fast as its budget allows.
+     */
+    class ROCKY_VSG_INTERNAL TerrainTileAtlas : public std::enable_shared_from_this<TerrainTileAtlas>
+    {
+    public:
+        //! Per-tile data in the tile buffer; see rocky.terrain.vert
+        struct TileData
+        {
+            TerrainTileDescriptors::Uniforms uniforms;
+            glm::ivec4 layers = { -1, -1, 0, 0 }; // elevation, color
+        };
+
+        //! Per-instance data in a view's instance buffer; see rocky.terrain.vert
+        struct Instance
+        {
+            glm::fmat4 modelview;
+            glm::uvec4 tile; // x = slot in the tile buffer
+        };
+
+        //! Construct an empty atlas
+        TerrainTileAtlas(Runtime& runtime, const TerrainSettings& settings);
+
+        //! Creates the state group that draws the queued tiles.
+        //! @param config Instanced pipeline configuration from TerrainState
+        //! @param elevationSampler Sampler for the elevation texture array
+        //! @param colorSampler Sampler for the color texture array
+        vsg::ref_ptr<vsg::StateGroup> createStateGroup(
+            vsg::ref_ptr<vsg::GraphicsPipelineConfig> config,
+            vsg::ref_ptr<vsg::Sampler> elevationSampler,
+            vsg::ref_ptr<vsg::Sampler> colorSampler);
+
+        //! Places a tile's images and data in the atlas.
+        //! @param previous The tile's current entry, to draw with until the new one is ready
+        //! @return The tile's entry, or nullptr if the tile must render on its own
+        shared_ptr<TerrainTileAtlasEntry> add(
+            const TerrainTileRenderModel& renderModel,
+            const TerrainTileDescriptors::Uniforms& uniforms,
+            shared_ptr<TerrainTileAtlasEntry> previous);
+
+        //! Queues a tile to draw with the rest of the view being recorded.
+        //! @return False if the tile is not in the atlas and must draw itself
+        bool enqueue(const TerrainTileNode* tile, vsg::RecordTraversal& rv) const;
+
+        //! Grows the atlas as needed, streams new images to the GPU and
+        //! publishes other changes. Call once per frame during the update.
+        void update(Runtime& runtime);
+
+        //! Number of tiles drawn with instancing in the last frame
+        unsigned tilesDrawn() const {
+            return _lastTilesDrawn;
+        }
+
+        //! Number of draw calls that drew them
+        unsigned drawCalls() const {
+            return _lastDrawCalls;
+        }
+
+        //! Number of tiles in the atlas
+        unsigned size() const;
+
+        //! Number of images waiting to stream to the GPU
+        unsigned backlog() const;
+
+        //! Records the queued tiles of a view; called by the atlas's draw command
+        void record(vsg::CommandBuffer& commandBuffer) const;
+
+    private:
+        //! A texture array, one layer per image
+        struct TextureArray
+        {
+            uint32_t binding = 0;
+            vsg::ref_ptr<vsg::Sampler> sampler;
+            Image::PixelFormat format = Image::UNDEFINED;
+            VkFormat vkFormat = VK_FORMAT_UNDEFINED;
+            unsigned width = 0, height = 0;
+            unsigned mipLevels = 1;
+            vsg::ref_ptr<vsg::Image> image; // GPU only
+            vsg::ref_ptr<vsg::DescriptorImage> descriptor;
+            util::SlotAllocator layers;
+            std::vector<unsigned> refs; // tiles using each layer
+            std::vector<shared_ptr<Image>> images; // image in each layer
+            std::vector<bool> resident; // whether each layer's image is on the GPU
+            std::unordered_map<const Image*, int> lookup;
+            bool fresh = false; // image needs initializing
+            bool wantsGrowth = false;
+        };
+
+        //! Tiles queued for drawing in one view, and the buffer
+        //! holding their instances
+        struct ViewData
+        {
+            std::unordered_map<const vsg::Geometry*, std::vector<Instance>> batches;
+            vsg::ref_ptr<vsg::ubyteArray> instances;
+            vsg::ref_ptr<vsg::BindDescriptorSet> bind;
+            unsigned capacity = 0;
+        };
+
+        const TerrainSettings& _settings;
+        vsg::ref_ptr<StreamingUploader> _uploader;
+        mutable std::mutex _mutex;
+        TextureArray _elevation, _color;
+        std::deque<std::pair<TextureArray*, int>> _uploads; // oldest first
+        std::vector<std::weak_ptr<TerrainTileAtlasEntry>> _waiting; // entries not yet ready
+        vsg::ref_ptr<vsg::ubyteArray> _tiles;
+        vsg::ref_ptr<vsg::DescriptorBuffer> _tilesDescriptor;
+        util::SlotAllocator _tileSlots;
+        bool _tilesModified = false;
+        bool _tilesWantGrowth = false;
+        bool _rebuild = false;
+
+        vsg::ref_ptr<vsg::GraphicsPipelineConfig> _config;
+        vsg::ref_ptr<vsg::StateGroup> _stateGroup;
+        vsg::ref_ptr<vsg::BindDescriptorSet> _bind;
+        util::ViewLocal<ViewData> _views;
+        mutable std::vector<ViewData> _spareViews; // ready for views that have yet to draw
+
+        mutable std::atomic<unsigned> _tilesDrawn = { 0u };
+        mutable std::atomic<unsigned> _drawCalls = { 0u };
+        unsigned _lastTilesDrawn = 0u;
+        unsigned _lastDrawCalls = 0u;
+
+        // places an image in an array, or finds the layer already holding it;
+        // false if it doesn't fit. A null image needs no layer (-1).
+        bool acquire(TextureArray& array, shared_ptr<Image> image, int& layer);
+
+        // whether an entry's images are all on the GPU
+        bool resident(const TerrainTileAtlasEntry& entry) const;
+
+        // lets go of a layer
+        void release(TextureArray& array, int layer);
+
+        // (re)allocates an array's image to hold some number of layers
+        void resize(TextureArray& array, unsigned layers, Runtime& runtime);
+
+        // (re)allocates the tile buffer to hold some number of tiles
+        void resizeTiles(unsigned count);
+
+        // creates the descriptor set binding the arrays and the tile buffer
+        vsg::ref_ptr<vsg::BindDescriptorSet> createBind() const;
+
+        // (re)allocates a view's instance buffer to hold every tile in the atlas
+        void resizeInstances(ViewData& view, Runtime& runtime);
+
+        friend class TerrainTileAtlasEntry;
+    };
+}
@@ -27,5 +27,20 @@ namespace ROCKY_NAMESPACE
 
         //! Access terrain settings.
         virtual const TerrainSettings& settings() = 0;
+
+        //! How far the camera of the view being recorded is expected to move,
+        //! in world coordinates, over the prefetch interval.
+        virtual vsg::dvec3 predictedMotion(vsg::RecordTraversal& t) = 0;
+
+        //! Queue a tile to draw with instancing in the view being recorded.
+        //! Returns false if the tile should record its own geometry.
+        virtual bool drawInstanced(
+            const TerrainTileNode* tile,
+            vsg::RecordTraversal& t) = 0;
+
+        //! Tell the host that a tile drew its surface, either way.
+        virtual void drawn(
+            const TerrainTileNode* tile,
+            vsg::RecordTraversal& t) = 0;
     };
 }
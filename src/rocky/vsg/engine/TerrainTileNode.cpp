@@ -46,7 +46,8 @@ TerrainTileNode::TerrainTileNode(
     const TileKey& in_key,
     TerrainTileNode* in_parent,
     vsg::ref_ptr<vsg::Node> in_geometry,
-    const glm::fvec2& in_morphConstants,
+    const glm::fvec2& in_morphRange,
+    const glm::fvec2& in_childrenMorphRange,
     float in_childrenVisibilityRange,
     const SRS& worldSRS,
     const TerrainTileDescriptors& in_initialDescriptors,
@@ -54,9 +55,10 @@ TerrainTileNode::TerrainTileNode(
     Runtime& runtime)
 {
     key = in_key;
-    morphConstants = in_morphConstants;
+    childrenMorphRange = in_childrenMorphRange;
     childrenVisibilityRange = in_childrenVisibilityRange;
     renderModel.descriptors = in_initialDescriptors;
+    renderModel.morphRange = in_morphRange;
     _host = in_host;
 
     doNotExpire = (in_parent == nullptr);
@@ -64,12 +66,20 @@ TerrainTileNode::TerrainTileNode(
     surface = nullptr;
     stategroup = nullptr;
     lastTraversalFrame = 0;
+    lastTraversalTime = vsg::time_point();
     lastTraversalRange = FLT_MAX;
-    _needsSubtiles = false;
+    residentBytes = 0u;
+    numTriangles = 0u;
     _needsUpdate = false;
+    _needsRefresh = false;
  
     ROCKY_HARD_ASSERT(in_geometry.valid());
 
+    if (auto shared = in_geometry.cast<SharedGeometry>(); shared && shared->proxy_indices)
+    {
+        numTriangles = (unsigned)shared->proxy_indices->size() / 3u;
+    }
+
     if (in_geometry.valid())
     {
         // scene graph is: tile->surface->stateGroup->geometry
@@ -102,39 +112,48 @@ TerrainTileNode::recomputeBound()
 }
 
 void
-TerrainTileNode::setElevation(shared_ptr<Image> image, const glm::dmat4& matrix)
+TerrainTileNode::setElevation(shared_ptr<Image> image, const glm::dmat4& matrix, shared_ptr<HeightfieldPyramid> pyramid)
 {
     if (surface)
     {
         if (image != getElevationRaster() || matrix != getElevationMatrix() || !this->bound.valid())
         {
-            surface->setElevation(image, matrix);
+            surface->setElevation(image, matrix, pyramid);
             recomputeBound();
         }
     }
 }
 
 bool
-TerrainTileNode::shouldSubDivide(vsg::State* state) const
+TerrainTileNode::shouldSubDivide(vsg::State* state, const vsg::dvec3& eyeOffset) const
 {
-    // can we subdivide at all?
-    if (childrenVisibilityRange == FLT_MAX)
-        return false;
-
 #ifdef USE_SSE
 
-    const float TILE_SIZE_PIXELS = 256.0f;
-
+    auto& settings = _host->settings();
     auto& vp = state->_commandBuffer->viewDependentState->viewportData->at(0);
-    float min_screen_height_ratio = (TILE_SIZE_PIXELS + _host->settings().screenSpaceError) / vp[3];
-    float d = state->lodDistance(bound);
-    return (d > 0.0) && (bound.r > (d * min_screen_height_ratio));
+
+    // moving the eye is the same as moving the tile the other way
+    double lodDistance = state->lodDistance(vsg::dsphere(bound.center - eyeOffset, bound.radius));
+
+    // scaled like lodDistance
+    double subtileDistance = 0.0;
+    if (settings.morphTerrain)
+    {
+        double f = std::abs(state->projectionMatrixStack.top()[1][1]);
+        subtileDistance = surface->distanceToSubtiles(state, eyeOffset) / f;
+    }
+
+    return TerrainTilePolicy::shouldSubdivide(
+        settings, key.levelOfDetail(), bound.r, lodDistance, subtileDistance, vp[3], childrenMorphRange);
 
 #else
 
+    // can we subdivide at all?
+    if (childrenVisibilityRange == FLT_MAX)
+        return false;
+
     // are the children in range?
-    // Note - this method prefered when using morphing.
-    return surface->anyChildBoxWithinRange(childrenVisibilityRange, state);
+    return surface->distanceToSubtiles(state) <= childrenVisibilityRange;
 
 #endif
 }
@@ -156,37 +175,48 @@ TerrainTileNode::accept(vsg::RecordTraversal& rv) const
     lastTraversalTime.exchange(rv.getFrameStamp()->time);
 
     if (subtilesExist())
-        _needsSubtiles = false;
+        _subdivision.needsSubtiles = false;
 
-    if (surface->isVisible(rv.getState()))
+    if (surface->isVisible(rv.getState(), _host->settings().horizonCulling.value()))
     {
-        // determine whether we can and should subdivide to a higher resolution:
+        // determine whether we can and should subdivide to a higher resolution,
+        // now and with the eye where the camera is heading:
         bool subtilesInRange = shouldSubDivide(rv.getState());
 
-        if (subtilesInRange && subtilesExist())
+        bool subtilesPredicted =
+            !subtilesInRange &&
+            _host->settings().prefetchSeconds.value() > 0.0f &&
+            shouldSubDivide(rv.getState(), _host->predictedMotion(rv));
+
+        auto traversal = TerrainTilePolicy::subdivide(
+            _subdivision, subtilesInRange, subtilesPredicted, subtilesExist(), !subtilesLoader.empty());
+
+        if (traversal == TerrainTilePolicy::Traversal::Subtiles)
         {
             // children are available, traverse them now.
             children[1]->accept(rv);
+        }
+        else
+        {
+            // children do not exist or are out of range; use this tile's geometry,
+            // unless it draws along with the other tiles in the atlas
+            if (!_host->drawInstanced(this, rv))
+                children[0]->accept(rv);
+
+            _host->drawn(this, rv);
+        }
 
 #ifdef AGGRESSIVE_PAGEOUT
-            // always ping all children at once so the system can never
-            // delete one of a quad.
+        // always ping all children at once so the system can never
+        // delete one of a quad.
+        if (traversal != TerrainTilePolicy::Traversal::Tile)
+        {
             _host->ping(subTile(0), this, rv);
             _host->ping(subTile(1), this, rv);
             _host->ping(subTile(2), this, rv);
             _host->ping(subTile(3), this, rv);
-#endif
-        }
-        else
-        {
-            // children do not exist or are out of range; use this tile's geometry
-            children[0]->accept(rv);
-
-            if (subtilesInRange && subtilesLoader.empty())
-            {
-                _needsSubtiles = true;
-            }
         }
+#endif
     }
 
 #ifndef AGGRESSIVE_PAGEOUT
@@ -218,7 +248,7 @@ TerrainTileNode::unloadSubtiles(Runtime& runtime)
 
     children.resize(1);
     subtilesLoader.reset();
-    _needsSubtiles = false;
+    _subdivision = { };
 }
 
 void
@@ -228,12 +258,24 @@ TerrainTileNode::inheritFrom(vsg::ref_ptr<TerrainTileNode> parent)
     {
         auto& sb = scaleBias[key.getQuadrant()];
 
+        // the morph range belongs to this tile's LOD
+        auto morphRange = renderModel.morphRange;
+
         renderModel = parent->renderModel;
         renderModel.applyScaleBias(sb);
+        renderModel.morphRange = morphRange;
 
         revision = parent->revision;
 
         // prompts regeneration of the local bounds
-        setElevation(renderModel.elevation.image, renderModel.elevation.matrix);
+        setElevation(renderModel.elevation.image, renderModel.elevation.matrix, renderModel.elevationPyramid);
     }
 }
+
+void
+TerrainTileNode::inheritColorFrom(const TerrainTileNode& parent)
+{
+    renderModel.color = parent.renderModel.color;
+    if (renderModel.color.image)
+        renderModel.color.matrix *= scaleBias[key.getQuadrant()];
+}
@@ -8,6 +8,7 @@
 #include <rocky/vsg/Common.h>
 #include <rocky/vsg/engine/SurfaceNode.h>
 #include <rocky/vsg/engine/TerrainTileHost.h>
+#include <rocky/vsg/engine/TerrainTilePolicy.h>
 #include <rocky/Threading.h>
 #include <rocky/TileKey.h>
 #include <rocky/Image.h>
@@ -28,6 +29,7 @@ namespace ROCKY_NAMESPACE
     class TerrainTileNode;
     class TerrainEngine;
     class TerrainSettings;
+    class TerrainTileAtlasEntry;
     class Runtime;
 
     struct TextureData
@@ -55,6 +57,8 @@ namespace ROCKY_NAMESPACE
             glm::fmat4 color_matrix;
             glm::fmat4 normal_matrix;
             glm::fmat4 model_matrix;
+            glm::fvec4 elevation_decode = { 1, 0, 0, 0 }; // scale, offset
+            glm::fvec4 morph = { 0, 1, 1, 2 }; // morph start, morph end, screen-space error, tile size
         };
         vsg::ref_ptr<vsg::DescriptorImage> color;
         vsg::ref_ptr<vsg::DescriptorImage> colorParent;
@@ -72,6 +76,12 @@ namespace ROCKY_NAMESPACE
         TextureData normal;
         TextureData colorParent;
 
+        //! Min/max pyramid of the elevation image
+        shared_ptr<HeightfieldPyramid> elevationPyramid;
+
+        //! Morph range of the tile's LOD (see TerrainTilePolicy::morphFactor)
+        glm::fvec2 morphRange = { 0, 1 };
+
         TerrainTileDescriptors descriptors;
 
         void applyScaleBias(const glm::dmat4& sb)
@@ -98,10 +108,15 @@ namespace ROCKY_NAMESPACE
         TileKey key;
         bool doNotExpire;
         Revision revision;
-        glm::fvec2 morphConstants;
+        glm::fvec2 childrenMorphRange;
         float childrenVisibilityRange;
         unsigned numLODs;
         TerrainTileRenderModel renderModel;
+
+        //! Place in the terrain tile atlas, when the tile draws with instancing
+        //! (see TerrainTileAtlas). Declared after the render model, whose images
+        //! it refers to, so that it goes first.
+        shared_ptr<TerrainTileAtlasEntry> atlasEntry;
         
         vsg::ref_ptr<SurfaceNode> surface;
         vsg::ref_ptr<vsg::StateGroup> stategroup;
@@ -111,16 +126,29 @@ namespace ROCKY_NAMESPACE
         //mutable jobs::future<bool> elevationMerger;
         mutable jobs::future<TerrainTileModel> dataLoader;
         mutable jobs::future<bool> dataMerger;
+        mutable jobs::future<TerrainTileModel> dataRefresher;
+        mutable jobs::future<bool> refreshMerger;
         mutable std::atomic<uint64_t> lastTraversalFrame;
         mutable std::atomic<vsg::time_point> lastTraversalTime;
         mutable std::atomic<float> lastTraversalRange;
 
+        //! Memory used by this tile's textures and loaded data, in bytes
+        std::size_t residentBytes;
+
+        //! Triangles this tile draws, skirts included
+        unsigned numTriangles;
+
+        //! Data this tile loaded, including any refreshes since; a refresh
+        //! replaces only the parts whose layers changed
+        TerrainTileModel dataModel;
+
         //! Construct a new tile node
         TerrainTileNode(
             const TileKey& key,
             TerrainTileNode* parent,
             vsg::ref_ptr<vsg::Node> geometry,
-            const glm::fvec2& morphConstants,
+            const glm::fvec2& morphRange,
+            const glm::fvec2& childrenMorphRange,
             float childrenVisibilityRange,
             const SRS& worldSRS,
             const TerrainTileDescriptors& initialDescriptors,
@@ -129,11 +157,12 @@ namespace ROCKY_NAMESPACE
 
         virtual ~TerrainTileNode();
 
-        //! Elevation data for this node along with its scale/bias matrix;
-        //! needed for bounding box
+        //! Elevation data for this node along with its scale/bias matrix
+        //! and min/max pyramid; needed for bounding box
         void setElevation(
             shared_ptr<Image> image,
-            const glm::dmat4& matrix);
+            const glm::dmat4& matrix,
+            shared_ptr<HeightfieldPyramid> pyramid);
 
         //! This node's elevation raster image
         shared_ptr<Image> getElevationRaster() const {
@@ -159,8 +188,11 @@ namespace ROCKY_NAMESPACE
         
     protected:
 
-        mutable bool _needsSubtiles;
+        mutable TerrainTilePolicy::Subdivision _subdivision;
         mutable bool _needsUpdate;
+        mutable bool _needsRefresh;        // layers in _refreshManifest changed since the data loaded
+        CreateTileManifest _refreshManifest;
+        CreateTileManifest _refreshingManifest; // layers that dataRefresher is loading
         TerrainTileHost* _host;
 
         // set the tile's render model equal to the specified parent's
@@ -168,9 +200,13 @@ namespace ROCKY_NAMESPACE
         // inherits the textures.
         void inheritFrom(vsg::ref_ptr<TerrainTileNode> parent);
 
+        // same as inheritFrom, for the color texture alone
+        void inheritColorFrom(const TerrainTileNode& parent);
+
     private:
 
-        bool shouldSubDivide(vsg::State* state) const;
+        //! @param eyeOffset Moves the eye by this much (world coordinates) for the test
+        bool shouldSubDivide(vsg::State* state, const vsg::dvec3& eyeOffset = { 0, 0, 0 }) const;
 
         //! Calculate the culling extent
         void recomputeBound();
@@ -11,8 +11,11 @@
 #include <rocky/vsg/TerrainSettings.h>
 
 #include <rocky/ElevationLayer.h>
+#include <rocky/HeightfieldEdges.h>
+#include <rocky/HeightfieldPyramid.h>
 #include <rocky/ImageLayer.h>
 #include <rocky/Map.h>
+#include <rocky/Metrics.h>
 #include <rocky/TerrainTileModelFactory.h>
 
 #include <vsg/nodes/QuadGroup.h>
@@ -27,6 +30,155 @@ using namespace ROCKY_NAMESPACE;
 //#define RP_DEBUG Log::info()
 #define RP_DEBUG if(false) Log::info()
 
+namespace
+{
+    // state of a tile's data, from its loading and merging futures
+    TerrainTilePolicy::Data dataState(const TerrainTileNode& tile)
+    {
+        if (tile.dataMerger.available())
+            return TerrainTilePolicy::Data::Merged;
+        if (tile.dataLoader.available())
+            return tile.dataMerger.empty() ? TerrainTilePolicy::Data::Loaded : TerrainTilePolicy::Data::Merging;
+        if (tile.dataLoader.empty())
+            return TerrainTilePolicy::Data::None;
+        return TerrainTilePolicy::Data::Loading;
+    }
+
+    // Each tile uploads its own copy of every texture in its render model,
+    // inherited or not (see TerrainState), so this is its share of GPU memory.
+    std::size_t textureBytes(const TerrainTileRenderModel& model)
+    {
+        std::size_t bytes = sizeof(TerrainTileDescriptors::Uniforms);
+        for (auto* texture : { &model.color, &model.elevation, &model.normal })
+        {
+            if (texture->image)
+                bytes += texture->image->sizeInBytes();
+        }
+        return bytes;
+    }
+
+    // Bytes of the data a tile loaded itself, as opposed to what it shares
+    // with its ancestors
+    std::size_t dataBytes(const TerrainTileModel& model)
+    {
+        std::size_t bytes = 0u;
+        if (!model.colorLayers.empty() && model.colorLayers[0].image.valid())
+            bytes += model.colorLayers[0].image.image()->sizeInBytes();
+        for (auto& source : model.colorLayerSources)
+        {
+            if (source.image.valid())
+                bytes += source.image.image()->sizeInBytes();
+        }
+        if (model.elevation.heightfield.valid())
+            bytes += model.elevation.heightfield.heightfield()->sizeInBytes();
+        if (model.elevation.pyramid)
+            bytes += model.elevation.pyramid->sizeInBytes();
+        if (model.normalMap.image.valid())
+            bytes += model.normalMap.image.image()->sizeInBytes();
+        return bytes;
+    }
+
+    void configure(TerrainTileModelFactory& factory, const TerrainEngine& engine)
+    {
+        factory.compositeColorLayers = true;
+        factory.mipmapColorLayers = engine.settings.mipmapImagery.value();
+        factory.textureCompression = engine.settings.textureCompression.value();
+        factory.blockCompressionSupported = engine.runtime.textureCompressionBC;
+        if (factory.textureCompression != "none")
+            factory.compressionPool = jobs::get_pool(engine.compressSchedulerName);
+
+        auto encoding = Heightfield::encoding(engine.settings.elevationEncoding.value());
+        if (encoding != Image::UNDEFINED)
+            factory.elevationEncoding = encoding;
+    }
+
+    // Copies the data in a tile model into the tile's render model.
+    // Returns true if there was anything to copy.
+    bool mergeModel(TerrainTileNode& tile, const TerrainTileModel& model)
+    {
+        auto& renderModel = tile.renderModel;
+
+        bool updated = false;
+
+        if (model.colorLayers.size() > 0)
+        {
+            auto& layer = model.colorLayers[0];
+            if (layer.image.valid())
+            {
+                renderModel.color.name = "color " + layer.key.str();
+                renderModel.color.image = layer.image.image();
+                renderModel.color.matrix = layer.matrix;
+            }
+            updated = true;
+        }
+
+#ifndef LOAD_ELEVATION_SEPARATELY
+        if (model.elevation.heightfield.valid())
+        {
+            renderModel.elevation.name = "elevation " + model.elevation.key.str();
+            renderModel.elevation.image = model.elevation.heightfield.heightfield();
+            renderModel.elevation.matrix = model.elevation.matrix;
+            renderModel.elevationPyramid = model.elevation.pyramid;
+
+            // prompt the tile can update its bounds
+            tile.setElevation(
+                renderModel.elevation.image,
+                renderModel.elevation.matrix,
+                renderModel.elevationPyramid);
+
+            updated = true;
+        }
+
+        if (model.normalMap.image.valid())
+        {
+            renderModel.elevation.name = "normal " + model.normalMap.key.str();
+            renderModel.normal.image = model.normalMap.image.image();
+            renderModel.normal.matrix = model.normalMap.matrix;
+
+            updated = true;
+        }
+#endif
+
+        return updated;
+    }
+
+    // Key of the tile at the same LOD offset from a tile, or an invalid key past
+    // the edge of the profile (which only wraps around a whole-earth profile)
+    TileKey neighborKey(const TileKey& key, int dx, int dy)
+    {
+        auto [tx, ty] = key.profile().numTiles(key.levelOfDetail());
+        int x = (int)key.tileX() + dx;
+        int y = (int)key.tileY() + dy;
+
+        if (y < 0 || y >= (int)ty)
+            return TileKey::INVALID;
+
+        if ((x < 0 || x >= (int)tx) && key.profile().geographicExtent().width() < 360.0)
+            return TileKey::INVALID;
+
+        return key.createNeighborKey(dx, dy);
+    }
+
+    // Whether two heightfields have the same samples all around their edges
+    bool sameEdges(const Heightfield& a, const Heightfield& b)
+    {
+        if (a.width() != b.width() || a.height() != b.height() || a.pixelFormat() != b.pixelFormat())
+            return false;
+
+        for (auto side : { HeightfieldEdges::WEST, HeightfieldEdges::EAST, HeightfieldEdges::SOUTH, HeightfieldEdges::NORTH })
+        {
+            for (unsigned i = 0; i < HeightfieldEdges::numSamples(a, side); ++i)
+            {
+                unsigned c, r;
+                HeightfieldEdges::sampleAt(a, side, i, c, r);
+                if (a.heightAt(c, r) != b.heightAt(c, r))
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
 //----------------------------------------------------------------------------
 
 TerrainTilePager::TerrainTilePager(
@@ -58,6 +210,12 @@ TerrainTilePager::releaseAll()
     _loadData.clear();
     _mergeData.clear();
     _updateData.clear();
+    _refreshData.clear();
+    _mergeRefresh.clear();
+    _unloadSubtiles.clear();
+    _layerRevisions.clear();
+    _edgeFixups.clear();
+    _residentBytes = 0u;
 }
 
 void
@@ -99,15 +257,18 @@ TerrainTilePager::ping(TerrainTileNode* tile, const TerrainTileNode* parent, vsg
             _loadData.push_back(tile->key);
 #else
 
-        auto tileHasData = tile->dataMerger.available();
+        auto requests = TerrainTilePolicy::requests(
+            dataState(*tile),
+            tile->_subdivision,
+            parent ? dataState(*parent) : TerrainTilePolicy::Data::Merged);
 
 #ifdef LOAD_ELEVATION_SEPARATELY
         auto tileHasElevation = tile->elevationMerger.available();
 #else
-        auto tileHasElevation = tileHasData;
+        auto tileHasElevation = true;
 #endif
         
-        if (tileHasData && tileHasElevation && tile->_needsSubtiles)
+        if (requests.loadSubtiles && tileHasElevation)
             _loadSubtiles.push_back(tile->key);
 
 #ifdef LOAD_ELEVATION_SEPARATELY
@@ -116,9 +277,21 @@ TerrainTilePager::ping(TerrainTileNode* tile, const TerrainTileNode* parent, vsg
             _loadElevation.push_back(tile->key);
 #endif
 
-        bool parentHasData = (parent == nullptr || parent->dataMerger.available());
-        if (parentHasData && tile->dataLoader.empty())
+        if (requests.loadData)
             _loadData.push_back(tile->key);
+
+        // This will only queue one merge per frame, to prevent overloading
+        // the (synchronous) update cycle in VSG.
+        if (requests.mergeData)
+            _mergeData.push_back(tile->key);
+
+        if (requests.unloadSubtiles)
+            _unloadSubtiles.push_back(tile->key);
+
+        // refresh parents ahead of their subtiles, which may inherit their data
+        bool parentRefreshed = (parent == nullptr || (!parent->_needsRefresh && parent->dataRefresher.empty()));
+        if (parentRefreshed && tile->_needsRefresh && tile->dataMerger.available() && tile->dataRefresher.empty())
+            _refreshData.push_back(tile->key);
 #endif
 
     }
@@ -137,10 +310,8 @@ TerrainTilePager::ping(TerrainTileNode* tile, const TerrainTileNode* parent, vsg
         _mergeElevation.push_back(tile->key);
 #endif
 
-    // This will only queue one merge per frame, to prevent overloading
-    // the (synchronous) update cycle in VSG.
-    if (tile->dataLoader.available() && tile->dataMerger.empty())
-        _mergeData.push_back(tile->key);
+    if (tile->dataRefresher.available() && !tile->refreshMerger.working())
+        _mergeRefresh.push_back(tile->key);
 
     if (tile->_needsUpdate)
         _updateData.push_back(tile->key);
@@ -165,6 +336,9 @@ TerrainTilePager::update(
     //    << "needsLoad=" << _loadData.size() << " "
     //    << "needsMerge=" << _mergeData.size() << std::endl;
 
+    // find the tiles whose layers changed
+    markDirtyTiles(terrain);
+
     // update any tiles that asked for it
     for (auto& key : _updateData)
     {
@@ -176,6 +350,17 @@ TerrainTilePager::update(
     }
     _updateData.clear();
 
+    // drop any subtiles loaded ahead of a camera that went elsewhere
+    for (auto& key : _unloadSubtiles)
+    {
+        auto iter = _tiles.find(key);
+        if (iter != _tiles.end() && iter->second._tile->_subdivision.needsUnloadSubtiles)
+        {
+            iter->second._tile->unloadSubtiles(terrain->runtime);
+        }
+    }
+    _unloadSubtiles.clear();
+
     // launch any "new subtiles" requests
     for (auto& key : _loadSubtiles)
     {
@@ -186,7 +371,7 @@ TerrainTilePager::update(
                 iter->second._tile, // parent
                 terrain);  // context
 
-            iter->second._tile->_needsSubtiles = false;
+            iter->second._tile->_subdivision.needsSubtiles = false;
         }
     }
     _loadSubtiles.clear();
@@ -237,30 +422,108 @@ TerrainTilePager::update(
     }
     _mergeData.clear();
 
-    // Flush unused tiles (i.e., tiles that failed to ping) out of the system.
-    // Tiles ping their children all at once; this should in theory prevent
-    // a child from expiring without its siblings.
-    const auto dispose = [&](TerrainTileNode* tile)
+    // reload the layers that changed in any visible tiles
+    for (auto& key : _refreshData)
+    {
+        auto iter = _tiles.find(key);
+        if (iter != _tiles.end())
+        {
+            requestRefreshData(iter->second._tile, io, terrain);
+        }
+    }
+    _refreshData.clear();
+
+    for (auto& key : _mergeRefresh)
     {
-        if (!tile->doNotExpire)
+        auto iter = _tiles.find(key);
+        if (iter != _tiles.end())
         {
-            auto key = tile->key;
-            auto parent_iter = _tiles.find(key.createParentKey());
-            if (parent_iter != _tiles.end())
+            requestMergeRefresh(iter->second._tile, terrain);
+        }
+    }
+    _mergeRefresh.clear();
+
+    // normalize the edges of tiles whose neighbors changed, a few at a time
+    if (_settings.normalizeEdges.value())
+    {
+        const unsigned maxEdgeFixupsPerFrame = _settings.maxEdgeFixupsPerFrame.value();
+
+        std::unordered_set<TileKey> fixups;
+        for (auto iter = _edgeFixups.begin(); iter != _edgeFixups.end() && fixups.size() < maxEdgeFixupsPerFrame; )
+        {
+            fixups.emplace(*iter);
+            iter = _edgeFixups.erase(iter);
+        }
+
+        for (auto& key : fixups)
+        {
+            auto iter = _tiles.find(key);
+            if (iter != _tiles.end() && normalize(*iter->second._tile))
             {
-                auto parent = parent_iter->second._tile;
-                if (parent.valid())
-                {
-                    parent->unloadSubtiles(terrain->runtime);
-                }
+                auto& tile = iter->second._tile;
+
+                terrain->stateFactory.updateTerrainTileDescriptors(
+                    tile->renderModel,
+                    tile->stategroup,
+                    tile->atlasEntry,
+                    terrain->runtime);
+
+                tile->residentBytes = textureBytes(tile->renderModel) + dataBytes(tile->dataModel);
+
+                // finer tiles following this one's edges follow it again, except
+                // the ones just normalized, so two tiles can't keep requeuing each other
+                queueEdgeFixups(key, &fixups);
             }
-            _tiles.erase(key);
-            return true;
         }
-        return false;
+    }
+
+    // Expire unused tiles (i.e., tiles that failed to ping), least recently
+    // used first. Tiles ping their children all at once; this should in
+    // theory prevent a child from expiring without its siblings.
+    _residentBytes = terrain->geometryPool.sizeInBytes();
+    for (auto& entry : _tiles)
+        _residentBytes += entry.second._tile->residentBytes;
+
+    unsigned unloaded = 0u;
+
+    const auto dispose = [&](TerrainTileNode* tile)
+    {
+        auto key = tile->key;
+        auto parent_iter = _tiles.find(key.createParentKey());
+        auto parent = parent_iter != _tiles.end() ? parent_iter->second._tile : vsg::ref_ptr<TerrainTileNode>();
+
+        TerrainTilePolicy::Usage usage;
+        usage.doNotExpire = tile->doNotExpire;
+        usage.orphaned = !parent.valid() || !parent->subtilesExist() ||
+            parent->subTile(key.getQuadrant()) != tile;
+        usage.framesUnused = fs->frameCount - tile->lastTraversalFrame;
+        usage.secondsUnused = std::chrono::duration<double>(fs->time - tile->lastTraversalTime.load()).count();
+        usage.range = tile->lastTraversalRange;
+
+        auto expiry = TerrainTilePolicy::expire(_settings, usage, _residentBytes, _tiles.size(), unloaded);
+
+        if (expiry == TerrainTilePolicy::Expiry::Keep)
+            return false;
+
+        if (expiry == TerrainTilePolicy::Expiry::ExpireWithSiblings)
+        {
+            parent->unloadSubtiles(terrain->runtime);
+            ++unloaded;
+        }
+
+        _residentBytes -= tile->residentBytes;
+        _tiles.erase(key);
+
+        // neighbors that shared edges with the tile now meet whatever replaces it
+        if (_settings.normalizeEdges.value())
+            queueEdgeFixups(key);
+
+        return true;
     };
 
-    _tracker.flush(~0, dispose);
+    _tracker.flushOldestFirst(~0, dispose);
+
+    ROCKY_PROFILING_PLOT("Terrain resident bytes", (int64_t)_residentBytes);
 }
 
 vsg::ref_ptr<TerrainTileNode>
@@ -283,18 +546,20 @@ TerrainTilePager::createTile(
         nullptr);
 
     // initialize all the per-tile uniforms the shaders will need:
-    float range, morphStart, morphEnd;
-    getRanges(key, range, morphStart, morphEnd);
-    float one_over_end_minus_start = 1.0f / (morphEnd - morphStart);
-    auto morphConstants = glm::fvec2(morphEnd * one_over_end_minus_start, one_over_end_minus_start);
+    auto& lod = _lods[key.levelOfDetail()];
+    auto morphRange = glm::fvec2(lod.morphStart, lod.morphEnd);
 
-    // Calculate the visibility range for this tile's children.
+    // Calculate the visibility and morph ranges for this tile's children.
     float childrenVisibilityRange = FLT_MAX;
+    auto childrenMorphRange = glm::fvec2(0.0f, 0.0f);
     if (key.levelOfDetail() < (_lods.size() - 1))
     {
         auto[tw, th] = key.profile().numTiles(key.levelOfDetail());
         TileKey testKey = key.createChildKey((key.tileY() <= th / 2) ? 0 : 3);
         childrenVisibilityRange = getRange(testKey);
+
+        auto& childLOD = _lods[key.levelOfDetail() + 1];
+        childrenMorphRange = glm::fvec2(childLOD.morphStart, childLOD.morphEnd);
     }
 
     // Make the new terrain tile
@@ -302,7 +567,8 @@ TerrainTilePager::createTile(
         key,
         parent,
         geometry,
-        morphConstants,
+        morphRange,
+        childrenMorphRange,
         childrenVisibilityRange,
         terrain->worldSRS,
         terrain->stateFactory.defaultTileDescriptors,
@@ -320,11 +586,30 @@ TerrainTilePager::createTile(
     terrain->stateFactory.updateTerrainTileDescriptors(
         tile->renderModel,
         tile->stategroup,
+        tile->atlasEntry,
         terrain->runtime);
 
+    tile->residentBytes = textureBytes(tile->renderModel);
+
     return tile;
 }
 
+void
+TerrainTilePager::trackCamera(const glm::dvec3& eye, double maxMotion, vsg::RecordTraversal& rv)
+{
+    auto& view = _views[rv.getState()->_commandBuffer->viewID];
+    auto time = std::chrono::duration<double>(rv.getFrameStamp()->time.time_since_epoch()).count();
+
+    view.camera.update(eye, time);
+    view.motion = view.camera.displacement(_settings.prefetchSeconds.value(), maxMotion);
+}
+
+const glm::dvec3&
+TerrainTilePager::predictedMotion(vsg::RecordTraversal& rv) const
+{
+    return _views[rv.getState()->_commandBuffer->viewID].motion;
+}
+
 vsg::ref_ptr<TerrainTileNode>
 TerrainTilePager::getTile(const TileKey& key) const
 {
@@ -382,11 +667,15 @@ TerrainTilePager::requestLoadSubtiles(
         return result;
     };
 
-    // a callback that will return the loading priority of a tile
+    // a callback that will return the loading priority of a tile;
+    // subtiles the camera doesn't need yet rank with the level they're on.
     auto priority_func = [weak_parent]() -> float
     {
         auto tile = weak_parent.ref_ptr();
-        return tile ? -(sqrt(tile->lastTraversalRange) * tile->key.levelOfDetail()) : 0.0f;
+        if (!tile)
+            return 0.0f;
+        unsigned lod = tile->key.levelOfDetail() + (tile->_subdivision.subtilesPrefetched ? 1 : 0);
+        return TerrainTilePolicy::priority(tile->lastTraversalRange, lod);
     };
 
     parent->subtilesLoader = engine->runtime.compileAndAddChild(
@@ -436,8 +725,7 @@ TerrainTilePager::requestLoadData(
         }
 
         TerrainTileModelFactory factory;
-
-        factory.compositeColorLayers = true;
+        configure(factory, *engine);
 
         auto model = factory.createTileModel(
             engine->map.get(),
@@ -454,7 +742,7 @@ TerrainTilePager::requestLoadData(
     auto priority_func = [tile_weak]() -> float
     {
         vsg::ref_ptr<TerrainTileNode> tile = tile_weak.ref_ptr();
-        return tile ? -(sqrt(tile->lastTraversalRange) * tile->key.levelOfDetail()) : 0.0f;
+        return tile ? TerrainTilePolicy::priority(tile->lastTraversalRange, tile->key.levelOfDetail()) : 0.0f;
     };
 
     tile->dataLoader = jobs::dispatch(
@@ -501,63 +789,200 @@ TerrainTilePager::requestMergeData(
             return false;
         }
 
-        auto model = tile->dataLoader.value();
+        tile->dataModel = tile->dataLoader.value();
 
         auto& renderModel = tile->renderModel;
 
-        bool updated = false;
+        bool updated = mergeModel(*tile, tile->dataModel);
 
-        if (model.colorLayers.size() > 0)
+        if (engine->settings.normalizeEdges.value() && tile->dataModel.elevation.heightfield.valid())
         {
-            auto& layer = model.colorLayers[0];
-            if (layer.image.valid())
-            {
-                renderModel.color.name = "color " + layer.key.str();
-                renderModel.color.image = layer.image.image();
-                renderModel.color.matrix = layer.matrix;
-            }
-            updated = true;
+            if (engine->tiles.normalizeEdges(*tile))
+                updated = true;
         }
 
-#ifndef LOAD_ELEVATION_SEPARATELY
-        if (model.elevation.heightfield.valid())
+        renderModel.modelMatrix = to_glm(tile->surface->matrix);
+
+        if (updated)
         {
-            renderModel.elevation.name = "elevation " + model.elevation.key.str();
-            renderModel.elevation.image = model.elevation.heightfield.heightfield();
-            renderModel.elevation.matrix = model.elevation.matrix;
+            engine->stateFactory.updateTerrainTileDescriptors(
+                renderModel,
+                tile->stategroup,
+                tile->atlasEntry,
+                engine->runtime);
 
-            // prompt the tile can update its bounds
-            tile->setElevation(
-                renderModel.elevation.image,
-                renderModel.elevation.matrix);
+            tile->residentBytes = textureBytes(renderModel) + dataBytes(tile->dataModel);
 
-            updated = true;
+            //RP_DEBUG << "mergeData -> " << key.str() << std::endl;
+        }
+        else
+        {
+            //RP_DEBUG << "merge EMPTY TILE MODEL -> " << key.str() << std::endl;
         }
 
-        if (model.normalMap.image.valid())
+        return true;
+    };
+
+    auto merge_op = util::PromiseOperation<bool>::create(merge);
+
+    tile->dataMerger = merge_op->future();
+
+    vsg::observer_ptr<TerrainTileNode> tile_weak(tile);
+    auto priority_func = [tile_weak]() -> float
+    {
+        vsg::ref_ptr<TerrainTileNode> tile = tile_weak.ref_ptr();
+        return tile ? TerrainTilePolicy::priority(tile->lastTraversalRange, tile->key.levelOfDetail()) : 0.0f;
+    };
+
+    engine->runtime.runDuringUpdate(merge_op, priority_func);
+}
+
+void
+TerrainTilePager::requestRefreshData(
+    vsg::ref_ptr<TerrainTileNode> tile,
+    const IOOptions& in_io,
+    shared_ptr<TerrainEngine> engine) const
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(tile, void());
+
+    // make sure we're not already working on it
+    if (!tile->dataRefresher.empty())
+    {
+        return;
+    }
+
+    auto key = tile->key;
+
+    // changes from here on go into the next refresh
+    auto manifest = tile->_refreshManifest;
+    tile->_refreshManifest = CreateTileManifest();
+    tile->_refreshingManifest = manifest;
+    tile->_needsRefresh = false;
+
+    // composite the layers that didn't change from what the tile already has
+    auto reuse = tile->dataModel.colorLayerSources;
+
+    const IOOptions io(in_io);
+
+    auto load = [key, manifest, reuse, engine, io](Cancelable& p) -> TerrainTileModel
+    {
+        if (p.canceled())
         {
-            renderModel.elevation.name = "normal " + model.normalMap.key.str();
-            renderModel.normal.image = model.normalMap.image.image();
-            renderModel.normal.matrix = model.normalMap.matrix;
+            return { };
+        }
 
-            updated = true;
+        TerrainTileModelFactory factory;
+        configure(factory, *engine);
+        factory.reuseColorLayers = reuse;
+
+        auto model = factory.createTileModel(
+            engine->map.get(),
+            key,
+            manifest,
+            IOOptions(io, p));
+
+        return model;
+    };
+
+    vsg::observer_ptr<TerrainTileNode> tile_weak(tile);
+    auto priority_func = [tile_weak]() -> float
+    {
+        vsg::ref_ptr<TerrainTileNode> tile = tile_weak.ref_ptr();
+        return tile ? TerrainTilePolicy::priority(tile->lastTraversalRange, tile->key.levelOfDetail()) : 0.0f;
+    };
+
+    tile->dataRefresher = jobs::dispatch(
+        load,
+        jobs::context {
+            "refresh data " + key.str(),
+            jobs::get_pool(engine->loadSchedulerName),
+            priority_func,
+            nullptr
+        } );
+}
+
+void
+TerrainTilePager::requestMergeRefresh(
+    vsg::ref_ptr<TerrainTileNode> tile,
+    shared_ptr<TerrainEngine> engine) const
+{
+    ROCKY_SOFT_ASSERT_AND_RETURN(tile, void());
+
+    // make sure we're not already working on it
+    if (tile->refreshMerger.working())
+    {
+        return;
+    }
+
+    auto key = tile->key;
+
+    auto merge = [key, engine](Cancelable& p) -> bool
+    {
+        if (p.canceled())
+        {
+            return false;
         }
-#endif
 
-        renderModel.modelMatrix = to_glm(tile->surface->matrix);
+        auto tile = engine->tiles.getTile(key);
+        if (!tile)
+        {
+            return false;
+        }
+
+        auto model = tile->dataRefresher.release();
+        auto& manifest = tile->_refreshingManifest;
+
+        // Apply only what the refresh reloaded, and carry it into the tile's
+        // data so the next refresh starts from here.
+        TerrainTileModel changes;
+        bool inherit = false;
+
+        if (manifest.includesColor())
+        {
+            tile->dataModel.colorLayers = model.colorLayers;
+            tile->dataModel.colorLayerSources = model.colorLayerSources;
+            tile->dataModel.requiresUpdate = model.requiresUpdate;
+            changes.colorLayers = model.colorLayers;
+
+            // no data of its own anymore, so show the parent's as a new tile would
+            inherit = model.colorLayers.empty();
+        }
+
+        if (manifest.includesElevation())
+        {
+            tile->dataModel.elevation = model.elevation;
+            tile->dataModel.normalMap = model.normalMap;
+            changes.elevation = model.elevation;
+            changes.normalMap = model.normalMap;
+        }
+
+        bool updated = mergeModel(*tile, changes);
+
+        if (engine->settings.normalizeEdges.value() && changes.elevation.heightfield.valid())
+        {
+            if (engine->tiles.normalizeEdges(*tile))
+                updated = true;
+        }
+
+        if (inherit)
+        {
+            auto parent = engine->tiles.getTile(key.createParentKey());
+            if (parent)
+            {
+                tile->inheritColorFrom(*parent);
+                updated = true;
+            }
+        }
 
         if (updated)
         {
             engine->stateFactory.updateTerrainTileDescriptors(
-                renderModel,
+                tile->renderModel,
                 tile->stategroup,
+                tile->atlasEntry,
                 engine->runtime);
 
-            //RP_DEBUG << "mergeData -> " << key.str() << std::endl;
-        }
-        else
-        {
-            //RP_DEBUG << "merge EMPTY TILE MODEL -> " << key.str() << std::endl;
+            tile->residentBytes = textureBytes(tile->renderModel) + dataBytes(tile->dataModel);
         }
 
         return true;
@@ -565,18 +990,338 @@ TerrainTilePager::requestMergeData(
 
     auto merge_op = util::PromiseOperation<bool>::create(merge);
 
-    tile->dataMerger = merge_op->future();
+    tile->refreshMerger = merge_op->future();
 
     vsg::observer_ptr<TerrainTileNode> tile_weak(tile);
     auto priority_func = [tile_weak]() -> float
     {
         vsg::ref_ptr<TerrainTileNode> tile = tile_weak.ref_ptr();
-        return tile ? -(sqrt(tile->lastTraversalRange) * tile->key.levelOfDetail()) : 0.0f;
+        return tile ? TerrainTilePolicy::priority(tile->lastTraversalRange, tile->key.levelOfDetail()) : 0.0f;
     };
 
     engine->runtime.runDuringUpdate(merge_op, priority_func);
 }
 
+void
+TerrainTilePager::markDirtyTiles(shared_ptr<TerrainEngine> terrain)
+{
+    std::unordered_map<UID, Revision> revisions;
+
+    for (auto& layer : terrain->map->layers().all())
+    {
+        auto revision = layer->revision();
+        revisions[layer->uid()] = revision;
+
+        // a new layer; the tiles load it as usual
+        auto iter = _layerRevisions.find(layer->uid());
+        if (iter == _layerRevisions.end() || iter->second == revision)
+            continue;
+
+        // only these layers contribute to the tiles' data
+        if (_tiles.empty() || (!ImageLayer::cast(layer) && !ElevationLayer::cast(layer)))
+            continue;
+
+        const SRS& srs = _tiles.begin()->first.profile().srs();
+
+        std::vector<GeoExtent> extents;
+        if (!layer->dirtyExtents(iter->second, extents))
+        {
+            extents = { layer->extent() };
+        }
+
+        // an invalid extent means anywhere
+        for (auto& extent : extents)
+        {
+            if (extent.valid() && !extent.srs().isHorizEquivalentTo(srs))
+                extent = extent.transform(srs);
+        }
+
+        for (auto& entry : _tiles)
+        {
+            auto& tile = entry.second._tile;
+
+            // tiles yet to start loading will load the latest data anyway
+            if (tile->dataLoader.empty())
+                continue;
+
+            auto tileExtent = entry.first.extent();
+            for (auto& extent : extents)
+            {
+                if (!extent.valid() || extent.intersects(tileExtent, false))
+                {
+                    tile->_refreshManifest.insert(layer);
+                    tile->_needsRefresh = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    _layerRevisions.swap(revisions);
+}
+
+bool
+TerrainTilePager::normalizeEdges(TerrainTileNode& tile)
+{
+    std::scoped_lock lock(_mutex);
+
+    bool changed = normalize(tile);
+
+    // the neighbors share edges with the data this tile had before
+    queueEdgeFixups(tile.key);
+
+    return changed;
+}
+
+const TerrainTileNode*
+TerrainTilePager::drawnAt(TileKey key) const
+{
+    // Subtiles load in quads under a resident parent, so the nearest resident
+    // tile covering a key is the one drawn there. That is an approximation:
+    // a resident tile may still draw in place of its resident subtiles.
+    do
+    {
+        auto iter = _tiles.find(key);
+        if (iter != _tiles.end())
+            return iter->second._tile.get();
+    }
+    while (key.makeParent());
+
+    return nullptr;
+}
+
+bool
+TerrainTilePager::normalize(TerrainTileNode& tile) const
+{
+    auto& original = tile.dataModel.elevation.heightfield;
+    if (!original.valid())
+        return false;
+
+    auto hf = original.heightfield()->decode();
+    const auto& key = tile.key;
+    const unsigned lod = key.levelOfDetail();
+    const unsigned segments = _settings.tileSize.value() - 1;
+    const int tx = (int)key.profile().numTiles(lod).first;
+
+    // whether a tile draws the data it loaded for a key, rather than a stand-in
+    auto hasOwnData = [](const TerrainTileNode* other, const TileKey& otherkey)
+        {
+            return other->key == otherkey && other->dataModel.elevation.heightfield.valid();
+        };
+
+    // location of a point on the tile grid of this LOD (column, and row from the
+    // north) in the coordinates of a tile at this LOD or a coarser one
+    auto toUV = [&](const TerrainTileNode* other, int c, int r)
+        {
+            int scale = 1 << (lod - other->key.levelOfDetail());
+            int x = c - (int)other->key.tileX() * scale;
+            int y = r - (int)other->key.tileY() * scale;
+
+            // across the antimeridian
+            if (x < 0) x += tx;
+            else if (x > scale) x -= tx;
+
+            return glm::dvec2((double)x / (double)scale, 1.0 - (double)y / (double)scale);
+        };
+
+    // height of the surface another tile draws at a point on its boundary
+    auto drawnHeight = [&](const TerrainTileNode* other, int c, int r)
+        {
+            auto uv = toUV(other, c, r);
+            return HeightfieldEdges::boundaryHeight(
+                *Heightfield::cast_from(other->renderModel.elevation.image.get()),
+                other->renderModel.elevation.matrix,
+                segments,
+                uv.x, uv.y);
+        };
+
+    auto drawsElevation = [](const TerrainTileNode* other)
+        {
+            return Heightfield::cast_from(other->renderModel.elevation.image.get()) != nullptr;
+        };
+
+    const int col = (int)key.tileX();
+    const int row = (int)key.tileY();
+
+    struct Side {
+        HeightfieldEdges::Side side;
+        int dx, dy;                 // offset of the neighbor
+        int c0, r0, c1, r1;         // ends of the side, south/west first
+    };
+
+    const Side sides[4] = {
+        { HeightfieldEdges::WEST,  -1,  0, 0, 1, 0, 0 },
+        { HeightfieldEdges::EAST,   1,  0, 1, 1, 1, 0 },
+        { HeightfieldEdges::SOUTH,  0,  1, 0, 1, 1, 1 },
+        { HeightfieldEdges::NORTH,  0, -1, 0, 0, 1, 0 }
+    };
+
+    for (auto& side : sides)
+    {
+        auto neighborkey = neighborKey(key, side.dx, side.dy);
+        auto neighbor = neighborkey.valid() ? drawnAt(neighborkey) : nullptr;
+        if (!neighbor)
+            continue;
+
+        // a neighbor at the same LOD shares the average of both tiles' data;
+        // any other neighbor stays as it is and this tile follows its surface
+        if (hasOwnData(neighbor, neighborkey) &&
+            HeightfieldEdges::average(*hf, side.side, *neighbor->dataModel.elevation.heightfield.heightfield()))
+        {
+            continue;
+        }
+
+        if (drawsElevation(neighbor))
+        {
+            auto start = toUV(neighbor, col + side.c0, row + side.r0);
+            auto end = toUV(neighbor, col + side.c1, row + side.r1);
+            bool vertical = side.side == HeightfieldEdges::WEST || side.side == HeightfieldEdges::EAST;
+
+            HeightfieldEdges::follow(
+                *hf, side.side,
+                *Heightfield::cast_from(neighbor->renderModel.elevation.image.get()),
+                neighbor->renderModel.elevation.matrix,
+                segments,
+                vertical ? start.y : start.x,
+                vertical ? end.y : end.x);
+        }
+    }
+
+    // Up to four tiles meet at a corner, so it can't come from one side alone. Every
+    // tile there takes the same height: on the coarsest surface drawn around it if
+    // there is one, otherwise the average of all four tiles' data.
+    for (int cy = 0; cy <= 1; ++cy)
+    {
+        for (int cx = 0; cx <= 1; ++cx)
+        {
+            const TerrainTileNode* coarsest = nullptr;
+            float sum = 0.0f;
+            unsigned count = 0;
+
+            for (int dy = cy - 1; dy <= cy; ++dy)
+            {
+                for (int dx = cx - 1; dx <= cx; ++dx)
+                {
+                    const Heightfield* data = original.heightfield().get();
+
+                    if (dx != 0 || dy != 0)
+                    {
+                        auto neighborkey = neighborKey(key, dx, dy);
+                        auto neighbor = neighborkey.valid() ? drawnAt(neighborkey) : nullptr;
+                        if (!neighbor)
+                            continue;
+
+                        if (hasOwnData(neighbor, neighborkey))
+                        {
+                            data = neighbor->dataModel.elevation.heightfield.heightfield().get();
+                        }
+                        else
+                        {
+                            if (drawsElevation(neighbor) &&
+                                (!coarsest || neighbor->key.levelOfDetail() < coarsest->key.levelOfDetail()))
+                            {
+                                coarsest = neighbor;
+                            }
+                            continue;
+                        }
+                    }
+
+                    // the corner is at column (cx - dx) and row from the north (cy - dy) of that tile
+                    float h = data->heightAt(
+                        (cx - dx) * (data->width() - 1),
+                        (1 - (cy - dy)) * (data->height() - 1));
+
+                    if (h != NO_DATA_VALUE)
+                    {
+                        sum += h;
+                        ++count;
+                    }
+                }
+            }
+
+            float& corner = hf->heightAt(cx * (hf->width() - 1), (1 - cy) * (hf->height() - 1));
+
+            if (coarsest)
+                corner = drawnHeight(coarsest, col + cx, row + cy);
+            else if (count > 0)
+                corner = sum / (float)count;
+        }
+    }
+
+    shared_ptr<Heightfield> result = hf;
+    if (original.heightfield()->pixelFormat() != Image::R32_SFLOAT)
+    {
+        result = hf->encode(original.heightfield()->pixelFormat());
+    }
+
+    // no change from what the tile draws now
+    auto current = Heightfield::cast_from(tile.renderModel.elevation.image.get());
+    if (current && tile.renderModel.elevation.matrix == glm::dmat4(1) && sameEdges(*current, *result))
+    {
+        return false;
+    }
+
+    auto& renderModel = tile.renderModel;
+    renderModel.elevation.name = "elevation " + key.str();
+    renderModel.elevation.image = result;
+    renderModel.elevation.matrix = glm::dmat4(1);
+    renderModel.elevationPyramid = std::make_shared<HeightfieldPyramid>(result.get());
+
+    tile.setElevation(
+        renderModel.elevation.image,
+        renderModel.elevation.matrix,
+        renderModel.elevationPyramid);
+
+    return true;
+}
+
+void
+TerrainTilePager::queueEdgeFixups(const TileKey& key, const std::unordered_set<TileKey>* except)
+{
+    struct Entry {
+        TileKey key;
+        int dx, dy; // direction from the entry toward the tile
+    };
+
+    std::vector<Entry> stack;
+
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            if (dx != 0 || dy != 0)
+            {
+                auto neighborkey = neighborKey(key, dx, dy);
+                if (neighborkey.valid())
+                    stack.push_back({ neighborkey, -dx, -dy });
+            }
+        }
+    }
+
+    while (!stack.empty())
+    {
+        auto entry = stack.back();
+        stack.pop_back();
+
+        if (_tiles.find(entry.key) == _tiles.end())
+            continue;
+
+        if (!except || except->count(entry.key) == 0)
+            _edgeFixups.insert(entry.key);
+
+        // subtiles on the side facing the tile (quadrant 0 is the northwest)
+        for (unsigned quadrant = 0; quadrant < 4; ++quadrant)
+        {
+            int qx = (int)(quadrant & 1), qy = (int)(quadrant >> 1);
+            if ((entry.dx == 0 || qx == (entry.dx > 0 ? 1 : 0)) &&
+                (entry.dy == 0 || qy == (entry.dy > 0 ? 1 : 0)))
+            {
+                stack.push_back({ entry.key.createChildKey(quadrant), entry.dx, entry.dy });
+            }
+        }
+    }
+}
+
 void
 TerrainTilePager::requestLoadElevation(
     vsg::ref_ptr<TerrainTileNode> tile,
@@ -609,6 +1354,10 @@ TerrainTilePager::requestLoadElevation(
 
         TerrainTileModelFactory factory;
 
+        auto encoding = Heightfield::encoding(engine->settings.elevationEncoding.value());
+        if (encoding != Image::UNDEFINED)
+            factory.elevationEncoding = encoding;
+
         auto model = factory.createTileModel(
             engine->map.get(),
             key,
@@ -676,11 +1425,13 @@ TerrainTilePager::requestMergeElevation(
             {
                 renderModel.elevation.image = model.elevation.heightfield.heightfield();
                 renderModel.elevation.matrix = model.elevation.matrix;
+                renderModel.elevationPyramid = model.elevation.pyramid;
 
                 // prompt the tile can update its bounds
                 tile->setElevation(
                     renderModel.elevation.image,
-                    renderModel.elevation.matrix);
+                    renderModel.elevation.matrix,
+                    renderModel.elevationPyramid);
 
                 updated = true;
             }
@@ -697,6 +1448,7 @@ TerrainTilePager::requestMergeElevation(
                 engine->stateFactory.updateTerrainTileDescriptors(
                     renderModel,
                     tile->stategroup,
+                    tile->atlasEntry,
                     engine->runtime);
 
                 Log::info() << "Elevation merged for " << key.str() << std::endl;
@@ -743,15 +1495,11 @@ TerrainTilePager::initializeLODs(const Profile& profile, const TerrainSettings&
 
     double metersPerEquatorialDegree = (profile.srs().ellipsoid().semiMajorAxis() * 2.0 * M_PI) / 360.0;
 
-    double prevPos = 0.0;
-
     for (int lod = (int)(numLods - 1); lod >= 0; --lod)
     {
-        double span = _lods[lod].visibilityRange - prevPos;
-
-        _lods[lod].morphEnd = _lods[lod].visibilityRange;
-        _lods[lod].morphStart = prevPos + span * (0.66);
-        prevPos = _lods[lod].morphEnd;
+        auto morphRange = TerrainTilePolicy::computeMorphRange(profile, lod);
+        _lods[lod].morphStart = morphRange[0];
+        _lods[lod].morphEnd = morphRange[1];
 
         // Calc the maximum valid TY (to avoid over-subdivision at the poles)
         // In a geographic map, this will effectively limit the maximum LOD
@@ -784,30 +1532,6 @@ TerrainTilePager::initializeLODs(const Profile& profile, const TerrainSettings&
     }
 }
 
-void
-TerrainTilePager::getRanges(
-    const TileKey& key,
-    float& out_range,
-    float& out_startMorphRange,
-    float& out_endMorphRange) const
-{
-    out_range = 0.0f;
-    out_startMorphRange = 0.0f;
-    out_endMorphRange = 0.0f;
-
-    if (key.levelOfDetail() < _lods.size())
-    {
-        const LOD& lod = _lods[key.levelOfDetail()];
-
-        if (key.tileY() >= lod.minValidTY && key.tileY() <= lod.maxValidTY)
-        {
-            out_range = lod.visibilityRange;
-            out_startMorphRange = lod.morphStart;
-            out_endMorphRange = lod.morphEnd;
-        }
-    }
-}
-
 float
 TerrainTilePager::getRange(const TileKey& key) const
 {
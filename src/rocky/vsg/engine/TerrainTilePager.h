@@ -7,8 +7,11 @@
 
 #include <rocky/vsg/Common.h>
 #include <rocky/vsg/engine/TerrainTileNode.h>
+#include <rocky/vsg/engine/ViewLocal.h>
+#include <rocky/CameraPredictor.h>
 #include <rocky/SentryTracker.h>
 #include <chrono>
+#include <unordered_set>
 
 namespace ROCKY_NAMESPACE
 {
@@ -58,6 +61,10 @@ namespace ROCKY_NAMESPACE
         //! Number of tiles in the registry.
         unsigned size() const { return _tiles.size(); }
 
+        //! Memory used by the resident tiles and their geometry, in bytes,
+        //! as of the last update. See TerrainSettings::memoryBudget.
+        std::size_t residentBytes() const { return _residentBytes; }
+
         //! Empty the registry, releasing all tiles.
         void releaseAll();
 
@@ -73,11 +80,32 @@ namespace ROCKY_NAMESPACE
             vsg::ref_ptr<TerrainTileNode> parent,
             shared_ptr<TerrainEngine> terrain);
 
+        //! Records the eye position of the view being recorded, from which
+        //! the pager predicts the tiles it will need next.
+        //! ONLY call during record, once per view, before the tiles.
+        //! @param eye Eye position in world coordinates
+        //! @param maxMotion Farthest the camera may be predicted to move
+        void trackCamera(
+            const glm::dvec3& eye,
+            double maxMotion,
+            vsg::RecordTraversal&);
+
+        //! Motion expected of the camera of the view being recorded over
+        //! the next TerrainSettings::prefetchSeconds.
+        const glm::dvec3& predictedMotion(vsg::RecordTraversal&) const;
+
         //! Fetches a tile by its key.
         //! @param key TileKey for which to fetch a tile
         //! @return The tile, if it exists
         vsg::ref_ptr<TerrainTileNode> getTile(const TileKey& key) const;
 
+        //! Makes the edges of a tile whose elevation data just merged agree
+        //! with its resident neighbors (see TerrainSettings::normalizeEdges),
+        //! and queues the neighbors that depend on it to do the same.
+        //! ONLY call during update.
+        //! @return True if the tile's elevation changed
+        bool normalizeEdges(TerrainTileNode& tile);
+
     //protected:
 
         TileTable _tiles;
@@ -86,6 +114,7 @@ namespace ROCKY_NAMESPACE
         TerrainTileHost* _host;
         const TerrainSettings& _settings;
         bool _updateViewerRequired = false;
+        std::size_t _residentBytes = 0u;
 
         std::vector<TileKey> _loadSubtiles;
         std::vector<TileKey> _loadElevation;
@@ -93,6 +122,22 @@ namespace ROCKY_NAMESPACE
         std::vector<TileKey> _loadData;
         std::vector<TileKey> _mergeData; 
         std::vector<TileKey> _updateData;
+        std::vector<TileKey> _refreshData;
+        std::vector<TileKey> _mergeRefresh;
+        std::vector<TileKey> _unloadSubtiles;
+
+        //! Layer revisions as of the last update, to detect changes
+        std::unordered_map<UID, Revision> _layerRevisions;
+
+        //! Tiles to normalize again because a neighbor changed or expired
+        std::unordered_set<TileKey> _edgeFixups;
+
+        struct ViewData
+        {
+            CameraPredictor camera;
+            glm::dvec3 motion = { 0, 0, 0 };
+        };
+        util::ViewLocal<ViewData> _views;
 
         //! Visibility info for a single terrain tile LOD
         struct LOD {
@@ -131,11 +176,32 @@ namespace ROCKY_NAMESPACE
             const IOOptions& io,
             shared_ptr<TerrainEngine> terrain) const;
 
-        void getRanges(
-            const TileKey& key,
-            float& out_range,
-            float& out_startMorphRange,
-            float& out_endMorphRange) const;
+        void requestRefreshData(
+            vsg::ref_ptr<TerrainTileNode> tile,
+            const IOOptions& io,
+            shared_ptr<TerrainEngine> terrain) const;
+
+        void requestMergeRefresh(
+            vsg::ref_ptr<TerrainTileNode> tile,
+            shared_ptr<TerrainEngine> terrain) const;
+
+        //! Marks the resident tiles that intersect the extents reported
+        //! by layers that changed (see Layer::dirty), for refresh
+        void markDirtyTiles(shared_ptr<TerrainEngine> terrain);
+
+        //! Resident tile that draws over a key: the tile at that key, or
+        //! the nearest ancestor standing in for it
+        const TerrainTileNode* drawnAt(TileKey key) const;
+
+        //! Rebuilds a tile's elevation from its data, with the samples along its
+        //! edges shared with, or following, whatever its neighbors draw
+        //! @return True if the tile's elevation changed
+        bool normalize(TerrainTileNode& tile) const;
+
+        //! Queues for normalizing the resident tiles whose edges depend on a tile:
+        //! its neighbors at the same LOD and their descendants that touch it
+        //! @param except Tiles not to queue, if any
+        void queueEdgeFixups(const TileKey& key, const std::unordered_set<TileKey>* except = nullptr);
 
         float getRange(const TileKey& key) const;
     };
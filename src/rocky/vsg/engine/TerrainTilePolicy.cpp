@@ -0,0 +1,242 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "TerrainTilePolicy.h"
+
+#include <rocky/vsg/TerrainSettings.h>
+#include <rocky/Horizon.h>
+#include <rocky/Profile.h>
+#include <rocky/TileKey.h>
+
+using namespace ROCKY_NAMESPACE;
+
+namespace
+{
+    // nominal size of a tile on screen, in pixels, for the screen-space error test
+    const float TILE_SIZE_PIXELS = 256.0f;
+}
+
+bool
+TerrainTilePolicy::isBoxVisible(const glm::dvec3 (&corners)[8], const glm::dvec4* planes, unsigned numPlanes)
+{
+    // culled when all the corners are outside any one plane
+    for (unsigned f = 0; f < numPlanes; ++f)
+    {
+        auto& plane = planes[f];
+        unsigned p = 0;
+        for (; p < 8; ++p)
+        {
+            if (glm::dot(glm::dvec3(plane), corners[p]) + plane.w > 0.0) // visible?
+                break;
+        }
+        if (p == 8)
+            return false;
+    }
+    return true;
+}
+
+bool
+TerrainTilePolicy::isVisible(const Bounds& bounds, const glm::dvec4* planes, unsigned numPlanes, const Horizon* horizon)
+{
+    // The horizon test is a single point per box, so it goes first.
+    auto visible = [&](unsigned b)
+    {
+        if (horizon && bounds.hasOcclusionPoint[b] && !horizon->isOcclusionPointVisible(bounds.occlusionPoints[b]))
+            return false;
+        return isBoxVisible(bounds.corners[b], planes, numPlanes);
+    };
+
+    if (!visible(0))
+        return false;
+
+    for (unsigned q = 1; q < 5; ++q)
+    {
+        if (visible(q))
+            return true;
+    }
+    return false;
+}
+
+double
+TerrainTilePolicy::distanceToSubtiles(const Bounds& bounds, const glm::dvec3& point)
+{
+    double distance = DBL_MAX;
+
+    for (unsigned b = 1; b < 5; ++b)
+    {
+        // the box's edges from its min corner (see Bounds::corners)
+        auto& corners = bounds.corners[b];
+        const glm::dvec3& origin = corners[4];
+        const glm::dvec3 axes[3] = { corners[5] - origin, corners[6] - origin, corners[0] - origin };
+
+        glm::dvec3 nearest = origin;
+        for (auto& axis : axes)
+        {
+            double len2 = glm::dot(axis, axis);
+            if (len2 > 0.0)
+                nearest += axis * util::clamp(glm::dot(point - origin, axis) / len2, 0.0, 1.0);
+        }
+        distance = std::min(distance, glm::length(point - nearest));
+    }
+    return distance;
+}
+
+bool
+TerrainTilePolicy::exceedsScreenSpaceError(double radius, double lodDistance, double viewportHeight, float screenSpaceError)
+{
+    double min_screen_height_ratio = (TILE_SIZE_PIXELS + screenSpaceError) / viewportHeight;
+    return (lodDistance > 0.0) && (radius > (lodDistance * min_screen_height_ratio));
+}
+
+float
+TerrainTilePolicy::morphFactor(double lodDistance, double viewportHeight, float screenSpaceError, const glm::fvec2& morphRange)
+{
+    // radius of the largest tile that would still meet the screen-space error
+    // at this distance; see exceedsScreenSpaceError.
+    double radius = std::max(lodDistance, 0.0) * (TILE_SIZE_PIXELS + screenSpaceError) / viewportHeight;
+
+    return (float)util::clamp((radius - morphRange[0]) / (morphRange[1] - morphRange[0]), 0.0, 1.0);
+}
+
+glm::fvec2
+TerrainTilePolicy::computeMorphRange(const Profile& profile, unsigned lod)
+{
+    // radius of a tile near the middle of the profile; the same for every tile
+    // in the LOD, so that neighboring tiles morph their shared edges together.
+    auto radius = [&](unsigned level)
+    {
+        auto [tx, ty] = profile.numTiles(level);
+        TileKey key(level, tx / 2, ty / 2, profile);
+        return key.extent().computeBoundingGeoCircle().radius();
+    };
+
+    // A parent subdivides until its subtiles are far enough away that a tile of
+    // the parent's own size would meet the screen-space error; by then a subtile
+    // must look exactly like its parent. The subtile's own subtiles finish at its
+    // size in turn, and it starts morphing only some way past that.
+    double r = radius(lod);
+    double parent_r = lod > 0 ? radius(lod - 1) : 2.0 * r;
+    double end = parent_r;
+    double start = r + (parent_r - r) * 0.66;
+
+    return glm::fvec2(start, end);
+}
+
+bool
+TerrainTilePolicy::shouldSubdivide(
+    const TerrainSettings& settings,
+    unsigned lod,
+    double radius,
+    double lodDistance,
+    double subtileDistance,
+    double viewportHeight,
+    const glm::fvec2& childrenMorphRange)
+{
+    // can we subdivide at all?
+    if (lod >= settings.maxLevelOfDetail.value())
+        return false;
+
+    if (settings.morphTerrain.value())
+    {
+        // Subdivide while any part of the subtiles is near enough that they would not
+        // have finished morphing into this tile, so the switch between them never pops.
+        // Children of the same parent come and go together, so the nearest one counts.
+        return morphFactor(subtileDistance, viewportHeight, settings.screenSpaceError.value(), childrenMorphRange) < 1.0f;
+    }
+
+    return exceedsScreenSpaceError(radius, lodDistance, viewportHeight, settings.screenSpaceError.value());
+}
+
+TerrainTilePolicy::Traversal
+TerrainTilePolicy::subdivide(
+    Subdivision& state,
+    bool subtilesInRange,
+    bool subtilesPredicted,
+    bool subtilesExist,
+    bool subtilesRequested)
+{
+    if (subtilesInRange)
+    {
+        state.subtilesPrefetched = false;
+        state.needsUnloadSubtiles = false;
+
+        if (subtilesExist)
+            return Traversal::Subtiles;
+    }
+
+    // will the camera want the subtiles shortly?
+    subtilesPredicted = subtilesPredicted && !subtilesInRange;
+
+    if ((subtilesInRange || subtilesPredicted) && !subtilesRequested)
+    {
+        state.needsSubtiles = true;
+        state.subtilesPrefetched = subtilesPredicted;
+    }
+    else if (state.subtilesPrefetched && subtilesExist)
+    {
+        if (subtilesPredicted)
+        {
+            // keep the subtiles alive, and loading, until the camera gets here
+            return Traversal::TileKeepSubtiles;
+        }
+
+        // the camera went elsewhere; dropping the subtiles
+        // cancels any loads they started
+        state.needsUnloadSubtiles = true;
+    }
+
+    return Traversal::Tile;
+}
+
+TerrainTilePolicy::Requests
+TerrainTilePolicy::requests(Data data, const Subdivision& state, Data parentData)
+{
+    Requests r;
+
+    // "progressive" means do not load LOD N+1 until LOD N is complete.
+    r.loadSubtiles = data == Data::Merged && state.needsSubtiles;
+    r.loadData = parentData == Data::Merged && data == Data::None;
+
+    // the merges themselves are limited per frame by the update cycle
+    r.mergeData = data == Data::Loaded;
+
+    r.unloadSubtiles = state.needsUnloadSubtiles;
+    return r;
+}
+
+TerrainTilePolicy::Expiry
+TerrainTilePolicy::expire(
+    const TerrainSettings& settings,
+    const Usage& usage,
+    std::size_t residentBytes,
+    std::size_t numResident,
+    unsigned expiredThisFrame)
+{
+    if (usage.doNotExpire)
+        return Expiry::Keep;
+
+    // A tile whose parent dropped its subtiles is no longer in the scene
+    // graph and will never be used again, so it always goes.
+    if (usage.orphaned)
+        return Expiry::Expire;
+
+    // Under a memory budget, unused tiles stay resident until the budget is
+    // exceeded so that a camera returning to an area finds them ready.
+    const std::size_t budget = (std::size_t)settings.memoryBudget.value() * 1024u * 1024u;
+    if (budget > 0u && residentBytes <= budget)
+        return Expiry::Keep;
+
+    if (expiredThisFrame >= settings.maxTilesToUnloadPerFrame.value() ||
+        numResident <= settings.minResidentTilesBeforeUnload.value() ||
+        usage.framesUnused < settings.minFramesBeforeUnload.value() ||
+        usage.secondsUnused < settings.minSecondsBeforeUnload.value() ||
+        usage.range < settings.minRangeBeforeUnload.value())
+    {
+        return Expiry::Keep;
+    }
+
+    // orphans the siblings too; they follow shortly
+    return Expiry::ExpireWithSiblings;
+}
@@ -0,0 +1,217 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/vsg/Common.h>
+#include <rocky/Math.h>
+#include <cfloat>
+#include <cstdint>
+
+namespace ROCKY_NAMESPACE
+{
+    class Horizon;
+    class Profile;
+    class TerrainSettings;
+
+    /**
+     * The decisions the terrain engine makes about each tile as it records and
+     * pages the terrain: whether the tile is visible, whether it subdivides, what
+     * it asks the pager for, and when it expires. None of them needs a scene
+     * graph, so TerrainTileNode, TerrainTilePager and TerrainPagingSimulator all
+     * make them here, the same way.
+     */
+    class ROCKY_EXPORT TerrainTilePolicy
+    {
+    public:
+        //! World-space bounds of a tile: the box around the tile [0] and the
+        //! boxes around its quadrants [1 + quadrant]. Each box is 8 corners in its
+        //! own frame, top corners first: (xmin, ymin), (xmax, ymin), (xmin, ymax), (xmax, ymax)
+        struct Bounds
+        {
+            glm::dvec3 corners[5][8];
+
+            //! Horizon occlusion points of the same boxes (geocentric maps only)
+            glm::dvec3 occlusionPoints[5];
+            bool hasOcclusionPoint[5] = { false, false, false, false, false };
+        };
+
+        //! State of a tile's data
+        enum class Data
+        {
+            None,       // not requested yet
+            Loading,
+            Loaded,     // waiting for a merge
+            Merging,
+            Merged
+        };
+
+        //! What a tile wants done about its subtiles; see subdivide()
+        struct Subdivision
+        {
+            bool needsSubtiles = false;
+            bool subtilesPrefetched = false;  // requested for where the camera is going, not where it is
+            bool needsUnloadSubtiles = false; // prefetched subtiles the camera turned out not to need
+        };
+
+        //! What a visible tile draws
+        enum class Traversal
+        {
+            Subtiles,           // the subtiles instead of the tile
+            Tile,               // the tile itself
+            TileKeepSubtiles    // the tile, keeping its prefetched subtiles alive
+        };
+
+        //! What a tile in use asks of the pager; see requests()
+        struct Requests
+        {
+            bool loadSubtiles = false;
+            bool loadData = false;
+            bool mergeData = false;
+            bool unloadSubtiles = false;
+        };
+
+        //! How long a tile has gone unused, for expiry
+        struct Usage
+        {
+            bool doNotExpire = false;
+            bool orphaned = false;          // its parent no longer holds it
+            std::uint64_t framesUnused = 0;
+            double secondsUnused = 0.0;
+            float range = FLT_MAX;          // distance from the camera when last used
+        };
+
+        //! What becomes of an unused tile; see expire()
+        enum class Expiry
+        {
+            Keep,
+            Expire,
+            ExpireWithSiblings  // the parent drops all its subtiles
+        };
+
+    public:
+        //! Whether a box is at least partly inside a set of planes
+        //! @param corners Corners of the box
+        //! @param planes Planes (normal, distance), facing inward
+        //! @param numPlanes Number of planes
+        static bool isBoxVisible(
+            const glm::dvec3 (&corners)[8],
+            const glm::dvec4* planes,
+            unsigned numPlanes);
+
+        //! Whether a tile is visible: its box, then, since one box is loose around
+        //! rough terrain, any of its quadrants' boxes
+        //! @param bounds Bounds of the tile
+        //! @param planes View frustum planes (normal, distance) in world coordinates, facing inward
+        //! @param numPlanes Number of planes
+        //! @param horizon Horizon to cull against, or nullptr
+        static bool isVisible(
+            const Bounds& bounds,
+            const glm::dvec4* planes,
+            unsigned numPlanes,
+            const Horizon* horizon);
+
+        //! Distance from a point to the nearest of a tile's quadrant boxes, which
+        //! are the boxes of its subtiles; zero inside one
+        static double distanceToSubtiles(
+            const Bounds& bounds,
+            const glm::dvec3& point);
+
+        //! Screen-space error test behind the subdivision decision.
+        //! @param radius Radius of the tile's bounding sphere
+        //! @param lodDistance View distance of the tile, as computed by vsg::State::lodDistance
+        //! @param viewportHeight Height of the viewport in pixels
+        //! @param screenSpaceError Acceptable error in pixels (see TerrainSettings)
+        //! @return True if the tile is too coarse to draw and should subdivide
+        static bool exceedsScreenSpaceError(
+            double radius,
+            double lodDistance,
+            double viewportHeight,
+            float screenSpaceError);
+
+        //! How far a vertex has morphed toward the geometry of its tile's parent,
+        //! from 0 (not at all) to 1 (all the way). Mirrors rocky.terrain.vert.
+        //! @param lodDistance View distance of the vertex, scaled as by vsg::State::lodDistance
+        //! @param viewportHeight Height of the viewport in pixels
+        //! @param screenSpaceError Acceptable error in pixels (see TerrainSettings)
+        //! @param morphRange Morph range of the tile's LOD, as the radii of the tiles
+        //!    that would just meet the screen-space error (see computeMorphRange)
+        //! @return Morph factor [0..1]
+        static float morphFactor(
+            double lodDistance,
+            double viewportHeight,
+            float screenSpaceError,
+            const glm::fvec2& morphRange);
+
+        //! Morph range of the tiles at a level of detail, as the radii of the tiles
+        //! that would just meet the screen-space error at the distances where
+        //! morphing starts and ends (see morphFactor)
+        static glm::fvec2 computeMorphRange(const Profile& profile, unsigned lod);
+
+        //! Whether a tile is too coarse to draw and should subdivide: the
+        //! screen-space error test, or when morphing, whether any subtile is
+        //! near enough that it would still be morphing.
+        //! @param settings Terrain settings
+        //! @param lod Level of detail of the tile
+        //! @param radius Radius of the tile's bounding sphere
+        //! @param lodDistance View distance of the tile, as computed by vsg::State::lodDistance
+        //! @param subtileDistance Distance from the eye to the nearest subtile's box,
+        //!    scaled like lodDistance
+        //! @param viewportHeight Height of the viewport in pixels
+        //! @param childrenMorphRange Morph range of the subtiles' LOD
+        static bool shouldSubdivide(
+            const TerrainSettings& settings,
+            unsigned lod,
+            double radius,
+            double lodDistance,
+            double subtileDistance,
+            double viewportHeight,
+            const glm::fvec2& childrenMorphRange);
+
+        //! Decides what a visible tile draws, and updates what it wants done
+        //! about its subtiles.
+        //! @param state What the tile wants done about its subtiles
+        //! @param subtilesInRange Whether the tile should subdivide (see shouldSubdivide)
+        //! @param subtilesPredicted Whether it should subdivide with the eye where the camera
+        //!    is heading (see TerrainSettings::prefetchSeconds); only matters when not in range
+        //! @param subtilesExist Whether the subtiles are ready to draw
+        //! @param subtilesRequested Whether the subtiles are already on their way
+        static Traversal subdivide(
+            Subdivision& state,
+            bool subtilesInRange,
+            bool subtilesPredicted,
+            bool subtilesExist,
+            bool subtilesRequested);
+
+        //! What a tile in use asks of the pager. Tiles load their data only
+        //! once their parents have, and subtiles only once the tile has.
+        //! @param data State of the tile's data
+        //! @param state What the tile wants done about its subtiles
+        //! @param parentData State of the parent's data; Merged for a root tile
+        static Requests requests(
+            Data data,
+            const Subdivision& state,
+            Data parentData);
+
+        //! What becomes of a tile that went unused this frame.
+        //! @param settings Terrain settings
+        //! @param usage How long the tile has gone unused
+        //! @param residentBytes Memory used by the resident tiles
+        //! @param numResident Number of resident tiles
+        //! @param expiredThisFrame Tiles expired (with siblings) so far this frame
+        static Expiry expire(
+            const TerrainSettings& settings,
+            const Usage& usage,
+            std::size_t residentBytes,
+            std::size_t numResident,
+            unsigned expiredThisFrame);
+
+        //! Loading priority of a tile (higher goes first), given its
+        //! distance from the camera and its level of detail.
+        static float priority(float range, unsigned lod) {
+            return -(sqrt(range) * lod);
+        }
+    };
+}
@@ -11,6 +11,8 @@
 #include <rocky/Math.h>
 #include <vsg/maths/vec3.h>
 #include <vsg/maths/mat4.h>
+#include <vsg/core/Array2D.h>
+#include <vsg/core/Array3D.h>
 #include <vsg/vk/State.h>
 #include <vsg/vk/Context.h>
 #include <vsg/commands/Commands.h>
@@ -74,16 +76,22 @@ namespace ROCKY_NAMESPACE
             // NB!
             // We copy the values out of image FIRST because once we call
             // image->releaseData() they will all reset!
+            // For compressed formats, each T is one block of pixels.
             unsigned
-                width = image->width(),
-                height = image->height(),
-                depth = image->depth();
+                block = image->blockSize(),
+                width = (image->width() + block - 1) / block,
+                height = (image->height() + block - 1) / block,
+                depth = image->depth(),
+                mipmaps = image->mipmapLevels();
 
             T* data = reinterpret_cast<T*>(image->releaseData());
 
             vsg::Data::Properties props;
             props.format = format;
             props.allocatorType = vsg::ALLOCATOR_TYPE_NEW_DELETE;
+            props.blockWidth = block;
+            props.blockHeight = block;
+            props.maxNumMipmaps = mipmaps;
 
             vsg::ref_ptr<vsg::Data> vsg_data;
             if (depth == 1)
@@ -138,6 +146,24 @@ namespace ROCKY_NAMESPACE
             case Image::R64_SFLOAT:
                 return move<double>(image, VK_FORMAT_R64_SFLOAT);
                 break;
+            case Image::R16_SFLOAT:
+                return move<unsigned short>(image, VK_FORMAT_R16_SFLOAT);
+                break;
+            case Image::BC1_RGBA_UNORM:
+                return move<vsg::block64>(image, VK_FORMAT_BC1_RGBA_UNORM_BLOCK);
+                break;
+            case Image::BC3_UNORM:
+                return move<vsg::block128>(image, VK_FORMAT_BC3_UNORM_BLOCK);
+                break;
+            case Image::BC4_UNORM:
+                return move<vsg::block64>(image, VK_FORMAT_BC4_UNORM_BLOCK);
+                break;
+            case Image::BC5_UNORM:
+                return move<vsg::block128>(image, VK_FORMAT_BC5_UNORM_BLOCK);
+                break;
+            case Image::BC7_UNORM:
+                return move<vsg::block128>(image, VK_FORMAT_BC7_UNORM_BLOCK);
+                break;
             };
 
             return { };
@@ -152,9 +178,9 @@ namespace ROCKY_NAMESPACE
             if (!image)
                 return {};
 
+            // any mipmaps the image carries come along with it
             auto data = moveImageData(image);
             data->properties.origin = vsg::TOP_LEFT;
-            data->properties.maxNumMipmaps = 1;
 
             return data;
         }
@@ -176,6 +202,13 @@ namespace ROCKY_NAMESPACE
                 vkformat == VK_FORMAT_R16_UNORM ? Image::R16_UNORM :
                 vkformat == VK_FORMAT_R32_SFLOAT ? Image::R32_SFLOAT :
                 vkformat == VK_FORMAT_R64_SFLOAT ? Image::R64_SFLOAT :
+                vkformat == VK_FORMAT_R16_SFLOAT ? Image::R16_SFLOAT :
+                vkformat == VK_FORMAT_BC1_RGB_UNORM_BLOCK ? Image::BC1_RGBA_UNORM :
+                vkformat == VK_FORMAT_BC1_RGBA_UNORM_BLOCK ? Image::BC1_RGBA_UNORM :
+                vkformat == VK_FORMAT_BC3_UNORM_BLOCK ? Image::BC3_UNORM :
+                vkformat == VK_FORMAT_BC4_UNORM_BLOCK ? Image::BC4_UNORM :
+                vkformat == VK_FORMAT_BC5_UNORM_BLOCK ? Image::BC5_UNORM :
+                vkformat == VK_FORMAT_BC7_UNORM_BLOCK ? Image::BC7_UNORM :
                 Image::UNDEFINED;
 
             if (format == Image::UNDEFINED)
@@ -183,17 +216,20 @@ namespace ROCKY_NAMESPACE
                 return Status(Status::ResourceUnavailable, "Unsupported image format");
             }
 
+            // for compressed data, width and height are in blocks.
+            // (only the first mipmap level is kept.)
             auto image = Image::create(
                 format,
-                data->width(),
-                data->height(),
+                data->width() * std::max((unsigned)data->properties.blockWidth, 1u),
+                data->height() * std::max((unsigned)data->properties.blockHeight, 1u),
                 data->depth());
 
             memcpy(image->data<uint8_t>(), data->dataPointer(), image->sizeInBytes());
 
             if (data->properties.origin == vsg::TOP_LEFT)
             {
-                image->flipVerticalInPlace();
+                if (!image->flipVerticalInPlace())
+                    return Status(Status::ResourceUnavailable, "Unable to flip compressed image data");
             }
 
             return Result(image);
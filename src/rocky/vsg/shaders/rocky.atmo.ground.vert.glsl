@@ -132,8 +132,9 @@ void atmos_GroundFromAtmosphere(in vec3 vertex_view)
 
 void atmos_vertex_main(inout vec3 vertex_view)
 {
-    // Get camera position and height (from tile space)
-    earth_center = (pc.modelview * inverse(tile.model_matrix) * vec4(0, 0, 0, 1)).xyz;
+    // Get camera position and height (from tile space; modelview is set by rocky.terrain.vert,
+    // since push constants only hold the tile's matrix when it does not draw instanced)
+    earth_center = (modelview * inverse(tile.model_matrix) * vec4(0, 0, 0, 1)).xyz;
     atmos_fCameraHeight = length(earth_center);
     atmos_fCameraHeight2 = atmos_fCameraHeight * atmos_fCameraHeight;
 
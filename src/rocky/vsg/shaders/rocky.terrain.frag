@@ -2,6 +2,7 @@
 #extension GL_NV_fragment_shader_barycentric : enable
 #pragma import_defines(RK_LIGHTING)
 #pragma import_defines(RK_WIREFRAME_OVERLAY)
+#pragma import_defines(RK_INSTANCED)
 
 layout(push_constant) uniform PushConstants
 {
@@ -20,9 +21,17 @@ struct RkData {
 // input varyings
 layout(location = 0) in RkData rk;
 
+#if defined(RK_INSTANCED)
+// color texture array layer
+layout(location = 4) flat in int rk_color_layer;
+
+// one layer per color image; see rocky::TerrainTileAtlas
+layout(set = 0, binding = 15) uniform sampler2DArray color_tex;
+#else
 // uniforms
 layout(set = 0, binding = 11) uniform sampler2D color_tex;
 layout(set = 0, binding = 12) uniform sampler2D normal_tex;
+#endif
 
 #if defined(RK_LIGHTING)
 #include "rocky.lighting.frag.glsl"
@@ -42,7 +51,12 @@ vec3 get_normal()
 
 void main()
 {
+#if defined(RK_INSTANCED)
+    // no color image: the base color shows through
+    vec4 texel = rk_color_layer >= 0 ? texture(color_tex, vec3(rk.uv, rk_color_layer)) : vec4(0);
+#else
     vec4 texel = texture(color_tex, rk.uv);
+#endif
     out_color = mix(rk.color, clamp(texel, 0, 1), texel.a);
 
     if (gl_FrontFacing == false)
@@ -1,8 +1,15 @@
 #version 450
 #pragma import_defines(RK_LIGHTING)
 #pragma import_defines(RK_ATMOSPHERE)
+#pragma import_defines(RK_MORPH_TERRAIN)
+#pragma import_defines(RK_INSTANCED)
 
+#if defined(RK_INSTANCED)
+// one layer per elevation image; see rocky::TerrainTileAtlas
+layout(set = 0, binding = 14) uniform sampler2DArray elevation_tex;
+#else
 layout(set = 0, binding = 10) uniform sampler2D elevation_tex;
+#endif
 
 layout(push_constant) uniform PushConstants
 {
@@ -10,6 +17,38 @@ layout(push_constant) uniform PushConstants
     mat4 modelview;
 } pc;
 
+#if defined(RK_INSTANCED)
+// see rocky::TerrainTileAtlas::TileData
+struct TileData
+{
+    mat4 elevation_matrix;
+    mat4 color_matrix;
+    mat4 normal_matrix;
+    mat4 model_matrix;
+    vec4 elevation_decode; // x = scale, y = offset
+    vec4 morph; // x = start, y = end, z = screen-space error, w = tile size
+    ivec4 layers; // x = elevation, y = color; -1 = none
+};
+
+layout(set = 0, binding = 16) readonly buffer TileBuffer {
+    TileData tiles[];
+};
+
+// see rocky::TerrainTileAtlas::Instance
+struct TileInstance
+{
+    mat4 modelview;
+    uvec4 tile; // x = index in tiles[]
+};
+
+layout(set = 2, binding = 0) readonly buffer InstanceBuffer {
+    TileInstance instances[];
+};
+
+// this instance's tile, set in main()
+TileData tile;
+
+#else
 // see rocky::TerrainTileDescriptors
 layout(set = 0, binding = 13) uniform TileData
 {
@@ -17,13 +56,36 @@ layout(set = 0, binding = 13) uniform TileData
     mat4 color_matrix;
     mat4 normal_matrix;
     mat4 model_matrix;
+    vec4 elevation_decode; // x = scale, y = offset
+    vec4 morph; // x = start, y = end, z = screen-space error, w = tile size
 } tile;
+#endif
+
+// modelview matrix of the tile being drawn, set in main()
+mat4 modelview;
 
 // input vertex attributes
 layout(location = 0) in vec3 in_vertex;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec3 in_uvw;
 
+#if defined(RK_MORPH_TERRAIN)
+// the vertex (and its normal) that this one collapses onto in the parent tile
+layout(location = 3) in vec3 in_vertex_neighbor;
+layout(location = 4) in vec3 in_normal_neighbor;
+
+// vsg viewport data
+layout(set = 1, binding = 1) uniform VSG_Viewports {
+    vec4 viewport[1]; // x, y, width, height
+} vsg_viewports;
+
+// see rocky::GeometryPool
+#define VERTEX_CONSTRAINT 16
+
+// see rocky::TerrainTilePolicy::exceedsScreenSpaceError
+#define TILE_SIZE_PIXELS 256.0
+#endif
+
 // inter-stage interface block
 struct RkData {
     vec4 color;
@@ -35,6 +97,11 @@ struct RkData {
 // output varyings
 layout(location = 0) out RkData rk;
 
+#if defined(RK_INSTANCED)
+// color texture array layer
+layout(location = 4) flat out int rk_color_layer;
+#endif
+
 #if defined(RK_ATMOSPHERE)
 #include "rocky.atmo.ground.vert.glsl"
 #endif
@@ -47,6 +114,11 @@ out gl_PerVertex {
 // sample the elevation data at a UV tile coordinate
 float terrain_get_elevation(in vec2 uv)
 {
+#if defined(RK_INSTANCED)
+    if (tile.layers.x < 0)
+        return 0.0;
+#endif
+
     float size = float(textureSize(elevation_tex, 0).x);
     vec2 coeff = vec2((size - 1.0) / size, 0.5 / size);
 
@@ -57,24 +129,69 @@ float terrain_get_elevation(in vec2 uv)
         + coeff.x * tile.elevation_matrix[3].st // bias
         + coeff.y;
 
-    return texture(elevation_tex, elevc).r;
+#if defined(RK_INSTANCED)
+    float height = texture(elevation_tex, vec3(elevc, tile.layers.x)).r;
+#else
+    float height = texture(elevation_tex, elevc).r;
+#endif
+
+    // decodes quantized (R16_UNORM) heights; identity for float data
+    return height * tile.elevation_decode.x + tile.elevation_decode.y;
 }
 
+#if defined(RK_MORPH_TERRAIN)
+// how far a vertex has morphed toward the parent tile's geometry, 0..1;
+// see rocky::TerrainTilePolicy::morphFactor
+float terrain_get_morph_factor(in vec3 position_view)
+{
+    float lod_distance = length(position_view) / abs(pc.projection[1][1]);
+    float radius = lod_distance * (TILE_SIZE_PIXELS + tile.morph.z) / vsg_viewports.viewport[0].w;
+    return clamp((radius - tile.morph.x) / (tile.morph.y - tile.morph.x), 0.0, 1.0);
+}
+#endif
+
 void main()
 {
-    float elevation = terrain_get_elevation(in_uvw.st);
-    vec3 position = in_vertex + in_normal*elevation;
-    vec4 position_view = pc.modelview * vec4(position, 1.0);
+#if defined(RK_INSTANCED)
+    tile = tiles[instances[gl_InstanceIndex].tile.x];
+    modelview = instances[gl_InstanceIndex].modelview;
+    rk_color_layer = tile.layers.y;
+#else
+    modelview = pc.modelview;
+#endif
+
+    vec3 vertex = in_vertex;
+    vec3 normal = in_normal;
+    vec2 uv = in_uvw.st;
+
+#if defined(RK_MORPH_TERRAIN)
+    if ((int(in_uvw.z) & VERTEX_CONSTRAINT) == 0)
+    {
+        // the unmorphed position decides how far to morph
+        vec3 position = in_vertex + in_normal * terrain_get_elevation(uv);
+        float morph = terrain_get_morph_factor((modelview * vec4(position, 1.0)).xyz);
+
+        // odd rows and columns slide back onto the parent's grid
+        float cells = tile.morph.w - 1.0;
+        uv -= mod(round(uv * cells), 2.0) / cells * morph;
+        vertex = mix(in_vertex, in_vertex_neighbor, morph);
+        normal = normalize(mix(in_normal, in_normal_neighbor, morph));
+    }
+#endif
+
+    float elevation = terrain_get_elevation(uv);
+    vec3 position = vertex + normal*elevation;
+    vec4 position_view = modelview * vec4(position, 1.0);
 
 #if defined(RK_ATMOSPHERE)
     atmos_vertex_main(position_view.xyz);
 #endif
 
-    mat3 normal_matrix = mat3(transpose(inverse(pc.modelview)));
-    rk.up_view = normal_matrix * in_normal;
+    mat3 normal_matrix = mat3(transpose(inverse(modelview)));
+    rk.up_view = normal_matrix * normal;
     
     rk.color = vec4(1); // placeholder
-    rk.uv = (tile.color_matrix * vec4(in_uvw.st, 0, 1)).st;
+    rk.uv = (tile.color_matrix * vec4(uv, 0, 1)).st;
     rk.vertex_view = position_view.xyz / position_view.w;
     
     gl_Position = pc.projection * position_view;
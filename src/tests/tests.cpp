@@ -6,14 +6,27 @@
 #include <rocky/Log.h>
 #include <rocky/Map.h>
 #include <rocky/Math.h>
+#include <rocky/CameraPredictor.h>
 #include <rocky/Image.h>
+#include <rocky/ImageCompressor.h>
+#include <rocky/ElevationLayer.h>
+#include <rocky/Geoid.h>
 #include <rocky/Heightfield.h>
+#include <rocky/HeightfieldEdges.h>
+#include <rocky/Horizon.h>
+#include <rocky/HeightfieldPyramid.h>
+#include <rocky/SlotAllocator.h>
+#include <rocky/TerrainRGB.h>
+#include <rocky/TerrainTileModelFactory.h>
 #include <rocky/TileKey.h>
+#include <rocky/TileCoverage.h>
 #include <rocky/URI.h>
 #include <rocky/Utils.h>
 #include <rocky/contrib/EarthFileImporter.h>
 
+#include <bitset>
 #include <random>
+#include <chrono>
 
 #ifdef ROCKY_HAS_GDAL
 #include <rocky/GDALImageLayer.h>
@@ -23,6 +36,11 @@
 #include <rocky/TMSImageLayer.h>
 #endif
 
+#ifdef ROCKY_HAS_VSG
+#include <rocky/vsg/engine/TerrainPagingSimulator.h>
+#include <rocky/vsg/engine/TerrainTilePolicy.h>
+#endif
+
 #define ROCKY_EXPOSE_JSON_FUNCTIONS
 #include <rocky/json.h>
 
@@ -37,6 +55,161 @@ namespace
             return StatusOK;
         }
     };
+
+    // elevation layer with an analytic height of 10*lon + 20*lat meters
+    class TestElevationLayer : public Inherit<ElevationLayer, TestElevationLayer>
+    {
+    public:
+        TestElevationLayer() {
+            setProfile(Profile::GLOBAL_GEODETIC);
+        }
+
+        static float height(double lon, double lat) {
+            return (float)(10.0 * lon + 20.0 * lat);
+        }
+
+    protected:
+        Result<GeoHeightfield> createHeightfieldImplementation(const TileKey& key, const IOOptions& io) const override {
+            auto hf = Heightfield::create(257, 257);
+            auto& ex = key.extent();
+            for (unsigned r = 0; r < hf->height(); ++r)
+                for (unsigned c = 0; c < hf->width(); ++c)
+                    hf->heightAt(c, r) = height(
+                        ex.xmin() + ex.width() * (double)c / 256.0,
+                        ex.ymin() + ex.height() * (double)r / 256.0);
+            return GeoHeightfield(hf, ex);
+        }
+    };
+
+    // smooth RGBA test pattern with a little noise
+    shared_ptr<Image> makeTestImage(unsigned width, unsigned height)
+    {
+        std::mt19937 engine(0);
+        std::uniform_int_distribution<> noise(-8, 8);
+        auto image = Image::create(Image::R8G8B8A8_UNORM, width, height);
+        auto ptr = image->data<unsigned char>();
+        for (unsigned t = 0; t < height; ++t)
+        {
+            for (unsigned s = 0; s < width; ++s, ptr += 4)
+            {
+                ptr[0] = (unsigned char)clamp((int)(255 * s / width) + noise(engine), 0, 255);
+                ptr[1] = (unsigned char)clamp((int)(255 * t / height) + noise(engine), 0, 255);
+                ptr[2] = (unsigned char)clamp((int)(255 * (s + t) / (width + height)) + noise(engine), 0, 255);
+                ptr[3] = 255;
+            }
+        }
+        return image;
+    }
+
+    // peak signal-to-noise ratio (dB) over the first n components of two 8-bit images
+    double psnr(const Image& a, const Image& b, unsigned n)
+    {
+        double sum = 0.0;
+        for (unsigned i = 0; i < a.sizeInPixels(); ++i)
+        {
+            for (unsigned c = 0; c < n; ++c)
+            {
+                double e = (double)a.data<unsigned char>()[i * a.numComponents() + c] - (double)b.data<unsigned char>()[i * b.numComponents() + c];
+                sum += e * e;
+            }
+        }
+        double mse = sum / (double)(a.sizeInPixels() * n);
+        return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 100.0;
+    }
+
+    // encodes height = 100 * sin(s) * cos(t) + 500 in an 8-bit RGB(A) image
+    shared_ptr<Image> makeTerrainRGBImage(unsigned width, unsigned height, unsigned components, util::TerrainRGB::Format format)
+    {
+        auto image = Image::create(components == 4 ? Image::R8G8B8A8_UNORM : Image::R8G8B8_UNORM, width, height);
+        auto ptr = image->data<unsigned char>();
+        for (unsigned t = 0; t < height; ++t)
+        {
+            for (unsigned s = 0; s < width; ++s, ptr += components)
+            {
+                double h = 100.0 * sin(0.05 * s) * cos(0.05 * t) + 500.0;
+                if (format == util::TerrainRGB::Format::Mapbox)
+                {
+                    unsigned v = (unsigned)((h + 10000.0) * 10.0);
+                    ptr[0] = (v >> 16) & 0xff, ptr[1] = (v >> 8) & 0xff, ptr[2] = v & 0xff;
+                }
+                else
+                {
+                    double v = h + 32768.0;
+                    ptr[0] = (unsigned char)(v / 256.0), ptr[1] = (unsigned char)fmod(v, 256.0), ptr[2] = (unsigned char)(fmod(v, 1.0) * 256.0);
+                }
+                if (components == 4)
+                    ptr[3] = 255;
+            }
+        }
+        return image;
+    }
+
+#ifdef ROCKY_HAS_ZLIB
+    // writes an 8-bit RGB(A) image as a PNG, cycling through the scanline filter types.
+    // (ZLibCompressor writes a gzip wrapper instead of a zlib one, which the decoder accepts.)
+    std::string makePNG(const Image& image)
+    {
+        auto crc = [](const std::string& data)
+            {
+                std::uint32_t c = 0xffffffffu;
+                for (unsigned char b : data)
+                {
+                    c ^= b;
+                    for (int k = 0; k < 8; ++k)
+                        c = (c >> 1) ^ (0xedb88320u & (0u - (c & 1u)));
+                }
+                return c ^ 0xffffffffu;
+            };
+
+        auto be32 = [](std::uint32_t v)
+            {
+                return std::string{ (char)(v >> 24), (char)(v >> 16), (char)(v >> 8), (char)v };
+            };
+
+        auto chunk = [&](const char* type, const std::string& data)
+            {
+                std::string body = std::string(type, 4) + data;
+                return be32((std::uint32_t)data.size()) + body + be32(crc(body));
+            };
+
+        unsigned bpp = image.numComponents();
+        unsigned stride = image.width() * bpp;
+        std::string raw;
+        std::vector<unsigned char> prev(stride, 0);
+
+        // PNG rows run top-down
+        for (int y = (int)image.height() - 1; y >= 0; --y)
+        {
+            auto row = image.data<unsigned char>() + y * image.rowSizeInBytes();
+            unsigned char filter = (unsigned char)(y % 5);
+            raw.push_back((char)filter);
+            for (unsigned i = 0; i < stride; ++i)
+            {
+                int a = i >= bpp ? row[i - bpp] : 0, b = prev[i], c = i >= bpp ? prev[i - bpp] : 0;
+                int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                int predictor =
+                    filter == 1 ? a :
+                    filter == 2 ? b :
+                    filter == 3 ? (a + b) / 2 :
+                    filter == 4 ? (pa <= pb && pa <= pc ? a : pb <= pc ? b : c) :
+                    0;
+                raw.push_back((char)(unsigned char)(row[i] - predictor));
+            }
+            memcpy(prev.data(), row, stride);
+        }
+
+        std::stringstream compressed;
+        util::ZLibCompressor().compress(raw, compressed);
+
+        std::string header = be32(image.width()) + be32(image.height());
+        header += std::string{ 8, (char)(bpp == 4 ? 6 : 2), 0, 0, 0 };
+
+        return std::string("\x89PNG\r\n\x1a\n", 8) +
+            chunk("IHDR", header) +
+            chunk("IDAT", compressed.str()) +
+            chunk("IEND", {});
+    }
+#endif
 }
 
 TEST_CASE("json")
@@ -107,6 +280,208 @@ TEST_CASE("TileKey")
     CHECK(TileKey(2, 0, 0, p).quadKey() == "000");
     CHECK(TileKey(2, 1, 0, p).quadKey() == "001");
     CHECK(TileKey(2, 5, 1, p).quadKey() == "103");
+
+    // compact ids and table-driven bounds:
+    TileKey key(5, 17, 9, p);
+    auto id = key.id();
+    CHECK(id.valid());
+    CHECK(id == TileKey(5, 17, 9, Profile("global-geodetic")).id());
+    CHECK(id != TileKey(5, 17, 9, Profile::SPHERICAL_MERCATOR).id());
+    CHECK(std::hash<TileID>()(id) == std::hash<TileID>()(key.id()));
+    CHECK(TileKey::INVALID.id().valid() == false);
+
+    // ids follow the whole profile definition
+    Profile west(SRS::WGS84, Box(-180, -90, 0, 90), 1, 1);
+    Profile west_again(SRS::WGS84, Box(-180, -90, 0, 90), 1, 1);
+    Profile east(SRS::WGS84, Box(0, -90, 180, 90), 1, 1);
+    CHECK(TileKey(1, 0, 0, west).id() == TileKey(1, 0, 0, west_again).id());
+    CHECK(TileKey(1, 0, 0, west).id() != TileKey(1, 0, 0, east).id());
+    CHECK(west != east);
+
+    auto e = key.extent();
+    auto b = key.bounds();
+    CHECK((b.xmin == e.xMin() && b.ymin == e.yMin() && b.xmax == e.xMax() && b.ymax == e.yMax()));
+    CHECK(e == p.tileExtent(5, 17, 9));
+}
+
+TEST_CASE("TileKey benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    const unsigned iterations = 10000000;
+    auto p = Profile::GLOBAL_GEODETIC;
+    std::vector<TileKey> keys;
+    for (unsigned i = 0; i < 1024; ++i)
+        keys.emplace_back(12, i, i / 2, p);
+    std::vector<TileID> ids;
+    for (auto& key : keys)
+        ids.push_back(key.id());
+
+    auto run = [&](const char* label, auto&& func)
+        {
+            std::size_t sink = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < iterations; ++i)
+                sink += func(i & 1023);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << label << ": " << 1e9 * elapsed.count() / (double)iterations << " ns (" << (sink & 1) << ")" << std::endl;
+        };
+
+    run("TileKey copy+hash", [&](unsigned i) { TileKey k = keys[i]; return std::hash<TileKey>()(k); });
+    run("TileID copy+hash", [&](unsigned i) { TileID k = ids[i]; return std::hash<TileID>()(k); });
+    run("TileKey compare", [&](unsigned i) { return (std::size_t)(keys[i] == keys[(i + 1) & 1023]); });
+    run("TileID compare", [&](unsigned i) { return (std::size_t)(ids[i] == ids[(i + 1) & 1023]); });
+    run("TileKey::extent", [&](unsigned i) { return (std::size_t)keys[i].extent().xMin(); });
+    run("TileKey::bounds", [&](unsigned i) { return (std::size_t)keys[i].bounds().xmin; });
+    run("Profile::tileBounds(TileID)", [&](unsigned i) { return (std::size_t)p.tileBounds(ids[i].lod, ids[i].x, ids[i].y).xmin; });
+}
+
+namespace
+{
+    // random data extents scattered over the globe, some without a maxLevel
+    DataExtentList makeTestDataExtents(std::size_t count, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<double> lon(-180.0, 175.0), lat(-90.0, 85.0), size(0.01, 5.0);
+        std::uniform_int_distribution<unsigned> level(0, 14);
+
+        DataExtentList extents;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            double x = lon(rng), y = lat(rng);
+            GeoExtent ex(SRS::WGS84, x, y, x + size(rng), y + size(rng));
+            unsigned a = level(rng), b = level(rng);
+            if (i % 5 == 0)
+                extents.emplace_back(ex, std::min(a, b));
+            else
+                extents.emplace_back(ex, std::min(a, b), std::max(a, b));
+        }
+        return extents;
+    }
+
+    // key at a lod containing a point, in a geodetic profile
+    TileKey keyAt(const Profile& profile, unsigned lod, double lon, double lat)
+    {
+        auto [w, h] = profile.tileDimensions(lod);
+        auto [nx, ny] = profile.numTiles(lod);
+        unsigned x = std::min((unsigned)((lon + 180.0) / w), nx - 1);
+        unsigned y = std::min((unsigned)((90.0 - lat) / h), ny - 1);
+        return TileKey(lod, x, y, profile);
+    }
+}
+
+TEST_CASE("TileCoverage")
+{
+    auto profile = Profile::GLOBAL_GEODETIC;
+    std::mt19937 rng(7);
+    auto extents = makeTestDataExtents(500, rng);
+
+    TileCoverage index(profile, extents);
+    REQUIRE(index.tableLevels() > 0);
+
+    // reference answer: test every extent
+    auto brute_force = [&](const TileKey& key)
+        {
+            TileCoverage::Coverage result;
+            Box b = key.bounds();
+            for (auto& de : extents)
+            {
+                if (de.xMin() < b.xmax && de.xMax() > b.xmin && de.yMin() < b.ymax && de.yMax() > b.ymin)
+                {
+                    result.overlaps = true;
+                    if (de.minLevel().value_or(0u) > key.levelOfDetail())
+                        continue;
+                    result.intersects = true;
+                    result.maxLevel = std::max(result.maxLevel, de.maxLevel().value_or(UINT_MAX));
+                }
+            }
+            return result;
+        };
+
+    // half the keys sit on a data extent, half anywhere; levels above and below the tables
+    std::uniform_int_distribution<std::size_t> pick(0, extents.size() - 1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (int i = 0; i < 4000; ++i)
+    {
+        unsigned lod = i % 18;
+        double lon, lat;
+        if (i & 1)
+        {
+            auto& de = extents[pick(rng)];
+            lon = de.xMin() + unit(rng) * de.width();
+            lat = de.yMin() + unit(rng) * de.height();
+        }
+        else
+        {
+            lon = -180.0 + 360.0 * unit(rng);
+            lat = -90.0 + 180.0 * unit(rng);
+        }
+
+        auto key = keyAt(profile, lod, lon, lat);
+        auto expected = brute_force(key);
+        auto actual = index.coverage(key);
+        CHECK(actual.intersects == expected.intersects);
+        CHECK(actual.overlaps == expected.overlaps);
+        if (expected.intersects)
+            CHECK(actual.maxLevel == expected.maxLevel);
+    }
+
+    // layers answer from the same index
+    auto layer = TestElevationLayer::create();
+    layer->setDataExtents(extents);
+    auto key = keyAt(profile, 9, extents[3].xMin() + 0.001, extents[3].yMin() + 0.001);
+    CHECK(layer->coverage(key).intersects);
+    CHECK(layer->coverage(key).maxLevel == index.coverage(key).maxLevel);
+
+    // layers intersect keys above an extent's minLevel, but have no data there
+    auto deepOnly = TestElevationLayer::create();
+    deepOnly->setDataExtents({ DataExtent(GeoExtent(SRS::WGS84, 10.0, 10.0, 20.0, 20.0), 6u, 12u) });
+    auto shallow = keyAt(profile, 3, 15.0, 15.0);
+    CHECK(deepOnly->intersects(shallow));
+    CHECK_FALSE(deepOnly->coverage(shallow).intersects);
+    CHECK_FALSE(deepOnly->mayHaveData(shallow));
+    CHECK(deepOnly->mayHaveData(keyAt(profile, 8, 15.0, 15.0)));
+    CHECK_FALSE(deepOnly->intersects(keyAt(profile, 8, -150.0, -50.0)));
+}
+
+TEST_CASE("TileCoverage benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    auto profile = Profile::GLOBAL_GEODETIC;
+    std::mt19937 rng(7);
+    auto extents = makeTestDataExtents(50000, rng);
+
+    auto start = std::chrono::steady_clock::now();
+    TileCoverage index(profile, extents);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Build index of 50000 extents: " << 1000.0 * elapsed.count() << " ms" << std::endl;
+
+    auto layer = TestElevationLayer::create();
+    layer->setDataExtents(extents);
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    auto run = [&](const char* label, const Profile& keyProfile, unsigned lod)
+        {
+            std::vector<TileKey> keys;
+            auto [nx, ny] = keyProfile.numTiles(lod);
+            for (int i = 0; i < 4096; ++i)
+                keys.emplace_back(lod, (unsigned)(unit(rng) * nx) % nx, (unsigned)(unit(rng) * ny) % ny, keyProfile);
+
+            layer->mayHaveData(keys.front()); // build the index
+
+            const int iterations = 250000;
+            std::size_t hits = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+                hits += layer->mayHaveData(keys[i & 4095]) ? 1 : 0;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << label << " LOD " << lod << ": " << (double)iterations / elapsed.count()
+                << " lookups/s (" << hits << " hits)" << std::endl;
+        };
+
+    for (unsigned lod : { 4u, 8u, 12u, 16u })
+        run("mayHaveData, layer profile", profile, lod);
+
+    for (unsigned lod : { 4u, 8u, 12u })
+        run("mayHaveData, foreign profile", Profile::SPHERICAL_MERCATOR, lod);
 }
 
 TEST_CASE("Threading")
@@ -130,6 +505,31 @@ TEST_CASE("Threading")
     CHECK(f2.value() == 123);
 }
 
+TEST_CASE("SlotAllocator")
+{
+    util::SlotAllocator slots(3);
+    CHECK(slots.allocate() == 0);
+    CHECK(slots.allocate() == 1);
+    CHECK(slots.allocate() == 2);
+    CHECK(slots.full());
+    CHECK(slots.allocate() == -1);
+
+    // released slots come back before fresh ones
+    slots.release(1);
+    CHECK(slots.size() == 2);
+    CHECK(!slots.full());
+    CHECK(slots.allocate() == 1);
+
+    slots.grow(4);
+    CHECK(slots.allocate() == 3);
+    CHECK(slots.end() == 4);
+    CHECK(slots.size() == 4);
+
+    // never shrinks
+    slots.grow(2);
+    CHECK(slots.capacity() == 4);
+}
+
 TEST_CASE("Math")
 {
     CHECK(is_identity(glm::fmat4(1)));
@@ -148,6 +548,180 @@ TEST_CASE("Math")
     CHECK(r == glm::fvec3(0.75f, 0.75f, 0));
 }
 
+TEST_CASE("CameraPredictor")
+{
+    CameraPredictor predictor;
+    CHECK(!predictor.valid());
+    CHECK(predictor.displacement(1.0) == glm::dvec3(0, 0, 0));
+
+    // steady motion of 100 units/s along x, at 60 frames per second
+    for (int i = 0; i < 10; ++i)
+        predictor.update(glm::dvec3(100.0 * i / 60.0, 0, 1000), i / 60.0);
+    REQUIRE(predictor.valid());
+    CHECK(predictor.velocity().x == Approx(100.0));
+    CHECK(predictor.displacement(2.0).x == Approx(200.0));
+    CHECK(predictor.displacement(2.0, 50.0).x == Approx(50.0));
+
+    // a second sample in the same frame is ignored
+    predictor.update(glm::dvec3(5000, 0, 0), 9 / 60.0);
+    CHECK(predictor.velocity().x == Approx(100.0));
+
+    // stopping brings the estimate down
+    for (int i = 10; i < 30; ++i)
+        predictor.update(glm::dvec3(900.0 / 60.0, 0, 1000), i / 60.0);
+    CHECK(glm::length(predictor.velocity()) < 0.01);
+
+    // a long pause starts over
+    predictor.update(glm::dvec3(0, 0, 0), 10.0);
+    CHECK(!predictor.valid());
+}
+
+TEST_CASE("Ellipsoid")
+{
+    Ellipsoid e;
+
+    std::vector<glm::dvec3> lla;
+    for (int lat = -90; lat <= 90; lat += 15)
+        for (int lon = -180; lon < 180; lon += 30)
+            for (double h : { -400.0, 0.0, 8848.0, 400000.0 })
+                lla.emplace_back(lon + 0.123, lat, h);
+
+    std::vector<glm::dvec3> ecef(lla.size());
+    e.geodeticToGeocentric(lla.data(), ecef.data(), lla.size());
+    for (std::size_t i = 0; i < lla.size(); ++i)
+        CHECK(ecef[i] == e.geodeticToGeocentric(lla[i]));
+
+    // round trip through the closed-form solution:
+    std::vector<glm::dvec3> geod(ecef.size());
+    e.geocentricToGeodetic(ecef.data(), geod.data(), ecef.size());
+    for (std::size_t i = 0; i < lla.size(); ++i)
+    {
+        if (std::abs(lla[i].y) < 90.0)
+            CHECK(std::abs(geod[i].x - lla[i].x) < 1e-9);
+        CHECK(std::abs(geod[i].y - lla[i].y) < 1e-9);
+        CHECK(std::abs(geod[i].z - lla[i].z) < 1e-6);
+
+        // agrees with the single-point conversion (an approximation
+        // that drifts by a millimeter or so at orbital altitudes):
+        auto single = e.geocentricToGeodetic(ecef[i]);
+        CHECK(std::abs(geod[i].y - single.y) < 1e-7);
+        CHECK(std::abs(geod[i].z - single.z) < 1e-2);
+    }
+
+    std::vector<glm::dvec3> up(ecef.size());
+    e.geocentricToUpVectors(ecef.data(), up.data(), ecef.size());
+    std::vector<glm::dmat4> frames(ecef.size());
+    e.geocentricToLocalToWorld(ecef.data(), frames.data(), ecef.size());
+    for (std::size_t i = 0; i < ecef.size(); ++i)
+    {
+        CHECK(glm::dot(up[i], e.geocentricToUpVector(ecef[i])) > 1.0 - 1e-12);
+
+        auto single = e.geocentricToLocalToWorld(ecef[i]);
+        for (int c = 0; c < 4; ++c)
+            CHECK(glm::distance(frames[i][c], single[c]) < 1e-8);
+    }
+
+    // near the center of the earth:
+    glm::dvec3 center[2] = { { 0, 0, 0 }, { 1000, 0, 0 } }, out[2];
+    e.geocentricToGeodetic(center, out, 2);
+    CHECK(out[0] == e.geocentricToGeodetic(center[0]));
+    CHECK(out[1] == e.geocentricToGeodetic(center[1]));
+}
+
+TEST_CASE("Horizon")
+{
+    Ellipsoid e;
+    Horizon horizon(e);
+
+    // from 1000 km up, the antipode is hidden and the point below is not
+    horizon.setEye(e.geodeticToGeocentric(glm::dvec3(0, 0, 1e6)));
+    auto below = e.geodeticToGeocentric(glm::dvec3(0, 0, 0));
+    auto antipode = e.geodeticToGeocentric(glm::dvec3(180, 0, 0));
+    CHECK(horizon.isVisible(below.x, below.y, below.z));
+    CHECK(!horizon.isVisible(antipode.x, antipode.y, antipode.z));
+
+    // a single point is its own occlusion point
+    glm::dvec3 p;
+    REQUIRE(Horizon::computeOcclusionPoint(e, &below, 1, p));
+    CHECK(glm::distance(p, below) < 1e-3);
+
+    // an occluded occlusion point hides every point it was computed for
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> lon(-180, 180), lat(-80, 80), h(-500, 9000);
+    unsigned occluded = 0, failures = 0;
+    for (int i = 0; i < 200; ++i)
+    {
+        double x = lon(gen), y = lat(gen);
+        std::vector<glm::dvec3> patch;
+        for (int j = 0; j < 16; ++j)
+            patch.push_back(e.geodeticToGeocentric(glm::dvec3(x + 0.5 * (j % 4), y + 0.5 * (j / 4), h(gen))));
+
+        REQUIRE(Horizon::computeOcclusionPoint(e, patch.data(), patch.size(), p));
+
+        horizon.setEye(e.geodeticToGeocentric(glm::dvec3(lon(gen), lat(gen), 2e5)));
+        if (!horizon.isOcclusionPointVisible(p))
+        {
+            ++occluded;
+            for (auto& q : patch)
+                if (horizon.isVisible(q.x, q.y, q.z))
+                    ++failures;
+        }
+    }
+    CHECK(occluded > 0);
+    CHECK(failures == 0);
+
+    // no occlusion point for half the globe
+    glm::dvec3 hemisphere[2] = {
+        e.geodeticToGeocentric(glm::dvec3(-90, 0, 0)),
+        e.geodeticToGeocentric(glm::dvec3(90, 0, 0)) };
+    CHECK(!Horizon::computeOcclusionPoint(e, hemisphere, 2, p));
+}
+
+TEST_CASE("Ellipsoid benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    // Positions and normals for a tile's worth of terrain vertices,
+    // one vertex at a time vs. in bulk.
+    const unsigned tiles = 1000;
+    auto xform = SRS::WGS84.to(SRS::ECEF);
+    auto& ellipsoid = SRS::ECEF.ellipsoid();
+
+    for (unsigned tileSize : { 17u, 65u })
+    {
+        const unsigned count = tileSize * tileSize;
+        std::vector<glm::dvec3> world(count), up(count);
+        double sink = 0.0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < tiles; ++t)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                glm::dvec3 unit(-10.0 + (double)(i % tileSize) / (tileSize - 1), 45.0 + (double)(i / tileSize) / (tileSize - 1), 0.0);
+                glm::dvec3 plus_one(unit.x, unit.y, 1.0);
+                xform.transform(unit, world[i]);
+                xform.transform(plus_one, up[i]);
+                up[i] = glm::normalize(up[i] - world[i]);
+            }
+            sink += up[t % count].z;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << tileSize << "x" << tileSize << ", per vertex: " << 1e3 * elapsed.count() / (double)tiles << " ms per tile" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < tiles; ++t)
+        {
+            for (unsigned i = 0; i < count; ++i)
+                world[i] = glm::dvec3(-10.0 + (double)(i % tileSize) / (tileSize - 1), 45.0 + (double)(i / tileSize) / (tileSize - 1), 0.0);
+            xform.transformArray(world.data(), count);
+            ellipsoid.geocentricToUpVectors(world.data(), up.data(), count);
+            sink += up[t % count].z;
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << tileSize << "x" << tileSize << ", bulk: " << 1e3 * elapsed.count() / (double)tiles << " ms per tile (" << (sink > 0.0) << ")" << std::endl;
+    }
+}
+
 #ifdef ROCKY_HAS_ZLIB
 TEST_CASE("Compression")
 {
@@ -220,6 +794,185 @@ TEST_CASE("Image")
     CHECK(equiv(value.a, 1.0f, 0.01f));
 }
 
+TEST_CASE("Image compression")
+{
+    auto image = makeTestImage(256, 256);
+    util::ImageCompressor compressor;
+
+    auto bc1 = compressor.compress(image, Image::BC1_RGBA_UNORM);
+    REQUIRE(bc1.status.ok());
+    CHECK(bc1.value->compressed());
+    CHECK(bc1.value->width() == 256);
+    CHECK(bc1.value->sizeInBytes() == 32768);
+    CHECK(bc1.value->rowSizeInBytes() == 512);
+
+    auto bc7 = compressor.compress(image, Image::BC7_UNORM);
+    REQUIRE(bc7.status.ok());
+    CHECK(bc7.value->sizeInBytes() == 65536);
+
+    // non-multiple-of-4 sizes round up to whole blocks
+    CHECK(Image::create(Image::BC3_UNORM, 257, 255)->sizeInBytes() == 65 * 64 * 16);
+
+    // already-compressed data passes through
+    CHECK(compressor.compress(bc1.value, Image::BC1_RGBA_UNORM).value == bc1.value);
+
+    // round-trip quality
+    CHECK(psnr(*image, *compressor.decompress(bc1.value).value, 3) > 32.0);
+    CHECK(psnr(*image, *compressor.decompress(bc7.value).value, 4) > 38.0);
+
+    auto bc3 = compressor.compress(image, Image::BC3_UNORM);
+    CHECK(psnr(*image, *compressor.decompress(bc3.value).value, 4) > 32.0);
+
+    auto bc5 = compressor.compress(image, Image::BC5_UNORM);
+    auto bc5_decoded = compressor.decompress(bc5.value).value;
+    CHECK(bc5_decoded->pixelFormat() == Image::R8G8_UNORM);
+
+    // multithreaded encoding gives the same result
+    compressor.pool = jobs::get_pool("test.compress");
+    compressor.blockRowsPerTask = 4;
+    auto bc1_mt = compressor.compress(image, Image::BC1_RGBA_UNORM);
+    REQUIRE(bc1_mt.status.ok());
+    CHECK(memcmp(bc1_mt.value->data<char>(), bc1.value->data<char>(), bc1.value->sizeInBytes()) == 0);
+
+    // flipping the blocks matches flipping the pixels
+    auto flipped = compressor.decompress(bc1.value).value;
+    flipped->flipVerticalInPlace();
+    bc1.value->flipVerticalInPlace();
+    auto decoded = compressor.decompress(bc1.value).value;
+    CHECK(memcmp(flipped->data<char>(), decoded->data<char>(), flipped->sizeInBytes()) == 0);
+
+    // BC7 and partial block rows flip by re-encoding, without shifting the rows
+    for (auto format : { Image::BC1_RGBA_UNORM, Image::BC7_UNORM })
+    {
+        auto strip = makeTestImage(16, 6);
+        auto expected = strip->clone();
+        expected->flipVerticalInPlace();
+        auto encoded = compressor.compress(strip, format).value;
+        REQUIRE(encoded->flipVerticalInPlace());
+        CHECK(psnr(*expected, *compressor.decompress(encoded).value, 3) > 22.0);
+    }
+
+    // BC7 blocks in modes other than the encoder's own
+    const unsigned char bc7_blocks[2][16] = {
+        { 0x52, 0xF2, 0x26, 0x65, 0xA6, 0x0C, 0x12, 0xD2, 0x89, 0x18, 0x5D, 0x95, 0x0E, 0xE8, 0x81, 0x36 }, // mode 1
+        { 0x10, 0x16, 0x6F, 0x6B, 0x11, 0x3D, 0x17, 0x8D, 0x6C, 0x0F, 0xD3, 0x90, 0x1F, 0xF2, 0x39, 0xA1 }  // mode 4
+    };
+    auto bc7_modes = Image::create(Image::BC7_UNORM, 8, 4);
+    memcpy(bc7_modes->data<char>(), bc7_blocks, sizeof(bc7_blocks));
+    auto bc7_decoded = compressor.decompress(bc7_modes);
+    REQUIRE(bc7_decoded.status.ok());
+    auto texel = [&](unsigned s, unsigned t) {
+        auto p = bc7_decoded.value->data<unsigned char>() + (t * 8 + s) * 4;
+        return std::vector<int>{ p[0], p[1], p[2], p[3] };
+    };
+    const std::vector<int> bc7_texels[4] = {
+        { 164, 175, 110, 255 }, { 190, 162, 86, 255 }, { 187, 209, 143, 210 }, { 192, 194, 104, 208 } };
+    CHECK(texel(0, 0) == bc7_texels[0]);
+    CHECK(texel(3, 3) == bc7_texels[1]);
+    CHECK(texel(4, 0) == bc7_texels[2]);
+    CHECK(texel(7, 3) == bc7_texels[3]);
+
+    CHECK(util::ImageCompressor::format("auto", image.get()) == Image::BC1_RGBA_UNORM);
+    CHECK(util::ImageCompressor::format("none", image.get()) == Image::UNDEFINED);
+}
+
+TEST_CASE("Image mipmaps")
+{
+    // one-pixel black and white checkerboard with a checkered alpha
+    auto image = Image::create(Image::R8G8B8A8_UNORM, 256, 256);
+    auto ptr = image->data<unsigned char>();
+    for (unsigned t = 0; t < 256; ++t)
+        for (unsigned s = 0; s < 256; ++s, ptr += 4)
+            ptr[0] = ptr[1] = ptr[2] = ptr[3] = ((s + t) & 1) ? 255 : 0;
+
+    auto linear = image->clone();
+
+    REQUIRE(image->generateMipmaps(Image::BOX, true));
+    CHECK(image->mipmapLevels() == 9);
+    CHECK(image->sizeInBytes() == 262144);
+    CHECK(image->totalSizeInBytes() == 349524);
+    CHECK(image->mipmapWidth(8) == 1);
+
+    // gamma-correct: 50% linear coverage encodes to sRGB 188, while alpha stays linear
+    auto level1 = image->data_at_miplevel(1);
+    CHECK(level1[0] == 188);
+    CHECK(level1[3] == 128);
+    auto level8 = image->data_at_miplevel(8);
+    CHECK(level8[0] == 188);
+
+    REQUIRE(linear->generateMipmaps(Image::BOX, false));
+    CHECK(linear->data_at_miplevel(1)[0] == 128);
+
+    // clone and copy carry the whole chain
+    auto clone = image->clone();
+    CHECK(clone->mipmapLevels() == 9);
+    CHECK(memcmp(clone->data<char>(), image->data<char>(), image->totalSizeInBytes()) == 0);
+
+    // the Kaiser filter preserves a constant image
+    auto flat = Image::create(Image::R8G8B8A8_UNORM, 64, 16);
+    flat->fill(Color(0.5f, 0.25f, 1.0f, 1.0f));
+    REQUIRE(flat->generateMipmaps(Image::KAISER, true));
+    CHECK(flat->mipmapLevels() == 7);
+    auto last = flat->data_at_miplevel(6);
+    CHECK(std::abs((int)last[0] - (int)flat->data<unsigned char>()[0]) <= 1);
+    CHECK(std::abs((int)last[1] - (int)flat->data<unsigned char>()[1]) <= 1);
+
+    // compressing keeps the mipmaps
+    auto bc1 = util::ImageCompressor().compress(image, Image::BC1_RGBA_UNORM);
+    REQUIRE(bc1.status.ok());
+    CHECK(bc1.value->mipmapLevels() == 9);
+    CHECK(bc1.value->totalSizeInBytes() == 43704);
+}
+
+TEST_CASE("Image mipmaps benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    auto image = makeTestImage(256, 256);
+    const int iterations = 64;
+
+    for (auto filter : { Image::BOX, Image::KAISER })
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto tile = image->clone();
+            tile->generateMipmaps(filter, true);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << (filter == Image::BOX ? "Box" : "Kaiser") << " mipmaps: "
+            << 1000.0 * elapsed.count() / (double)iterations << " ms per 256x256 tile" << std::endl;
+    }
+}
+
+TEST_CASE("Image compression benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    auto image = makeTestImage(256, 256);
+    const int iterations = 64;
+
+    for (auto pool : { (jobs::jobpool*)nullptr, jobs::get_pool("test.compress") })
+    {
+        for (auto format : { Image::BC1_RGBA_UNORM, Image::BC3_UNORM, Image::BC7_UNORM })
+        {
+            util::ImageCompressor compressor;
+            compressor.pool = pool;
+
+            Result<shared_ptr<Image>> result;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+                result = compressor.compress(image, format);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            double mpix = (double)(image->sizeInPixels() * iterations) / 1e6 / elapsed.count();
+            double quality = psnr(*image, *compressor.decompress(result.value).value, format == Image::BC1_RGBA_UNORM ? 3 : 4);
+
+            std::cout << "BC format " << format << (pool ? " (threaded)" : "")
+                << ": " << mpix << " Mpixels/s, PSNR " << quality << " dB" << std::endl;
+        }
+    }
+}
+
 TEST_CASE("Heightfield")
 {
     auto hf = Heightfield::create(257, 257);
@@ -233,23 +986,483 @@ TEST_CASE("Heightfield")
         CHECK(hf->componentSizeInBytes() == 4);
         CHECK(hf->sizeInPixels() == 66049);
 
-        // write/read:
-        hf->heightAt(16, 16) = 100.0f;
-        hf->heightAt(16, 17) = 50.0f;
-        hf->heightAt(17, 16) = 50.0f;
-        hf->heightAt(17, 17) = 100.0f;
-        CHECK(hf->heightAt(16, 16) == 100.0f);
-        CHECK(hf->heightAtPixel(16.5, 16.5, Heightfield::BILINEAR) == 75.0f);
-        
-        // read with NO_DATA_VALUEs:
-        hf->heightAt(17, 17) = NO_DATA_VALUE;
-        hf->heightAt(16, 16) = NO_DATA_VALUE;
-        CHECK(hf->heightAtPixel(16.5, 16.5, Heightfield::BILINEAR) == 50.0f);
+        // write/read:
+        hf->heightAt(16, 16) = 100.0f;
+        hf->heightAt(16, 17) = 50.0f;
+        hf->heightAt(17, 16) = 50.0f;
+        hf->heightAt(17, 17) = 100.0f;
+        CHECK(hf->heightAt(16, 16) == 100.0f);
+        CHECK(hf->heightAtPixel(16.5, 16.5, Heightfield::BILINEAR) == 75.0f);
+        
+        // read with NO_DATA_VALUEs:
+        hf->heightAt(17, 17) = NO_DATA_VALUE;
+        hf->heightAt(16, 16) = NO_DATA_VALUE;
+        CHECK(hf->heightAtPixel(16.5, 16.5, Heightfield::BILINEAR) == 50.0f);
+
+        // all NODATA:
+        hf->fill(NO_DATA_VALUE);
+        CHECK(hf->heightAtPixel(16.5, 16.5, Heightfield::BILINEAR) == NO_DATA_VALUE);
+    }
+}
+
+TEST_CASE("Geoid")
+{
+    // synthetic undulation grid, one post per degree
+    auto hf = Heightfield::create(361, 181);
+    for (unsigned r = 0; r < hf->height(); ++r)
+        for (unsigned c = 0; c < hf->width(); ++c)
+            hf->heightAt(c, r) = (float)(30.0 * sin(0.05 * c) * cos(0.07 * r));
+
+    auto geoid = Geoid::create("test", hf, Units::METERS);
+    REQUIRE(geoid->valid());
+
+    std::vector<glm::dvec3> points;
+    for (double lat = -90.0; lat <= 90.0; lat += 3.7)
+        for (double lon = -180.0; lon <= 180.0; lon += 4.3)
+            points.emplace_back(lon, lat, 0.0);
+    points.emplace_back(180.0, 90.0, 0.0);
+
+    std::vector<float> heights(points.size());
+    geoid->getHeights(points.data(), points.size(), heights.data());
+
+    for (std::size_t i = 0; i < points.size(); ++i)
+    {
+        CHECK(equiv(heights[i], geoid->getHeight(points[i].y, points[i].x), 1e-4f));
+    }
+
+    // longitudes wrap around the antimeridian
+    glm::dvec3 wrapped[2] = { { -170.5, 12.25, 0.0 }, { 189.5, 12.25, 0.0 } };
+    float wrapped_heights[2];
+    geoid->getHeights(wrapped, 2, wrapped_heights);
+    CHECK(equiv(wrapped_heights[0], wrapped_heights[1], 1e-4f));
+}
+
+TEST_CASE("Heightfield encoding")
+{
+    // synthetic terrain spanning a realistic height range:
+    auto hf = Heightfield::create(257, 257);
+    for (unsigned r = 0; r < hf->height(); ++r)
+        for (unsigned c = 0; c < hf->width(); ++c)
+            hf->heightAt(c, r) = -420.0f + 9268.0f * (float)((c * 7919 + r * 104729) % 65521) / 65520.0f;
+    hf->heightAt(0, 0) = -420.0f;
+    hf->heightAt(1, 0) = 8848.0f;
+    hf->heightAt(100, 100) = NO_DATA_VALUE;
+
+    auto max_error = [&](const Heightfield* encoded) {
+        double e = 0.0;
+        for (unsigned r = 0; r < hf->height(); ++r)
+            for (unsigned c = 0; c < hf->width(); ++c)
+                if (hf->heightAt(c, r) != NO_DATA_VALUE)
+                    e = std::max(e, (double)std::abs(encoded->heightAt(c, r) - hf->heightAt(c, r)));
+        return e;
+    };
+
+    SECTION("R16 quantized")
+    {
+        // (compact heightfields are read-only, so use const access)
+        shared_ptr<const Heightfield> r16 = hf->encode(Image::R16_UNORM);
+        REQUIRE(r16);
+        CHECK(r16->pixelFormat() == Image::R16_UNORM);
+        CHECK(r16->sizeInBytes() == hf->sizeInBytes() / 2);
+        CHECK(Heightfield::cast_from(r16.get()) != nullptr);
+        CHECK(r16->heightAt(100, 100) == NO_DATA_VALUE);
+
+        // half a quantization step, plus a little float round-off:
+        double bound = (8848.0 + 420.0) / 65534.0 / 2.0;
+        CHECK(max_error(r16.get()) <= bound * 1.01);
+
+        // the GPU path: normalized value * scale + offset
+        float n = (float)r16->data<std::uint16_t>(1, 0) / 65535.0f;
+        CHECK(std::abs(n * r16->heightScale() + r16->heightOffset() - 8848.0f) <= bound * 1.01);
+
+        // interpolation works on decoded heights:
+        float expected = hf->heightAtPixel(30.25, 40.75, Heightfield::BILINEAR);
+        CHECK(std::abs(r16->heightAtPixel(30.25, 40.75, Heightfield::BILINEAR) - expected) <= bound * 1.01);
+
+        // the encoding travels with copies:
+        auto copy = r16->clone();
+        auto copy_hf = Heightfield::cast_from(copy.get());
+        REQUIRE(copy_hf);
+        CHECK(copy_hf->heightAt(1, 0) == r16->heightAt(1, 0));
+
+        auto decoded = r16->decode();
+        CHECK(decoded->pixelFormat() == Image::R32_SFLOAT);
+        CHECK(decoded->heightAt(1, 0) == r16->heightAt(1, 0));
+        CHECK(decoded->heightAt(100, 100) == NO_DATA_VALUE);
+    }
+
+    SECTION("Half float")
+    {
+        shared_ptr<const Heightfield> half = hf->encode(Image::R16_SFLOAT);
+        REQUIRE(half);
+        CHECK(half->pixelFormat() == Image::R16_SFLOAT);
+        CHECK(half->sizeInBytes() == hf->sizeInBytes() / 2);
+        CHECK(half->heightAt(100, 100) == NO_DATA_VALUE);
+
+        // relative error of half the 11-bit significand:
+        unsigned out_of_bounds = 0;
+        for (unsigned r = 0; r < hf->height(); ++r)
+            for (unsigned c = 0; c < hf->width(); ++c)
+                if (hf->heightAt(c, r) != NO_DATA_VALUE &&
+                    std::abs(half->heightAt(c, r) - hf->heightAt(c, r)) > std::abs(hf->heightAt(c, r)) / 2048.0f)
+                    ++out_of_bounds;
+        CHECK(out_of_bounds == 0);
+
+        CHECK(half->heightAt(1, 0) == 8848.0f); // exactly representable
+
+        // out of range heights clamp to the largest half:
+        auto big = Heightfield::create(2, 2);
+        big->fill(100000.0f);
+        shared_ptr<const Heightfield> big_half = big->encode(Image::R16_SFLOAT);
+        CHECK(big_half->heightAt(0, 0) == 65504.0f);
+    }
+
+    SECTION("Half conversion")
+    {
+        // every finite half survives a round trip through float:
+        unsigned failures = 0;
+        for (unsigned i = 0; i < 65536; ++i)
+        {
+            auto h = (std::uint16_t)i;
+            float f = util::half_to_float(h);
+            if (f == f && util::float_to_half(f) != h)
+                ++failures;
+        }
+        CHECK(failures == 0);
+        CHECK(util::half_to_float(util::float_to_half(1.0f)) == 1.0f);
+        CHECK(util::float_to_half(1.0f + 1.0f / 4096.0f) == util::float_to_half(1.0f)); // ties to even
+        CHECK(util::half_to_float(util::float_to_half(65520.0f)) == std::numeric_limits<float>::infinity());
+    }
+
+    SECTION("Layer cache")
+    {
+        // full-precision cache entries are shared; compact ones decode into new copies
+        TileKey key(4, 3, 2, Profile::GLOBAL_GEODETIC);
+
+        auto layer = TestElevationLayer::create();
+        REQUIRE(layer->open().ok());
+        auto first = layer->createHeightfield(key);
+        REQUIRE(first.status.ok());
+        CHECK(layer->createHeightfield(key).value.heightfield() == first.value.heightfield());
+
+        auto compact = TestElevationLayer::create();
+        compact->setCacheEncoding(Image::R16_UNORM);
+        REQUIRE(compact->open().ok());
+        auto a = compact->createHeightfield(key);
+        auto b = compact->createHeightfield(key);
+        REQUIRE(b.status.ok());
+        CHECK(b.value.heightfield()->pixelFormat() == Image::R32_SFLOAT);
+        CHECK(a.value.heightfield() != b.value.heightfield());
+    }
+}
+
+TEST_CASE("Heightfield edges")
+{
+    // two neighbors at the same LOD, one above the other:
+    auto south = Heightfield::create(17, 17);
+    auto north = Heightfield::create(17, 17);
+    for (unsigned r = 0; r < 17; ++r)
+    {
+        for (unsigned c = 0; c < 17; ++c)
+        {
+            south->heightAt(c, r) = (float)(c * 3 + r);
+            north->heightAt(c, r) = (float)(100 + c * c - r);
+        }
+    }
+    north->heightAt(5, 0) = NO_DATA_VALUE;
+
+    SECTION("Average")
+    {
+        auto south_data = south->decode(), north_data = north->decode();
+        CHECK(HeightfieldEdges::average(*south, HeightfieldEdges::NORTH, *north_data));
+        CHECK(HeightfieldEdges::average(*north, HeightfieldEdges::SOUTH, *south_data));
+
+        // both sides end up with the same samples:
+        for (unsigned c = 0; c < 17; ++c)
+            CHECK(south->heightAt(c, 16) == north->heightAt(c, 0));
+
+        CHECK(south->heightAt(3, 16) == 0.5f * (south_data->heightAt(3, 16) + north_data->heightAt(3, 0)));
+        CHECK(north->heightAt(5, 0) == south_data->heightAt(5, 16));
+
+        // the rest is untouched:
+        CHECK(south->heightAt(3, 15) == south_data->heightAt(3, 15));
+
+        // sides of different sizes don't average
+        auto small = Heightfield::create(9, 9);
+        CHECK_FALSE(HeightfieldEdges::average(*small, HeightfieldEdges::SOUTH, *south_data));
+    }
+
+    SECTION("Follow")
+    {
+        // the north neighbor is one LOD coarser, so the south tile
+        // runs along the western half of its southern side:
+        unsigned segments = 16;
+        HeightfieldEdges::follow(*south, HeightfieldEdges::NORTH, *north, glm::dmat4(1), segments, 0.0, 0.5);
+
+        for (unsigned c = 0; c < 17; ++c)
+        {
+            if (c % 2 == 0)
+            {
+                // right on a vertex of the coarser neighbor
+                CHECK(south->heightAt(c, 16) == north->heightAt(c / 2, 0));
+            }
+            else
+            {
+                // halfway along one of its segments
+                float mid = 0.5f * (north->heightAt(c / 2, 0) + north->heightAt(c / 2 + 1, 0));
+                CHECK(std::abs(south->heightAt(c, 16) - mid) < 1e-3f);
+            }
+        }
+
+        // the same surface, for a neighbor that inherits the upper-left
+        // quadrant of its own parent's data:
+        auto parent = Heightfield::create(33, 33);
+        for (unsigned r = 0; r < 33; ++r)
+            for (unsigned c = 0; c < 33; ++c)
+                parent->heightAt(c, r) = (float)(c * r);
+
+        glm::dmat4 quadrant(0.5, 0, 0, 0, 0, 0.5, 0, 0, 0, 0, 1, 0, 0.0, 0.5, 0, 1);
+        float h = HeightfieldEdges::boundaryHeight(*parent, quadrant, segments, 0.25, 0.0);
+        CHECK(std::abs(h - parent->heightAt(4, 16)) < 1e-3f);
+    }
+}
+
+TEST_CASE("Heightfield pyramid")
+{
+    // a ridge along the east edge, flat everywhere else
+    auto hf = Heightfield::create(257, 257);
+    for (unsigned r = 0; r < hf->height(); ++r)
+        for (unsigned c = 0; c < hf->width(); ++c)
+            hf->heightAt(c, r) = c > 192 ? 3000.0f + (float)((c * 31 + r * 17) % 500) : 100.0f;
+    hf->heightAt(10, 10) = NO_DATA_VALUE;
+
+    HeightfieldPyramid pyramid(hf.get());
+    REQUIRE(pyramid.valid());
+    CHECK(pyramid.numLevels() > 1);
+
+    float hmin, hmax;
+    REQUIRE(pyramid.heightRange(0.0, 0.0, 1.0, 1.0, hmin, hmax));
+    CHECK(hmin == 100.0f);
+    CHECK(hmax >= 3499.0f);
+
+    // the flat half does not see the ridge:
+    REQUIRE(pyramid.heightRange(0.0, 0.0, 0.5, 1.0, hmin, hmax));
+    CHECK(hmin == 100.0f);
+    CHECK(hmax == 100.0f);
+
+    // every sample in a window is inside its range:
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> uv(0.0, 1.0);
+    unsigned failures = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        double u0 = uv(gen), u1 = uv(gen), v0 = uv(gen), v1 = uv(gen);
+        if (u0 > u1) std::swap(u0, u1);
+        if (v0 > v1) std::swap(v0, v1);
+        pyramid.heightRange(u0, v0, u1, v1, hmin, hmax);
+
+        for (int j = 0; j < 16; ++j)
+        {
+            double u = u0 + (u1 - u0) * uv(gen), v = v0 + (v1 - v0) * uv(gen);
+            for (auto interp : { Heightfield::NEAREST, Heightfield::BILINEAR })
+            {
+                float h = hf->heightAtUV(u, v, interp);
+                if (h != NO_DATA_VALUE && (h < hmin || h > hmax))
+                    ++failures;
+            }
+        }
+    }
+    CHECK(failures == 0);
+
+    // works on compact encodings, in decoded heights:
+    auto r16 = hf->encode(Image::R16_UNORM);
+    HeightfieldPyramid r16_pyramid(r16.get());
+    REQUIRE(r16_pyramid.heightRange(0.0, 0.0, 0.5, 1.0, hmin, hmax));
+    CHECK(equiv(hmin, 100.0f, 0.1f));
+    CHECK(equiv(hmax, 100.0f, 0.1f));
+
+    // no valid heights, no range:
+    auto empty = Heightfield::create(17, 17);
+    empty->fill(NO_DATA_VALUE);
+    HeightfieldPyramid empty_pyramid(empty.get());
+    CHECK(empty_pyramid.heightRange(0.0, 0.0, 1.0, 1.0, hmin, hmax) == false);
+}
+
+TEST_CASE("Heightfield pyramid benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    auto hf = Heightfield::create(257, 257);
+    for (unsigned r = 0; r < hf->height(); ++r)
+        for (unsigned c = 0; c < hf->width(); ++c)
+            hf->heightAt(c, r) = (float)(2000.0 * sin(0.05 * c) * cos(0.07 * r));
+
+    const unsigned tileSize = 17;
+    const int iterations = 10000;
+
+    // bounding a tile that inherits one 16th of the heightfield, like a
+    // grandchild of the tile that loaded it: one sample per vertex...
+    float check = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        double u0 = 0.25 * (i % 4), v0 = 0.25 * ((i / 4) % 4);
+        float hmin = FLT_MAX, hmax = -FLT_MAX;
+        for (unsigned r = 0; r < tileSize; ++r)
+        {
+            for (unsigned c = 0; c < tileSize; ++c)
+            {
+                float h = hf->heightAtUV(
+                    u0 + 0.25 * (double)c / (double)(tileSize - 1),
+                    v0 + 0.25 * (double)r / (double)(tileSize - 1),
+                    Heightfield::NEAREST);
+                hmin = std::min(hmin, h), hmax = std::max(hmax, h);
+            }
+        }
+        check += hmax - hmin;
+    }
+    std::chrono::duration<double> walk = std::chrono::steady_clock::now() - start;
+
+    // ...or one query per quadrant.
+    start = std::chrono::steady_clock::now();
+    HeightfieldPyramid pyramid(hf.get());
+    std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        double u0 = 0.25 * (i % 4), v0 = 0.25 * ((i / 4) % 4);
+        for (unsigned q = 0; q < 4; ++q)
+        {
+            double qu = u0 + ((q & 1) ? 0.125 : 0.0), qv = v0 + ((q < 2) ? 0.125 : 0.0);
+            float hmin, hmax;
+            pyramid.heightRange(qu, qv, qu + 0.125, qv + 0.125, hmin, hmax);
+            check += hmax - hmin;
+        }
+    }
+    std::chrono::duration<double> query = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Vertex walk: " << 1e6 * walk.count() / (double)iterations << " us per tile" << std::endl;
+    std::cout << "Pyramid: " << 1e6 * query.count() / (double)iterations << " us per tile (4 quadrants), "
+        << 1000.0 * build.count() << " ms to build, " << pyramid.sizeInBytes() << " bytes" << std::endl;
+    CHECK(check > 0.0f);
+}
+
+TEST_CASE("Terrain RGB")
+{
+    using util::TerrainRGB;
+
+    SECTION("Mapbox")
+    {
+        const unsigned char pixels[] = {
+            0x01, 0x86, 0xa0,   // 100000 -> 0m
+            0x01, 0x98, 0x06,   // 104454 -> 445.4m
+            0x00, 0x00, 0x00 }; // -10000m -> no data
+        float heights[3];
+        TerrainRGB::decodeRow(pixels, 3, 3, TerrainRGB::Format::Mapbox, heights);
+        CHECK(heights[0] == 0.0f);
+        CHECK(equiv(heights[1], 445.4f, 0.01f));
+        CHECK(heights[2] == NO_DATA_VALUE);
+    }
+
+    SECTION("Terrarium")
+    {
+        const unsigned char pixels[] = {
+            0x80, 0x00, 0x00, 0xff,   // 0m
+            0x81, 0xbd, 0x80, 0xff,   // 445.5m
+            0x7f, 0xff, 0x00, 0xff }; // -1m
+        float heights[3];
+        TerrainRGB::decodeRow(pixels, 4, 3, TerrainRGB::Format::Terrarium, heights);
+        CHECK(heights[0] == 0.0f);
+        CHECK(heights[1] == 445.5f);
+        CHECK(heights[2] == -1.0f);
+    }
+
+    SECTION("Images")
+    {
+        for (auto format : { TerrainRGB::Format::Mapbox, TerrainRGB::Format::Terrarium })
+        {
+            auto rgb = makeTerrainRGBImage(64, 32, 3, format);
+            auto rgba = makeTerrainRGBImage(64, 32, 4, format);
+
+            auto hf = TerrainRGB::decode(rgb.get(), format);
+            REQUIRE(hf);
+            CHECK(hf->width() == 64);
+            CHECK(hf->height() == 32);
+            CHECK(equiv(hf->heightAt(10, 20), (float)(100.0 * sin(0.5) * cos(1.0) + 500.0), 0.1f));
+
+            auto hf2 = TerrainRGB::decode(rgba.get(), format);
+            REQUIRE(hf2);
+            CHECK(memcmp(hf->data<float>(), hf2->data<float>(), hf->sizeInBytes()) == 0);
+        }
+
+        auto unsupported = Image::create(Image::R32_SFLOAT, 4, 4);
+        CHECK(TerrainRGB::decode(unsupported.get(), TerrainRGB::Format::Mapbox) == nullptr);
+    }
+
+#ifdef ROCKY_HAS_ZLIB
+    SECTION("PNG")
+    {
+        for (unsigned components : { 3u, 4u })
+        {
+            auto image = makeTerrainRGBImage(37, 23, components, TerrainRGB::Format::Mapbox);
+            auto png = makePNG(*image);
+            CHECK(TerrainRGB::isPNG(png));
+
+            auto expected = TerrainRGB::decode(image.get(), TerrainRGB::Format::Mapbox);
+            auto r = TerrainRGB::decodePNG(png, TerrainRGB::Format::Mapbox);
+            REQUIRE(r.status.ok());
+            REQUIRE(r.value->width() == 37);
+            REQUIRE(r.value->height() == 23);
+            CHECK(memcmp(r.value->data<float>(), expected->data<float>(), expected->sizeInBytes()) == 0);
+        }
+
+        CHECK(TerrainRGB::decodePNG("not a png", TerrainRGB::Format::Mapbox).status.failed());
+    }
+#endif
+}
+
+TEST_CASE("Terrain RGB benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    using util::TerrainRGB;
+    auto image = makeTerrainRGBImage(512, 512, 3, TerrainRGB::Format::Mapbox);
+    const int iterations = 64;
 
-        // all NODATA:
-        hf->fill(NO_DATA_VALUE);
-        CHECK(hf->heightAtPixel(16.5, 16.5, Heightfield::BILINEAR) == NO_DATA_VALUE);
+    auto report = [&](const std::string& what, std::chrono::steady_clock::time_point start)
+        {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << what << ": " << 1000.0 * elapsed.count() / (double)iterations << " ms per 512x512 tile" << std::endl;
+        };
+
+    // the generic path: read each pixel as normalized floats
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto hf = Heightfield::create(image->width(), image->height());
+        glm::fvec4 pixel;
+        for (unsigned y = 0; y < image->height(); ++y)
+        {
+            for (unsigned x = 0; x < image->width(); ++x)
+            {
+                image->read(pixel, x, y);
+                hf->heightAt(x, y) = -10000.f + ((pixel.r * 255.0f * 65536.0f + pixel.g * 255.0f * 256.0f + pixel.b * 255.0f) * 0.1f);
+            }
+        }
     }
+    report("Per-pixel decode", start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        TerrainRGB::decode(image.get(), TerrainRGB::Format::Mapbox);
+    report("Row decode", start);
+
+#ifdef ROCKY_HAS_ZLIB
+    auto png = makePNG(*image);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        TerrainRGB::decodePNG(png, TerrainRGB::Format::Mapbox);
+    report("PNG decode (incl. inflate)", start);
+#endif
 }
 
 TEST_CASE("Map")
@@ -298,6 +1511,449 @@ TEST_CASE("Map")
     }
 }
 
+TEST_CASE("Layer dirty extents")
+{
+    Instance instance;
+
+    auto map = Map::create(instance);
+    auto layer = TestElevationLayer::create();
+    map->layers().add(layer);
+
+    std::vector<GeoExtent> extents;
+    auto start = layer->revision();
+    CHECK(layer->dirtyExtents(start, extents));
+    CHECK(extents.empty());
+
+    GeoExtent a(SRS::WGS84, 0, 0, 10, 10);
+    GeoExtent b(SRS::WGS84, 20, 20, 30, 30);
+
+    layer->dirty(a);
+    auto middle = layer->revision();
+    layer->dirty(b);
+    CHECK(layer->revision() == start + 2);
+
+    CHECK(layer->dirtyExtents(start, extents));
+    CHECK(extents.size() == 2);
+
+    extents.clear();
+    CHECK(layer->dirtyExtents(middle, extents));
+    REQUIRE(extents.size() == 1);
+    CHECK(extents[0] == b);
+
+    // manifests follow the revisions of their layers
+    CreateTileManifest manifest;
+    manifest.insert(layer);
+    CHECK(manifest.includesElevation());
+    CHECK_FALSE(manifest.includesColor());
+    CHECK(manifest.inSyncWith(map.get()));
+
+    layer->dirty(a);
+    CHECK_FALSE(manifest.inSyncWith(map.get()));
+    manifest.updateRevisions(map.get());
+    CHECK(manifest.inSyncWith(map.get()));
+
+    // a change to the whole layer
+    auto before = layer->revision();
+    layer->dirty();
+    CHECK_FALSE(layer->dirtyExtents(before, extents));
+
+    // changes too old to remember count as the whole layer too
+    before = layer->revision();
+    for (int i = 0; i < 1000; ++i)
+        layer->dirty(a);
+    CHECK_FALSE(layer->dirtyExtents(before, extents));
+}
+
+TEST_CASE("Elevation sampling")
+{
+    auto layer = TestElevationLayer::create();
+    REQUIRE(layer->open().ok());
+
+    ElevationLayerVector layers;
+    layers.push_back(layer);
+
+    std::mt19937 engine(0);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0), lat(-89.0, 89.0);
+
+    const std::size_t count = 1000;
+    std::vector<glm::dvec3> points(count);
+    for (auto& p : points)
+        p = glm::dvec3(lon(engine), lat(engine), 0.0);
+    points[0] = glm::dvec3(-180.0, -90.0, 0.0); // corner
+    points[1] = glm::dvec3(0.0, 0.0, 0.0); // tile boundary
+
+    SECTION("Geographic")
+    {
+        std::vector<float> heights(count);
+        auto n = layers.sampleHeights(points.data(), count, SRS::WGS84, heights.data(), 4, Image::BILINEAR, IOOptions());
+        CHECK(n == count);
+
+        unsigned bad = 0;
+        for (std::size_t i = 0; i < count; ++i)
+            if (std::abs(heights[i] - TestElevationLayer::height(points[i].x, points[i].y)) > 0.01f)
+                ++bad;
+        CHECK(bad == 0);
+    }
+
+    SECTION("Projected input")
+    {
+        // same points in spherical mercator (inside its latitude limits):
+        std::vector<glm::dvec3> merc;
+        std::vector<glm::dvec3> geo;
+        for (auto& p : points)
+            if (std::abs(p.y) < 80.0)
+                geo.push_back(p);
+        merc = geo;
+        REQUIRE(SRS::WGS84.to(SRS::SPHERICAL_MERCATOR).transformArray(merc.data(), merc.size()));
+
+        std::vector<float> heights(merc.size());
+        auto n = layers.sampleHeights(merc.data(), merc.size(), SRS::SPHERICAL_MERCATOR, heights.data(), 4, Image::BILINEAR, IOOptions());
+        CHECK(n == merc.size());
+
+        unsigned bad = 0;
+        for (std::size_t i = 0; i < merc.size(); ++i)
+            if (std::abs(heights[i] - TestElevationLayer::height(geo[i].x, geo[i].y)) > 0.01f)
+                ++bad;
+        CHECK(bad == 0);
+    }
+
+    SECTION("Job pool")
+    {
+        std::vector<float> heights(count), pooled(count);
+        layers.sampleHeights(points.data(), count, SRS::WGS84, heights.data(), 8, Image::BILINEAR, IOOptions());
+
+        auto pool = jobs::get_pool("test.elevation");
+        pool->set_concurrency(4);
+        CHECK(layers.sampleHeights(points.data(), count, SRS::WGS84, pooled.data(), 8, Image::BILINEAR, IOOptions(), pool) == count);
+        CHECK(pooled == heights);
+    }
+
+    SECTION("Outside the profile")
+    {
+        glm::dvec3 outside(200.0, 100.0, 0.0);
+        float height = 0.0f;
+        CHECK(layers.sampleHeights(&outside, 1, SRS::WGS84, &height, 4, Image::BILINEAR, IOOptions()) == 0);
+        CHECK(height == NO_DATA_VALUE);
+    }
+}
+
+TEST_CASE("Elevation sampling benchmark", "[.][benchmark]")
+{
+    auto layer = TestElevationLayer::create();
+    REQUIRE(layer->open().ok());
+
+    ElevationLayerVector layers;
+    layers.push_back(layer);
+
+    std::mt19937 engine(0);
+    std::uniform_real_distribution<double> lon(-10.0, 10.0), lat(40.0, 50.0);
+
+    const std::size_t count = 1000000;
+    const unsigned lod = 8;
+    std::vector<glm::dvec3> points(count);
+    for (auto& p : points)
+        p = glm::dvec3(lon(engine), lat(engine), 0.0);
+
+    using clock = std::chrono::steady_clock;
+    auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    // one point at a time, the way callers sample today (on a subset,
+    // since every query fetches a tile):
+    const std::size_t singleCount = 10000;
+    std::vector<float> single(singleCount);
+    auto t0 = clock::now();
+    for (std::size_t i = 0; i < singleCount; ++i)
+    {
+        auto key = TileKey::createTileKeyContainingPoint(points[i].x, points[i].y, lod, layer->profile());
+        auto hf = layer->createHeightfield(key, IOOptions());
+        single[i] = hf.value.heightAt(points[i].x, points[i].y, SRS::WGS84, Image::BILINEAR);
+    }
+    auto t1 = clock::now();
+
+    std::vector<float> batch(count);
+    layers.sampleHeights(points.data(), count, SRS::WGS84, batch.data(), lod, Image::BILINEAR, IOOptions());
+    auto t2 = clock::now();
+
+    auto pool = jobs::get_pool("test.elevation");
+    pool->set_concurrency(4);
+    layers.sampleHeights(points.data(), count, SRS::WGS84, batch.data(), lod, Image::BILINEAR, IOOptions(), pool);
+    auto t3 = clock::now();
+
+    double maxError = 0.0;
+    for (std::size_t i = 0; i < singleCount; ++i)
+        maxError = std::max(maxError, (double)std::abs(single[i] - batch[i]));
+
+    std::cout << "Elevation sampling, " << count << " points: "
+        << "per-point " << ms(t1 - t0) * (double)(count / singleCount) << " ms (extrapolated), "
+        << "batched " << ms(t2 - t1) << " ms, "
+        << "batched on 4 threads " << ms(t3 - t2) << " ms, "
+        << "max difference " << maxError << " m" << std::endl;
+
+    CHECK(maxError < 0.01);
+}
+
+#ifdef ROCKY_HAS_VSG
+TEST_CASE("Terrain paging")
+{
+    Instance instance;
+    auto map = Map::create(instance);
+    map->layers().add(TestElevationLayer::create());
+
+    TerrainSettings settings("{}");
+    settings.maxLevelOfDetail = 12u;
+
+    TerrainPagingSimulator sim(map, settings);
+    sim.frameRate = 30.0;
+
+    // descend from orbit and hold
+    std::vector<TerrainPagingSimulator::Waypoint> path = {
+        { 0.0, 10.0, 45.0, 1.5e7 },
+        { 2.0, 10.0, 45.0, 2.0e4 }
+    };
+
+    auto report = sim.run(path, instance.ioOptions());
+    REQUIRE(report.converged);
+
+    auto& last = report.frames.back();
+    CHECK(last.settled);
+    CHECK(last.tilesDrawn > 0);
+    CHECK(last.maxLevelDrawn > 4);
+    CHECK(last.maxLevelDrawn <= 12);
+    CHECK(report.totalLoads >= last.tilesResident);
+    CHECK(report.totalBytesLoaded > 0);
+
+    auto j = parse_json(report.to_json());
+    CHECK(j["frames"].size() == report.frames.size());
+    CHECK(j["summary"]["converged"].get<bool>());
+
+    // climbing back up releases the detailed tiles
+    auto resident = sim.size();
+    for (int i = 0; i < 10; ++i)
+        sim.frame(path.front(), instance.ioOptions());
+    CHECK(sim.size() < resident);
+
+    SECTION("Memory budget")
+    {
+        // a round trip: down, back up, and down again
+        path.push_back({ 4.0, 10.0, 45.0, 1.5e7 });
+        path.push_back({ 6.0, 10.0, 45.0, 2.0e4 });
+
+        auto unbudgeted = sim.run(path, instance.ioOptions());
+        REQUIRE(unbudgeted.converged);
+
+        // with room for everything, the second descent finds its tiles resident
+        settings.memoryBudget = 4096u;
+        auto budgeted = sim.run(path, instance.ioOptions());
+        REQUIRE(budgeted.converged);
+        CHECK(budgeted.totalLoads < unbudgeted.totalLoads);
+        CHECK(budgeted.peakResidentBytes >= unbudgeted.peakResidentBytes);
+        CHECK(budgeted.frames.back().residentBytes <= 4096ull * 1024 * 1024);
+
+        // with too little room, tiles expire and the second descent reloads
+        settings.memoryBudget = 1u;
+        auto tight = sim.run(path, instance.ioOptions());
+        REQUIRE(tight.converged);
+        CHECK(tight.totalLoads > budgeted.totalLoads);
+    }
+
+    SECTION("Prefetch")
+    {
+        // a fast, low pass over the terrain
+        path = {
+            { 0.0, 10.0, 45.0, 2.0e4 },
+            { 1.0, 10.0, 45.0, 2.0e4, 90.0, -45.0 },
+            { 6.0, 16.0, 45.0, 2.0e4, 90.0, -45.0 }
+        };
+
+        settings.prefetchSeconds = 0.0f;
+        auto reactive = sim.run(path, instance.ioOptions());
+        REQUIRE(reactive.converged);
+
+        unsigned prefetched = 0;
+        for (auto& f : reactive.frames)
+            prefetched += f.subtilesPrefetched;
+        CHECK(prefetched == 0);
+
+        settings.prefetchSeconds = 1.0f;
+        auto predictive = sim.run(path, instance.ioOptions());
+        REQUIRE(predictive.converged);
+
+        for (auto& f : predictive.frames)
+            prefetched += f.subtilesPrefetched;
+        CHECK(prefetched > 0);
+
+        // the same detail in the end, once the camera stops
+        CHECK(predictive.frames.back().maxLevelDrawn == reactive.frames.back().maxLevelDrawn);
+        CHECK(predictive.frames.back().tilesBlurry == 0);
+    }
+
+    SECTION("Horizon culling")
+    {
+        // skimming the surface toward the horizon
+        path = {
+            { 0.0, 10.0, 45.0, 1.5e7 },
+            { 2.0, 10.0, 45.0, 2.0e3, 0.0, -5.0 }
+        };
+
+        settings.horizonCulling = false;
+        auto unculled = sim.run(path, instance.ioOptions());
+        REQUIRE(unculled.converged);
+
+        settings.horizonCulling = true;
+        auto culled = sim.run(path, instance.ioOptions());
+        REQUIRE(culled.converged);
+
+        CHECK(culled.totalTilesTraversed < unculled.totalTilesTraversed);
+        CHECK(culled.totalLoads <= unculled.totalLoads);
+        CHECK(culled.frames.back().tilesTraversed < unculled.frames.back().tilesTraversed);
+        CHECK(culled.frames.back().maxLevelDrawn == unculled.frames.back().maxLevelDrawn);
+    }
+
+    SECTION("Morphing")
+    {
+        settings.morphTerrain = true;
+        auto morphed = sim.run(path, instance.ioOptions());
+        REQUIRE(morphed.converged);
+        CHECK(morphed.frames.back().maxLevelDrawn > 4);
+
+        // morphing hides a coarser screen-space error, which needs fewer tiles
+        settings.screenSpaceError = 4.0f * settings.screenSpaceError.value();
+        auto coarse = sim.run(path, instance.ioOptions());
+        REQUIRE(coarse.converged);
+        CHECK(coarse.peakTilesResident < morphed.peakTilesResident);
+    }
+}
+
+TEST_CASE("Terrain morphing")
+{
+    const double viewportHeight = 1080.0;
+    const float screenSpaceError = 150.0f;
+
+    // view distance at which a tile of this radius just meets the screen-space error
+    auto lodDistance = [&](double radius) {
+        return radius * viewportHeight / (256.0 + screenSpaceError);
+    };
+
+    for (unsigned lod = 0; lod < 19; ++lod)
+    {
+        auto range = TerrainTilePolicy::computeMorphRange(Profile::GLOBAL_GEODETIC, lod);
+        auto childRange = TerrainTilePolicy::computeMorphRange(Profile::GLOBAL_GEODETIC, lod + 1);
+        REQUIRE(range[0] < range[1]);
+
+        // subtiles finish morphing before their parent starts
+        CHECK(childRange[1] <= range[0]);
+        CHECK(TerrainTilePolicy::morphFactor(lodDistance(childRange[1]), viewportHeight, screenSpaceError, childRange) == 1.0f);
+        CHECK(TerrainTilePolicy::morphFactor(lodDistance(childRange[1]), viewportHeight, screenSpaceError, range) == 0.0f);
+
+        // and the factor runs smoothly from 0 to 1 across the range
+        CHECK(TerrainTilePolicy::morphFactor(lodDistance(range[0]), viewportHeight, screenSpaceError, range) == Approx(0.0f));
+        CHECK(TerrainTilePolicy::morphFactor(lodDistance(0.5 * (range[0] + range[1])), viewportHeight, screenSpaceError, range) == Approx(0.5f));
+        CHECK(TerrainTilePolicy::morphFactor(lodDistance(range[1]), viewportHeight, screenSpaceError, range) == Approx(1.0f));
+        CHECK(TerrainTilePolicy::morphFactor(lodDistance(2.0 * range[1]), viewportHeight, screenSpaceError, range) == 1.0f);
+        CHECK(TerrainTilePolicy::morphFactor(0.0, viewportHeight, screenSpaceError, range) == 0.0f);
+
+        float prev = 0.0f;
+        for (int i = 0; i <= 100; ++i)
+        {
+            double radius = range[0] + (range[1] - range[0]) * (double)i / 100.0;
+            float factor = TerrainTilePolicy::morphFactor(lodDistance(radius), viewportHeight, screenSpaceError, range);
+            CHECK(factor >= prev);
+            prev = factor;
+        }
+    }
+
+    // a larger screen-space error morphs sooner
+    auto range = TerrainTilePolicy::computeMorphRange(Profile::GLOBAL_GEODETIC, 10);
+    double d = lodDistance(0.5 * (range[0] + range[1]));
+    CHECK(TerrainTilePolicy::morphFactor(d, viewportHeight, 2.0f * screenSpaceError, range) >
+        TerrainTilePolicy::morphFactor(d, viewportHeight, screenSpaceError, range));
+}
+
+TEST_CASE("Terrain tile policy")
+{
+    using Policy = TerrainTilePolicy;
+
+    SECTION("Subdivision")
+    {
+        Policy::Subdivision state;
+
+        // subtiles the camera wants are requested, and drawn once they exist
+        CHECK(Policy::subdivide(state, true, false, false, false) == Policy::Traversal::Tile);
+        CHECK(state.needsSubtiles);
+        CHECK_FALSE(state.subtilesPrefetched);
+        CHECK(Policy::subdivide(state, true, false, true, true) == Policy::Traversal::Subtiles);
+
+        // subtiles prefetched ahead of the camera stay while it keeps coming...
+        state = { };
+        CHECK(Policy::subdivide(state, false, true, false, false) == Policy::Traversal::Tile);
+        CHECK(state.subtilesPrefetched);
+        CHECK(Policy::subdivide(state, false, true, true, true) == Policy::Traversal::TileKeepSubtiles);
+        CHECK_FALSE(state.needsUnloadSubtiles);
+
+        // ...and go when it turns away
+        CHECK(Policy::subdivide(state, false, false, true, true) == Policy::Traversal::Tile);
+        CHECK(state.needsUnloadSubtiles);
+    }
+
+    SECTION("Requests")
+    {
+        Policy::Subdivision state;
+        state.needsSubtiles = true;
+
+        // data loads only under a parent with data, and subtiles only under a tile with data
+        auto r = Policy::requests(Policy::Data::None, state, Policy::Data::Loading);
+        CHECK_FALSE(r.loadData);
+        CHECK_FALSE(r.loadSubtiles);
+
+        r = Policy::requests(Policy::Data::None, state, Policy::Data::Merged);
+        CHECK(r.loadData);
+        CHECK_FALSE(r.loadSubtiles);
+
+        r = Policy::requests(Policy::Data::Loaded, state, Policy::Data::Merged);
+        CHECK(r.mergeData);
+
+        r = Policy::requests(Policy::Data::Merged, state, Policy::Data::Merged);
+        CHECK(r.loadSubtiles);
+        CHECK_FALSE(r.loadData);
+        CHECK_FALSE(r.mergeData);
+    }
+
+    SECTION("Expiry")
+    {
+        TerrainSettings settings("{}");
+        settings.minResidentTilesBeforeUnload = 0u;
+        settings.minFramesBeforeUnload = 10u;
+        settings.minSecondsBeforeUnload = 0.0f;
+        settings.minRangeBeforeUnload = 0.0f;
+        settings.memoryBudget = 0u;
+
+        Policy::Usage usage;
+        usage.framesUnused = 20u;
+        usage.secondsUnused = 1.0;
+        usage.range = 1e6f;
+        CHECK(Policy::expire(settings, usage, 0u, 100u, 0u) == Policy::Expiry::ExpireWithSiblings);
+
+        // recently used
+        usage.framesUnused = 5u;
+        CHECK(Policy::expire(settings, usage, 0u, 100u, 0u) == Policy::Expiry::Keep);
+
+        // orphans always go; pinned tiles never do
+        usage.orphaned = true;
+        CHECK(Policy::expire(settings, usage, 0u, 100u, 0u) == Policy::Expiry::Expire);
+        usage.doNotExpire = true;
+        CHECK(Policy::expire(settings, usage, 0u, 100u, 0u) == Policy::Expiry::Keep);
+
+        // within a memory budget, unused tiles stay
+        usage = { };
+        usage.framesUnused = 20u;
+        usage.secondsUnused = 1.0;
+        settings.memoryBudget = 1u;
+        CHECK(Policy::expire(settings, usage, 1024u, 100u, 0u) == Policy::Expiry::Keep);
+        CHECK(Policy::expire(settings, usage, 2u * 1024u * 1024u, 100u, 0u) == Policy::Expiry::ExpireWithSiblings);
+    }
+}
+#endif
+
 #ifdef ROCKY_HAS_GDAL
 TEST_CASE("GDAL")
 {
@@ -577,6 +2233,50 @@ TEST_CASE("SRS")
             REQUIRE(xform(glm::dvec3(0, 0, 17.16), out));
             CHECK(equiv(out.z, 17.16, E));
         }
+
+        // the cached geoid grid agrees with PROJ, at the grid's own resolution;
+        // EGM2008's 2.5' grid is too fine to cache and stays with PROJ:
+        for (auto& def : { "epsg:4326+5773", "epsg:4326+5798", "epsg:4326+3855" })
+        {
+            SRS vdatum(def);
+            auto xform = wgs84.to(vdatum);
+            if (!xform.valid())
+                continue; // datum grid not installed
+
+            auto geoid = vdatum.geoid();
+            CHECK(xform.isFastPath() == (geoid != nullptr));
+
+            if (std::string(def) == "epsg:4326+5773")
+            {
+                // EGM96 is a 15' grid
+                REQUIRE(geoid);
+                CHECK(geoid->heightfield->width() == 1441);
+                CHECK(geoid->heightfield->height() == 721);
+            }
+            else if (std::string(def) == "epsg:4326+3855")
+            {
+                CHECK(geoid == nullptr);
+            }
+
+            std::vector<glm::dvec3> fast, proj;
+            for (double lat = -80.0; lat <= 80.0; lat += 7.3)
+                for (double lon = -179.0; lon <= 179.0; lon += 11.7)
+                    fast.emplace_back(lon, lat, 100.0);
+            proj = fast;
+
+            REQUIRE(xform.transformArray(fast.data(), fast.size()));
+            REQUIRE(xform.withoutFastPath().transformArray(proj.data(), proj.size()));
+            for (std::size_t i = 0; i < fast.size(); ++i)
+            {
+                CHECK(equiv(fast[i].x, proj[i].x, 1e-9));
+                CHECK(equiv(fast[i].y, proj[i].y, 1e-9));
+                CHECK(equiv(fast[i].z, proj[i].z, 0.01));
+            }
+
+            REQUIRE(xform.inverseArray(fast.data(), fast.size()));
+            for (auto& p : fast)
+                CHECK(equiv(p.z, 100.0, 1e-6));
+        }
     }
 
     SECTION("SRS Metadata")
@@ -629,6 +2329,172 @@ TEST_CASE("SRS")
         // REQUIRE no crash :)
     }
 
+    SECTION("Shared SRSOperation")
+    {
+        // one operation used from several threads resolves a handle in each
+        auto xform = SRS::WGS84.to(SRS::SPHERICAL_MERCATOR);
+        REQUIRE(xform.valid());
+
+        std::atomic<unsigned> failures = { 0 };
+        auto function = [&]()
+        {
+            glm::dvec3 out;
+            for (unsigned i = 0; i < 1000; ++i)
+                if (!xform(glm::dvec3(-180, 0, 0), out) || !equiv(out, glm::dvec3(-20037508.34278925, 0, 0)))
+                    ++failures;
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < 8; ++i)
+            threads.emplace_back(function);
+
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(failures == 0);
+
+        // a copy made on this thread keeps working
+        auto copy = xform;
+        glm::dvec3 out;
+        CHECK(copy(glm::dvec3(-180, 0, 0), out));
+        CHECK(equiv(out, glm::dvec3(-20037508.34278925, 0, 0)));
+    }
+
+    SECTION("Fast paths")
+    {
+        // closed-form conversions must agree with PROJ
+        std::mt19937 engine(0);
+        std::uniform_real_distribution<> lon(-180.0, 180.0), lat(-85.0, 85.0), hae(-1000.0, 100000.0);
+        std::vector<glm::dvec3> points(1000);
+        for (auto& p : points)
+            p = glm::dvec3(lon(engine), lat(engine), hae(engine));
+
+        auto check = [&](const SRSOperation& xform, double epsilon)
+            {
+                REQUIRE(xform.isFastPath());
+                auto reference = xform.withoutFastPath();
+                REQUIRE(reference.valid());
+                CHECK(reference.isFastPath() == false);
+
+                unsigned failures = 0;
+                for (auto& p : points)
+                {
+                    glm::dvec3 a, b, a_inv, b_inv;
+                    REQUIRE(xform(p, a));
+                    REQUIRE(reference(p, b));
+                    REQUIRE(xform.inverse(a, a_inv));
+                    REQUIRE(reference.inverse(b, b_inv));
+                    if (!equiv(a, b, epsilon) || !equiv(a_inv, b_inv, 1e-5))
+                        ++failures;
+                }
+                CHECK(failures == 0);
+
+                // batched:
+                auto batch = points;
+                REQUIRE(xform.transformArray(batch.data(), batch.size()));
+                glm::dvec3 b;
+                reference(points[7], b);
+                CHECK(equiv(batch[7], b, epsilon));
+            };
+
+        check(SRS::WGS84.to(SRS::ECEF), 1e-3);
+        check(SRS::WGS84.to(SRS::SPHERICAL_MERCATOR), 1e-3);
+
+        // the reverse direction is recognized too
+        CHECK(SRS::ECEF.to(SRS::WGS84).isFastPath());
+        CHECK(SRS::SPHERICAL_MERCATOR.to(SRS::WGS84).isFastPath());
+
+        // a 2D geographic SRS has no height, so doesn't qualify for ECEF
+        CHECK(SRS("epsg:4326").to(SRS::ECEF).isFastPath() == false);
+        CHECK(SRS("epsg:32632").to(SRS::WGS84).isFastPath() == false);
+    }
+
+    SECTION("SRS Interning")
+    {
+        SRS a("wgs84"), b("wgs84");
+        CHECK(a.id() == b.id());
+        CHECK(a.id() != 0);
+
+        // different definitions of the same SRS are equivalent:
+        SRS c("epsg:4979");
+        CHECK(c.id() != a.id());
+        CHECK(c.equivalenceId() == a.equivalenceId());
+        CHECK(c == a);
+        CHECK(a.isHorizEquivalentTo(c));
+        CHECK_FALSE(a.isHorizEquivalentTo(SRS::SPHERICAL_MERCATOR));
+
+        SRS d(SRS::SPHERICAL_MERCATOR.wkt());
+        CHECK(d.equivalenceId() == SRS::SPHERICAL_MERCATOR.equivalenceId());
+        CHECK(d != a);
+
+        CHECK(SRS().id() == 0);
+        CHECK(SRS().equivalenceId() == 0);
+        CHECK(SRS("unknown").valid() == false);
+        CHECK(SRS("unknown") != SRS("unknown"));
+
+        // derived SRS's are cached and stable:
+        CHECK(SRS::SPHERICAL_MERCATOR.geoSRS().id() == SRS::SPHERICAL_MERCATOR.geoSRS().id());
+        CHECK(SRS::WGS84.geocentricSRS().isGeocentric());
+        CHECK(SRS::ECEF.geoSRS().isGeodetic());
+    }
+
+    SECTION("Batch transforms")
+    {
+        SRS target("epsg:3395"); // world mercator, so everything goes through PROJ
+
+        // mixed source SRS's, plus an invalid extent:
+        std::vector<GeoExtent> extents;
+        for (int i = 0; i < 16; ++i)
+            extents.emplace_back(SRS::WGS84, -170.0 + 20.0 * i, -60.0 + 5.0 * i, -160.0 + 20.0 * i, -50.0 + 5.0 * i);
+        extents.emplace_back(SRS::SPHERICAL_MERCATOR, -1e6, -1e6, 1e6, 1e6);
+        extents.emplace_back(target, -2e6, 1e6, 2e6, 3e6);
+        extents.emplace_back();
+
+        std::vector<GeoExtent> batch(extents.size());
+        auto numValid = GeoExtent::transformArray(extents.data(), extents.size(), target, batch.data());
+        CHECK(numValid == extents.size() - 1);
+        for (std::size_t i = 0; i < extents.size(); ++i)
+            CHECK(batch[i] == extents[i].transform(target));
+
+        // in place:
+        GeoExtent::transformArray(extents.data(), extents.size(), target, extents.data());
+        CHECK(extents == batch);
+
+        // profile clamping, including out-of-bounds and whole-earth inputs:
+        Profile SM("spherical-mercator");
+        std::vector<GeoExtent> geo = {
+            GeoExtent(SRS::WGS84, -180, -90, 180, 90),
+            GeoExtent(SRS::WGS84, 10, 80, 20, 90),
+            GeoExtent(SRS::WGS84, -10, -10, 10, 10),
+            GeoExtent(SRS("epsg:32633"), 400000, 5000000, 500000, 5100000) };
+        auto clamped = SM.clampAndTransformExtents(geo);
+        REQUIRE(clamped.size() == geo.size());
+        for (std::size_t i = 0; i < geo.size(); ++i)
+            CHECK(clamped[i] == SM.clampAndTransformExtent(geo[i]));
+
+        // points and circles:
+        std::vector<GeoPoint> points = {
+            GeoPoint(SRS::WGS84, -74.0, 40.7, 10.0),
+            GeoPoint(SRS::SPHERICAL_MERCATOR, 1e6, 2e6, 0.0),
+            GeoPoint(SRS::WGS84, 139.7, 35.7, 100.0),
+            GeoPoint() };
+        auto expected = points;
+        CHECK(GeoPoint::transformArray(points.data(), points.size(), SRS::ECEF) == 3);
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            GeoPoint p;
+            REQUIRE(expected[i].transform(SRS::ECEF, p));
+            CHECK(points[i].srs == SRS::ECEF);
+            CHECK(glm::distance(glm::dvec3(points[i].x, points[i].y, points[i].z), glm::dvec3(p.x, p.y, p.z)) < 1e-6);
+        }
+        CHECK(points[3].valid() == false);
+
+        std::vector<GeoCircle> circles = { GeoCircle(expected[0], 1000.0), GeoCircle(expected[1], 2000.0) };
+        CHECK(GeoCircle::transformArray(circles.data(), circles.size(), SRS::ECEF) == 2);
+        CHECK(circles[0].center() == points[0]);
+        CHECK(circles[1].radius() == 2000.0);
+    }
+
     SECTION("Well-known Profiles")
     {
         Profile GG("global-geodetic");
@@ -678,6 +2544,302 @@ TEST_CASE("SRS")
     }
 }
 
+TEST_CASE("SRS benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    const unsigned iterations = 10000000;
+    SRS a("wgs84"), b("epsg:4979"), c = SRS::SPHERICAL_MERCATOR;
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned matches = 0;
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        if (a.isHorizEquivalentTo((i & 1) ? b : c))
+            ++matches;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "isHorizEquivalentTo: " << 1e9 * elapsed.count() / (double)iterations << " ns per call" << std::endl;
+    CHECK(matches == iterations / 2);
+
+    std::vector<SRS> copies(1024);
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        copies[i & 1023] = (i & 1) ? a : c;
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "SRS copy: " << 1e9 * elapsed.count() / (double)iterations << " ns per copy" << std::endl;
+}
+
+TEST_CASE("SRS transform benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    const std::size_t count = 10000000;
+    auto xform = SRS::WGS84.to(SRS::SPHERICAL_MERCATOR);
+    REQUIRE(xform.valid());
+
+    std::vector<glm::dvec3> points(count);
+    for (std::size_t i = 0; i < count; ++i)
+        points[i] = glm::dvec3(-180.0 + 360.0 * (double)i / (double)count, 45.0, 0.0);
+
+    glm::dvec3 out;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& p : points)
+        xform.transform(p, out);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "One at a time: " << (double)count / elapsed.count() << " points/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    xform.transformArray(points.data(), points.size());
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Bulk: " << (double)count / elapsed.count() << " points/s" << std::endl;
+}
+
+TEST_CASE("SRS fast path benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    const std::size_t count = 1000000;
+    std::vector<glm::dvec3> points(count);
+    for (std::size_t i = 0; i < count; ++i)
+        points[i] = glm::dvec3(-180.0 + 360.0 * (double)i / (double)count, 45.0, 100.0);
+
+    for (auto& target : { SRS::ECEF, SRS::SPHERICAL_MERCATOR })
+    {
+        auto fast = SRS::WGS84.to(target);
+        REQUIRE(fast.isFastPath());
+
+        for (auto& xform : { fast.withoutFastPath(), fast })
+        {
+            std::string label = std::string(target.name()) + (xform.isFastPath() ? " (closed form)" : " (PROJ)");
+
+            glm::dvec3 out;
+            auto start = std::chrono::steady_clock::now();
+            for (auto& p : points)
+                xform.transform(p, out);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << label << ", one at a time: " << (double)count / elapsed.count() << " points/s" << std::endl;
+
+            auto batch = points;
+            start = std::chrono::steady_clock::now();
+            xform.transformArray(batch.data(), batch.size());
+            elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << label << ", bulk: " << (double)count / elapsed.count() << " points/s" << std::endl;
+        }
+    }
+}
+
+TEST_CASE("SRS vertical datum benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    SRS egm96("epsg:4326+5773");
+    auto xform = SRS::WGS84.to(egm96);
+    REQUIRE(xform.valid());
+
+    // one 256x256 elevation tile
+    const unsigned size = 256;
+    std::vector<glm::dvec3> tile(size * size);
+    for (unsigned r = 0; r < size; ++r)
+        for (unsigned c = 0; c < size; ++c)
+            tile[r * size + c] = glm::dvec3(10.0 + 0.01 * c, 45.0 + 0.01 * r, 100.0);
+
+    const int iterations = 50;
+    for (auto& op : { xform.withoutFastPath(), xform })
+    {
+        auto batch = tile;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            op.transformArray(batch.data(), batch.size());
+            op.inverseArray(batch.data(), batch.size());
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << (op.isFastPath() ? "Geoid grid" : "PROJ") << ": "
+            << 1000.0 * elapsed.count() / (2.0 * iterations) << " ms per 256x256 tile" << std::endl;
+    }
+}
+
+TEST_CASE("SRS cold start benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    // Each job transforms one 17x17 tile's worth of points with an operation
+    // no thread has used yet.
+    auto pool = jobs::get_pool("test.srs");
+    pool->set_concurrency(32);
+
+    auto run = [&](const SRS& srs)
+        {
+            auto group = jobs::jobgroup::create();
+            jobs::context context{ "srs cold start", pool, {}, group };
+
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < 32; ++i)
+            {
+                jobs::dispatch([srs]()
+                    {
+                        std::vector<glm::dvec3> points;
+                        for (unsigned r = 0; r < 17; ++r)
+                            for (unsigned c = 0; c < 17; ++c)
+                                points.emplace_back(400000.0 + 1000.0 * c, 5000000.0 + 1000.0 * r, 0.0);
+                        srs.to(SRS::WGS84).transformArray(points.data(), points.size());
+                    }, context);
+            }
+            group->join();
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            return 1000.0 * elapsed.count();
+        };
+
+    std::cout << "Cold: " << run(SRS("epsg:32633")) << " ms for 32 tiles" << std::endl;
+
+    SRS warm("epsg:32634");
+    SRS::warmUp({ warm, SRS::WGS84 });
+    std::cout << "Warmed up: " << run(warm) << " ms for 32 tiles" << std::endl;
+}
+
+TEST_CASE("GeoExtent")
+{
+    // the normalized bounds are usable at compile time
+    constexpr GeoExtent::Normalized a(170.0, 180.0, -180.0, -170.0, -10.0, 10.0);
+    constexpr GeoExtent::Normalized b(-175.0, -5.0, -165.0, 5.0);
+    constexpr GeoExtent::Normalized c(0.0, -5.0, 10.0, 5.0);
+    static_assert(a.intersects(b) && !a.intersects(c), "Normalized::intersects");
+    static_assert(a.contains(175.0, 0.0) && a.contains(-175.0, 0.0) && !a.contains(0.0, 0.0), "Normalized::contains");
+    static_assert(!a.contains(b) && a.contains(GeoExtent::Normalized(-178.0, -1.0, -172.0, 1.0)), "Normalized::contains");
+    static_assert(!GeoExtent::Normalized().intersects(a) && !a.contains(GeoExtent::Normalized()), "empty Normalized");
+
+    SECTION("Geographic lattice")
+    {
+        // Every pairing of extents on a lattice that includes antimeridian crossings,
+        // global spans and the poles, compared against a one-degree cell reference.
+        struct Cells
+        {
+            std::bitset<360> x;
+            std::bitset<180> y;
+        };
+
+        std::vector<GeoExtent> extents;
+        std::vector<Cells> cells;
+
+        for (int west = -180; west < 180; west += 15)
+        {
+            for (int width : { 1, 15, 45, 90, 170, 190, 345, 360 })
+            {
+                for (auto [south, height] : { std::pair{ -90, 180 }, std::pair{ -90, 15 }, std::pair{ -10, 20 }, std::pair{ 75, 15 } })
+                {
+                    extents.emplace_back(SRS::WGS84, west, south, west + width, south + height);
+
+                    Cells cell;
+                    for (int i = 0; i < width; ++i)
+                        cell.x.set(((west + 180 + i) % 360 + 360) % 360);
+                    for (int j = 0; j < height; ++j)
+                        cell.y.set(south + 90 + j);
+                    cells.push_back(cell);
+                }
+            }
+        }
+
+        std::size_t intersectMismatches = 0, containMismatches = 0;
+        for (std::size_t i = 0; i < extents.size(); ++i)
+        {
+            for (std::size_t j = 0; j < extents.size(); ++j)
+            {
+                bool intersects = (cells[i].x & cells[j].x).any() && (cells[i].y & cells[j].y).any();
+                bool contains = (cells[j].x & ~cells[i].x).none() && (cells[j].y & ~cells[i].y).none();
+
+                if (extents[i].intersects(extents[j]) != intersects)
+                    ++intersectMismatches;
+                if (extents[i].contains(extents[j]) != contains)
+                    ++containMismatches;
+            }
+        }
+        CHECK(intersectMismatches == 0);
+        CHECK(containMismatches == 0);
+    }
+
+    SECTION("Antimeridian")
+    {
+        GeoExtent ex(SRS::WGS84, 170.0, -10.0, -170.0, 10.0);
+        CHECK(ex.crossesAntimeridian());
+        CHECK(ex.width() == 20.0);
+        CHECK(ex.contains(175.0, 0.0));
+        CHECK(ex.contains(-175.0, 0.0));
+        CHECK(ex.contains(180.0, 10.0));
+        CHECK(ex.contains(-180.0, -10.0));
+        CHECK(ex.contains(185.0, 0.0));
+        CHECK(!ex.contains(0.0, 0.0));
+        CHECK(!ex.contains(175.0, 11.0));
+        CHECK(ex.intersects(GeoExtent(SRS::WGS84, -175.0, -5.0, -165.0, 5.0)));
+        CHECK(!ex.intersects(GeoExtent(SRS::WGS84, -170.0, -5.0, -160.0, 5.0)));
+
+        // transforming it must not wrap it around the world the other way
+        auto out = ex.transform(SRS("epsg:4326"));
+        REQUIRE(out.valid());
+        CHECK(out.crossesAntimeridian());
+        CHECK(equiv(out.width(), 20.0));
+        CHECK(equiv(out.west(), 170.0));
+    }
+}
+
+TEST_CASE("GeoExtent benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    const std::size_t count = 4096;
+    std::vector<GeoExtent> extents(count);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0), lat(-90.0, 80.0), size(0.5, 30.0);
+    for (auto& ex : extents)
+    {
+        double x = lon(gen), y = lat(gen);
+        ex = GeoExtent(SRS::WGS84, x, y, x + size(gen), std::min(90.0, y + size(gen)));
+    }
+
+    std::size_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; ++i)
+        for (std::size_t j = 0; j < count; ++j)
+            hits += extents[i].intersects(extents[j]) ? 1 : 0;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "intersects: " << (double)(count * count) / elapsed.count() << " tests/s (" << hits << " hits)" << std::endl;
+
+    hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; ++i)
+        for (std::size_t j = 0; j < count; ++j)
+            hits += extents[i].contains(extents[j]) ? 1 : 0;
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "contains: " << (double)(count * count) / elapsed.count() << " tests/s (" << hits << " hits)" << std::endl;
+}
+
+TEST_CASE("GeoExtent transform benchmark", "[.][benchmark]")
+{
+    // Run with: rtests "[benchmark]"
+    const std::size_t count = 100000;
+    std::vector<GeoExtent> extents(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        double lon = -179.0 + 358.0 * (double)(i % 1000) / 1000.0;
+        double lat = -80.0 + 160.0 * (double)(i / 1000) / (double)(count / 1000);
+        extents[i] = GeoExtent(SRS::WGS84, lon, lat, lon + 0.25, lat + 0.25);
+    }
+
+    for (auto& target : { SRS::SPHERICAL_MERCATOR, SRS("epsg:3395") })
+    {
+        std::vector<GeoExtent> output(count);
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i)
+            output[i] = extents[i].transform(target);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << target.name() << ", one at a time: " << (double)count / elapsed.count() << " extents/s" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        auto numValid = GeoExtent::transformArray(extents.data(), count, target, output.data());
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << target.name() << ", batched: " << (double)count / elapsed.count() << " extents/s" << std::endl;
+        CHECK(numValid == count);
+    }
+}
+
 TEST_CASE("IO")
 {
     SECTION("HTTP")